@@ -120,6 +120,24 @@ typedef unsigned int *BITMAP_PTR_TYPE;
 #define BITMAP_CLEAR_P(BMAP, SZ, BIT)				\
   (!BMAP_SET_P((BMAP), (SZ), (BIT)))
 
+/* return the bit number of the least significant set bit in bitmap entry
+   ENT, ENT must be non-zero */
+#if defined(__GNUC__) && (__GNUC__ >= 4)
+#define BITMAP_ENT_FIRST_ONE(ENT)	__builtin_ctz(ENT)
+#else /* !__GNUC__ */
+#define BITMAP_ENT_FIRST_ONE(ENT)				\
+({								\
+  BITMAP_ENT_TYPE __ent = (ENT);				\
+  int __n = 0;							\
+  while (!(__ent & 1))						\
+    {								\
+      __ent >>= 1;						\
+      __n++;							\
+    }								\
+  __n;								\
+})
+#endif /* __GNUC__ */
+
 /* count the number of bits set in BMAP */
 #define BITMAP_COUNT_ONES(BMAP, SZ)				\
 ({								\
@@ -57,6 +57,7 @@
 #include "host.h"
 #include "misc.h"
 #include "machine.h"
+#include "chkpt.h"
 #include "bpred.h"
 
 /* turn this on to enable the SimpleScalar 2.0 RAS bug */
@@ -348,34 +349,36 @@ bpred_stats(struct bpred_t *pred,	/* branch predictor instance */
 	  (double)pred->dir_hits/(double)(pred->dir_hits+pred->misses));
 }
 
-/* register branch predictor stats */
-void
-bpred_reg_stats(struct bpred_t *pred,	/* branch predictor instance */
-		struct stat_sdb_t *sdb)	/* stats database */
+/* return the stats name of branch predictor PRED */
+static char *
+bpred_name(struct bpred_t *pred)	/* branch predictor instance */
 {
-  char buf[512], buf1[512], *name;
-
-  /* get a name for this predictor */
   switch (pred->class)
     {
     case BPredComb:
-      name = "bpred_comb";
-      break;
+      return "bpred_comb";
     case BPred2Level:
-      name = "bpred_2lev";
-      break;
+      return "bpred_2lev";
     case BPred2bit:
-      name = "bpred_bimod";
-      break;
+      return "bpred_bimod";
     case BPredTaken:
-      name = "bpred_taken";
-      break;
+      return "bpred_taken";
     case BPredNotTaken:
-      name = "bpred_nottaken";
-      break;
+      return "bpred_nottaken";
     default:
       panic("bogus branch predictor class");
     }
+}
+
+/* register branch predictor stats */
+void
+bpred_reg_stats(struct bpred_t *pred,	/* branch predictor instance */
+		struct stat_sdb_t *sdb)	/* stats database */
+{
+  char buf[512], buf1[512], *name;
+
+  /* get a name for this predictor */
+  name = bpred_name(pred);
 
   sprintf(buf, "%s.lookups", name);
   stat_reg_counter(sdb, buf, "total number of bpred lookups",
@@ -463,6 +466,29 @@ bpred_reg_stats(struct bpred_t *pred,	/* branch predictor instance */
 		   buf1, "%9.4f");
 }
 
+/* register branch predictor functional warming stats */
+void
+bpred_reg_warm_stats(struct bpred_t *pred,	/* branch predictor instance */
+		     struct stat_sdb_t *sdb)	/* stats database */
+{
+  char buf[512], buf1[512], *name;
+
+  /* get a name for this predictor */
+  name = bpred_name(pred);
+
+  sprintf(buf, "%s.warm_lookups", name);
+  stat_reg_counter(sdb, buf, "total number of functional warming lookups",
+		   &pred->warm_lookups, 0, NULL);
+  sprintf(buf, "%s.warm_misses", name);
+  stat_reg_counter(sdb, buf, "total number of functional warming misses",
+		   &pred->warm_misses, 0, NULL);
+  sprintf(buf, "%s.warm_addr_rate", name);
+  sprintf(buf1, "1 - %s.warm_misses / %s.warm_lookups", name, name);
+  stat_reg_formula(sdb, buf,
+		   "functional warming address-prediction rate", buf1,
+		   "%9.4f");
+}
+
 void
 bpred_after_priming(struct bpred_t *bpred)
 {
@@ -571,7 +597,8 @@ bpred_lookup(struct bpred_t *pred,	/* branch predictor instance */
   if (!(MD_OP_FLAGS(op) & F_CTRL))
     return 0;
 
-  pred->lookups++;
+  if (!pred->warming)
+    pred->lookups++;
 
   dir_update_ptr->dir.ras = FALSE;
   dir_update_ptr->pdir1 = NULL;
@@ -650,7 +677,8 @@ bpred_lookup(struct bpred_t *pred,	/* branch predictor instance */
       md_addr_t target = pred->retstack.stack[pred->retstack.tos].target;
       pred->retstack.tos = (pred->retstack.tos + pred->retstack.size - 1)
 	                   % pred->retstack.size;
-      pred->retstack_pops++;
+      if (!pred->warming)
+	pred->retstack_pops++;
       dir_update_ptr->dir.ras = TRUE; /* using RAS here */
       return target;
     }
@@ -662,7 +690,8 @@ bpred_lookup(struct bpred_t *pred,	/* branch predictor instance */
       pred->retstack.tos = (pred->retstack.tos + 1)% pred->retstack.size;
       pred->retstack.stack[pred->retstack.tos].target = 
 	baddr + sizeof(md_inst_t);
-      pred->retstack_pushes++;
+      if (!pred->warming)
+	pred->retstack_pushes++;
     }
 #endif /* !RAS_BUG_COMPATIBLE */
   
@@ -761,49 +790,55 @@ bpred_update(struct bpred_t *pred,	/* branch predictor instance */
 
   /* Have a branch here */
 
-  if (correct)
-    pred->addr_hits++;
-
-  if (!!pred_taken == !!taken)
-    pred->dir_hits++;
-  else
-    pred->misses++;
-
-  if (dir_update_ptr->dir.ras)
+  /* the stats are left alone while functionally warming, see bpred_warm() */
+  if (!pred->warming)
     {
-      pred->used_ras++;
       if (correct)
-	pred->ras_hits++;
-    }
-  else if ((MD_OP_FLAGS(op) & (F_CTRL|F_COND)) == (F_CTRL|F_COND))
-    {
-      if (dir_update_ptr->dir.meta)
-	pred->used_2lev++;
+	pred->addr_hits++;
+
+      if (!!pred_taken == !!taken)
+	pred->dir_hits++;
       else
-	pred->used_bimod++;
-    }
+	pred->misses++;
 
-  /* keep stats about JR's; also, but don't change any bpred state for JR's
-   * which are returns unless there's no retstack */
-  if (MD_IS_INDIR(op))
-    {
-      pred->jr_seen++;
-      if (correct)
-	pred->jr_hits++;
-      
-      if (!dir_update_ptr->dir.ras)
+      if (dir_update_ptr->dir.ras)
 	{
-	  pred->jr_non_ras_seen++;
+	  pred->used_ras++;
 	  if (correct)
-	    pred->jr_non_ras_hits++;
+	    pred->ras_hits++;
 	}
-      else
+      else if ((MD_OP_FLAGS(op) & (F_CTRL|F_COND)) == (F_CTRL|F_COND))
+	{
+	  if (dir_update_ptr->dir.meta)
+	    pred->used_2lev++;
+	  else
+	    pred->used_bimod++;
+	}
+
+      /* keep stats about JR's */
+      if (MD_IS_INDIR(op))
 	{
-	  /* return that used the ret-addr stack; no further work to do */
-	  return;
+	  pred->jr_seen++;
+	  if (correct)
+	    pred->jr_hits++;
+
+	  if (!dir_update_ptr->dir.ras)
+	    {
+	      pred->jr_non_ras_seen++;
+	      if (correct)
+		pred->jr_non_ras_hits++;
+	    }
 	}
     }
 
+  /* don't change any bpred state for JR's which are returns unless there's
+   * no retstack */
+  if (MD_IS_INDIR(op) && dir_update_ptr->dir.ras)
+    {
+      /* return that used the ret-addr stack; no further work to do */
+      return;
+    }
+
   /* Can exit now if this is a stateless predictor */
   if (pred->class == BPredNotTaken || pred->class == BPredTaken)
     return;
@@ -820,7 +855,8 @@ bpred_update(struct bpred_t *pred,	/* branch predictor instance */
       pred->retstack.tos = (pred->retstack.tos + 1)% pred->retstack.size;
       pred->retstack.stack[pred->retstack.tos].target = 
 	baddr + sizeof(md_inst_t);
-      pred->retstack_pushes++;
+      if (!pred->warming)
+	pred->retstack_pushes++;
     }
 #endif /* RAS_BUG_COMPATIBLE */
 
@@ -983,3 +1019,217 @@ bpred_update(struct bpred_t *pred,	/* branch predictor instance */
 	}
     }
 }
+
+/* functionally warm predictor PRED with the branch at BADDR, i.e., probe
+   the predictor and update it with the actual outcome of the branch, its
+   next instruction address NPC, as a non-speculative bpred_lookup() and
+   bpred_update() pair would, BTARGET, OP, IS_CALL and IS_RETURN are as for
+   bpred_lookup(), the prediction is charged to the warming stats only */
+void
+bpred_warm(struct bpred_t *pred,	/* branch predictor instance */
+	   md_addr_t baddr,		/* branch address */
+	   md_addr_t btarget,		/* branch target if taken */
+	   md_addr_t npc,		/* actual next instruction address */
+	   enum md_opcode op,		/* opcode of instruction */
+	   int is_call,			/* non-zero if inst is fn call */
+	   int is_return)		/* non-zero if inst is fn return */
+{
+  struct bpred_update_t update_rec;
+  int stack_recover_idx;
+  md_addr_t pred_PC;
+
+  /* probe and update the predictor without touching its timing stats */
+  pred->warming = TRUE;
+  pred_PC = bpred_lookup(pred, baddr, btarget, op, is_call, is_return,
+			 &update_rec, &stack_recover_idx);
+  if (!pred_PC)
+    {
+      /* no predicted taken target, predict not taken */
+      pred_PC = baddr + sizeof(md_inst_t);
+    }
+
+  bpred_update(pred, baddr, npc,
+	       /* taken? */npc != (baddr + sizeof(md_inst_t)),
+	       /* pred taken? */pred_PC != (baddr + sizeof(md_inst_t)),
+	       /* correct pred? */pred_PC == npc,
+	       op, &update_rec);
+  pred->warming = FALSE;
+
+  /* charge the prediction to the warming stats, not the timing stats */
+  pred->warm_lookups++;
+  if (pred_PC != npc)
+    pred->warm_misses++;
+}
+
+/* write the tables of branch direction predictor PRED_DIR to checkpoint
+   stream FD */
+static void
+bpred_dir_chkpt_write(struct bpred_dir_t *pred_dir,	/* dir predictor */
+		      FILE *fd)				/* checkpoint stream */
+{
+  CHKPT_WRITE_VAR(fd, pred_dir->class);
+  switch (pred_dir->class)
+    {
+    case BPred2Level:
+      CHKPT_WRITE_VAR(fd, pred_dir->config.two.l1size);
+      CHKPT_WRITE_VAR(fd, pred_dir->config.two.l2size);
+      chkpt_write(fd, pred_dir->config.two.shiftregs,
+		  pred_dir->config.two.l1size * sizeof(int));
+      chkpt_write(fd, pred_dir->config.two.l2table,
+		  pred_dir->config.two.l2size * sizeof(unsigned char));
+      break;
+    case BPred2bit:
+      CHKPT_WRITE_VAR(fd, pred_dir->config.bimod.size);
+      chkpt_write(fd, pred_dir->config.bimod.table,
+		  pred_dir->config.bimod.size * sizeof(unsigned char));
+      break;
+    default:
+      /* no other state */
+      break;
+    }
+}
+
+/* restore the tables of branch direction predictor PRED_DIR from
+   checkpoint stream FD */
+static void
+bpred_dir_chkpt_read(struct bpred_dir_t *pred_dir,	/* dir predictor */
+		     FILE *fd)				/* checkpoint stream */
+{
+  enum bpred_class class;
+  int l1size, l2size;
+  unsigned int size;
+
+  CHKPT_READ_VAR(fd, class);
+  if (class != pred_dir->class)
+    fatal("checkpointed branch predictor has a different configuration");
+  switch (pred_dir->class)
+    {
+    case BPred2Level:
+      CHKPT_READ_VAR(fd, l1size);
+      CHKPT_READ_VAR(fd, l2size);
+      if (l1size != pred_dir->config.two.l1size
+	  || l2size != pred_dir->config.two.l2size)
+	fatal("checkpointed branch predictor has a different configuration");
+      chkpt_read(fd, pred_dir->config.two.shiftregs,
+		 pred_dir->config.two.l1size * sizeof(int));
+      chkpt_read(fd, pred_dir->config.two.l2table,
+		 pred_dir->config.two.l2size * sizeof(unsigned char));
+      break;
+    case BPred2bit:
+      CHKPT_READ_VAR(fd, size);
+      if (size != pred_dir->config.bimod.size)
+	fatal("checkpointed branch predictor has a different configuration");
+      chkpt_read(fd, pred_dir->config.bimod.table,
+		 pred_dir->config.bimod.size * sizeof(unsigned char));
+      break;
+    default:
+      /* no other state */
+      break;
+    }
+}
+
+/* BTB entry ENT as an index into the BTB of PRED, -1 if ENT is NULL */
+#define BTB_ENT_INDEX(PRED, ENT)					\
+  ((ENT) ? (int)((ENT) - (PRED)->btb.btb_data) : -1)
+
+/* write the state of branch predictor PRED, i.e., its direction predictor
+   tables, BTB (including replacement order) and return address stack, to
+   checkpoint stream FD */
+void
+bpred_chkpt_write(struct bpred_t *pred,	/* branch predictor instance */
+		  FILE *fd)		/* checkpoint stream */
+{
+  int i, prev, next;
+  struct bpred_btb_ent_t *ent;
+
+  chkpt_write_tag(fd, "bpred");
+  CHKPT_WRITE_VAR(fd, pred->class);
+
+  /* direction predictors */
+  if (pred->dirpred.bimod)
+    bpred_dir_chkpt_write(pred->dirpred.bimod, fd);
+  if (pred->dirpred.twolev)
+    bpred_dir_chkpt_write(pred->dirpred.twolev, fd);
+  if (pred->dirpred.meta)
+    bpred_dir_chkpt_write(pred->dirpred.meta, fd);
+
+  /* BTB, with LRU chains as entry indices */
+  CHKPT_WRITE_VAR(fd, pred->btb.sets);
+  CHKPT_WRITE_VAR(fd, pred->btb.assoc);
+  for (i=0; pred->btb.btb_data && i < pred->btb.sets * pred->btb.assoc; i++)
+    {
+      ent = &pred->btb.btb_data[i];
+      CHKPT_WRITE_VAR(fd, ent->addr);
+      CHKPT_WRITE_VAR(fd, ent->op);
+      CHKPT_WRITE_VAR(fd, ent->target);
+      prev = BTB_ENT_INDEX(pred, ent->prev);
+      next = BTB_ENT_INDEX(pred, ent->next);
+      CHKPT_WRITE_VAR(fd, prev);
+      CHKPT_WRITE_VAR(fd, next);
+    }
+
+  /* return address stack */
+  CHKPT_WRITE_VAR(fd, pred->retstack.size);
+  CHKPT_WRITE_VAR(fd, pred->retstack.tos);
+  for (i=0; i < pred->retstack.size; i++)
+    {
+      ent = &pred->retstack.stack[i];
+      CHKPT_WRITE_VAR(fd, ent->addr);
+      CHKPT_WRITE_VAR(fd, ent->target);
+    }
+}
+
+/* restore the state of branch predictor PRED from checkpoint stream FD, the
+   predictor stats are unchanged */
+void
+bpred_chkpt_read(struct bpred_t *pred,	/* branch predictor instance */
+		 FILE *fd)		/* checkpoint stream */
+{
+  int i, prev, next, sets, assoc, size;
+  enum bpred_class class;
+  struct bpred_btb_ent_t *ent;
+
+  chkpt_read_tag(fd, "bpred");
+  CHKPT_READ_VAR(fd, class);
+  if (class != pred->class)
+    fatal("checkpointed branch predictor has a different configuration");
+
+  /* direction predictors */
+  if (pred->dirpred.bimod)
+    bpred_dir_chkpt_read(pred->dirpred.bimod, fd);
+  if (pred->dirpred.twolev)
+    bpred_dir_chkpt_read(pred->dirpred.twolev, fd);
+  if (pred->dirpred.meta)
+    bpred_dir_chkpt_read(pred->dirpred.meta, fd);
+
+  /* BTB */
+  CHKPT_READ_VAR(fd, sets);
+  CHKPT_READ_VAR(fd, assoc);
+  if (sets != pred->btb.sets || assoc != pred->btb.assoc)
+    fatal("checkpointed branch predictor has a different configuration");
+  for (i=0; pred->btb.btb_data && i < pred->btb.sets * pred->btb.assoc; i++)
+    {
+      ent = &pred->btb.btb_data[i];
+      CHKPT_READ_VAR(fd, ent->addr);
+      CHKPT_READ_VAR(fd, ent->op);
+      CHKPT_READ_VAR(fd, ent->target);
+      CHKPT_READ_VAR(fd, prev);
+      CHKPT_READ_VAR(fd, next);
+      if (prev >= sets * assoc || next >= sets * assoc)
+	fatal("checkpointed BTB is corrupt");
+      ent->prev = (prev >= 0) ? &pred->btb.btb_data[prev] : NULL;
+      ent->next = (next >= 0) ? &pred->btb.btb_data[next] : NULL;
+    }
+
+  /* return address stack */
+  CHKPT_READ_VAR(fd, size);
+  if (size != pred->retstack.size)
+    fatal("checkpointed branch predictor has a different configuration");
+  CHKPT_READ_VAR(fd, pred->retstack.tos);
+  for (i=0; i < pred->retstack.size; i++)
+    {
+      ent = &pred->retstack.stack[i];
+      CHKPT_READ_VAR(fd, ent->addr);
+      CHKPT_READ_VAR(fd, ent->target);
+    }
+}
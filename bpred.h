@@ -171,6 +171,14 @@ struct bpred_t {
   counter_t retstack_pops;	/* number of times a value was popped */
   counter_t retstack_pushes;	/* number of times a value was pushed */
   counter_t ras_hits;		/* num correct return-address predictions */
+
+  int warming;			/* non-zero while functionally warming, the
+				   stats above are then left alone, see
+				   bpred_warm() */
+
+  /* functional warming stats, see bpred_warm() */
+  counter_t warm_lookups;	/* num warming lookups */
+  counter_t warm_misses;	/* num incorrect warming predictions */
 };
 
 /* branch predictor update information */
@@ -223,6 +231,11 @@ void
 bpred_reg_stats(struct bpred_t *pred,	/* branch predictor instance */
 		struct stat_sdb_t *sdb);/* stats database */
 
+/* register branch predictor functional warming stats */
+void
+bpred_reg_warm_stats(struct bpred_t *pred,	/* branch predictor instance */
+		     struct stat_sdb_t *sdb);	/* stats database */
+
 /* reset stats after priming, if appropriate */
 void bpred_after_priming(struct bpred_t *bpred);
 
@@ -272,6 +285,32 @@ bpred_update(struct bpred_t *pred,	/* branch predictor instance */
 	     enum md_opcode op,		/* opcode of instruction */
 	     struct bpred_update_t *dir_update_ptr); /* pred state pointer */
 
+/* functionally warm predictor PRED with the branch at BADDR, i.e., probe
+   the predictor and update it with the actual outcome of the branch, its
+   next instruction address NPC, as a non-speculative bpred_lookup() and
+   bpred_update() pair would, BTARGET, OP, IS_CALL and IS_RETURN are as for
+   bpred_lookup(), the prediction is charged to the warming stats only */
+void
+bpred_warm(struct bpred_t *pred,	/* branch predictor instance */
+	   md_addr_t baddr,		/* branch address */
+	   md_addr_t btarget,		/* branch target if taken */
+	   md_addr_t npc,		/* actual next instruction address */
+	   enum md_opcode op,		/* opcode of instruction */
+	   int is_call,			/* non-zero if inst is fn call */
+	   int is_return);		/* non-zero if inst is fn return */
+
+/* write the state of branch predictor PRED, i.e., its direction predictor
+   tables, BTB (including replacement order) and return address stack, to
+   checkpoint stream FD */
+void
+bpred_chkpt_write(struct bpred_t *pred,	/* branch predictor instance */
+		  FILE *fd);		/* checkpoint stream */
+
+/* restore the state of branch predictor PRED from checkpoint stream FD, the
+   predictor stats are unchanged */
+void
+bpred_chkpt_read(struct bpred_t *pred,	/* branch predictor instance */
+		 FILE *fd);		/* checkpoint stream */
 
 #ifdef foo0
 /* OBSOLETE */
@@ -51,11 +51,18 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "host.h"
 #include "misc.h"
 #include "machine.h"
+#include "chkpt.h"
 #include "cache.h"
 
 /* cache access macros */
@@ -87,12 +94,6 @@
 #define CACHE_HALF(data, bofs)	  __CACHE_ACCESS(unsigned short, data, bofs)
 #define CACHE_BYTE(data, bofs)	  __CACHE_ACCESS(unsigned char, data, bofs)
 
-/* cache block hashing macros, this macro is used to index into a cache
-   set hash table (to find the correct block on N in an N-way cache), the
-   cache set index function is CACHE_SET, defined above */
-#define CACHE_HASH(cp, key)						\
-  (((key >> 24) ^ (key >> 16) ^ (key >> 8) ^ key) & ((cp)->hsize-1))
-
 /* copy data out of a cache block to buffer indicated by argument pointer p */
 #define CACHE_BCOPY(cmd, blk, bofs, p, nbytes)	\
   if (cmd == Read)							\
@@ -139,121 +140,423 @@
 /* bound sqword_t/dfloat_t to positive int */
 #define BOUND_POS(N)		((int)(MIN(MAX(0, (N)), 2147483647)))
 
-/* unlink BLK from the hash table bucket chain in SET */
-static void
-unlink_htab_ent(struct cache_t *cp,		/* cache to update */
-		struct cache_set_t *set,	/* set containing bkt chain */
-		struct cache_blk_t *blk)	/* block to unlink */
+/* return the way of the valid block with tag TAG in set SET of cache CP, or
+   -1 if the block is not in the set; on SSE2 and AVX2 hosts, the tags of the
+   set are compared 4 or 8 (2 or 4 for 64-bit addresses) at a time, and the
+   ways with a matching tag are checked for a valid block */
+static INLINE int
+cache_find(struct cache_t *cp,			/* cache to search */
+	   struct cache_set_t *set,		/* set to search */
+	   md_addr_t tag)			/* tag of the block */
 {
-  struct cache_blk_t *prev, *ent;
-  int index = CACHE_HASH(cp, blk->tag);
-
-  /* locate the block in the hash table bucket chain */
-  for (prev=NULL,ent=set->hash[index];
-       ent;
-       prev=ent,ent=ent->hash_next)
+  int i = 0;
+#if defined(__SSE2__)
+  int way;
+  unsigned int mask;
+  __m128i key, eq;
+#if defined(__AVX2__)
+  __m256i key8, eq8;
+#endif /* __AVX2__ */
+
+  if (sizeof(md_addr_t) == 4)
     {
-      if (ent == blk)
-	break;
+#if defined(__AVX2__)
+      key8 = _mm256_set1_epi32((int)tag);
+      for (; i + 8 <= cp->assoc; i += 8)
+	{
+	  eq8 = _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i *)
+						      &set->tags[i]), key8);
+	  for (mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq8));
+	       mask != 0;
+	       mask &= mask - 1)
+	    {
+	      way = i + __builtin_ctz(mask);
+	      if (set->status[way] & CACHE_BLK_VALID)
+		return way;
+	    }
+	}
+#endif /* __AVX2__ */
+      key = _mm_set1_epi32((int)tag);
+      for (; i + 4 <= cp->assoc; i += 4)
+	{
+	  eq = _mm_cmpeq_epi32(_mm_loadu_si128((__m128i *)&set->tags[i]), key);
+	  for (mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+	       mask != 0;
+	       mask &= mask - 1)
+	    {
+	      way = i + __builtin_ctz(mask);
+	      if (set->status[way] & CACHE_BLK_VALID)
+		return way;
+	    }
+	}
     }
-  assert(ent);
-
-  /* unlink the block from the hash table bucket chain */
-  if (!prev)
+  else
     {
-      /* head of hash bucket list */
-      set->hash[index] = ent->hash_next;
+      /* 64-bit tags are equal if both of their 32-bit halves are equal */
+      key = _mm_set1_epi64x((long long)tag);
+      for (; i + 2 <= cp->assoc; i += 2)
+	{
+	  eq = _mm_cmpeq_epi32(_mm_loadu_si128((__m128i *)&set->tags[i]), key);
+	  eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2,3,0,1)));
+	  for (mask = _mm_movemask_pd(_mm_castsi128_pd(eq));
+	       mask != 0;
+	       mask &= mask - 1)
+	    {
+	      way = i + __builtin_ctz(mask);
+	      if (set->status[way] & CACHE_BLK_VALID)
+		return way;
+	    }
+	}
     }
-  else
+#endif /* __SSE2__ */
+
+  /* the ways left over, or all of them without SIMD instructions */
+  for (; i < cp->assoc; i++)
     {
-      /* middle or end of hash bucket list */
-      prev->hash_next = ent->hash_next;
+      if (set->tags[i] == tag && (set->status[i] & CACHE_BLK_VALID))
+	return i;
     }
-  ent->hash_next = NULL;
+  return -1;
 }
 
-/* insert BLK onto the head of the hash table bucket chain in SET */
+/* make block WAY of SET the most recently used (or filled) block */
 static void
-link_htab_ent(struct cache_t *cp,		/* cache to update */
-	      struct cache_set_t *set,		/* set containing bkt chain */
-	      struct cache_blk_t *blk)		/* block to insert */
+cache_age_mru(struct cache_t *cp,		/* cache to update */
+	      struct cache_set_t *set,		/* set containing block */
+	      int way)				/* block to move */
 {
-  int index = CACHE_HASH(cp, blk->tag);
+  int i;
+  cache_age_t age = set->ages[way];
 
-  /* insert block onto the head of the bucket chain */
-  blk->hash_next = set->hash[index];
-  set->hash[index] = blk;
+  /* the younger blocks grow one older */
+  for (i=0; i<cp->assoc; i++)
+    set->ages[i] += (set->ages[i] < age);
+  set->ages[way] = 0;
 }
 
-/* where to insert a block onto the ordered way chain */
-enum list_loc_t { Head, Tail };
+/* make block WAY of SET the block replaced next */
+static void
+cache_age_lru(struct cache_t *cp,		/* cache to update */
+	      struct cache_set_t *set,		/* set containing block */
+	      int way)				/* block to move */
+{
+  int i;
+  cache_age_t age = set->ages[way];
+
+  /* the older blocks grow one younger */
+  for (i=0; i<cp->assoc; i++)
+    set->ages[i] -= (set->ages[i] > age);
+  set->ages[way] = cp->assoc - 1;
+}
+
+/* replace the oldest block of SET, i.e., make it the most recently used (or
+   filled) block, returns its way */
+static int
+cache_age_repl(struct cache_t *cp,		/* cache to update */
+	       struct cache_set_t *set)		/* set to replace in */
+{
+  int i, way = 0;
+  cache_age_t mask = cp->assoc - 1;
+
+  /* all blocks grow one older, the oldest wraps around to age 0 */
+  for (i=0; i<cp->assoc; i++)
+    {
+      if (set->ages[i] == mask)
+	way = i;
+      set->ages[i] = (set->ages[i] + 1) & mask;
+    }
+  return way;
+}
 
-/* insert BLK into the order way chain in SET at location WHERE */
+/* place in ORDER the ways of SET from the most recently used (or filled)
+   block to the block replaced next */
 static void
-update_way_list(struct cache_set_t *set,	/* set contained way chain */
-		struct cache_blk_t *blk,	/* block to insert */
-		enum list_loc_t where)		/* insert location */
+cache_set_order(struct cache_t *cp,		/* cache instance */
+		struct cache_set_t *set,	/* set to order */
+		int *order)			/* ways, in replacement order */
+{
+  int i;
+
+  for (i=0; i<cp->assoc; i++)
+    order[set->ages[i]] = i;
+}
+
+/* point the PLRU tree bits of SET on the path from the root to block WAY
+   away from it */
+static void
+cache_plru_touch(struct cache_t *cp,		/* cache to update */
+		 struct cache_set_t *sp,	/* set containing block */
+		 int way)			/* block accessed */
+{
+  int node;
+
+  /* node 1 is the root, nodes ASSOC to 2*ASSOC-1 are the blocks, a left
+     child sets the bit of its parent to 1 (go right) */
+  for (node = way + cp->assoc; node > 1; node >>= 1)
+    sp->rstate[(node >> 1) - 1] = !(node & 1);
+}
+
+/* return the SHiP signature of the block with tag TAG in set SET */
+static unsigned int
+cache_ship_sig(struct cache_t *cp,		/* cache instance */
+	       md_addr_t tag,			/* block tag */
+	       md_addr_t set)			/* block set */
 {
-  /* unlink entry from the way list */
-  if (!blk->way_prev && !blk->way_next)
+  md_addr_t region = CACHE_MK_BADDR(cp, tag, set) >> CACHE_SHIP_REGION_SHIFT;
+
+  return (unsigned int)((region ^ (region >> 14) ^ (region >> 28))
+			& (CACHE_SHCT_SIZE - 1));
+}
+
+/* return the DRRIP set dueling role of set SET, SRRIP or BRRIP for the
+   leader sets of the policies, DRRIP for follower sets */
+static enum cache_policy
+cache_duel_role(struct cache_t *cp,		/* cache instance */
+		md_addr_t set)			/* set index */
+{
+  md_addr_t k = set & (cp->duel_stride - 1);
+
+  return k == 0 ? SRRIP : k == 1 ? BRRIP : DRRIP;
+}
+
+/* select the block of set SET to replace at a miss, LRU and FIFO also make
+   it the youngest block of the set, the other policies update their state
+   when the block is filled, see cache_repl_fill(); the policy stats are
+   left alone if WARM is non-zero, i.e., for functional warming */
+static int
+cache_repl_victim(struct cache_t *cp,		/* cache instance */
+		  md_addr_t set,		/* set of the miss */
+		  int warm)			/* functional warming? */
+{
+  struct cache_set_t *sp = &cp->sets[set];
+  int i, way, node;
+  enum cache_policy role;
+
+  switch (cp->policy) {
+  case LRU:
+  case FIFO:
+    return cache_age_repl(cp, sp);
+  case Random:
+    if (cp->rand_private)
+      return myrand_r(&cp->rand_state) & (cp->assoc - 1);
+    return myrand() & (cp->assoc - 1);
+  case DRRIP:
+    /* a miss in a leader set counts against its policy */
+    role = cache_duel_role(cp, set);
+    if (role == SRRIP)
+      {
+	if (cp->psel < (1 << CACHE_PSEL_BITS) - 1)
+	  cp->psel++;
+	if (!warm)
+	  cp->drrip_srrip_misses++;
+      }
+    else if (role == BRRIP)
+      {
+	if (cp->psel > 0)
+	  cp->psel--;
+	if (!warm)
+	  cp->drrip_brrip_misses++;
+      }
+    break;
+  default:
+    break;
+  }
+
+  /* the other policies fill invalid blocks first */
+  for (way=0; way<cp->assoc; way++)
     {
-      /* only one entry in list (direct-mapped), no action */
-      assert(set->way_head == blk && set->way_tail == blk);
-      /* Head/Tail order already */
-      return;
+      if (!(sp->status[way] & CACHE_BLK_VALID))
+	return way;
     }
-  /* else, more than one element in the list */
-  else if (!blk->way_prev)
+
+  if (cp->policy == PLRU)
     {
-      assert(set->way_head == blk && set->way_tail != blk);
-      if (where == Head)
+      /* follow the tree bits from the root */
+      for (node=1; node < cp->assoc; )
+	node = 2*node + sp->rstate[node-1];
+      return node - cp->assoc;
+    }
+
+  /* RRIP: the first block with a distant RRPV, the set is aged until one
+     block has it */
+  for (;;)
+    {
+      for (way=0; way<cp->assoc; way++)
 	{
-	  /* already there */
-	  return;
+	  if (sp->rstate[way] == CACHE_RRPV_MAX)
+	    goto found;
 	}
-      /* else, move to tail */
-      set->way_head = blk->way_next;
-      blk->way_next->way_prev = NULL;
+      for (i=0; i<cp->assoc; i++)
+	sp->rstate[i]++;
+      if (!warm)
+	cp->rrip_agings++;
     }
-  else if (!blk->way_next)
+
+ found:
+  /* SHiP learns from blocks that go without a hit */
+  if (cp->policy == SHiP)
     {
-      /* end of list (and not front of list) */
-      assert(set->way_head != blk && set->way_tail == blk);
-      if (where == Tail)
+      if (sp->status[way] & CACHE_BLK_REUSED)
 	{
-	  /* already there */
-	  return;
+	  if (!warm)
+	    cp->ship_reused_evictions++;
+	}
+      else
+	{
+	  if (!warm)
+	    cp->ship_dead_evictions++;
+	  if (cp->shct[sp->sigs[way]] > 0)
+	    cp->shct[sp->sigs[way]]--;
 	}
-      set->way_tail = blk->way_prev;
-      blk->way_prev->way_next = NULL;
     }
-  else
+  return way;
+}
+
+/* update the replacement state of set SET, after block WAY is filled with
+   the block with tag TAG, the policy stats are left alone if WARM is set */
+static void
+cache_repl_fill(struct cache_t *cp,		/* cache instance */
+		md_addr_t set,			/* set of the miss */
+		int way,			/* block filled */
+		md_addr_t tag,			/* tag of the block */
+		int warm)			/* functional warming? */
+{
+  struct cache_set_t *sp = &cp->sets[set];
+  enum cache_policy policy = cp->policy;
+  int rrpv;
+
+  if (policy == PLRU)
     {
-      /* middle of list (and not front or end of list) */
-      assert(set->way_head != blk && set->way_tail != blk);
-      blk->way_prev->way_next = blk->way_next;
-      blk->way_next->way_prev = blk->way_prev;
+      cache_plru_touch(cp, sp, way);
+      return;
+    }
+  if (!CACHE_POLICY_RRIP(policy))
+    return;
+
+  /* DRRIP follower sets use the policy that misses least in its leaders */
+  if (policy == DRRIP)
+    {
+      policy = cache_duel_role(cp, set);
+      if (policy == DRRIP)
+	{
+	  if (cp->psel >= (1 << (CACHE_PSEL_BITS - 1)))
+	    {
+	      policy = BRRIP;
+	      if (!warm)
+		cp->drrip_brrip_fills++;
+	    }
+	  else
+	    policy = SRRIP;
+	}
     }
 
-  /* link BLK back into the list */
-  if (where == Head)
+  if (policy == SHiP)
     {
-      /* link to the head of the way list */
-      blk->way_next = set->way_head;
-      blk->way_prev = NULL;
-      set->way_head->way_prev = blk;
-      set->way_head = blk;
+      /* distant, unless blocks of the same signature have hit */
+      sp->sigs[way] = cache_ship_sig(cp, tag, set);
+      rrpv = (cp->shct[sp->sigs[way]] == 0
+	      ? CACHE_RRPV_MAX : CACHE_RRPV_MAX - 1);
     }
-  else if (where == Tail)
+  else if (policy == BRRIP)
     {
-      /* link to the tail of the way list */
-      blk->way_prev = set->way_tail;
-      blk->way_next = NULL;
-      set->way_tail->way_next = blk;
-      set->way_tail = blk;
+      /* distant, but for one block in CACHE_BRRIP_EPSILON */
+      rrpv = (++cp->brrip_fills % CACHE_BRRIP_EPSILON == 0
+	      ? CACHE_RRPV_MAX - 1 : CACHE_RRPV_MAX);
     }
   else
-    panic("bogus WHERE designator");
+    {
+      /* SRRIP: long */
+      rrpv = CACHE_RRPV_MAX - 1;
+    }
+
+  if (rrpv == CACHE_RRPV_MAX && !warm)
+    cp->rrip_distant_fills++;
+  sp->rstate[way] = rrpv;
+}
+
+/* update the replacement state of set SP after a hit on block WAY */
+static void
+cache_repl_hit(struct cache_t *cp,		/* cache instance */
+	       struct cache_set_t *sp,		/* set of the hit */
+	       int way)				/* block that hit */
+{
+  switch (cp->policy) {
+  case LRU:
+    /* if this is not the youngest block, make it the most recently used */
+    if (sp->ages[way] != 0)
+      cache_age_mru(cp, sp, way);
+    break;
+  case PLRU:
+    cache_plru_touch(cp, sp, way);
+    break;
+  case SHiP:
+    sp->status[way] |= CACHE_BLK_REUSED;
+    if (cp->shct[sp->sigs[way]] < CACHE_SHCT_MAX)
+      cp->shct[sp->sigs[way]]++;
+    /* FALLTHROUGH */
+  case SRRIP:
+  case BRRIP:
+  case DRRIP:
+    /* hit priority, predict a near re-reference */
+    sp->rstate[way] = 0;
+    break;
+  default:
+    /* Random and FIFO ignore hits */
+    break;
+  }
+}
+
+/* return the MSHR of cache CP that is freed first, i.e., a free MSHR if
+   there is one */
+static struct cache_mshr_t *
+cache_mshr_next(struct cache_t *cp)		/* cache instance */
+{
+  struct cache_mshr_t *mshr = &cp->mshrs[0];
+  int i;
+
+  for (i=1; i<cp->nmshrs; i++)
+    {
+      if (cp->mshrs[i].ready < mshr->ready)
+	mshr = &cp->mshrs[i];
+    }
+  return mshr;
+}
+
+/* return the MSHR of cache CP that fills block BADDR at READY, or NULL if
+   there is none */
+static struct cache_mshr_t *
+cache_mshr_find(struct cache_t *cp,		/* cache instance */
+		md_addr_t baddr,		/* address of block */
+		tick_t ready)			/* time block is filled */
+{
+  int i;
+
+  /* an MSHR freed early may still hold the address of a block that was
+     replaced while it was being filled, so the fill time must match too */
+  for (i=0; i<cp->nmshrs; i++)
+    {
+      if (cp->mshrs[i].baddr == baddr && cp->mshrs[i].ready == ready)
+	return &cp->mshrs[i];
+    }
+  return NULL;
+}
+
+/* merge an access at address ADDR of cache CP into the MSHR of its block,
+   which is filled at READY, accesses beyond the MSHR target limit would
+   wait for the fill, which is when the block is ready anyway */
+static void
+cache_mshr_merge(struct cache_t *cp,		/* cache instance */
+		 md_addr_t addr,		/* address of access */
+		 tick_t ready)			/* time block is filled */
+{
+  struct cache_mshr_t *mshr = cache_mshr_find(cp, CACHE_BADDR(cp, addr),
+					      ready);
+
+  if (mshr)
+    {
+      mshr->targets++;
+      cp->mshr_merges++;
+    }
 }
 
 /* create and initialize a general cache structure */
@@ -275,6 +578,11 @@ cache_create(char *name,		/* name of the cache */
   struct cache_t *cp;
   struct cache_blk_t *blk;
   int i, j, bindex;
+  md_addr_t *tags;
+  unsigned int *status;
+  cache_age_t *ages;
+  byte_t *rstate = NULL;
+  half_t *sigs = NULL;
 
   /* check all cache parameters */
   if (nsets <= 0)
@@ -292,6 +600,12 @@ cache_create(char *name,		/* name of the cache */
     fatal("cache associativity `%d' must be non-zero and positive", assoc);
   if ((assoc & (assoc-1)) != 0)
     fatal("cache associativity `%d' must be a power of two", assoc);
+  if (assoc > CACHE_MAX_ASSOC)
+    fatal("cache associativity `%d' must be %d or less",
+	  assoc, CACHE_MAX_ASSOC);
+  if (policy == DRRIP && nsets < CACHE_DUEL_MIN_STRIDE)
+    fatal("DRRIP needs at least %d cache sets for set dueling, not `%d'",
+	  CACHE_DUEL_MIN_STRIDE, nsets);
   if (!blk_access_fn)
     fatal("must specify miss/replacement functions");
 
@@ -311,11 +625,30 @@ cache_create(char *name,		/* name of the cache */
   cp->policy = policy;
   cp->hit_latency = hit_latency;
 
+  /* random replacements are drawn from the shared generator, see
+     cache_seed_rand() */
+  cp->rand_private = FALSE;
+  cp->rand_state = 0;
+
   /* miss/replacement functions */
   cp->blk_access_fn = blk_access_fn;
 
+  /* replacement policy state, DRRIP followers start with SRRIP, and SHiP
+     starts out predicting hits for all signatures */
+  cp->duel_stride = MAX(nsets / CACHE_DUEL_SETS, CACHE_DUEL_MIN_STRIDE);
+  cp->psel = (1 << (CACHE_PSEL_BITS - 1)) - 1;
+  cp->brrip_fills = 0;
+  cp->shct = NULL;
+  if (policy == SHiP)
+    {
+      cp->shct = (byte_t *)calloc(CACHE_SHCT_SIZE, sizeof(byte_t));
+      if (!cp->shct)
+	fatal("out of virtual memory");
+      for (i=0; i<CACHE_SHCT_SIZE; i++)
+	cp->shct[i] = 1;
+    }
+
   /* compute derived parameters */
-  cp->hsize = CACHE_HIGHLY_ASSOC(cp) ? (assoc >> 2) : 0;
   cp->blk_mask = bsize-1;
   cp->set_shift = log_base2(bsize);
   cp->set_mask = nsets-1;
@@ -325,7 +658,6 @@ cache_create(char *name,		/* name of the cache */
   cp->bus_free = 0;
 
   /* print derived parameters during debug */
-  debug("%s: cp->hsize     = %d", cp->name, cp->hsize);
   debug("%s: cp->blk_mask  = 0x%08x", cp->name, cp->blk_mask);
   debug("%s: cp->set_shift = %d", cp->name, cp->set_shift);
   debug("%s: cp->set_mask  = 0x%08x", cp->name, cp->set_mask);
@@ -338,10 +670,30 @@ cache_create(char *name,		/* name of the cache */
   cp->replacements = 0;
   cp->writebacks = 0;
   cp->invalidations = 0;
+  cp->warm_hits = 0;
+  cp->warm_misses = 0;
+  cp->warm_writebacks = 0;
+  cp->rrip_distant_fills = 0;
+  cp->rrip_agings = 0;
+  cp->drrip_srrip_misses = 0;
+  cp->drrip_brrip_misses = 0;
+  cp->drrip_brrip_fills = 0;
+  cp->ship_reused_evictions = 0;
+  cp->ship_dead_evictions = 0;
+  cp->mshr_allocs = 0;
+  cp->mshr_merges = 0;
+  cp->mshr_full = 0;
+  cp->mshr_busy_cycles = 0;
+
+  /* no MSHRs, see cache_set_mshrs() */
+  cp->nmshrs = 0;
+  cp->mshr_targets = 0;
+  cp->mshrs = NULL;
 
   /* blow away the last block accessed */
   cp->last_tagset = 0;
   cp->last_blk = NULL;
+  cp->last_status = NULL;
 
   /* allocate data blocks */
   cp->data = (byte_t *)calloc(nsets * assoc,
@@ -350,27 +702,43 @@ cache_create(char *name,		/* name of the cache */
   if (!cp->data)
     fatal("out of virtual memory");
 
+  /* allocate the tag, status and age arrays of all sets */
+  tags = (md_addr_t *)calloc(nsets * assoc, sizeof(md_addr_t));
+  status = (unsigned int *)calloc(nsets * assoc, sizeof(unsigned int));
+  ages = (cache_age_t *)calloc(nsets * assoc, sizeof(cache_age_t));
+  if (!tags || !status || !ages)
+    fatal("out of virtual memory");
+
+  /* PLRU and RRIP keep a byte of replacement state per block, blocks
+     start out with a distant RRPV */
+  if (policy == PLRU || CACHE_POLICY_RRIP(policy))
+    {
+      rstate = (byte_t *)calloc(nsets * assoc, sizeof(byte_t));
+      if (!rstate)
+	fatal("out of virtual memory");
+      if (policy != PLRU)
+	memset(rstate, CACHE_RRPV_MAX, nsets * assoc);
+    }
+  if (policy == SHiP)
+    {
+      sigs = (half_t *)calloc(nsets * assoc, sizeof(half_t));
+      if (!sigs)
+	fatal("out of virtual memory");
+    }
+
   /* slice up the data blocks */
   for (bindex=0,i=0; i<nsets; i++)
     {
-      cp->sets[i].way_head = NULL;
-      cp->sets[i].way_tail = NULL;
-      /* get a hash table, if needed */
-      if (cp->hsize)
-	{
-	  cp->sets[i].hash =
-	    (struct cache_blk_t **)calloc(cp->hsize,
-					  sizeof(struct cache_blk_t *));
-	  if (!cp->sets[i].hash)
-	    fatal("out of virtual memory");
-	}
+      cp->sets[i].tags = tags + i*assoc;
+      cp->sets[i].status = status + i*assoc;
+      cp->sets[i].ages = ages + i*assoc;
+      cp->sets[i].rstate = rstate ? rstate + i*assoc : NULL;
+      cp->sets[i].sigs = sigs ? sigs + i*assoc : NULL;
       /* NOTE: all the blocks in a set *must* be allocated contiguously,
 	 otherwise, block accesses through SET->BLKS will fail (used
 	 during random replacement selection) */
       cp->sets[i].blks = CACHE_BINDEX(cp, cp->data, bindex);
-      
-      /* link the data blocks into ordered way chain and hash table bucket
-         chains, if hash table exists */
+
       for (j=0; j<assoc; j++)
 	{
 	  /* locate next cache block */
@@ -378,29 +746,59 @@ cache_create(char *name,		/* name of the cache */
 	  bindex++;
 
 	  /* invalidate new cache block */
-	  blk->status = 0;
-	  blk->tag = 0;
+	  cp->sets[i].status[j] = 0;
+	  cp->sets[i].tags[j] = 0;
 	  blk->ready = 0;
 	  blk->user_data = (usize != 0
 			    ? (byte_t *)calloc(usize, sizeof(byte_t)) : NULL);
 
-	  /* insert cache block into set hash table */
-	  if (cp->hsize)
-	    link_htab_ent(cp, &cp->sets[i], blk);
-
-	  /* insert into head of way list, order is arbitrary at this point */
-	  blk->way_next = cp->sets[i].way_head;
-	  blk->way_prev = NULL;
-	  if (cp->sets[i].way_head)
-	    cp->sets[i].way_head->way_prev = blk;
-	  cp->sets[i].way_head = blk;
-	  if (!cp->sets[i].way_tail)
-	    cp->sets[i].way_tail = blk;
+	  /* the replacement order is arbitrary at this point, the last
+	     block is the most recently filled one */
+	  cp->sets[i].ages[j] = assoc - 1 - j;
 	}
     }
   return cp;
 }
 
+/* give cache CP NMSHRS miss status holding registers, each of which can
+   hold up to TARGETS accesses to the block being filled (zero for no limit),
+   all MSHRs are free at first */
+void
+cache_set_mshrs(struct cache_t *cp,	/* cache instance */
+		int nmshrs,		/* number of MSHRs */
+		int targets)		/* accesses per MSHR, 0 for no limit */
+{
+  if (nmshrs < 0)
+    fatal("number of MSHRs `%d' must be zero or positive", nmshrs);
+  if (targets < 0)
+    fatal("MSHR targets `%d' must be zero or positive", targets);
+
+  if (cp->mshrs)
+    free(cp->mshrs);
+  cp->mshrs = NULL;
+  cp->nmshrs = nmshrs;
+  cp->mshr_targets = targets;
+  if (nmshrs)
+    {
+      cp->mshrs = (struct cache_mshr_t *)
+	calloc(nmshrs, sizeof(struct cache_mshr_t));
+      if (!cp->mshrs)
+	fatal("out of virtual memory");
+    }
+}
+
+/* give cache CP its own random replacement generator, seeded with SEED, by
+   default caches draw random replacements from the shared myrand()
+   generator, a simulator that accesses caches from several host threads,
+   e.g., sim-sweep, must seed each of them, so they do not share state */
+void
+cache_seed_rand(struct cache_t *cp,	/* cache instance */
+		unsigned int seed)	/* generator seed */
+{
+  cp->rand_private = TRUE;
+  cp->rand_state = seed;
+}
+
 /* parse policy */
 enum cache_policy			/* replacement policy enum */
 cache_char2policy(char c)		/* replacement policy as a char */
@@ -409,6 +807,11 @@ cache_char2policy(char c)		/* replacement policy as a char */
   case 'l': return LRU;
   case 'r': return Random;
   case 'f': return FIFO;
+  case 'p': return PLRU;
+  case 's': return SRRIP;
+  case 'b': return BRRIP;
+  case 'd': return DRRIP;
+  case 'h': return SHiP;
   default: fatal("bogus replacement policy, `%c'", c);
   }
 }
@@ -427,7 +830,21 @@ cache_config(struct cache_t *cp,	/* cache instance */
 	  cp->policy == LRU ? "LRU"
 	  : cp->policy == Random ? "Random"
 	  : cp->policy == FIFO ? "FIFO"
+	  : cp->policy == PLRU ? "PLRU"
+	  : cp->policy == SRRIP ? "SRRIP"
+	  : cp->policy == BRRIP ? "BRRIP"
+	  : cp->policy == DRRIP ? "DRRIP"
+	  : cp->policy == SHiP ? "SHiP"
 	  : (abort(), ""));
+  if (cp->nmshrs)
+    {
+      if (cp->mshr_targets)
+	fprintf(stream, "cache: %s: %d MSHRs, %d targets/MSHR\n",
+		cp->name, cp->nmshrs, cp->mshr_targets);
+      else
+	fprintf(stream, "cache: %s: %d MSHRs, unlimited targets/MSHR\n",
+		cp->name, cp->nmshrs);
+    }
 }
 
 /* register cache stats */
@@ -471,6 +888,103 @@ cache_reg_stats(struct cache_t *cp,	/* cache instance */
   sprintf(buf, "%s.inv_rate", name);
   sprintf(buf1, "%s.invalidations / %s.accesses", name, name);
   stat_reg_formula(sdb, buf, "invalidation rate (i.e., invs/ref)", buf1, NULL);
+
+  /* replacement policy stats */
+  if (CACHE_POLICY_RRIP(cp->policy))
+    {
+      sprintf(buf, "%s.rrip_distant_fills", name);
+      stat_reg_counter(sdb, buf, "total number of fills with a distant RRPV",
+		       &cp->rrip_distant_fills, 0, NULL);
+      sprintf(buf, "%s.rrip_agings", name);
+      stat_reg_counter(sdb, buf, "total number of set RRPV agings",
+		       &cp->rrip_agings, 0, NULL);
+    }
+  if (cp->policy == DRRIP)
+    {
+      /* the policy selector itself is not registered, sampling rolls back
+	 and merges the stats, which would corrupt it */
+      sprintf(buf, "%s.drrip_srrip_misses", name);
+      stat_reg_counter(sdb, buf, "total number of misses in SRRIP leader sets",
+		       &cp->drrip_srrip_misses, 0, NULL);
+      sprintf(buf, "%s.drrip_brrip_misses", name);
+      stat_reg_counter(sdb, buf, "total number of misses in BRRIP leader sets",
+		       &cp->drrip_brrip_misses, 0, NULL);
+      sprintf(buf, "%s.drrip_brrip_fills", name);
+      stat_reg_counter(sdb, buf, "total number of follower fills with BRRIP",
+		       &cp->drrip_brrip_fills, 0, NULL);
+    }
+  if (cp->policy == SHiP)
+    {
+      sprintf(buf, "%s.ship_reused_evictions", name);
+      stat_reg_counter(sdb, buf, "total number of evictions of reused blocks",
+		       &cp->ship_reused_evictions, 0, NULL);
+      sprintf(buf, "%s.ship_dead_evictions", name);
+      stat_reg_counter(sdb, buf, "total number of evictions of dead blocks",
+		       &cp->ship_dead_evictions, 0, NULL);
+      sprintf(buf, "%s.ship_dead_rate", name);
+      sprintf(buf1, "%s.ship_dead_evictions / "
+	      "(%s.ship_dead_evictions + %s.ship_reused_evictions)",
+	      name, name, name);
+      stat_reg_formula(sdb, buf, "dead block rate (i.e., dead/evictions)",
+		       buf1, NULL);
+    }
+
+  /* MSHR stats */
+  if (cp->nmshrs)
+    {
+      sprintf(buf, "%s.mshr_allocs", name);
+      stat_reg_counter(sdb, buf, "total number of MSHR allocations",
+		       &cp->mshr_allocs, 0, NULL);
+      sprintf(buf, "%s.mshr_merges", name);
+      stat_reg_counter(sdb, buf, "total number of misses merged into MSHRs",
+		       &cp->mshr_merges, 0, NULL);
+      sprintf(buf, "%s.mshr_full", name);
+      stat_reg_counter(sdb, buf, "total number of misses that waited for "
+		       "an MSHR", &cp->mshr_full, 0, NULL);
+      sprintf(buf, "%s.mshr_busy_cycles", name);
+      stat_reg_counter(sdb, buf, "total number of cycles MSHRs were held",
+		       &cp->mshr_busy_cycles, 0, NULL);
+      sprintf(buf, "%s.mshr_merge_rate", name);
+      sprintf(buf1, "%s.mshr_merges / (%s.mshr_allocs + %s.mshr_merges)",
+	      name, name, name);
+      stat_reg_formula(sdb, buf, "MSHR merge rate (i.e., merges/misses)",
+		       buf1, NULL);
+      sprintf(buf, "%s.mshr_miss_lat", name);
+      sprintf(buf1, "%s.mshr_busy_cycles / %s.mshr_allocs", name, name);
+      stat_reg_formula(sdb, buf, "average cycles an MSHR is held per miss",
+		       buf1, NULL);
+    }
+}
+
+/* register cache functional warming stats */
+void
+cache_reg_warm_stats(struct cache_t *cp,	/* cache instance */
+		     struct stat_sdb_t *sdb)	/* stats database */
+{
+  char buf[512], buf1[512], *name;
+
+  /* get a name for this cache */
+  if (!cp->name || !cp->name[0])
+    name = "<unknown>";
+  else
+    name = cp->name;
+
+  sprintf(buf, "%s.warm_accesses", name);
+  sprintf(buf1, "%s.warm_hits + %s.warm_misses", name, name);
+  stat_reg_formula(sdb, buf, "total number of functional warming accesses",
+		   buf1, "%12.0f");
+  sprintf(buf, "%s.warm_hits", name);
+  stat_reg_counter(sdb, buf, "total number of functional warming hits",
+		   &cp->warm_hits, 0, NULL);
+  sprintf(buf, "%s.warm_misses", name);
+  stat_reg_counter(sdb, buf, "total number of functional warming misses",
+		   &cp->warm_misses, 0, NULL);
+  sprintf(buf, "%s.warm_writebacks", name);
+  stat_reg_counter(sdb, buf, "total number of functional warming writebacks",
+		   &cp->warm_writebacks, 0, NULL);
+  sprintf(buf, "%s.warm_miss_rate", name);
+  sprintf(buf1, "%s.warm_misses / %s.warm_accesses", name, name);
+  stat_reg_formula(sdb, buf, "functional warming miss rate", buf1, NULL);
 }
 
 /* print cache stats */
@@ -510,8 +1024,10 @@ cache_access(struct cache_t *cp,	/* cache to access */
   md_addr_t tag = CACHE_TAG(cp, addr);
   md_addr_t set = CACHE_SET(cp, addr);
   md_addr_t bofs = CACHE_BLK(cp, addr);
+  struct cache_set_t *sp = &cp->sets[set];
   struct cache_blk_t *blk, *repl;
-  int lat = 0;
+  struct cache_mshr_t *mshr = NULL;
+  int way, lat = 0;
 
   /* default replacement address */
   if (repl_addr)
@@ -536,70 +1052,45 @@ cache_access(struct cache_t *cp,	/* cache to access */
       blk = cp->last_blk;
       goto cache_fast_hit;
     }
-    
-  if (cp->hsize)
-    {
-      /* higly-associativity cache, access through the per-set hash tables */
-      int hindex = CACHE_HASH(cp, tag);
 
-      for (blk=cp->sets[set].hash[hindex];
-	   blk;
-	   blk=blk->hash_next)
-	{
-	  if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	    goto cache_hit;
-	}
-    }
-  else
-    {
-      /* low-associativity cache, linear search the way list */
-      for (blk=cp->sets[set].way_head;
-	   blk;
-	   blk=blk->way_next)
-	{
-	  if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	    goto cache_hit;
-	}
-    }
+  /* compare the tags of all the blocks in the set */
+  way = cache_find(cp, sp, tag);
+  if (way >= 0)
+    goto cache_hit;
 
   /* cache block not found */
 
   /* **MISS** */
   cp->misses++;
 
-  /* select the appropriate block to replace, and re-link this entry to
-     the appropriate place in the way list */
-  switch (cp->policy) {
-  case LRU:
-  case FIFO:
-    repl = cp->sets[set].way_tail;
-    update_way_list(&cp->sets[set], repl, Head);
-    break;
-  case Random:
+  /* the miss needs an MSHR, wait until one is freed if all are busy */
+  if (cp->nmshrs)
     {
-      int bindex = myrand() & (cp->assoc - 1);
-      repl = CACHE_BINDEX(cp, cp->sets[set].blks, bindex);
+      mshr = cache_mshr_next(cp);
+      if (mshr->ready > now)
+	{
+	  cp->mshr_full++;
+	  lat = mshr->ready - now;
+	}
+      cp->mshr_allocs++;
     }
-    break;
-  default:
-    panic("bogus replacement policy");
-  }
 
-  /* remove this block from the hash bucket chain, if hash exists */
-  if (cp->hsize)
-    unlink_htab_ent(cp, &cp->sets[set], repl);
+  /* select the appropriate block to replace */
+  way = cache_repl_victim(cp, set, /* warm */FALSE);
+  repl = CACHE_BINDEX(cp, sp->blks, way);
 
   /* blow away the last block to hit */
   cp->last_tagset = 0;
   cp->last_blk = NULL;
+  cp->last_status = NULL;
 
   /* write back replaced block data */
-  if (repl->status & CACHE_BLK_VALID)
+  if (sp->status[way] & CACHE_BLK_VALID)
     {
       cp->replacements++;
 
       if (repl_addr)
-	*repl_addr = CACHE_MK_BADDR(cp, repl->tag, set);
+	*repl_addr = CACHE_MK_BADDR(cp, sp->tags[way], set);
  
       /* don't replace the block until outstanding misses are satisfied */
       lat += BOUND_POS(repl->ready - now);
@@ -610,19 +1101,20 @@ cache_access(struct cache_t *cp,	/* cache to access */
       /* track bus resource usage */
       cp->bus_free = MAX(cp->bus_free, (now + lat)) + 1;
 
-      if (repl->status & CACHE_BLK_DIRTY)
+      if (sp->status[way] & CACHE_BLK_DIRTY)
 	{
 	  /* write back the cache block */
 	  cp->writebacks++;
 	  lat += cp->blk_access_fn(Write,
-				   CACHE_MK_BADDR(cp, repl->tag, set),
+				   CACHE_MK_BADDR(cp, sp->tags[way], set),
 				   cp->bsize, repl, now+lat);
 	}
     }
 
   /* update block tags */
-  repl->tag = tag;
-  repl->status = CACHE_BLK_VALID;	/* dirty bit set on update */
+  sp->tags[way] = tag;
+  sp->status[way] = CACHE_BLK_VALID;	/* dirty bit set on update */
+  cache_repl_fill(cp, set, way, tag, /* warm */FALSE);
 
   /* read data block */
   lat += cp->blk_access_fn(Read, CACHE_BADDR(cp, addr), cp->bsize,
@@ -636,7 +1128,7 @@ cache_access(struct cache_t *cp,	/* cache to access */
 
   /* update dirty status */
   if (cmd == Write)
-    repl->status |= CACHE_BLK_DIRTY;
+    sp->status[way] |= CACHE_BLK_DIRTY;
 
   /* get user block data, if requested and it exists */
   if (udata)
@@ -645,9 +1137,14 @@ cache_access(struct cache_t *cp,	/* cache to access */
   /* update block status */
   repl->ready = now+lat;
 
-  /* link this entry back into the hash table */
-  if (cp->hsize)
-    link_htab_ent(cp, &cp->sets[set], repl);
+  /* the MSHR is held until the block is filled */
+  if (mshr)
+    {
+      cp->mshr_busy_cycles += now + lat - MAX(mshr->ready, now);
+      mshr->baddr = CACHE_BADDR(cp, addr);
+      mshr->ready = now+lat;
+      mshr->targets = 1;
+    }
 
   /* return latency of the operation */
   return lat;
@@ -657,6 +1154,7 @@ cache_access(struct cache_t *cp,	/* cache to access */
   
   /* **HIT** */
   cp->hits++;
+  blk = CACHE_BINDEX(cp, sp->blks, way);
 
   /* copy data out of cache block, if block exists */
   if (cp->balloc)
@@ -666,20 +1164,19 @@ cache_access(struct cache_t *cp,	/* cache to access */
 
   /* update dirty status */
   if (cmd == Write)
-    blk->status |= CACHE_BLK_DIRTY;
+    sp->status[way] |= CACHE_BLK_DIRTY;
 
-  /* if LRU replacement and this is not the first element of list, reorder */
-  if (blk->way_prev && cp->policy == LRU)
-    {
-      /* move this block to head of the way (MRU) list */
-      update_way_list(&cp->sets[set], blk, Head);
-    }
+  /* update the replacement order */
+  cache_repl_hit(cp, sp, way);
 
-  /* tag is unchanged, so hash links (if they exist) are still valid */
+  /* a hit on a block that is still being filled is a secondary miss */
+  if (cp->nmshrs && blk->ready > now)
+    cache_mshr_merge(cp, addr, blk->ready);
 
   /* record the last block to hit */
   cp->last_tagset = CACHE_TAGSET(cp, addr);
   cp->last_blk = blk;
+  cp->last_status = &sp->status[way];
 
   /* get user block data, if requested and it exists */
   if (udata)
@@ -701,11 +1198,13 @@ cache_access(struct cache_t *cp,	/* cache to access */
 
   /* update dirty status */
   if (cmd == Write)
-    blk->status |= CACHE_BLK_DIRTY;
+    *cp->last_status |= CACHE_BLK_DIRTY;
 
-  /* this block hit last, no change in the way list */
+  /* this block hit last, no change in the replacement order */
 
-  /* tag is unchanged, so hash links (if they exist) are still valid */
+  /* a hit on a block that is still being filled is a secondary miss */
+  if (cp->nmshrs && blk->ready > now)
+    cache_mshr_merge(cp, addr, blk->ready);
 
   /* get user block data, if requested and it exists */
   if (udata)
@@ -719,6 +1218,128 @@ cache_access(struct cache_t *cp,	/* cache to access */
   return (int) MAX(cp->hit_latency, (blk->ready - now));
 }
 
+/* functionally warm cache CP with a CMD operation at address ADDR, i.e.,
+   update the block tags, dirty bits and replacement state as cache_access()
+   would, but without any latency bookkeeping (block ready times and bus
+   usage are untouched) and without calling the block access function, so
+   the caller must warm the next level of the memory hierarchy on a miss;
+   block data is not transferred, returns non-zero on a hit, on a miss,
+   *WB_ADDR is set to the address of the dirty block replaced, or zero */
+int					/* non-zero on a hit */
+cache_warm(struct cache_t *cp,		/* cache to warm */
+	   enum mem_cmd cmd,		/* access type, Read or Write */
+	   md_addr_t addr,		/* address of access */
+	   md_addr_t *wb_addr)		/* for address of dirty block replaced */
+{
+  md_addr_t tag = CACHE_TAG(cp, addr);
+  md_addr_t set = CACHE_SET(cp, addr);
+  struct cache_set_t *sp = &cp->sets[set];
+  int way;
+
+  /* default writeback address */
+  *wb_addr = 0;
+
+  /* check for a fast hit: access to same block */
+  if (CACHE_TAGSET(cp, addr) == cp->last_tagset)
+    {
+      /* hit in the same block, no change in the replacement order */
+      if (cmd == Write)
+	*cp->last_status |= CACHE_BLK_DIRTY;
+      cp->warm_hits++;
+      return TRUE;
+    }
+
+  /* compare the tags of all the blocks in the set */
+  way = cache_find(cp, sp, tag);
+  if (way >= 0)
+    {
+      /* update the replacement order */
+      cache_repl_hit(cp, sp, way);
+      goto cache_hit;
+    }
+
+  /* **MISS** */
+  cp->warm_misses++;
+
+  /* select the block to replace, as cache_access() would */
+  way = cache_repl_victim(cp, set, /* warm */TRUE);
+
+  /* blow away the last block to hit */
+  cp->last_tagset = 0;
+  cp->last_blk = NULL;
+  cp->last_status = NULL;
+
+  /* report the replaced block for writeback, if dirty */
+  if ((sp->status[way] & CACHE_BLK_VALID)
+      && (sp->status[way] & CACHE_BLK_DIRTY))
+    {
+      cp->warm_writebacks++;
+      *wb_addr = CACHE_MK_BADDR(cp, sp->tags[way], set);
+    }
+
+  /* update block tags and status, the block is available at once */
+  sp->tags[way] = tag;
+  sp->status[way] = CACHE_BLK_VALID;
+  if (cmd == Write)
+    sp->status[way] |= CACHE_BLK_DIRTY;
+  CACHE_BINDEX(cp, sp->blks, way)->ready = 0;
+  cache_repl_fill(cp, set, way, tag, /* warm */TRUE);
+
+  return FALSE;
+
+ cache_hit:
+
+  /* **HIT** */
+  cp->warm_hits++;
+
+  /* update dirty status */
+  if (cmd == Write)
+    sp->status[way] |= CACHE_BLK_DIRTY;
+
+  /* record the last block to hit */
+  cp->last_tagset = CACHE_TAGSET(cp, addr);
+  cp->last_blk = CACHE_BINDEX(cp, sp->blks, way);
+  cp->last_status = &sp->status[way];
+
+  return TRUE;
+}
+
+/* return non-zero if an access to address ADDR at NOW would be accepted by
+   cache CP without waiting for an MSHR, i.e., if it hits a filled block,
+   merges into the MSHR of a block being filled that has a target left, or
+   misses and finds a free MSHR; always non-zero if CP has no MSHRs */
+int					/* non-zero if access can proceed */
+cache_mshr_avail(struct cache_t *cp,	/* cache instance to check */
+		 md_addr_t addr,	/* address of access */
+		 tick_t now)		/* time of access */
+{
+  struct cache_set_t *sp = &cp->sets[CACHE_SET(cp, addr)];
+  struct cache_mshr_t *mshr;
+  struct cache_blk_t *blk;
+  int way;
+
+  if (!cp->nmshrs)
+    return TRUE;
+
+  way = cache_find(cp, sp, CACHE_TAG(cp, addr));
+  if (way < 0)
+    {
+      /* a primary miss, needs a free MSHR */
+      return cache_mshr_next(cp)->ready <= now;
+    }
+
+  blk = CACHE_BINDEX(cp, sp->blks, way);
+  if (blk->ready <= now)
+    {
+      /* a hit on a filled block */
+      return TRUE;
+    }
+
+  /* a secondary miss, needs a target of the MSHR filling the block */
+  mshr = cache_mshr_find(cp, CACHE_BADDR(cp, addr), blk->ready);
+  return (!mshr || !cp->mshr_targets || mshr->targets < cp->mshr_targets);
+}
+
 /* return non-zero if block containing address ADDR is contained in cache
    CP, this interface is used primarily for debugging and asserting cache
    invariants */
@@ -728,37 +1349,10 @@ cache_probe(struct cache_t *cp,		/* cache instance to probe */
 {
   md_addr_t tag = CACHE_TAG(cp, addr);
   md_addr_t set = CACHE_SET(cp, addr);
-  struct cache_blk_t *blk;
 
   /* permissions are checked on cache misses */
 
-  if (cp->hsize)
-  {
-    /* higly-associativity cache, access through the per-set hash tables */
-    int hindex = CACHE_HASH(cp, tag);
-    
-    for (blk=cp->sets[set].hash[hindex];
-	 blk;
-	 blk=blk->hash_next)
-    {	
-      if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	  return TRUE;
-    }
-  }
-  else
-  {
-    /* low-associativity cache, linear search the way list */
-    for (blk=cp->sets[set].way_head;
-	 blk;
-	 blk=blk->way_next)
-    {
-      if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	  return TRUE;
-    }
-  }
-  
-  /* cache block not found */
-  return FALSE;
+  return cache_find(cp, &cp->sets[set], tag) >= 0;
 }
 
 /* flush the entire cache, returns latency of the operation */
@@ -766,34 +1360,47 @@ unsigned int				/* latency of the flush operation */
 cache_flush(struct cache_t *cp,		/* cache instance to flush */
 	    tick_t now)			/* time of cache flush */
 {
-  int i, lat = cp->hit_latency; /* min latency to probe cache */
-  struct cache_blk_t *blk;
+  int i, j, way, lat = cp->hit_latency; /* min latency to probe cache */
+  int *order;
+  struct cache_set_t *sp;
 
   /* blow away the last block to hit */
   cp->last_tagset = 0;
   cp->last_blk = NULL;
+  cp->last_status = NULL;
 
-  /* no way list updates required because all blocks are being invalidated */
+  order = (int *)calloc(cp->assoc, sizeof(int));
+  if (!order)
+    fatal("out of virtual memory");
+
+  /* no replacement order updates required because all blocks are being
+     invalidated, the blocks are written back in replacement order */
   for (i=0; i<cp->nsets; i++)
     {
-      for (blk=cp->sets[i].way_head; blk; blk=blk->way_next)
+      sp = &cp->sets[i];
+      cache_set_order(cp, sp, order);
+      for (j=0; j<cp->assoc; j++)
 	{
-	  if (blk->status & CACHE_BLK_VALID)
+	  way = order[j];
+	  if (sp->status[way] & CACHE_BLK_VALID)
 	    {
 	      cp->invalidations++;
-	      blk->status &= ~CACHE_BLK_VALID;
+	      sp->status[way] &= ~CACHE_BLK_VALID;
 
-	      if (blk->status & CACHE_BLK_DIRTY)
+	      if (sp->status[way] & CACHE_BLK_DIRTY)
 		{
 		  /* write back the invalidated block */
           	  cp->writebacks++;
 		  lat += cp->blk_access_fn(Write,
-					   CACHE_MK_BADDR(cp, blk->tag, i),
-					   cp->bsize, blk, now+lat);
+					   CACHE_MK_BADDR(cp, sp->tags[way], i),
+					   cp->bsize,
+					   CACHE_BINDEX(cp, sp->blks, way),
+					   now+lat);
 		}
 	    }
 	}
     }
+  free(order);
 
   /* return latency of the flush operation */
   return lat;
@@ -808,55 +1415,165 @@ cache_flush_addr(struct cache_t *cp,	/* cache instance to flush */
 {
   md_addr_t tag = CACHE_TAG(cp, addr);
   md_addr_t set = CACHE_SET(cp, addr);
-  struct cache_blk_t *blk;
-  int lat = cp->hit_latency; /* min latency to probe cache */
+  struct cache_set_t *sp = &cp->sets[set];
+  int way, lat = cp->hit_latency; /* min latency to probe cache */
 
-  if (cp->hsize)
+  way = cache_find(cp, sp, tag);
+  if (way >= 0)
     {
-      /* higly-associativity cache, access through the per-set hash tables */
-      int hindex = CACHE_HASH(cp, tag);
+      cp->invalidations++;
+      sp->status[way] &= ~CACHE_BLK_VALID;
+
+      /* blow away the last block to hit */
+      cp->last_tagset = 0;
+      cp->last_blk = NULL;
+      cp->last_status = NULL;
 
-      for (blk=cp->sets[set].hash[hindex];
-	   blk;
-	   blk=blk->hash_next)
+      if (sp->status[way] & CACHE_BLK_DIRTY)
 	{
-	  if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	    break;
+	  /* write back the invalidated block */
+          cp->writebacks++;
+	  lat += cp->blk_access_fn(Write,
+				   CACHE_MK_BADDR(cp, sp->tags[way], set),
+				   cp->bsize, CACHE_BINDEX(cp, sp->blks, way),
+				   now+lat);
 	}
+      /* make this block the next one replaced, the other policies replace
+	 invalid blocks first */
+      if (cp->policy == LRU || cp->policy == FIFO || cp->policy == Random)
+	cache_age_lru(cp, sp, way);
     }
-  else
+
+  /* return latency of the operation */
+  return lat;
+}
+
+/* write the contents of cache CP to checkpoint stream FD, i.e., the tag,
+   status and user data (and data, if allocated) of every block, in
+   replacement order */
+void
+cache_chkpt_write(struct cache_t *cp,	/* cache instance to save */
+		  FILE *fd)		/* checkpoint stream */
+{
+  int i, j, *order;
+  struct cache_set_t *sp;
+  struct cache_blk_t *blk;
+
+  /* the configuration, checked at restore */
+  chkpt_write_tag(fd, cp->name);
+  CHKPT_WRITE_VAR(fd, cp->nsets);
+  CHKPT_WRITE_VAR(fd, cp->bsize);
+  CHKPT_WRITE_VAR(fd, cp->balloc);
+  CHKPT_WRITE_VAR(fd, cp->usize);
+  CHKPT_WRITE_VAR(fd, cp->assoc);
+  CHKPT_WRITE_VAR(fd, cp->policy);
+
+  order = (int *)calloc(cp->assoc, sizeof(int));
+  if (!order)
+    fatal("out of virtual memory");
+
+  for (i=0; i<cp->nsets; i++)
     {
-      /* low-associativity cache, linear search the way list */
-      for (blk=cp->sets[set].way_head;
-	   blk;
-	   blk=blk->way_next)
+      sp = &cp->sets[i];
+      cache_set_order(cp, sp, order);
+      for (j=0; j<cp->assoc; j++)
 	{
-	  if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	    break;
+	  blk = CACHE_BINDEX(cp, sp->blks, order[j]);
+	  CHKPT_WRITE_VAR(fd, sp->tags[order[j]]);
+	  CHKPT_WRITE_VAR(fd, sp->status[order[j]]);
+	  if (cp->usize)
+	    chkpt_write(fd, blk->user_data, cp->usize);
+	  if (cp->balloc)
+	    chkpt_write(fd, blk->data, cp->bsize);
 	}
     }
+  free(order);
 
-  if (blk)
+  /* the replacement state of the PLRU and RRIP policies, which leave the
+     ages, and so the checkpoint order of the blocks, alone */
+  if (cp->sets[0].rstate)
     {
-      cp->invalidations++;
-      blk->status &= ~CACHE_BLK_VALID;
+      chkpt_write_tag(fd, "repl");
+      chkpt_write(fd, cp->sets[0].rstate, cp->nsets * cp->assoc);
+      CHKPT_WRITE_VAR(fd, cp->psel);
+      CHKPT_WRITE_VAR(fd, cp->brrip_fills);
+      if (cp->policy == SHiP)
+	{
+	  chkpt_write(fd, cp->sets[0].sigs,
+		      cp->nsets * cp->assoc * sizeof(half_t));
+	  chkpt_write(fd, cp->shct, CACHE_SHCT_SIZE);
+	}
+    }
+}
 
-      /* blow away the last block to hit */
-      cp->last_tagset = 0;
-      cp->last_blk = NULL;
+/* restore the contents of cache CP from checkpoint stream FD, all blocks
+   are ready at once, and the cache stats are unchanged */
+void
+cache_chkpt_read(struct cache_t *cp,	/* cache instance to restore */
+		 FILE *fd)		/* checkpoint stream */
+{
+  int i, j, nsets, bsize, balloc, usize, assoc, *order;
+  enum cache_policy policy;
+  struct cache_set_t *sp;
+  struct cache_blk_t *blk;
+
+  chkpt_read_tag(fd, cp->name);
+  CHKPT_READ_VAR(fd, nsets);
+  CHKPT_READ_VAR(fd, bsize);
+  CHKPT_READ_VAR(fd, balloc);
+  CHKPT_READ_VAR(fd, usize);
+  CHKPT_READ_VAR(fd, assoc);
+  CHKPT_READ_VAR(fd, policy);
+  if (nsets != cp->nsets || bsize != cp->bsize || balloc != cp->balloc
+      || usize != cp->usize || assoc != cp->assoc || policy != cp->policy)
+    fatal("checkpointed cache `%s' has a different configuration", cp->name);
 
-      if (blk->status & CACHE_BLK_DIRTY)
+  /* blow away the last block to hit */
+  cp->last_tagset = 0;
+  cp->last_blk = NULL;
+  cp->last_status = NULL;
+  cp->bus_free = 0;
+
+  /* no misses are outstanding */
+  for (i=0; i<cp->nmshrs; i++)
+    cp->mshrs[i].ready = 0;
+
+  order = (int *)calloc(cp->assoc, sizeof(int));
+  if (!order)
+    fatal("out of virtual memory");
+
+  /* the blocks keep their ages, and take on the checkpointed contents in
+     replacement order */
+  for (i=0; i<cp->nsets; i++)
+    {
+      sp = &cp->sets[i];
+      cache_set_order(cp, sp, order);
+      for (j=0; j<cp->assoc; j++)
 	{
-	  /* write back the invalidated block */
-          cp->writebacks++;
-	  lat += cp->blk_access_fn(Write,
-				   CACHE_MK_BADDR(cp, blk->tag, set),
-				   cp->bsize, blk, now+lat);
+	  blk = CACHE_BINDEX(cp, sp->blks, order[j]);
+	  CHKPT_READ_VAR(fd, sp->tags[order[j]]);
+	  CHKPT_READ_VAR(fd, sp->status[order[j]]);
+	  blk->ready = 0;
+	  if (cp->usize)
+	    chkpt_read(fd, blk->user_data, cp->usize);
+	  if (cp->balloc)
+	    chkpt_read(fd, blk->data, cp->bsize);
 	}
-      /* move this block to tail of the way (LRU) list */
-      update_way_list(&cp->sets[set], blk, Tail);
     }
+  free(order);
 
-  /* return latency of the operation */
-  return lat;
+  /* the replacement state of the PLRU and RRIP policies */
+  if (cp->sets[0].rstate)
+    {
+      chkpt_read_tag(fd, "repl");
+      chkpt_read(fd, cp->sets[0].rstate, cp->nsets * cp->assoc);
+      CHKPT_READ_VAR(fd, cp->psel);
+      CHKPT_READ_VAR(fd, cp->brrip_fills);
+      if (cp->policy == SHiP)
+	{
+	  chkpt_read(fd, cp->sets[0].sigs,
+		     cp->nsets * cp->assoc * sizeof(half_t));
+	  chkpt_read(fd, cp->shct, CACHE_SHCT_SIZE);
+	}
+    }
 }
@@ -78,49 +78,92 @@
  * physical page address information, etc...
  *
  * The caches implemented by this module provide efficient storage management
- * and fast access for all cache geometries.  When sets become highly
- * associative, a hash table (indexed by address) is allocated for each set
- * in the cache.
+ * and fast access for all cache geometries.  The tags and status of the
+ * blocks of a set are kept in contiguous arrays, so that a lookup compares
+ * all the tags of the set at once (with SSE2 or AVX2 instructions, on hosts
+ * that have them), and the replacement order of the blocks of a set is
+ * kept as an age per block.
  *
  * This module also tracks latency of accessing the data cache, each cache has
  * a hit latency defined when instantiated, miss latency is returned by the
- * cache's block access function, the caches may service any number of hits
- * under any number of misses, the calling simulator should limit the number
- * of outstanding misses or the number of hits under misses as per the
- * limitations of the particular microarchitecture being simulated.
+ * cache's block access function.  By default, the caches may service any
+ * number of hits under any number of misses.  A cache can instead be given
+ * a fixed number of miss status holding registers (MSHRs), see
+ * cache_set_mshrs(): each outstanding miss then holds an MSHR until its block
+ * is filled, later misses to the same block merge into that MSHR (up to a
+ * limit of targets per MSHR), and a miss that finds all the MSHRs busy waits
+ * until one is freed.  The calling simulator can use cache_mshr_avail() to
+ * hold back accesses that would have to wait.
  *
  * Due to the organization of this cache implementation, the latency of a
  * request cannot be affected by a later request to this module.  As a result,
  * reordering of requests in the memory hierarchy is not possible.
  */
 
-/* highly associative caches are implemented using a hash table lookup to
-   speed block access, this macro decides if a cache is "highly associative" */
-#define CACHE_HIGHLY_ASSOC(cp)	((cp)->assoc > 4)
-
 /* cache replacement policy */
 enum cache_policy {
   LRU,		/* replace least recently used block (perfect LRU) */
   Random,	/* replace a random block */
-  FIFO		/* replace the oldest block in the set */
+  FIFO,		/* replace the oldest block in the set */
+  PLRU,		/* tree pseudo-LRU */
+  SRRIP,	/* static re-reference interval prediction */
+  BRRIP,	/* bimodal RRIP, most blocks are inserted distant */
+  DRRIP,	/* dynamic RRIP, SRRIP or BRRIP picked by set dueling */
+  SHiP		/* signature-based hit prediction, on top of SRRIP */
+};
+
+/* non-zero if replacement policy POLICY uses re-reference predictions */
+#define CACHE_POLICY_RRIP(POLICY)					\
+  ((POLICY) == SRRIP || (POLICY) == BRRIP || (POLICY) == DRRIP		\
+   || (POLICY) == SHiP)
+
+/* re-reference prediction values (RRPV) are 2 bits, the maximum predicts a
+   distant re-reference, i.e., the block is replaced next */
+#define CACHE_RRPV_MAX		3
+
+/* BRRIP inserts one block in this many at a long, not distant, RRPV */
+#define CACHE_BRRIP_EPSILON	32
+
+/* DRRIP set dueling: number of leader sets per policy, and bits of the
+   policy selector, followers use BRRIP if its upper bit is set; at least
+   one set in CACHE_DUEL_MIN_STRIDE is a follower, so smaller caches have
+   fewer leaders */
+#define CACHE_DUEL_SETS		32
+#define CACHE_DUEL_MIN_STRIDE	4
+#define CACHE_PSEL_BITS		10
+
+/* SHiP: the signature of a block is its memory region, and the signature
+   history counter table holds 3-bit counters, indexed by a hash of the
+   signature */
+#define CACHE_SHIP_REGION_SHIFT	14
+#define CACHE_SHCT_SIZE		16384
+#define CACHE_SHCT_MAX		7
+
+/* miss status holding register (MSHR), tracks an outstanding miss */
+struct cache_mshr_t
+{
+  md_addr_t baddr;		/* address of the block being filled */
+  tick_t ready;			/* time when the block is filled and the MSHR
+				   is freed, the MSHR is free if <= now */
+  int targets;			/* number of accesses waiting on the block,
+				   the primary miss included */
 };
 
 /* block status values */
 #define CACHE_BLK_VALID		0x00000001	/* block in valid, in use */
 #define CACHE_BLK_DIRTY		0x00000002	/* dirty block */
+#define CACHE_BLK_REUSED	0x00000004	/* hit since filled, for SHiP */
+
+/* maximum cache associativity, block ages must fit in a cache_age_t */
+#define CACHE_MAX_ASSOC		65536
+
+/* block age, i.e., position in the replacement order of its set */
+typedef half_t cache_age_t;
 
-/* cache block (or line) definition */
+/* cache block (or line) definition, the tag and status of a block are kept
+   in the tag and status arrays of its set */
 struct cache_blk_t
 {
-  struct cache_blk_t *way_next;	/* next block in the ordered way chain, used
-				   to order blocks for replacement */
-  struct cache_blk_t *way_prev;	/* previous block in the order way chain */
-  struct cache_blk_t *hash_next;/* next block in the hash bucket chain, only
-				   used in highly-associative caches */
-  /* since hash table lists are typically small, there is no previous
-     pointer, deletion requires a trip through the hash table bucket list */
-  md_addr_t tag;		/* data block tag value */
-  unsigned int status;		/* block status, see CACHE_BLK_* defs above */
   tick_t ready;		/* time when block will be accessible, field
 				   is set when a miss fetch is initiated */
   byte_t *user_data;		/* pointer to user defined data, e.g.,
@@ -132,13 +175,19 @@ struct cache_blk_t
 				   should probably be a multiple of 8 */
 };
 
-/* cache set definition (one or more blocks sharing the same set index) */
+/* cache set definition (one or more blocks sharing the same set index),
+   entry I of the tag, status and age arrays belongs to block I of BLKS */
 struct cache_set_t
 {
-  struct cache_blk_t **hash;	/* hash table: for fast access w/assoc, NULL
-				   for low-assoc caches */
-  struct cache_blk_t *way_head;	/* head of way list */
-  struct cache_blk_t *way_tail;	/* tail pf way list */
+  md_addr_t *tags;		/* block tag values */
+  unsigned int *status;		/* block status, see CACHE_BLK_* defs above */
+  cache_age_t *ages;		/* block ages: 0 for the most recently used
+				   (LRU) or filled (FIFO) block, up to ASSOC-1
+				   for the block replaced next */
+  byte_t *rstate;		/* replacement state: the RRPV of each block
+				   (RRIP policies), or the ASSOC-1 tree bits
+				   (PLRU), NULL for other policies */
+  half_t *sigs;			/* SHiP signature of each block, or NULL */
   struct cache_blk_t *blks;	/* cache blocks, allocated sequentially, so
 				   this pointer can also be used for random
 				   access to cache blocks */
@@ -156,6 +205,26 @@ struct cache_t
   int assoc;			/* cache associativity */
   enum cache_policy policy;	/* cache replacement policy */
   unsigned int hit_latency;	/* cache hit latency */
+  int rand_private;		/* draw random replacements from RAND_STATE,
+				   see cache_seed_rand(), instead of the
+				   shared myrand() generator? */
+  unsigned int rand_state;	/* private random replacement generator */
+
+  /* replacement policy state */
+  int duel_stride;		/* DRRIP: one leader set per policy in this
+				   many sets */
+  int psel;			/* DRRIP: policy selector, this is policy
+				   state, not a stat, see the leader miss
+				   counters below */
+  unsigned int brrip_fills;	/* BRRIP fills, for the long insertions */
+  byte_t *shct;			/* SHiP: signature history counter table */
+
+  /* miss status holding registers, none if NMSHRS is zero, in which case
+     the number of outstanding misses is unlimited */
+  int nmshrs;			/* number of MSHRs */
+  int mshr_targets;		/* accesses that can wait on an MSHR, zero
+				   for no limit */
+  struct cache_mshr_t *mshrs;	/* MSHR file */
 
   /* miss/replacement handler, read/write BSIZE bytes starting at BADDR
      from/into cache block BLK, returns the latency of the operation
@@ -174,7 +243,6 @@ struct cache_t
 		     tick_t now);		/* when fetch was initiated */
 
   /* derived data, for fast decoding */
-  int hsize;			/* cache set hash table size */
   md_addr_t blk_mask;
   int set_shift;
   md_addr_t set_mask;		/* use *after* shift */
@@ -199,9 +267,30 @@ struct cache_t
   counter_t writebacks;		/* total number of writebacks at misses */
   counter_t invalidations;	/* total number of external invalidations */
 
+  /* replacement policy stats */
+  counter_t rrip_distant_fills;	/* blocks filled with a distant RRPV */
+  counter_t rrip_agings;	/* RRPVs of a set aged to find a victim */
+  counter_t drrip_srrip_misses;	/* misses in the SRRIP leader sets */
+  counter_t drrip_brrip_misses;	/* misses in the BRRIP leader sets */
+  counter_t drrip_brrip_fills;	/* follower set fills that used BRRIP */
+  counter_t ship_reused_evictions;/* evicted blocks that hit after fill */
+  counter_t ship_dead_evictions;/* evicted blocks that never hit */
+
+  /* MSHR stats */
+  counter_t mshr_allocs;	/* MSHRs allocated, i.e., primary misses */
+  counter_t mshr_merges;	/* secondary misses merged into an MSHR */
+  counter_t mshr_full;		/* misses that waited for a free MSHR */
+  counter_t mshr_busy_cycles;	/* total cycles MSHRs were held */
+
+  /* functional warming stats, see cache_warm() */
+  counter_t warm_hits;		/* total number of warming hits */
+  counter_t warm_misses;	/* total number of warming misses */
+  counter_t warm_writebacks;	/* total number of warming writebacks */
+
   /* last block to hit, used to optimize cache hit processing */
   md_addr_t last_tagset;	/* tag of last line accessed */
   struct cache_blk_t *last_blk;	/* cache block last accessed */
+  unsigned int *last_status;	/* status of the cache block last accessed */
 
   /* data blocks */
   byte_t *data;			/* pointer to data blocks allocation */
@@ -227,6 +316,22 @@ cache_create(char *name,		/* name of the cache */
 					   tick_t now),
 	     unsigned int hit_latency);/* latency in cycles for a hit */
 
+/* give cache CP NMSHRS miss status holding registers, each of which can
+   hold up to TARGETS accesses to the block being filled (zero for no limit),
+   all MSHRs are free at first */
+void
+cache_set_mshrs(struct cache_t *cp,	/* cache instance */
+		int nmshrs,		/* number of MSHRs */
+		int targets);		/* accesses per MSHR, 0 for no limit */
+
+/* give cache CP its own random replacement generator, seeded with SEED, by
+   default caches draw random replacements from the shared myrand()
+   generator, a simulator that accesses caches from several host threads,
+   e.g., sim-sweep, must seed each of them, so they do not share state */
+void
+cache_seed_rand(struct cache_t *cp,	/* cache instance */
+		unsigned int seed);	/* generator seed */
+
 /* parse policy */
 enum cache_policy			/* replacement policy enum */
 cache_char2policy(char c);		/* replacement policy as a char */
@@ -241,6 +346,11 @@ void
 cache_reg_stats(struct cache_t *cp,	/* cache instance */
 		struct stat_sdb_t *sdb);/* stats database */
 
+/* register cache functional warming stats */
+void
+cache_reg_warm_stats(struct cache_t *cp,	/* cache instance */
+		     struct stat_sdb_t *sdb);	/* stats database */
+
 /* print cache stats */
 void
 cache_stats(struct cache_t *cp,		/* cache instance */
@@ -264,6 +374,19 @@ cache_access(struct cache_t *cp,	/* cache to access */
 	     byte_t **udata,		/* for return of user data ptr */
 	     md_addr_t *repl_addr);	/* for address of replaced block */
 
+/* functionally warm cache CP with a CMD operation at address ADDR, i.e.,
+   update the block tags, dirty bits and replacement state as cache_access()
+   would, but without any latency bookkeeping (block ready times and bus
+   usage are untouched) and without calling the block access function, so
+   the caller must warm the next level of the memory hierarchy on a miss;
+   block data is not transferred, returns non-zero on a hit, on a miss,
+   *WB_ADDR is set to the address of the dirty block replaced, or zero */
+int					/* non-zero on a hit */
+cache_warm(struct cache_t *cp,		/* cache to warm */
+	   enum mem_cmd cmd,		/* access type, Read or Write */
+	   md_addr_t addr,		/* address of access */
+	   md_addr_t *wb_addr);		/* for address of dirty block replaced */
+
 /* cache access functions, these are safe, they check alignment and
    permissions */
 #define cache_double(cp, cmd, addr, p, now, udata)	\
@@ -279,6 +402,15 @@ cache_access(struct cache_t *cp,	/* cache to access */
 #define cache_byte(cp, cmd, addr, p, now, udata)	\
   cache_access(cp, cmd, addr, p, sizeof(char), now, udata)
 
+/* return non-zero if an access to address ADDR at NOW would be accepted by
+   cache CP without waiting for an MSHR, i.e., if it hits a filled block,
+   merges into the MSHR of a block being filled that has a target left, or
+   misses and finds a free MSHR; always non-zero if CP has no MSHRs */
+int					/* non-zero if access can proceed */
+cache_mshr_avail(struct cache_t *cp,	/* cache instance to check */
+		 md_addr_t addr,	/* address of access */
+		 tick_t now);		/* time of access */
+
 /* return non-zero if block containing address ADDR is contained in cache
    CP, this interface is used primarily for debugging and asserting cache
    invariants */
@@ -298,4 +430,15 @@ cache_flush_addr(struct cache_t *cp,	/* cache instance to flush */
 		 md_addr_t addr,	/* address of block to flush */
 		 tick_t now);		/* time of cache flush */
 
+/* write the contents of cache CP to checkpoint stream FD */
+void
+cache_chkpt_write(struct cache_t *cp,	/* cache instance to save */
+		  FILE *fd);		/* checkpoint stream */
+
+/* restore the contents of cache CP from checkpoint stream FD, all blocks
+   are ready at once, and the cache stats are unchanged */
+void
+cache_chkpt_read(struct cache_t *cp,	/* cache instance to restore */
+		 FILE *fd);		/* checkpoint stream */
+
 #endif /* CACHE_H */
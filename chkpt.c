@@ -0,0 +1,225 @@
+/* chkpt.c - binary microarchitectural checkpoint routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "regs.h"
+#include "memory.h"
+#include "loader.h"
+#include "chkpt.h"
+
+/* checkpoint file magic string */
+#define CHKPT_MAGIC			"SSCHKPT"
+
+/* maximum length of a section tag */
+#define CHKPT_TAG_SIZE			16
+
+/* write SIZE bytes at BUF to checkpoint stream FD */
+void
+chkpt_write(FILE *fd,				/* checkpoint stream */
+	    void *buf,				/* data to write */
+	    size_t size)			/* bytes to write */
+{
+  if (fwrite(buf, 1, size, fd) != size)
+    fatal("could not write checkpoint");
+}
+
+/* read SIZE bytes into BUF from checkpoint stream FD */
+void
+chkpt_read(FILE *fd,				/* checkpoint stream */
+	   void *buf,				/* buffer to read into */
+	   size_t size)				/* bytes to read */
+{
+  if (fread(buf, 1, size, fd) != size)
+    fatal("could not read checkpoint (truncated file?)");
+}
+
+/* write a checkpoint section tag TAG, which names the next structure */
+void
+chkpt_write_tag(FILE *fd,			/* checkpoint stream */
+		char *tag)			/* section tag */
+{
+  char buf[CHKPT_TAG_SIZE];
+
+  memset(buf, 0, CHKPT_TAG_SIZE);
+  strncpy(buf, tag, CHKPT_TAG_SIZE-1);
+  chkpt_write(fd, buf, CHKPT_TAG_SIZE);
+}
+
+/* read a checkpoint section tag, fatal if it is not TAG */
+void
+chkpt_read_tag(FILE *fd,			/* checkpoint stream */
+	       char *tag)			/* expected section tag */
+{
+  char buf[CHKPT_TAG_SIZE];
+
+  chkpt_read(fd, buf, CHKPT_TAG_SIZE);
+  buf[CHKPT_TAG_SIZE-1] = '\0';
+  if (strncmp(buf, tag, CHKPT_TAG_SIZE-1) != 0)
+    fatal("checkpoint has `%s' where `%s' was expected, "
+	  "was it written with another configuration?", buf, tag);
+}
+
+/* memory page visitor, counts the pages in the counter at DATA */
+static void
+chkpt_count_page(md_addr_t page_addr,		/* address of the page */
+		 byte_t *page,			/* host copy of the page */
+		 void *data)			/* page counter */
+{
+  (*(counter_t *)data)++;
+}
+
+/* memory page visitor, writes the page to the checkpoint stream DATA */
+static void
+chkpt_write_page(md_addr_t page_addr,		/* address of the page */
+		 byte_t *page,			/* host copy of the page */
+		 void *data)			/* checkpoint stream */
+{
+  CHKPT_WRITE_VAR((FILE *)data, page_addr);
+  chkpt_write((FILE *)data, page, MD_PAGE_SIZE);
+}
+
+/* write the checkpoint file header and the architected state to FD, ICNT is
+   the number of insts executed so far */
+void
+chkpt_write_arch(FILE *fd,			/* checkpoint stream */
+		 struct regs_t *regs,		/* registers to save */
+		 struct mem_t *mem,		/* memory to save */
+		 counter_t icnt)		/* insts executed */
+{
+  int version = CHKPT_FILE_VERSION, page_size = MD_PAGE_SIZE;
+  counter_t page_count;
+
+  /* header */
+  chkpt_write_tag(fd, CHKPT_MAGIC);
+  CHKPT_WRITE_VAR(fd, version);
+  CHKPT_WRITE_VAR(fd, page_size);
+  CHKPT_WRITE_VAR(fd, icnt);
+
+  /* registers */
+  chkpt_write_tag(fd, "regs");
+  chkpt_write(fd, regs, sizeof(struct regs_t));
+
+  /* loader segment state */
+  chkpt_write_tag(fd, "loader");
+  CHKPT_WRITE_VAR(fd, ld_text_base);
+  CHKPT_WRITE_VAR(fd, ld_text_size);
+  CHKPT_WRITE_VAR(fd, ld_data_base);
+  CHKPT_WRITE_VAR(fd, ld_data_size);
+  CHKPT_WRITE_VAR(fd, ld_brk_point);
+  CHKPT_WRITE_VAR(fd, ld_stack_base);
+  CHKPT_WRITE_VAR(fd, ld_stack_size);
+  CHKPT_WRITE_VAR(fd, ld_stack_min);
+
+  /* all active memory pages */
+  chkpt_write_tag(fd, "mem");
+  page_count = 0;
+  mem_forall_pages(mem, chkpt_count_page, &page_count);
+  CHKPT_WRITE_VAR(fd, page_count);
+  mem_forall_pages(mem, chkpt_write_page, fd);
+}
+
+/* read the checkpoint file header and the architected state from FD,
+   returns the number of insts executed when the checkpoint was written */
+counter_t
+chkpt_read_arch(FILE *fd,			/* checkpoint stream */
+		struct regs_t *regs,		/* registers to restore */
+		struct mem_t *mem)		/* memory to restore */
+{
+  int version, page_size;
+  counter_t icnt, page_count, n;
+  md_addr_t page_addr;
+
+  /* header */
+  chkpt_read_tag(fd, CHKPT_MAGIC);
+  CHKPT_READ_VAR(fd, version);
+  if (version != CHKPT_FILE_VERSION)
+    fatal("checkpoint file version %d is not supported", version);
+  CHKPT_READ_VAR(fd, page_size);
+  if (page_size != MD_PAGE_SIZE)
+    fatal("checkpoint page size does not match this simulator");
+  CHKPT_READ_VAR(fd, icnt);
+
+  /* registers */
+  chkpt_read_tag(fd, "regs");
+  chkpt_read(fd, regs, sizeof(struct regs_t));
+
+  /* loader segment state */
+  chkpt_read_tag(fd, "loader");
+  CHKPT_READ_VAR(fd, ld_text_base);
+  CHKPT_READ_VAR(fd, ld_text_size);
+  CHKPT_READ_VAR(fd, ld_data_base);
+  CHKPT_READ_VAR(fd, ld_data_size);
+  CHKPT_READ_VAR(fd, ld_brk_point);
+  CHKPT_READ_VAR(fd, ld_stack_base);
+  CHKPT_READ_VAR(fd, ld_stack_size);
+  CHKPT_READ_VAR(fd, ld_stack_min);
+
+  /* memory pages, the checkpoint holds every page that may be non-zero,
+     so the loaded program image is cleared before they are written, or
+     pages the program zeroed would come back with their loaded contents */
+  chkpt_read_tag(fd, "mem");
+  CHKPT_READ_VAR(fd, page_count);
+  mem_clear(mem);
+  for (n=0; n < page_count; n++)
+    {
+      CHKPT_READ_VAR(fd, page_addr);
+      MEM_TICKLE(mem, page_addr);
+      chkpt_read(fd, MEM_PAGE(mem, page_addr), MD_PAGE_SIZE);
+    }
+
+  return icnt;
+}
@@ -0,0 +1,120 @@
+/* chkpt.h - binary microarchitectural checkpoint interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef CHKPT_H
+#define CHKPT_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "regs.h"
+#include "memory.h"
+
+/*
+ * Binary checkpoints save the architected state of a program (registers,
+ * memory and the loader's segment state) together with the state of the
+ * microarchitectural structures that take long to warm up, e.g., caches,
+ * TLBs and branch predictors, so that a warmed-up machine can be restored
+ * instead of re-warmed.  Each structure writes its own state with the
+ * primitives below, e.g., cache_chkpt_write() and bpred_chkpt_write(), and
+ * the simulator writes the structures in a fixed order.  Checkpoints are in
+ * host byte order, and are only valid for the simulator and configuration
+ * that wrote them.  NOTE: the state of files opened by the simulated program
+ * is not saved, use EIO traces for programs that depend on it.
+ */
+
+/* binary checkpoint file version */
+#define CHKPT_FILE_VERSION		1
+
+/* write SIZE bytes at BUF to checkpoint stream FD */
+void
+chkpt_write(FILE *fd,				/* checkpoint stream */
+	    void *buf,				/* data to write */
+	    size_t size);			/* bytes to write */
+
+/* read SIZE bytes into BUF from checkpoint stream FD */
+void
+chkpt_read(FILE *fd,				/* checkpoint stream */
+	   void *buf,				/* buffer to read into */
+	   size_t size);			/* bytes to read */
+
+/* write/read variable VAR to/from checkpoint stream FD */
+#define CHKPT_WRITE_VAR(FD, VAR)	chkpt_write((FD), &(VAR), sizeof(VAR))
+#define CHKPT_READ_VAR(FD, VAR)		chkpt_read((FD), &(VAR), sizeof(VAR))
+
+/* write a checkpoint section tag TAG, which names the next structure */
+void
+chkpt_write_tag(FILE *fd,			/* checkpoint stream */
+		char *tag);			/* section tag */
+
+/* read a checkpoint section tag, fatal if it is not TAG */
+void
+chkpt_read_tag(FILE *fd,			/* checkpoint stream */
+	       char *tag);			/* expected section tag */
+
+/* write the checkpoint file header and the architected state to FD, ICNT is
+   the number of insts executed so far */
+void
+chkpt_write_arch(FILE *fd,			/* checkpoint stream */
+		 struct regs_t *regs,		/* registers to save */
+		 struct mem_t *mem,		/* memory to save */
+		 counter_t icnt);		/* insts executed */
+
+/* read the checkpoint file header and the architected state from FD,
+   returns the number of insts executed when the checkpoint was written */
+counter_t
+chkpt_read_arch(FILE *fd,			/* checkpoint stream */
+		struct regs_t *regs,		/* registers to restore */
+		struct mem_t *mem);		/* memory to restore */
+
+#endif /* CHKPT_H */
@@ -0,0 +1,855 @@
+/* dbt.c - native code translation of basic blocks routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <sys/mman.h>
+#endif
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "regs.h"
+#include "memory.h"
+#include "loader.h"
+#include "stats.h"
+#include "dbt.h"
+
+/* translation stats */
+static counter_t dbt_blocks = 0;	/* blocks translated */
+static counter_t dbt_insts = 0;		/* insts translated */
+static counter_t dbt_rejects = 0;	/* blocks that could not be translated */
+static counter_t dbt_code_bytes = 0;	/* native code generated, in bytes */
+
+#if defined(__GNUC__) && defined(__x86_64__) && defined(TARGET_PISA) \
+    && !defined(MD_CROSS_ENDIAN)
+
+/*
+ * x86-64 code generator for PISA blocks: the translated code of a block is
+ * a function called with the register file in RDI and the memory in RSI,
+ * each instruction reads its operands from the register file, computes its
+ * result in RAX, RCX, RDX, R8 or XMM0, and writes it back to the register
+ * file before the next instruction starts, so the simulated state is
+ * precise at every instruction boundary and any instruction may leave the
+ * block through an exit that returns the number of instructions executed
+ * before it
+ */
+
+/* size of the native code buffer, in bytes */
+#define DBT_CODE_SIZE		(16*1024*1024)
+
+/* maximum number of insts in a block */
+#define DBT_MAX_INSTS		64
+
+/* upper bounds of the native code of one inst, and of one exit */
+#define DBT_MAX_INST_CODE	128
+#define DBT_MAX_EXIT_CODE	16
+
+/* maximum number of exits of one inst */
+#define DBT_MAX_INST_EXITS	5
+
+/* native code buffer, and the number of bytes of it used */
+static byte_t *dbt_code = NULL;
+static unsigned int dbt_code_used = 0;
+
+/* next byte of the native code being generated */
+static byte_t *cp;
+
+/* host base of the memory accessed by the block being translated, if it is
+   a flat memory space, the only segment of the 32-bit PISA address space */
+static byte_t *flat_base;
+
+/* jumps to the exits of the block being translated: the location of the
+   32-bit displacement of each jump, and the inst it leaves the block at */
+static byte_t *exit_disp[DBT_MAX_INSTS * DBT_MAX_INST_EXITS];
+static int exit_inst[DBT_MAX_INSTS * DBT_MAX_INST_EXITS];
+static int num_exits;
+
+/* x86-64 registers */
+#define rAX		0
+#define rCX		1
+#define rDX		2
+#define rSP		4
+#define rSI		6
+#define rDI		7
+#define r8		8
+#define xmm0		0
+
+/* x86-64 condition codes */
+#define cc_B		0x2
+#define cc_E		0x4
+#define cc_NE		0x5
+#define cc_A		0x7
+#define cc_L		0xc
+#define cc_GE		0xd
+#define cc_LE		0xe
+#define cc_G		0xf
+
+/* x86-64 ALU opcodes, register to register, and opcode extensions of the
+   immediate forms */
+#define ALU_ADD		0x01
+#define ALU_OR		0x09
+#define ALU_AND		0x21
+#define ALU_SUB		0x29
+#define ALU_XOR		0x31
+#define ALU_CMP		0x39
+#define ALU_TEST	0x85
+#define IMM_ADD		0
+#define IMM_OR		1
+#define IMM_AND		4
+#define IMM_SUB		5
+#define IMM_XOR		6
+#define IMM_CMP		7
+#define SHIFT_SHL	4
+#define SHIFT_SHR	5
+#define SHIFT_SAR	7
+
+/* ModRM and SIB bytes */
+#define MODRM(MOD, REG, RM)	((((MOD) & 3) << 6) | (((REG) & 7) << 3) | ((RM) & 7))
+#define SIB(SCALE, IDX, BASE)	((((SCALE) & 3) << 6) | (((IDX) & 7) << 3) | ((BASE) & 7))
+
+/* register file field offsets */
+#define OFS_GPR(N)	(offsetof(struct regs_t, regs_R) + (N) * sizeof(sword_t))
+#define OFS_FPR_L(N)	(offsetof(struct regs_t, regs_F.l) + (N) * sizeof(sword_t))
+#define OFS_FPR_F(N)	(offsetof(struct regs_t, regs_F.f) + (N) * sizeof(sfloat_t))
+#define OFS_FPR_D(N)							\
+  (offsetof(struct regs_t, regs_F.d) + ((N) >> 1) * sizeof(dfloat_t))
+#define OFS_HI		offsetof(struct regs_t, regs_C.hi)
+#define OFS_LO		offsetof(struct regs_t, regs_C.lo)
+#define OFS_PC		offsetof(struct regs_t, regs_PC)
+#define OFS_NPC		offsetof(struct regs_t, regs_NPC)
+
+/* emit a byte, and a 32-bit word */
+static void
+emit(int b)
+{
+  *cp++ = (byte_t)b;
+}
+
+static void
+emit_word(word_t w)
+{
+  memcpy(cp, &w, sizeof(word_t));
+  cp += sizeof(word_t);
+}
+
+/* emit the ModRM byte and displacement of register file field DISP, REG
+   is the register or opcode extension of the instruction */
+static void
+emit_regs_operand(int reg, int disp)
+{
+  emit(MODRM(2, reg, rDI));
+  emit_word(disp);
+}
+
+/* emit the ModRM and SIB bytes of the host memory operand [RDX + RCX], as
+   set up by emit_mem_addr() */
+static void
+emit_page_operand(int reg)
+{
+  emit(MODRM(0, reg, rSP));
+  emit(SIB(0, rCX, rDX));
+}
+
+/* R = register file field DISP */
+static void
+emit_load_field(int r, int disp)
+{
+  if (r >= r8)
+    emit(0x44);
+  emit(0x8b);
+  emit_regs_operand(r, disp);
+}
+
+/* register file field DISP = R */
+static void
+emit_store_field(int r, int disp)
+{
+  if (r >= r8)
+    emit(0x44);
+  emit(0x89);
+  emit_regs_operand(r, disp);
+}
+
+/* register file field DISP = IMM */
+static void
+emit_store_imm(int disp, word_t imm)
+{
+  emit(0xc7);
+  emit_regs_operand(0, disp);
+  emit_word(imm);
+}
+
+/* R = GPR N, $r0 reads as zero, its register file entry may hold the
+   result of an inst executed by the engine */
+static void
+emit_load_gpr(int r, int n)
+{
+  if (n == MD_REG_ZERO)
+    {
+      if (r >= r8)
+	emit(0x45);
+      emit(ALU_XOR);
+      emit(MODRM(3, r, r));
+    }
+  else
+    emit_load_field(r, OFS_GPR(n));
+}
+
+/* GPR N = R, writes to $r0 are dropped */
+static void
+emit_store_gpr(int r, int n)
+{
+  if (n != MD_REG_ZERO)
+    emit_store_field(r, OFS_GPR(n));
+}
+
+/* DST = DST op SRC, for ALU_* opcodes */
+static void
+emit_alu(int op, int dst, int src)
+{
+  emit(op);
+  emit(MODRM(3, src, dst));
+}
+
+/* DST = DST op IMM, for IMM_* opcode extensions */
+static void
+emit_alu_imm(int ext, int dst, word_t imm)
+{
+  emit(0x81);
+  emit(MODRM(3, ext, dst));
+  emit_word(imm);
+}
+
+/* DST = DST shifted by N, or by CL if N is negative */
+static void
+emit_shift(int ext, int dst, int n)
+{
+  if (n < 0)
+    {
+      emit(0xd3);
+      emit(MODRM(3, ext, dst));
+    }
+  else
+    {
+      emit(0xc1);
+      emit(MODRM(3, ext, dst));
+      emit(n);
+    }
+}
+
+/* DST = IMM */
+static void
+emit_mov_imm(int dst, word_t imm)
+{
+  emit(0xb8 + dst);
+  emit_word(imm);
+}
+
+/* DST = SRC */
+static void
+emit_mov(int dst, int src)
+{
+  emit(0x89);
+  emit(MODRM(3, src, dst));
+}
+
+/* EAX = condition CC of the flags, i.e., 0 or 1 */
+static void
+emit_setcc(int cc)
+{
+  /* setcc al; movzx eax, al */
+  emit(0x0f); emit(0x90 + cc); emit(MODRM(3, 0, rAX));
+  emit(0x0f); emit(0xb6); emit(MODRM(3, rAX, rAX));
+}
+
+/* leave the block at inst I if condition CC of the flags holds */
+static void
+emit_exit_if(int cc, int i)
+{
+  emit(0x0f); emit(0x80 + cc);
+  exit_disp[num_exits] = cp;
+  exit_inst[num_exits] = i;
+  num_exits++;
+  emit_word(0);
+}
+
+/* leave the block at inst I if any of the bits MASK of AL are set */
+static void
+emit_exit_if_al(int mask, int i)
+{
+  /* test al, mask */
+  emit(0xa8); emit(mask);
+  emit_exit_if(cc_NE, i);
+}
+
+/* translate the memory address of load/store INST, the I-th inst of the
+   block, accessing SIZE bytes, to its host page in RDX and page offset in
+   RCX, as MEM_PAGE() does, leaving the block on anything but a first level
+   page table hit, on misaligned accesses (which may span pages), and on
+   stores to the text segment, which may write translated code; in a flat
+   memory space, RDX is the host base of the space and RCX the address */
+static void
+emit_mem_addr(md_inst_t inst, int i, int size, int is_store)
+{
+  /* EAX = effective address */
+  emit_load_gpr(rAX, BS);
+  if (OFS != 0)
+    emit_alu_imm(IMM_ADD, rAX, OFS);
+  if (size > 1)
+    emit_exit_if_al(size - 1, i);
+
+  if (is_store)
+    {
+      /* leave the block if ADDR - ld_text_base < ld_text_size */
+      emit_mov(rCX, rAX);
+      emit_alu_imm(IMM_SUB, rCX, ld_text_base);
+      emit_alu_imm(IMM_CMP, rCX, ld_text_size);
+      emit_exit_if(cc_B, i);
+    }
+
+  if (flat_base)
+    {
+      /* mov rdx, imm64; RCX = ADDR, zero extended */
+      emit(0x48); emit(0xb8 + rDX);
+      memcpy(cp, &flat_base, sizeof(byte_t *));
+      cp += sizeof(byte_t *);
+      emit_mov(rCX, rAX);
+      return;
+    }
+
+  /* RDX = mem->ptab[MEM_PTAB_SET(ADDR)] */
+  emit_mov(rCX, rAX);
+  emit_shift(SHIFT_SHR, rCX, MD_LOG_PAGE_SIZE);
+  emit_alu_imm(IMM_AND, rCX, MEM_PTAB_SIZE - 1);
+  emit(0x48); emit(0x8b);
+  emit(MODRM(2, rDX, rSP)); emit(SIB(3, rCX, rSI));
+  emit_word(offsetof(struct mem_t, ptab));
+
+  /* leave the block if the entry is NULL */
+  emit(0x48); emit_alu(ALU_TEST, rDX, rDX);
+  emit_exit_if(cc_E, i);
+
+  /* leave the block if entry->tag != MEM_PTAB_TAG(ADDR) */
+  emit_mov(rCX, rAX);
+  emit_shift(SHIFT_SHR, rCX, MD_LOG_PAGE_SIZE + MEM_LOG_PTAB_SIZE);
+  emit(ALU_CMP); emit(MODRM(2, rCX, rDX));
+  emit_word(offsetof(struct mem_pte_t, tag));
+  emit_exit_if(cc_NE, i);
+
+  /* RDX = entry->page, RCX = MEM_OFFSET(ADDR) */
+  emit(0x48); emit(0x8b); emit(MODRM(2, rDX, rDX));
+  emit_word(offsetof(struct mem_pte_t, page));
+  emit_mov(rCX, rAX);
+  emit_alu_imm(IMM_AND, rCX, MD_PAGE_SIZE - 1);
+}
+
+/* FP register file field N = field N op field T, OP is the SSE opcode and
+   PREFIX selects single (0xf3) or double (0xf2) precision */
+static void
+emit_fp_op(int prefix, int op, int d, int s, int t)
+{
+  /* movs? xmm0, [s]; op xmm0, [t]; movs? [d], xmm0 */
+  emit(prefix); emit(0x0f); emit(0x10); emit_regs_operand(xmm0, s);
+  emit(prefix); emit(0x0f); emit(op); emit_regs_operand(xmm0, t);
+  emit(prefix); emit(0x0f); emit(0x11); emit_regs_operand(xmm0, d);
+}
+
+/* REGS_NPC = the branch target of INST at PC if condition CC of the flags
+   holds, else the next inst */
+static void
+emit_branch(int cc, md_inst_t inst, md_addr_t PC)
+{
+  /* the moves leave the flags alone */
+  emit_mov_imm(rAX, PC + sizeof(md_inst_t));
+  emit_mov_imm(rDX, PC + 8 + (OFS << 2));
+  emit(0x0f); emit(0x40 + cc); emit(MODRM(3, rAX, rDX));
+  emit_store_field(rAX, OFS_NPC);
+}
+
+/* translate INST at PC, the I-th inst of the block, returns zero if the
+   inst is not supported; the translation of each inst follows its
+   implementation in machine.def, including the cases where a fault ends
+   the implementation early, which leave the block or are not supported */
+static int
+dbt_inst(md_inst_t inst,		/* inst to translate */
+	 md_addr_t PC,			/* address of the inst */
+	 int i)				/* index of the inst in the block */
+{
+  enum md_opcode op;
+
+  MD_SET_OPCODE(op, inst);
+  switch (op)
+    {
+    case NOP:
+      break;
+
+      /* integer ALU */
+    case ADDU:
+    case SUBU:
+    case AND_:
+    case OR:
+    case XOR:
+    case NOR:
+      emit_load_gpr(rAX, RS);
+      emit_load_gpr(rCX, RT);
+      emit_alu(op == ADDU ? ALU_ADD : op == SUBU ? ALU_SUB
+	       : op == AND_ ? ALU_AND : op == XOR ? ALU_XOR : ALU_OR,
+	       rAX, rCX);
+      if (op == NOR)
+	{
+	  /* not eax */
+	  emit(0xf7); emit(MODRM(3, 2, rAX));
+	}
+      emit_store_gpr(rAX, RD);
+      break;
+
+    case ADDIU:
+      emit_load_gpr(rAX, RS);
+      emit_alu_imm(IMM_ADD, rAX, IMM);
+      emit_store_gpr(rAX, RT);
+      break;
+
+    case ANDI:
+    case ORI:
+    case XORI:
+      emit_load_gpr(rAX, RS);
+      emit_alu_imm(op == ANDI ? IMM_AND : op == ORI ? IMM_OR : IMM_XOR,
+		   rAX, UIMM);
+      emit_store_gpr(rAX, RT);
+      break;
+
+    case LUI:
+      emit_mov_imm(rAX, UIMM << 16);
+      emit_store_gpr(rAX, RT);
+      break;
+
+    case SLT:
+    case SLTU:
+      emit_load_gpr(rAX, RS);
+      emit_load_gpr(rCX, RT);
+      emit_alu(ALU_CMP, rAX, rCX);
+      emit_setcc(op == SLT ? cc_L : cc_B);
+      emit_store_gpr(rAX, RD);
+      break;
+
+    case SLTI:
+    case SLTIU:
+      emit_load_gpr(rAX, RS);
+      emit_alu_imm(IMM_CMP, rAX, IMM);
+      emit_setcc(op == SLTI ? cc_L : cc_B);
+      emit_store_gpr(rAX, RT);
+      break;
+
+    case SLL:
+    case SRL:
+    case SRA:
+      if (SHAMT > 31)
+	return FALSE;
+      emit_load_gpr(rAX, RT);
+      emit_shift(op == SLL ? SHIFT_SHL : op == SRL ? SHIFT_SHR : SHIFT_SAR,
+		 rAX, SHAMT);
+      emit_store_gpr(rAX, RD);
+      break;
+
+    case SLLV:
+    case SRLV:
+    case SRAV:
+      /* the shift count is masked to 5 bits, as by the host */
+      emit_load_gpr(rAX, RT);
+      emit_load_gpr(rCX, RS);
+      emit_shift(op == SLLV ? SHIFT_SHL : op == SRLV ? SHIFT_SHR : SHIFT_SAR,
+		 rAX, -1);
+      emit_store_gpr(rAX, RD);
+      break;
+
+    case MULT:
+    case MULTU:
+      /* HI,LO = the 64-bit product of the sign or zero extended operands */
+      emit_load_gpr(rAX, RS);
+      emit_load_gpr(rCX, RT);
+      if (op == MULT)
+	{
+	  /* movsxd rax, eax; movsxd rcx, ecx */
+	  emit(0x48); emit(0x63); emit(MODRM(3, rAX, rAX));
+	  emit(0x48); emit(0x63); emit(MODRM(3, rCX, rCX));
+	}
+      /* imul rax, rcx */
+      emit(0x48); emit(0x0f); emit(0xaf); emit(MODRM(3, rAX, rCX));
+      emit_store_field(rAX, OFS_LO);
+      emit(0x48); emit_shift(SHIFT_SHR, rAX, 32);
+      emit_store_field(rAX, OFS_HI);
+      break;
+
+    case MFHI:
+    case MFLO:
+      emit_load_field(rAX, op == MFHI ? OFS_HI : OFS_LO);
+      emit_store_gpr(rAX, RD);
+      break;
+
+    case MTHI:
+    case MTLO:
+      emit_load_gpr(rAX, RS);
+      emit_store_field(rAX, op == MTHI ? OFS_HI : OFS_LO);
+      break;
+
+      /* loads and stores */
+    case LB:
+    case LBU:
+    case LH:
+    case LHU:
+    case LW:
+      emit_mem_addr(inst, i, (op == LW ? 4 : (op == LH || op == LHU) ? 2 : 1),
+		    /* store */FALSE);
+      if (op == LW)
+	emit(0x8b);
+      else
+	{
+	  /* movsx/movzx eax, byte/word [rdx + rcx] */
+	  emit(0x0f);
+	  emit(op == LB ? 0xbe : op == LBU ? 0xb6 : op == LH ? 0xbf : 0xb7);
+	}
+      emit_page_operand(rAX);
+      emit_store_gpr(rAX, RT);
+      break;
+
+    case SB:
+    case SH:
+    case SW:
+      emit_load_gpr(r8, RT);
+      emit_mem_addr(inst, i, (op == SW ? 4 : op == SH ? 2 : 1),
+		    /* store */TRUE);
+      if (op == SH)
+	emit(0x66);
+      emit(0x44);
+      emit(op == SB ? 0x88 : 0x89);
+      emit_page_operand(r8);
+      break;
+
+    case L_S:
+      emit_mem_addr(inst, i, 4, /* store */FALSE);
+      emit(0x8b); emit_page_operand(rAX);
+      emit_store_field(rAX, OFS_FPR_L(FT));
+      break;
+
+    case S_S:
+      emit_load_field(r8, OFS_FPR_L(FT));
+      emit_mem_addr(inst, i, 4, /* store */TRUE);
+      emit(0x44); emit(0x89); emit_page_operand(r8);
+      break;
+
+    case L_D:
+      /* the two words go to FT and FT+1, i.e., one host quad word */
+      if (FT & 01)
+	return FALSE;
+      emit_mem_addr(inst, i, 8, /* store */FALSE);
+      emit(0x48); emit(0x8b); emit_page_operand(rAX);
+      emit(0x48); emit_store_field(rAX, OFS_FPR_L(FT));
+      break;
+
+    case S_D:
+      if (FT & 01)
+	return FALSE;
+      emit(0x4c); emit(0x8b); emit_regs_operand(r8, OFS_FPR_L(FT));
+      emit_mem_addr(inst, i, 8, /* store */TRUE);
+      emit(0x4c); emit(0x89); emit_page_operand(r8);
+      break;
+
+      /* floating point */
+    case MFC1:
+      emit_load_field(rAX, OFS_FPR_L(FS));
+      emit_store_gpr(rAX, RT);
+      break;
+
+    case MTC1:
+      emit_load_gpr(rAX, RT);
+      emit_store_field(rAX, OFS_FPR_L(FS));
+      break;
+
+    case FADD_S:
+    case FSUB_S:
+    case FMUL_S:
+    case FDIV_S:
+      if ((FD & 01) || (FS & 01) || (FT & 01))
+	return FALSE;
+      emit_fp_op(0xf3, (op == FADD_S ? 0x58 : op == FSUB_S ? 0x5c
+			: op == FMUL_S ? 0x59 : 0x5e),
+		 OFS_FPR_F(FD), OFS_FPR_F(FS), OFS_FPR_F(FT));
+      break;
+
+    case FADD_D:
+    case FSUB_D:
+    case FMUL_D:
+    case FDIV_D:
+      if ((FD & 01) || (FS & 01) || (FT & 01))
+	return FALSE;
+      emit_fp_op(0xf2, (op == FADD_D ? 0x58 : op == FSUB_D ? 0x5c
+			: op == FMUL_D ? 0x59 : 0x5e),
+		 OFS_FPR_D(FD), OFS_FPR_D(FS), OFS_FPR_D(FT));
+      break;
+
+    case FMOV_S:
+    case FMOV_D:
+      if ((FD & 01) || (FS & 01))
+	return FALSE;
+      if (op == FMOV_D)
+	{
+	  emit(0x48); emit_load_field(rAX, OFS_FPR_D(FS));
+	  emit(0x48); emit_store_field(rAX, OFS_FPR_D(FD));
+	}
+      else
+	{
+	  emit_load_field(rAX, OFS_FPR_F(FS));
+	  emit_store_field(rAX, OFS_FPR_F(FD));
+	}
+      break;
+
+      /* control, always the last inst of the block */
+    case JUMP:
+    case JAL:
+      if (op == JAL)
+	emit_store_imm(OFS_GPR(31), PC + 8);
+      emit_store_imm(OFS_NPC, (PC & 036000000000) | (TARG << 2));
+      break;
+
+    case JR:
+    case JALR:
+      emit_load_gpr(rAX, RS);
+      emit_exit_if_al(0x7, i);
+      if (op == JALR && RD != MD_REG_ZERO)
+	{
+	  emit_store_imm(OFS_GPR(RD), PC + 8);
+	  if (RD == RS)
+	    {
+	      /* the target is read after the link register is written */
+	      emit_store_imm(OFS_NPC, PC + 8);
+	      break;
+	    }
+	}
+      emit_store_field(rAX, OFS_NPC);
+      break;
+
+    case BEQ:
+    case BNE:
+      emit_load_gpr(rAX, RS);
+      emit_load_gpr(rCX, RT);
+      emit_alu(ALU_CMP, rAX, rCX);
+      emit_branch(op == BEQ ? cc_E : cc_NE, inst, PC);
+      break;
+
+    case BLEZ:
+    case BGTZ:
+    case BLTZ:
+    case BGEZ:
+      emit_load_gpr(rAX, RS);
+      emit_alu(ALU_TEST, rAX, rAX);
+      emit_branch(op == BLEZ ? cc_LE : op == BGTZ ? cc_G
+		  : op == BLTZ ? cc_L : cc_GE, inst, PC);
+      break;
+
+    default:
+      /* not supported, including system calls */
+      return FALSE;
+    }
+  return TRUE;
+}
+
+/* initialize the translator, returns zero if the host cannot run
+   translated code */
+int
+dbt_init(void)
+{
+  dbt_code = (byte_t *)mmap(NULL, DBT_CODE_SIZE,
+			    PROT_READ|PROT_WRITE|PROT_EXEC,
+			    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (dbt_code == (byte_t *)MAP_FAILED)
+    {
+      warn("cannot allocate executable memory, blocks are not translated");
+      dbt_code = NULL;
+      return FALSE;
+    }
+  dbt_code_used = 0;
+  return TRUE;
+}
+
+/* translate the basic block of NINSTS instructions INSTS at address PC,
+   which accesses memory MEM, returns NULL if the block cannot be
+   translated */
+dbt_code_t
+dbt_translate(struct mem_t *mem,	/* memory accessed by the block */
+	      md_addr_t PC,		/* address of the block */
+	      md_inst_t *insts,		/* instructions of the block */
+	      int ninsts)		/* number of instructions */
+{
+  byte_t *start, *exit_code[DBT_MAX_INSTS];
+  md_addr_t last_PC = PC + (ninsts - 1) * sizeof(md_inst_t);
+  enum md_opcode op;
+  int i;
+
+  if (!dbt_code
+      || ninsts > DBT_MAX_INSTS
+      || (dbt_code_used + ninsts * (DBT_MAX_INST_CODE + DBT_MAX_EXIT_CODE)
+	  + DBT_MAX_INST_CODE > DBT_CODE_SIZE))
+    {
+      dbt_rejects++;
+      return NULL;
+    }
+
+  start = cp = dbt_code + dbt_code_used;
+  num_exits = 0;
+  flat_base = mem->flat ? mem->seg_base : NULL;
+  for (i=0; i < ninsts; i++)
+    {
+      if (!dbt_inst(insts[i], PC + i * sizeof(md_inst_t), i))
+	{
+	  dbt_rejects++;
+	  return NULL;
+	}
+    }
+
+  /* blocks that do not end with a control inst continue at the next inst,
+     then return the number of insts executed */
+  MD_SET_OPCODE(op, insts[ninsts - 1]);
+  if (!(MD_OP_FLAGS(op) & F_CTRL))
+    emit_store_imm(OFS_NPC, last_PC + sizeof(md_inst_t));
+  emit_store_imm(OFS_PC, last_PC);
+  emit_mov_imm(rAX, ninsts);
+  emit(0xc3);
+
+  /* the exits, one per inst that has any, leave the address of the inst in
+     REGS_NPC and return the number of insts executed before it */
+  for (i=0; i < ninsts; i++)
+    exit_code[i] = NULL;
+  for (i=0; i < num_exits; i++)
+    {
+      int inst = exit_inst[i];
+      sword_t disp;
+
+      if (!exit_code[inst])
+	{
+	  exit_code[inst] = cp;
+	  emit_store_imm(OFS_NPC, PC + inst * sizeof(md_inst_t));
+	  emit_mov_imm(rAX, inst);
+	  emit(0xc3);
+	}
+      disp = exit_code[inst] - (exit_disp[i] + sizeof(word_t));
+      memcpy(exit_disp[i], &disp, sizeof(word_t));
+    }
+
+  /* keep the blocks 16-byte aligned */
+  dbt_code_used = ((cp - dbt_code) + 15) & ~15;
+  dbt_code_bytes += cp - start;
+  dbt_blocks++;
+  dbt_insts += ninsts;
+
+  return (dbt_code_t)start;
+}
+
+/* discard all translated code */
+void
+dbt_flush(void)
+{
+  dbt_code_used = 0;
+}
+
+#else /* !x86-64 host with a PISA target */
+
+/* initialize the translator, returns zero if the host cannot run
+   translated code */
+int
+dbt_init(void)
+{
+  /* no code generator for this host and target */
+  return FALSE;
+}
+
+/* translate the basic block of NINSTS instructions INSTS at address PC,
+   which accesses memory MEM, returns NULL if the block cannot be
+   translated */
+dbt_code_t
+dbt_translate(struct mem_t *mem,	/* memory accessed by the block */
+	      md_addr_t PC,		/* address of the block */
+	      md_inst_t *insts,		/* instructions of the block */
+	      int ninsts)		/* number of instructions */
+{
+  dbt_rejects++;
+  return NULL;
+}
+
+/* discard all translated code */
+void
+dbt_flush(void)
+{
+  /* nada */
+}
+
+#endif /* x86-64 host with a PISA target */
+
+/* register translator statistics */
+void
+dbt_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
+{
+  stat_reg_counter(sdb, "dbt.blocks",
+		   "total number of blocks translated to native code",
+		   &dbt_blocks, /* initial value */0, /* format */NULL);
+  stat_reg_counter(sdb, "dbt.insts",
+		   "total number of insts translated to native code",
+		   &dbt_insts, /* initial value */0, /* format */NULL);
+  stat_reg_counter(sdb, "dbt.rejects",
+		   "total number of blocks that could not be translated",
+		   &dbt_rejects, /* initial value */0, /* format */NULL);
+  stat_reg_counter(sdb, "dbt.code_bytes",
+		   "total native code generated (in bytes)",
+		   &dbt_code_bytes, /* initial value */0, /* format */NULL);
+}
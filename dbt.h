@@ -0,0 +1,107 @@
+/* dbt.h - native code translation of basic blocks interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef DBT_H
+#define DBT_H
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "regs.h"
+#include "memory.h"
+#include "stats.h"
+
+/*
+ * This module translates the basic blocks of the fast functional engine
+ * (see fastfwd.c) into native host code.  A translated block keeps the
+ * simulated registers in the register file structure and accesses memory
+ * through the page table of the memory module (or the host base of a flat
+ * memory space), inline; only the common case
+ * of each instruction is translated, anything else (a page that is not in
+ * the first level of the page table, a misaligned access, a store to the
+ * text segment, a misaligned jump target) leaves the block and lets the
+ * engine execute the instruction.  Blocks with system calls or with
+ * instructions the translator does not support are not translated at all.
+ * Translation is only available where the host and target are supported,
+ * currently an x86-64 host with a PISA target, elsewhere dbt_init() fails.
+ */
+
+/* native code of a translated block, executes the block with registers
+   REGS and memory MEM, and returns the number of instructions executed;
+   the block is executed to its end, leaving the address of the next
+   instruction in REGS->REGS_NPC, unless an instruction must be executed by
+   the engine, in which case the instructions that precede it are executed
+   and its address is left in REGS->REGS_NPC */
+typedef int (*dbt_code_t)(struct regs_t *regs, struct mem_t *mem);
+
+/* initialize the translator, returns zero if the host cannot run
+   translated code */
+int
+dbt_init(void);
+
+/* translate the basic block of NINSTS instructions INSTS at address PC,
+   which accesses memory MEM, returns NULL if the block cannot be
+   translated */
+dbt_code_t
+dbt_translate(struct mem_t *mem,	/* memory accessed by the block */
+	      md_addr_t PC,		/* address of the block */
+	      md_inst_t *insts,		/* instructions of the block */
+	      int ninsts);		/* number of instructions */
+
+/* discard all translated code */
+void
+dbt_flush(void);
+
+/* register translator statistics */
+void
+dbt_reg_stats(struct stat_sdb_t *sdb);	/* stats database */
+
+#endif /* DBT_H */
@@ -203,6 +203,32 @@ eio_close(FILE *fd)
   gzclose(fd);
 }
 
+/* memory page visitor, counts the pages in the counter at DATA */
+static void
+eio_count_page(md_addr_t page_addr,		/* address of the page */
+	       byte_t *page,			/* host copy of the page */
+	       void *data)			/* page counter */
+{
+  (*(int *)data)++;
+}
+
+/* memory page visitor, dumps the page to the checkpoint stream DATA */
+static void
+eio_write_page(md_addr_t page_addr,		/* address of the page */
+	       byte_t *page,			/* host copy of the page */
+	       void *data)			/* checkpoint stream */
+{
+  struct exo_term_t *exo;
+
+  exo = exo_new(ec_list,
+		exo_new(ec_address, (exo_integer_t)page_addr),
+		exo_new(ec_blob, MD_PAGE_SIZE, page),
+		NULL);
+  exo_print(exo, (FILE *)data);
+  fprintf((FILE *)data, "\n\n");
+  exo_delete(exo);
+}
+
 /* check point current architected state to stream FD, returns
    EIO transaction count (an EIO file pointer) */
 counter_t
@@ -210,9 +236,8 @@ eio_write_chkpt(struct regs_t *regs,		/* regs to dump */
 		struct mem_t *mem,		/* memory to dump */
 		FILE *fd)			/* stream to write to */
 {
-  int i;
+  int i, page_count;
   struct exo_term_t *exo;
-  struct mem_pte_t *pte;
 
   myfprintf(fd, "/* ** start checkpoint @ %n... */\n\n", eio_trans_icnt);
 
@@ -247,9 +272,11 @@ eio_write_chkpt(struct regs_t *regs,		/* regs to dump */
   fprintf(fd, "\n\n");
   exo_delete(exo);
 
-  fprintf(fd, "/* writing `%d' memory pages... */\n", (int)mem->page_count);
+  page_count = 0;
+  mem_forall_pages(mem, eio_count_page, &page_count);
+  fprintf(fd, "/* writing `%d' memory pages... */\n", page_count);
   exo = exo_new(ec_list,
-		exo_new(ec_integer, (exo_integer_t)mem->page_count),
+		exo_new(ec_integer, (exo_integer_t)page_count),
 		exo_new(ec_address, (exo_integer_t)ld_brk_point),
 		exo_new(ec_address, (exo_integer_t)ld_stack_min),
 		NULL);
@@ -285,17 +312,7 @@ eio_write_chkpt(struct regs_t *regs,		/* regs to dump */
   exo_delete(exo);
 
   /* visit all active memory pages, and dump them to the checkpoint file */
-  MEM_FORALL(mem, i, pte)
-    {
-      /* dump this page... */
-      exo = exo_new(ec_list,
-		    exo_new(ec_address, (exo_integer_t)MEM_PTE_ADDR(pte, i)),
-		    exo_new(ec_blob, MD_PAGE_SIZE, pte->page),
-		    NULL);
-      exo_print(exo, fd);
-      fprintf(fd, "\n\n");
-      exo_delete(exo);
-    }
+  mem_forall_pages(mem, eio_write_page, fd);
 
   myfprintf(fd, "/* ** end checkpoint @ %n... */\n\n", eio_trans_icnt);
 
@@ -427,6 +444,10 @@ eio_read_chkpt(struct regs_t *regs,		/* regs to dump */
   ld_stack_size = (unsigned int)exo->as_list.head->next->as_integer.val;
   exo_delete(exo);
 
+  /* the checkpoint holds every page that may be non-zero, clear the pages
+     of any earlier state first, or pages zeroed since would keep it */
+  mem_clear(mem);
+
   for (i=0; i < page_count; i++)
     {
       int j;
@@ -0,0 +1,823 @@
+/* fastfwd.c - fast functional execution engine routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ * The following options configure the bag of tricks used to make the
+ * engine live up to its name.
+ */
+
+#ifdef __GNUC__
+/* faster dispatch mechanism, requires GNU GCC C extensions, CAVEAT: some
+   versions of GNU GCC core dump when optimizing the jump table code with
+   optimization levels higher than -O1 */
+/* #define USE_JUMP_TABLE */
+
+/* translate the program into basic blocks of threaded code once, and run
+   the blocks by jumping straight from one inst implementation to the next,
+   requires GNU GCC C extensions, takes precedence over USE_JUMP_TABLE */
+#define USE_BLOCK_ENGINE
+
+/* translate the blocks executed most often into native host code, where
+   the host and target are supported by the translator (see dbt.h),
+   requires USE_BLOCK_ENGINE */
+#define USE_NATIVE_BLOCKS
+#endif /* __GNUC__ */
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "regs.h"
+#include "memory.h"
+#include "loader.h"
+#include "syscall.h"
+#include "sim.h"
+#include "fastfwd.h"
+#include "dbt.h"
+
+#if defined(TARGET_ALPHA) && !defined(USE_BLOCK_ENGINE)
+/* predecoded text memory */
+static struct mem_t *dec = NULL;
+#endif
+
+#ifdef USE_BLOCK_ENGINE
+
+/*
+ * block translation: the program text is translated, lazily, into basic
+ * blocks of straight-line code that end with the first control or trap inst
+ * (or after FB_MAX_INSTS insts), each inst is translated into the address of
+ * its implementation in fastfwd_exec() and its instruction bits, from which
+ * the implementation reads its operand fields; a block leads to its
+ * successor through the successor pointers of the block, which are filled
+ * in the first time each successor is seen; stores to the text pages of
+ * translated blocks flush all the translations
+ */
+
+/* maximum number of insts in a block */
+#define FB_MAX_INSTS		64
+
+/* number of buckets of the block hash table, must be a power of two */
+#define FB_HASH_SIZE		4096
+
+/* number of executions of a block after which it is translated into
+   native code */
+#define FB_HOT_EXECS		50
+
+/* hash bucket of the block at address PC */
+#define FB_HASH(PC)							\
+  (((PC) / sizeof(md_inst_t)) & (FB_HASH_SIZE - 1))
+
+/* a translated inst */
+struct fb_inst_t {
+  void *handler;			/* address of the implementation */
+  md_inst_t inst;			/* instruction bits */
+};
+
+/* a translated block */
+struct fb_block_t {
+  struct fb_block_t *next;		/* next block in hash bucket */
+  md_addr_t PC;				/* address of the first inst */
+  int ninsts;				/* number of insts in the block */
+  struct fb_block_t *succ[2];		/* fall-through and other successor */
+  struct fb_inst_t *insts;		/* the insts, follow the block */
+#ifdef USE_NATIVE_BLOCKS
+  int execs;				/* number of executions */
+  dbt_code_t native;			/* native code, or NULL */
+#endif /* USE_NATIVE_BLOCKS */
+};
+
+/* block hash table */
+static struct fb_block_t *fb_hash[FB_HASH_SIZE];
+
+/* one flag per text page, set if blocks were translated from the page */
+static byte_t *fb_text_map = NULL;
+
+/* flush count, blocks are only chained within the same flush period */
+static counter_t fb_flushes = 0;
+
+/* memory the blocks were translated from, native code reaches memory
+   through it */
+static struct mem_t *fb_mem = NULL;
+
+#ifdef USE_NATIVE_BLOCKS
+/* non-zero if blocks can be translated into native code */
+static int fb_native = FALSE;
+#endif /* USE_NATIVE_BLOCKS */
+
+/* block translation stats */
+static counter_t fb_blocks = 0;		/* blocks translated */
+static counter_t fb_insts = 0;		/* insts translated */
+
+/* text page number of address ADDR */
+#define FB_TEXT_PAGE(ADDR)						\
+  (((ADDR) - (ld_text_base & ~(MD_PAGE_SIZE - 1))) >> MD_LOG_PAGE_SIZE)
+
+/* discard all the translated blocks */
+static void
+fb_flush(void)
+{
+  int i;
+  struct fb_block_t *blk, *next;
+
+  for (i=0; i < FB_HASH_SIZE; i++)
+    {
+      for (blk=fb_hash[i]; blk != NULL; blk=next)
+	{
+	  next = blk->next;
+	  free(blk);
+	}
+      fb_hash[i] = NULL;
+    }
+  memset(fb_text_map, 0, FB_TEXT_PAGE(ld_text_base + ld_text_size) + 1);
+#ifdef USE_NATIVE_BLOCKS
+  dbt_flush();
+#endif /* USE_NATIVE_BLOCKS */
+  fb_flushes++;
+}
+
+/* note a write of NBYTES at text segment address ADDR, returns non-zero
+   if blocks were translated from the text written, they are flushed */
+static int
+fb_text_write(md_addr_t addr,		/* address written */
+	      int nbytes)		/* size of the write */
+{
+  md_addr_t page;
+
+  if (addr + nbytes <= ld_text_base || addr >= ld_text_base + ld_text_size)
+    return FALSE;
+
+  for (page = FB_TEXT_PAGE(MAX(addr, ld_text_base));
+       page <= FB_TEXT_PAGE(MIN(addr + nbytes, ld_text_base + ld_text_size)
+			    - 1);
+       page++)
+    {
+      if (fb_text_map[page])
+	{
+	  fb_flush();
+	  return TRUE;
+	}
+    }
+  return FALSE;
+}
+
+/* system call memory access function, system calls may write the text */
+static enum md_fault_type
+fb_syscall_access(struct mem_t *mem,	/* memory space to access */
+		  enum mem_cmd cmd,	/* memory access cmd, Read or Write */
+		  md_addr_t addr,	/* data address to access */
+		  void *p,		/* data input/output buffer */
+		  int nbytes)		/* number of bytes to access */
+{
+  if (cmd == Write)
+    fb_text_write(addr, nbytes);
+  return mem_access(mem, cmd, addr, p, nbytes);
+}
+
+/* return the block at address PC, or NULL if it is not translated */
+static INLINE struct fb_block_t *
+fb_lookup(md_addr_t PC)			/* address of the block */
+{
+  struct fb_block_t *blk;
+
+  for (blk=fb_hash[FB_HASH(PC)]; blk != NULL; blk=blk->next)
+    {
+      if (blk->PC == PC)
+	return blk;
+    }
+  return NULL;
+}
+
+/* translate the block at address PC of memory MEM, HANDLERS holds the
+   address of the implementation of each opcode */
+static struct fb_block_t *
+fb_translate(struct mem_t *mem,		/* memory holding the program */
+	     md_addr_t PC,		/* address of the block */
+	     void **handlers)		/* inst implementations, by opcode */
+{
+  static struct fb_inst_t insts[FB_MAX_INSTS];
+  struct fb_block_t *blk;
+  md_addr_t end_PC, page;
+  md_inst_t inst;
+  enum md_opcode op;
+  int ninsts;
+
+  /* only the text segment is decoded (see ld_load_prog()) */
+  if (PC < ld_text_base || PC >= ld_text_base + ld_text_size)
+    panic("attempted to execute outside of the text segment @ 0x%08p", PC);
+
+  for (ninsts=0, end_PC=PC;
+       ninsts < FB_MAX_INSTS && end_PC < ld_text_base + ld_text_size;
+       ninsts++, end_PC += sizeof(md_inst_t))
+    {
+      MD_FETCH_INST(inst, mem, end_PC);
+      MD_SET_OPCODE(op, inst);
+      insts[ninsts].handler = handlers[op];
+      insts[ninsts].inst = inst;
+
+      /* control and trap insts end the block */
+      if (MD_OP_FLAGS(op) & (F_CTRL|F_TRAP))
+	{
+	  ninsts++, end_PC += sizeof(md_inst_t);
+	  break;
+	}
+    }
+
+  /* the insts follow the block */
+  blk = (struct fb_block_t *)
+    malloc(sizeof(struct fb_block_t) + ninsts * sizeof(struct fb_inst_t));
+  if (!blk)
+    fatal("out of virtual memory");
+  blk->PC = PC;
+  blk->ninsts = ninsts;
+  blk->succ[0] = blk->succ[1] = NULL;
+  blk->insts = (struct fb_inst_t *)(blk + 1);
+#ifdef USE_NATIVE_BLOCKS
+  blk->execs = 0;
+  blk->native = NULL;
+#endif /* USE_NATIVE_BLOCKS */
+  memcpy(blk->insts, insts, ninsts * sizeof(struct fb_inst_t));
+
+  /* link into the hash table, and mark the text pages translated */
+  blk->next = fb_hash[FB_HASH(PC)];
+  fb_hash[FB_HASH(PC)] = blk;
+  for (page=FB_TEXT_PAGE(PC); page <= FB_TEXT_PAGE(end_PC - 1); page++)
+    fb_text_map[page] = TRUE;
+
+  fb_blocks++;
+  fb_insts += ninsts;
+
+  return blk;
+}
+
+#ifdef USE_NATIVE_BLOCKS
+/* translate block BLK, which accesses memory MEM, into native code, the
+   block is left to the engine if it cannot be translated */
+static void
+fb_translate_native(struct mem_t *mem,		/* memory accessed */
+		    struct fb_block_t *blk)	/* block to translate */
+{
+  md_inst_t insts[FB_MAX_INSTS];
+  int i;
+
+  for (i=0; i < blk->ninsts; i++)
+    insts[i] = blk->insts[i].inst;
+  blk->native = dbt_translate(mem, blk->PC, insts, blk->ninsts);
+}
+#endif /* USE_NATIVE_BLOCKS */
+
+#endif /* USE_BLOCK_ENGINE */
+
+/* initialize the engine for the program just loaded into memory MEM, e.g.,
+   pre-decode its text segment, must be called once the program is loaded */
+void
+fastfwd_init(struct mem_t *mem)		/* memory holding the program */
+{
+#if defined(USE_BLOCK_ENGINE)
+  /* blocks are translated as they are first executed */
+  fb_text_map = (byte_t *)calloc(FB_TEXT_PAGE(ld_text_base + ld_text_size) + 1,
+				 sizeof(byte_t));
+  if (!fb_text_map)
+    fatal("out of virtual memory");
+#if defined(USE_NATIVE_BLOCKS)
+  fb_native = dbt_init();
+#endif /* USE_NATIVE_BLOCKS */
+#elif defined(TARGET_ALPHA)
+  /* pre-decode text segment */
+  unsigned i, num_insn = (ld_text_size + 3) / 4;
+
+  fprintf(stderr, "** pre-decoding %u insts...", num_insn);
+
+  /* allocate decoded text space */
+  dec = mem_create("dec");
+
+  for (i=0; i < num_insn; i++)
+    {
+      enum md_opcode op;
+      md_inst_t inst;
+      md_addr_t PC;
+
+      /* compute PC */
+      PC = ld_text_base + i * sizeof(md_inst_t);
+
+      /* get instruction from memory */
+      MD_FETCH_INST(inst, mem, PC);
+
+      /* decode the instruction */
+      MD_SET_OPCODE(op, inst);
+
+      /* insert into decoded opcode space */
+      MEM_WRITE_WORD(dec, PC << 1, (word_t)op);
+      MEM_WRITE_WORD(dec, (PC << 1)+sizeof(word_t), inst);
+    }
+  fprintf(stderr, "done\n");
+#endif
+}
+
+/* register engine-specific statistics */
+void
+fastfwd_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
+{
+#if defined(USE_BLOCK_ENGINE)
+  stat_reg_counter(sdb, "fastfwd.blocks",
+		   "total number of blocks translated",
+		   &fb_blocks, /* initial value */0, /* format */NULL);
+  stat_reg_counter(sdb, "fastfwd.insts",
+		   "total number of insts translated",
+		   &fb_insts, /* initial value */0, /* format */NULL);
+  stat_reg_counter(sdb, "fastfwd.flushes",
+		   "total number of flushes of the translated blocks",
+		   &fb_flushes, /* initial value */0, /* format */NULL);
+  stat_reg_formula(sdb, "fastfwd.block_size",
+		   "average number of insts per block translated",
+		   "fastfwd.insts / fastfwd.blocks", /* format */NULL);
+#if defined(USE_NATIVE_BLOCKS)
+  dbt_reg_stats(sdb);
+#endif /* USE_NATIVE_BLOCKS */
+#elif defined(TARGET_ALPHA)
+  mem_reg_stats(dec, sdb);
+#endif
+}
+
+/* return non-zero if the engine can execute the loaded program */
+int
+fastfwd_usable(void)
+{
+  /* must have natural byte/word ordering */
+  return !sim_swap_bytes && !sim_swap_words;
+}
+
+/*
+ * configure the execution engine
+ */
+
+/* next program counter */
+#define SET_NPC(EXPR)		(regs->regs_NPC = (EXPR))
+
+/* current program counter */
+#define CPC			(regs->regs_PC)
+
+/* general purpose registers */
+#define GPR(N)			(regs->regs_R[N])
+#define SET_GPR(N,EXPR)		(regs->regs_R[N] = (EXPR))
+
+#if defined(TARGET_PISA)
+
+/* floating point registers, L->word, F->single-prec, D->double-prec */
+#define FPR_L(N)		(regs->regs_F.l[(N)])
+#define SET_FPR_L(N,EXPR)	(regs->regs_F.l[(N)] = (EXPR))
+#define FPR_F(N)		(regs->regs_F.f[(N)])
+#define SET_FPR_F(N,EXPR)	(regs->regs_F.f[(N)] = (EXPR))
+#define FPR_D(N)		(regs->regs_F.d[(N) >> 1])
+#define SET_FPR_D(N,EXPR)	(regs->regs_F.d[(N) >> 1] = (EXPR))
+
+/* miscellaneous register accessors */
+#define SET_HI(EXPR)		(regs->regs_C.hi = (EXPR))
+#define HI			(regs->regs_C.hi)
+#define SET_LO(EXPR)		(regs->regs_C.lo = (EXPR))
+#define LO			(regs->regs_C.lo)
+#define FCC			(regs->regs_C.fcc)
+#define SET_FCC(EXPR)		(regs->regs_C.fcc = (EXPR))
+
+#elif defined(TARGET_ALPHA)
+
+/* floating point registers, L->word, F->single-prec, D->double-prec */
+#define FPR_Q(N)		(regs->regs_F.q[N])
+#define SET_FPR_Q(N,EXPR)	(regs->regs_F.q[N] = (EXPR))
+#define FPR(N)			(regs->regs_F.d[N])
+#define SET_FPR(N,EXPR)		(regs->regs_F.d[N] = (EXPR))
+
+/* miscellaneous register accessors */
+#define FPCR			(regs->regs_C.fpcr)
+#define SET_FPCR(EXPR)		(regs->regs_C.fpcr = (EXPR))
+#define UNIQ			(regs->regs_C.uniq)
+#define SET_UNIQ(EXPR)		(regs->regs_C.uniq = (EXPR))
+
+#else
+#error No ISA target defined...
+#endif
+
+/* precise architected memory state accessor macros */
+#define READ_BYTE(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, MEM_READ_BYTE(mem, (SRC)))
+#define READ_HALF(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, MEM_READ_HALF(mem, (SRC)))
+#define READ_WORD(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, MEM_READ_WORD(mem, (SRC)))
+#ifdef HOST_HAS_QWORD
+#define READ_QWORD(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, MEM_READ_QWORD(mem, (SRC)))
+#endif /* HOST_HAS_QWORD */
+
+#ifdef USE_BLOCK_ENGINE
+/* stores to the text segment may flush the translated blocks, including
+   the block being executed, which then ends with the store */
+#define CHECK_TEXT_WRITE(DST, TYPE)					\
+  ((md_addr_t)(DST) - ld_text_base < ld_text_size			\
+   && fb_text_write((DST), sizeof(TYPE))				\
+   ? (void)(ip_end = ip + 1) : (void)0)
+#else /* !USE_BLOCK_ENGINE */
+#define CHECK_TEXT_WRITE(DST, TYPE)	((void)0)
+#endif /* USE_BLOCK_ENGINE */
+
+#define WRITE_BYTE(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, CHECK_TEXT_WRITE((DST), byte_t),		\
+   MEM_WRITE_BYTE(mem, (DST), (SRC)))
+#define WRITE_HALF(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, CHECK_TEXT_WRITE((DST), half_t),		\
+   MEM_WRITE_HALF(mem, (DST), (SRC)))
+#define WRITE_WORD(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, CHECK_TEXT_WRITE((DST), word_t),		\
+   MEM_WRITE_WORD(mem, (DST), (SRC)))
+#ifdef HOST_HAS_QWORD
+#define WRITE_QWORD(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, CHECK_TEXT_WRITE((DST), qword_t),		\
+   MEM_WRITE_QWORD(mem, (DST), (SRC)))
+#endif /* HOST_HAS_QWORD */
+
+/* system call handler macro, the inst count is brought up to date first,
+   since the program may exit in the system call */
+#ifdef USE_BLOCK_ENGINE
+#define SYSCALL(INST)							\
+  (*icount = n, sys_syscall(regs, fb_syscall_access, mem, INST, TRUE))
+#else /* !USE_BLOCK_ENGINE */
+#define SYSCALL(INST)							\
+  (*icount = n, sys_syscall(regs, mem_access, mem, INST, TRUE))
+#endif /* USE_BLOCK_ENGINE */
+
+#ifdef TARGET_ALPHA
+#define ZERO_FP_REG()	regs->regs_F.d[MD_REG_ZERO] = 0.0
+#else
+#define ZERO_FP_REG()	/* nada... */
+#endif
+
+/* non-zero once the inst count limit is reached */
+#define LIMIT_REACHED()	(limit && n >= limit)
+
+/* note a write of NBYTES at address ADDR made outside of the engine, e.g.,
+   by the caller's own execution loop, so that the engine discards any code
+   it translated from the text written; callers that write memory between
+   calls to fastfwd_exec() must report their writes */
+void
+fastfwd_text_write(md_addr_t addr,	/* address written */
+		   int nbytes)		/* size of the write */
+{
+#if defined(USE_BLOCK_ENGINE)
+  if (fb_text_map)
+    fb_text_write(addr, nbytes);
+#endif /* USE_BLOCK_ENGINE */
+}
+
+/* execute the program in REGS and MEM starting with the instruction at
+   REGS->REGS_PC, incrementing *ICOUNT for each instruction executed, until
+   *ICOUNT reaches LIMIT, or until the program exits if LIMIT is zero; on
+   return, REGS->REGS_PC holds the next instruction to execute and
+   REGS->REGS_NPC the address that follows it */
+void
+fastfwd_exec(struct regs_t *regs,	/* registers to update */
+	     struct mem_t *mem,		/* memory to update */
+	     counter_t *icount,		/* executed inst counter */
+	     counter_t limit)		/* inst count limit, zero = none */
+{
+#if defined(USE_BLOCK_ENGINE)
+  /* the implementation of each opcode, the blocks are translated into
+     pointers to these, this code is GNU GCC specific */
+  static void *fb_handlers[/* max opcodes */] = {
+    &&fb_NA, /* NA */
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+    &&fb_##OP,
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+    &&fb_##OP,
+#define CONNECT(OP)
+#include "machine.def"
+  };
+
+  /* block being executed, and the flush period it was entered in */
+  struct fb_block_t *blk = NULL, *next;
+  counter_t flushes = 0;
+
+  /* next inst of the block to execute, and the end of the insts to
+     execute in the block */
+  struct fb_inst_t *ip, *ip_end;
+#elif defined(USE_JUMP_TABLE)
+  /* the jump table employs GNU GCC label extensions to construct an array
+     of pointers to instruction implementation code, the engine then uses
+     the table to lookup the location of instruction's implementing code, a
+     GNU GCC `goto' extension is then used to jump to the inst's implementing
+     code through the op_jump table; as a result, there is no need for
+     a main simulator loop, which eliminates one branch from the simulator
+     interpreter - crazy, no!?!? */
+
+  /* instruction jump table, this code is GNU GCC specific */
+  static void *op_jump[/* max opcodes */] = {
+    &&opcode_NA, /* NA */
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+    &&opcode_##OP,
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+    &&opcode_##OP,
+#define CONNECT(OP)
+#include "machine.def"
+  };
+#endif /* USE_BLOCK_ENGINE */
+
+  /* register allocate instruction buffer */
+  register md_inst_t inst;
+
+#if !defined(USE_BLOCK_ENGINE)
+  /* decoded opcode */
+  register enum md_opcode op;
+#endif /* !USE_BLOCK_ENGINE */
+
+  /* inst count, kept in a local until the engine returns */
+  counter_t n = *icount;
+
+#if defined(USE_BLOCK_ENGINE)
+
+  /* the blocks, and their native code, stay translated from one call to
+     the next, text written by the caller in between is reported through
+     fastfwd_text_write(); only blocks translated from another memory are
+     discarded */
+  if (mem != fb_mem)
+    {
+      if (fb_blocks != 0)
+	fb_flush();
+      fb_mem = mem;
+    }
+
+  /* REGS->REGS_NPC holds the address of the instruction to execute, until
+     the instruction is dispatched to its implementation */
+  regs->regs_NPC = regs->regs_PC;
+
+ next_block:
+  /* stop at the inst count limit */
+  if (LIMIT_REACHED())
+    goto limit_reached;
+
+  /* locate the next block, through the successors of the last block if it
+     was not flushed since it was entered */
+  if (blk && flushes == fb_flushes)
+    {
+      if (blk->succ[0] && blk->succ[0]->PC == regs->regs_NPC)
+	next = blk->succ[0];
+      else if (blk->succ[1] && blk->succ[1]->PC == regs->regs_NPC)
+	next = blk->succ[1];
+      else
+	{
+	  next = fb_lookup(regs->regs_NPC);
+	  if (!next)
+	    next = fb_translate(mem, regs->regs_NPC, fb_handlers);
+	  if (regs->regs_NPC == blk->PC + blk->ninsts * sizeof(md_inst_t))
+	    blk->succ[0] = next;
+	  else
+	    blk->succ[1] = next;
+	}
+    }
+  else
+    {
+      next = fb_lookup(regs->regs_NPC);
+      if (!next)
+	next = fb_translate(mem, regs->regs_NPC, fb_handlers);
+    }
+  blk = next;
+  flushes = fb_flushes;
+
+#if defined(USE_NATIVE_BLOCKS)
+  /* run the native code of the block if it ends within the limit, the
+     engine resumes the block at the first inst the code left to it */
+  if (blk->native && (!limit || limit - n >= blk->ninsts))
+    {
+      int ndone = blk->native(regs, mem);
+
+      n += ndone;
+      if (ndone == blk->ninsts)
+	goto next_block;
+      ip = blk->insts + ndone;
+      ip_end = blk->insts + blk->ninsts;
+      inst = ip->inst;
+      goto *ip->handler;
+    }
+
+  /* translate the block into native code once it is hot */
+  if (fb_native && ++blk->execs == FB_HOT_EXECS)
+    fb_translate_native(mem, blk);
+#endif /* USE_NATIVE_BLOCKS */
+
+  /* execute the block, or its first insts if the limit is reached in it */
+  ip = blk->insts;
+  if (limit && limit - n < blk->ninsts)
+    ip_end = ip + (limit - n);
+  else
+    ip_end = ip + blk->ninsts;
+
+  /* jump to the implementation of the first instruction */
+  inst = ip->inst;
+  goto *ip->handler;
+
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+  fb_##OP:								\
+    /* maintain $r0 semantics */					\
+    regs->regs_R[MD_REG_ZERO] = 0;					\
+    ZERO_FP_REG();							\
+									\
+    /* keep an instruction count */					\
+    n++;								\
+									\
+    /* locate next instruction */					\
+    regs->regs_PC = regs->regs_NPC;					\
+									\
+    /* set up default next PC */					\
+    regs->regs_NPC += sizeof(md_inst_t);				\
+									\
+    /* execute the instruction, faults break out of the loop */	\
+    do { SYMCAT(OP,_IMPL); } while (0);					\
+									\
+    /* jump to the implementation of the next instruction */		\
+    if (++ip < ip_end)							\
+      {									\
+	inst = ip->inst;						\
+	goto *ip->handler;						\
+      }									\
+    goto next_block;
+
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+  fb_##OP:								\
+    panic("attempted to execute a linking opcode");
+#define CONNECT(OP)
+#define DECLARE_FAULT(FAULT)						\
+	  { /* uncaught... */break; }
+#include "machine.def"
+
+  fb_NA:
+    panic("attempted to execute a bogus opcode");
+
+ limit_reached:
+  /* leave the next instruction to execute in REGS->REGS_PC */
+  regs->regs_PC = regs->regs_NPC;
+  regs->regs_NPC += sizeof(md_inst_t);
+  *icount = n;
+
+#elif defined(USE_JUMP_TABLE)
+
+  /* REGS->REGS_NPC holds the address of the instruction to execute, until
+     the instruction is dispatched to its implementation */
+  regs->regs_NPC = regs->regs_PC;
+
+  /* load instruction */
+  MD_FETCH_INST(inst, mem, regs->regs_NPC);
+
+  /* jump to instruction implementation */
+  MD_SET_OPCODE(op, inst);
+  goto *op_jump[op];
+
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+  opcode_##OP:								\
+    /* stop at the inst count limit */					\
+    if (LIMIT_REACHED())						\
+      goto limit_reached;						\
+									\
+    /* maintain $r0 semantics */					\
+    regs->regs_R[MD_REG_ZERO] = 0;					\
+    ZERO_FP_REG();							\
+									\
+    /* keep an instruction count */					\
+    n++;								\
+									\
+    /* locate next instruction */					\
+    regs->regs_PC = regs->regs_NPC;					\
+									\
+    /* set up default next PC */					\
+    regs->regs_NPC += sizeof(md_inst_t);				\
+									\
+    /* execute the instruction, faults break out of the loop */	\
+    do { SYMCAT(OP,_IMPL); } while (0);					\
+									\
+    /* get the next instruction */					\
+    MD_FETCH_INST(inst, mem, regs->regs_NPC);				\
+									\
+    /* jump to instruction implementation */				\
+    MD_SET_OPCODE(op, inst);						\
+    goto *op_jump[op];
+
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+  opcode_##OP:								\
+    panic("attempted to execute a linking opcode");
+#define CONNECT(OP)
+#define DECLARE_FAULT(FAULT)						\
+	  { /* uncaught... */break; }
+#include "machine.def"
+
+  opcode_NA:
+    panic("attempted to execute a bogus opcode");
+
+ limit_reached:
+  /* leave the next instruction to execute in REGS->REGS_PC */
+  regs->regs_PC = regs->regs_NPC;
+  regs->regs_NPC += sizeof(md_inst_t);
+  *icount = n;
+
+#else /* !USE_JUMP_TABLE */
+
+  /* set up initial default next PC */
+  regs->regs_NPC = regs->regs_PC + sizeof(md_inst_t);
+
+  while (!LIMIT_REACHED())
+    {
+      /* maintain $r0 semantics */
+      regs->regs_R[MD_REG_ZERO] = 0;
+#ifdef TARGET_ALPHA
+      regs->regs_F.d[MD_REG_ZERO] = 0.0;
+#endif /* TARGET_ALPHA */
+
+      /* keep an instruction count */
+      n++;
+
+#ifdef TARGET_ALPHA
+      /* load predecoded instruction */
+      op = (enum md_opcode)__UNCHK_MEM_READ(dec, regs->regs_PC << 1, word_t);
+      inst =
+	__UNCHK_MEM_READ(dec, (regs->regs_PC << 1)+sizeof(word_t), md_inst_t);
+#else /* !TARGET_ALPHA */
+      /* load instruction */
+      MD_FETCH_INST(inst, mem, regs->regs_PC);
+
+      /* decode the instruction */
+      MD_SET_OPCODE(op, inst);
+#endif
+
+      /* execute the instruction */
+      switch (op)
+	{
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+	case OP:							\
+	  SYMCAT(OP,_IMPL);						\
+	  break;
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+	case OP:							\
+	  panic("attempted to execute a linking opcode");
+#define CONNECT(OP)
+#define DECLARE_FAULT(FAULT)						\
+	  { /* uncaught... */break; }
+#include "machine.def"
+	default:
+	  panic("attempted to execute a bogus opcode");
+	}
+
+      /* execute next instruction */
+      regs->regs_PC = regs->regs_NPC;
+      regs->regs_NPC += sizeof(md_inst_t);
+    }
+  *icount = n;
+
+#endif /* USE_BLOCK_ENGINE */
+}
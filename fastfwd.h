@@ -0,0 +1,104 @@
+/* fastfwd.h - fast functional execution engine interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef FASTFWD_H
+#define FASTFWD_H
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "regs.h"
+#include "memory.h"
+#include "stats.h"
+
+/*
+ * This module holds the execution engine of the sim-fast functional
+ * simulator, so that the other simulators can use it to fast forward
+ * through the parts of a program they do not simulate.  The engine has
+ * none of the per-instruction overheads of the simulator main loops: no
+ * fault checks, no DLite debugger checks and no simulator hooks, so
+ * instruction errors will manifest as simulator execution errors, and the
+ * program must have natural byte/word ordering (see fastfwd_usable()).
+ */
+
+/* initialize the engine for the program just loaded into memory MEM, e.g.,
+   pre-decode its text segment, must be called once the program is loaded */
+void
+fastfwd_init(struct mem_t *mem);	/* memory holding the program */
+
+/* register engine-specific statistics */
+void
+fastfwd_reg_stats(struct stat_sdb_t *sdb);	/* stats database */
+
+/* return non-zero if the engine can execute the loaded program */
+int
+fastfwd_usable(void);
+
+/* note a write of NBYTES at address ADDR made outside of the engine, e.g.,
+   by the caller's own execution loop, so that the engine discards any code
+   it translated from the text written; callers that write memory between
+   calls to fastfwd_exec() must report their writes */
+void
+fastfwd_text_write(md_addr_t addr,	/* address written */
+		   int nbytes);		/* size of the write */
+
+/* execute the program in REGS and MEM starting with the instruction at
+   REGS->REGS_PC, incrementing *ICOUNT for each instruction executed, until
+   *ICOUNT reaches LIMIT, or until the program exits if LIMIT is zero; on
+   return, REGS->REGS_PC holds the next instruction to execute and
+   REGS->REGS_NPC the address that follows it */
+void
+fastfwd_exec(struct regs_t *regs,	/* registers to update */
+	     struct mem_t *mem,		/* memory to update */
+	     counter_t *icount,		/* executed inst counter */
+	     counter_t limit);		/* inst count limit, zero = none */
+
+#endif /* FASTFWD_H */
@@ -0,0 +1,522 @@
+/* frontend.c - decoupled functional front end routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "regs.h"
+#include "memory.h"
+#include "loader.h"
+#include "syscall.h"
+#include "frontend.h"
+
+/* front end registers and memory, only touched by the front end thread,
+   or by the timing model's thread while the front end waits on a trap */
+static struct regs_t fe_regs;
+static struct mem_t *fe_mem = NULL;
+
+/* private copy of the program text, read by both threads */
+static md_inst_t *fe_text = NULL;
+
+/* inst count limit of the front end, zero = none */
+static counter_t fe_limit;
+
+/* the ring of records, FE_HEAD is the number of records published by the
+   front end, FE_TAIL the number of records taken by the timing model, each
+   is only written by one side and they are published in batches */
+static struct fe_rec_t *fe_ring = NULL;
+static unsigned long fe_ring_size;
+static unsigned long fe_head = 0;
+static unsigned long fe_tail = 0;
+
+/* timing model's side of the ring, i.e., the records taken and the
+   records known to be published */
+static unsigned long fe_taken = 0;
+static unsigned long fe_avail = 0;
+
+/* number of records up to and including the last trap executed for the
+   front end by the timing model */
+static unsigned long fe_trap_done = 0;
+
+/* non-zero once the front end has published its last record */
+static int fe_done = FALSE;
+
+/* non-zero if the front end must quit instead of waiting on a trap */
+static int fe_quit = FALSE;
+
+/* front end thread, and non-zero while it is running */
+static pthread_t fe_thread;
+static int fe_running = FALSE;
+
+/* ring accessors, loads acquire and stores release the ring contents, so
+   the timing model sees the records published to it, and the front end
+   overwrites a record only after it has been taken */
+#define RING_LOAD(P)		__atomic_load_n((P), __ATOMIC_ACQUIRE)
+#define RING_STORE(P, V)	__atomic_store_n((P), (V), __ATOMIC_RELEASE)
+
+/* spin this many times on an empty or full ring before yielding the CPU */
+#define RING_SPIN		64
+
+/* publish the ring counters every this many records, a power of two no
+   larger than FRONTEND_MIN_RING */
+#define RING_BATCH		32
+
+
+/*
+ * configure the execution engine
+ */
+
+/* next program counter */
+#define SET_NPC(EXPR)		(regs->regs_NPC = (EXPR))
+
+/* target program counter */
+#undef  SET_TPC
+#define SET_TPC(EXPR)		(target_PC = (EXPR))
+
+/* current program counter */
+#define CPC			(regs->regs_PC)
+
+/* general purpose registers */
+#define GPR(N)			(regs->regs_R[N])
+#define SET_GPR(N,EXPR)		(regs->regs_R[N] = (EXPR))
+
+#if defined(TARGET_PISA)
+
+/* floating point registers, L->word, F->single-prec, D->double-prec */
+#define FPR_L(N)		(regs->regs_F.l[(N)])
+#define SET_FPR_L(N,EXPR)	(regs->regs_F.l[(N)] = (EXPR))
+#define FPR_F(N)		(regs->regs_F.f[(N)])
+#define SET_FPR_F(N,EXPR)	(regs->regs_F.f[(N)] = (EXPR))
+#define FPR_D(N)		(regs->regs_F.d[(N) >> 1])
+#define SET_FPR_D(N,EXPR)	(regs->regs_F.d[(N) >> 1] = (EXPR))
+
+/* miscellaneous register accessors */
+#define SET_HI(EXPR)		(regs->regs_C.hi = (EXPR))
+#define HI			(regs->regs_C.hi)
+#define SET_LO(EXPR)		(regs->regs_C.lo = (EXPR))
+#define LO			(regs->regs_C.lo)
+#define FCC			(regs->regs_C.fcc)
+#define SET_FCC(EXPR)		(regs->regs_C.fcc = (EXPR))
+
+#elif defined(TARGET_ALPHA)
+
+/* floating point registers, L->word, F->single-prec, D->double-prec */
+#define FPR_Q(N)		(regs->regs_F.q[N])
+#define SET_FPR_Q(N,EXPR)	(regs->regs_F.q[N] = (EXPR))
+#define FPR(N)			(regs->regs_F.d[N])
+#define SET_FPR(N,EXPR)		(regs->regs_F.d[N] = (EXPR))
+
+/* miscellaneous register accessors */
+#define FPCR			(regs->regs_C.fpcr)
+#define SET_FPCR(EXPR)		(regs->regs_C.fpcr = (EXPR))
+#define UNIQ			(regs->regs_C.uniq)
+#define SET_UNIQ(EXPR)		(regs->regs_C.uniq = (EXPR))
+
+#else
+#error No ISA target defined...
+#endif
+
+/* precise architected memory state accessor macros, as in the dispatch
+   stage of sim-outorder, the effective address and the size of the access
+   are recorded */
+#define __READ_MEM(SRC, SRC_V, FAULT)					\
+  (addr = (SRC), addr_size = sizeof(SRC_V),				\
+   ((FAULT) = mem_access(mem, Read, addr, &SRC_V, sizeof(SRC_V))),	\
+   SRC_V)
+
+#define READ_BYTE(SRC, FAULT)						\
+  __READ_MEM((SRC), temp_byte, (FAULT))
+#define READ_HALF(SRC, FAULT)						\
+  MD_SWAPH(__READ_MEM((SRC), temp_half, (FAULT)))
+#define READ_WORD(SRC, FAULT)						\
+  MD_SWAPW(__READ_MEM((SRC), temp_word, (FAULT)))
+#ifdef HOST_HAS_QWORD
+#define READ_QWORD(SRC, FAULT)						\
+  MD_SWAPQ(__READ_MEM((SRC), temp_qword, (FAULT)))
+#endif /* HOST_HAS_QWORD */
+
+#define __WRITE_MEM(SRC, DST, DST_V, FAULT)				\
+  (DST_V = (SRC), addr = (DST), addr_size = sizeof(DST_V),		\
+   ((FAULT) = mem_access(mem, Write, addr, &DST_V, sizeof(DST_V))))
+
+#define WRITE_BYTE(SRC, DST, FAULT)					\
+  __WRITE_MEM((SRC), (DST), temp_byte, (FAULT))
+#define WRITE_HALF(SRC, DST, FAULT)					\
+  __WRITE_MEM(MD_SWAPH(SRC), (DST), temp_half, (FAULT))
+#define WRITE_WORD(SRC, DST, FAULT)					\
+  __WRITE_MEM(MD_SWAPW(SRC), (DST), temp_word, (FAULT))
+#ifdef HOST_HAS_QWORD
+#define WRITE_QWORD(SRC, DST, FAULT)					\
+  __WRITE_MEM(MD_SWAPQ(SRC), (DST), temp_qword, (FAULT))
+#endif /* HOST_HAS_QWORD */
+
+/* system call handler macro */
+#define SYSCALL(INST)							\
+  sys_syscall(regs, fe_syscall_access, mem, INST, TRUE)
+
+/* non-zero if the access of NBYTES at ADDR writes to the program text */
+#define FE_TEXT_WRITE_P(ADDR, NBYTES)					\
+  ((ADDR) < (ld_text_base+ld_text_size) && (ADDR) + (NBYTES) > ld_text_base)
+
+/* system call memory access function, system calls are executed by the
+   thread that takes their record while the front end waits on them, so
+   the text they write is copied into the private copy of the text, where
+   the timing model fetches it next, as from memory without a front end */
+static enum md_fault_type
+fe_syscall_access(struct mem_t *mem,		/* memory space to access */
+		  enum mem_cmd cmd,		/* Read or Write */
+		  md_addr_t addr,		/* target address to access */
+		  void *vp,			/* host memory address */
+		  int nbytes)			/* number of bytes to access */
+{
+  enum md_fault_type fault;
+  md_addr_t PC;
+
+  fault = mem_access(mem, cmd, addr, vp, nbytes);
+  if (cmd == Write && FE_TEXT_WRITE_P(addr, nbytes))
+    {
+      for (PC = MAX(addr, ld_text_base) & ~(sizeof(md_inst_t) - 1);
+	   PC < addr + nbytes && PC < (ld_text_base+ld_text_size);
+	   PC += sizeof(md_inst_t))
+	MD_FETCH_INST(fe_text[(PC - ld_text_base) / sizeof(md_inst_t)],
+		      mem, PC);
+    }
+  return fault;
+}
+
+/* return the instruction at address PC, bogus text addresses read as a NOP,
+   as they do in the fetch stage of sim-outorder */
+static md_inst_t
+fe_fetch(md_addr_t PC)				/* inst address */
+{
+  if (ld_text_base <= PC
+      && PC < (ld_text_base+ld_text_size)
+      && !(PC & (sizeof(md_inst_t)-1)))
+    return fe_text[(PC - ld_text_base) / sizeof(md_inst_t)];
+  else
+    return MD_NOP_INST;
+}
+
+/* execute the instruction at REGS->REGS_PC and record it in REC, a trap
+   instruction is only recorded if TRAPS is zero; on return, REGS->REGS_PC
+   holds the next instruction to execute, unless the instruction was not
+   executed */
+static void
+fe_exec(struct regs_t *regs,			/* registers to update */
+	struct mem_t *mem,			/* memory to update */
+	struct fe_rec_t *rec,			/* record of the inst */
+	int traps)				/* execute traps? */
+{
+  md_inst_t inst;			/* actual instruction bits */
+  enum md_opcode op;			/* decoded opcode enum */
+  md_addr_t target_PC = 0;		/* actual next/target PC address */
+  md_addr_t addr = 0;			/* effective address, if load/store */
+  int addr_size = 0;			/* size of access at ADDR */
+  byte_t temp_byte = 0;			/* temp variable for mem access */
+  half_t temp_half = 0;			/* " ditto " */
+  word_t temp_word = 0;			/* " ditto " */
+#if defined(HOST_HAS_QWORD) && defined(TARGET_ALPHA)
+  /* only the Alpha target makes quadword accesses */
+  qword_t temp_qword = 0;		/* " ditto " */
+#endif /* HOST_HAS_QWORD && TARGET_ALPHA */
+  enum md_fault_type fault = md_fault_none;
+
+  /* get the next instruction to execute */
+  inst = fe_fetch(regs->regs_PC);
+
+  /* decode the instruction */
+  MD_SET_OPCODE(op, inst);
+
+  rec->PC = regs->regs_PC;
+  rec->flags = (MD_OP_FLAGS(op) & F_TRAP) ? FE_TRAP : 0;
+  if ((rec->flags & FE_TRAP) && !traps)
+    return;
+
+  /* maintain $r0 semantics */
+  regs->regs_R[MD_REG_ZERO] = 0;
+#ifdef TARGET_ALPHA
+  regs->regs_F.d[MD_REG_ZERO] = 0.0;
+#endif /* TARGET_ALPHA */
+
+  /* compute default next PC */
+  regs->regs_NPC = regs->regs_PC + sizeof(md_inst_t);
+
+  /* execute the instruction */
+  switch (op)
+    {
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+    case OP:								\
+      SYMCAT(OP,_IMPL);							\
+      break;
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+    case OP:								\
+      /* bogus inst, executed as a NOP by sim-outorder */		\
+      break;
+#define CONNECT(OP)
+#define DECLARE_FAULT(FAULT)						\
+      { fault = (FAULT); break; }
+#include "machine.def"
+    default:
+      /* bogus inst, executed as a NOP by sim-outorder */
+      break;
+    }
+
+  rec->NPC = regs->regs_NPC;
+  rec->target_PC = target_PC;
+  rec->addr = addr;
+  rec->addr_size = addr_size;
+  rec->fault = fault;
+
+  /* the front end runs ahead on its copy of the text, which a store of
+     its own cannot update behind the timing model's back, see
+     frontend_next() */
+  if ((MD_OP_FLAGS(op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE)
+      && FE_TEXT_WRITE_P(addr, addr_size))
+    rec->flags |= FE_TEXT_WRITE;
+
+  /* go to the next instruction */
+  regs->regs_PC = regs->regs_NPC;
+}
+
+/* front end thread, executes the program into the ring */
+static void *
+fe_main(void *arg)
+{
+  counter_t n;
+  unsigned long head = 0, tail = 0;
+  struct fe_rec_t *rec;
+  int spin;
+
+  for (n=0; !fe_limit || n < fe_limit; n++)
+    {
+      /* wait for a free record */
+      if (head - tail == fe_ring_size)
+	{
+	  RING_STORE(&fe_head, head);
+	  for (spin=0; head - (tail = RING_LOAD(&fe_tail)) == fe_ring_size;
+	       spin++)
+	    {
+	      if (spin >= RING_SPIN)
+		sched_yield();
+	    }
+	}
+
+      rec = &fe_ring[head & (fe_ring_size - 1)];
+      fe_exec(&fe_regs, fe_mem, rec, /* traps */FALSE);
+      head++;
+
+      if (rec->flags & FE_TRAP)
+	{
+	  /* wait for the timing model to execute the trap */
+	  RING_STORE(&fe_head, head);
+	  for (spin=0; RING_LOAD(&fe_trap_done) != head; spin++)
+	    {
+	      if (RING_LOAD(&fe_quit))
+		return NULL;
+	      if (spin >= RING_SPIN)
+		sched_yield();
+	    }
+	}
+      else if (rec->fault != md_fault_none)
+	{
+	  /* the timing model reports the fault, if it gets to it */
+	  break;
+	}
+      else if (!(head & (RING_BATCH - 1)))
+	RING_STORE(&fe_head, head);
+    }
+
+  /* the last records are published before the front end is done */
+  RING_STORE(&fe_head, head);
+  RING_STORE(&fe_done, TRUE);
+  return NULL;
+}
+
+/* start the front end, with a ring of RING_SIZE records, on the program in
+   REGS and MEM starting with the instruction at REGS->REGS_PC; the front end
+   executes at most LIMIT insts, or runs until the program exits if LIMIT is
+   zero, and it stops after the first instruction that faults */
+void
+frontend_start(struct regs_t *regs,	/* registers to start with */
+	       struct mem_t *mem,	/* memory holding the program */
+	       counter_t limit,		/* inst count limit, zero = none */
+	       int ring_size)		/* ring size, in records */
+{
+  unsigned i, num_insn = ld_text_size / sizeof(md_inst_t);
+
+  if (fe_running)
+    panic("functional front end already running");
+  if (ring_size < FRONTEND_MIN_RING || (ring_size & (ring_size - 1)) != 0)
+    panic("bad functional front end ring size: %d", ring_size);
+
+  /* copy the program text, the memory belongs to the front end thread,
+     the copy is made again at each start, as the text may have been
+     written since the last run */
+  if (!fe_text)
+    {
+      fe_text = (md_inst_t *)calloc(num_insn + 1, sizeof(md_inst_t));
+      if (!fe_text)
+	fatal("out of virtual memory");
+    }
+  for (i=0; i < num_insn; i++)
+    MD_FETCH_INST(fe_text[i], mem, ld_text_base + i * sizeof(md_inst_t));
+
+  if (!fe_ring)
+    {
+      fe_ring = (struct fe_rec_t *)calloc(ring_size, sizeof(struct fe_rec_t));
+      if (!fe_ring)
+	fatal("out of virtual memory");
+    }
+  fe_ring_size = ring_size;
+  fe_head = fe_tail = fe_taken = fe_avail = fe_trap_done = 0;
+  fe_done = fe_quit = FALSE;
+
+  fe_regs = *regs;
+  fe_mem = mem;
+  fe_limit = limit;
+
+  if (pthread_create(&fe_thread, NULL, fe_main, NULL) != 0)
+    fatal("cannot create functional front end thread");
+  fe_running = TRUE;
+}
+
+/* wait for the front end to publish a record, returns zero if it is done
+   and all its records have been taken */
+static int
+fe_wait(void)
+{
+  int spin;
+
+  for (spin=0; fe_taken == fe_avail; spin++)
+    {
+      if (RING_LOAD(&fe_done))
+	{
+	  /* FE_HEAD is final once FE_DONE is set */
+	  fe_avail = RING_LOAD(&fe_head);
+	  return fe_taken != fe_avail;
+	}
+      fe_avail = RING_LOAD(&fe_head);
+      if (fe_taken == fe_avail && spin >= RING_SPIN)
+	sched_yield();
+    }
+  return TRUE;
+}
+
+/* take the record of the next instruction executed by the front end into
+   REC, waiting for the front end as needed, trap instructions are executed
+   here, NOTE: the program may exit in a trap */
+void
+frontend_next(struct fe_rec_t *rec)	/* record of the next inst */
+{
+  struct fe_rec_t *r;
+
+  if (!fe_wait())
+    panic("functional front end ran dry");
+
+  r = &fe_ring[fe_taken & (fe_ring_size - 1)];
+  if (r->flags & FE_TEXT_WRITE)
+    fatal("store to the program text @ 0x%08p, self-modifying code cannot "
+	  "run with a functional front end (-fetch:decouple)", r->PC);
+  if (r->flags & FE_TRAP)
+    {
+      /* the front end waits on the trap, execute it on its state */
+      fe_exec(&fe_regs, fe_mem, r, /* traps */TRUE);
+      *rec = *r;
+      fe_taken++;
+      RING_STORE(&fe_tail, fe_taken);
+      RING_STORE(&fe_trap_done, fe_taken);
+      return;
+    }
+
+  *rec = *r;
+  fe_taken++;
+  if (!(fe_taken & (RING_BATCH - 1)))
+    RING_STORE(&fe_tail, fe_taken);
+}
+
+/* return the instruction at text address PC, from the private copy of the
+   program text */
+md_inst_t
+frontend_fetch(md_addr_t PC)		/* text address */
+{
+  return fe_text[(PC - ld_text_base) / sizeof(md_inst_t)];
+}
+
+/* stop the front end, the records not taken yet are discarded; the front
+   end runs up to its inst count limit or to the next trap instruction, so
+   the amount of work it does is not timing dependent */
+void
+frontend_stop(void)
+{
+  if (!fe_running)
+    return;
+
+  /* discard records until the front end is done, or waits on a trap */
+  while (fe_wait())
+    {
+      if (fe_ring[fe_taken & (fe_ring_size - 1)].flags & FE_TRAP)
+	{
+	  RING_STORE(&fe_quit, TRUE);
+	  break;
+	}
+      fe_taken++;
+      RING_STORE(&fe_tail, fe_taken);
+    }
+
+  pthread_join(fe_thread, NULL);
+  fe_running = FALSE;
+}
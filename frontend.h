@@ -0,0 +1,125 @@
+/* frontend.h - decoupled functional front end interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef FRONTEND_H
+#define FRONTEND_H
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "regs.h"
+#include "memory.h"
+
+/*
+ * This module implements a functional front end that runs ahead of a timing
+ * model.  The front end executes the program on the correct path only, on a
+ * thread of its own, and leaves one record per instruction executed in a
+ * lock-free single-producer single-consumer ring, from which the timing
+ * model takes the outcome of each instruction (next PC, branch target and
+ * effective address) instead of executing it.  Once the front end is
+ * started, it owns the program memory and the register state it was started
+ * with; the timing model fetches instructions from a private copy of the
+ * program text (see frontend_fetch()), which is refreshed at each start and
+ * patched by the system calls that write the text, while a store to the
+ * text is a fatal error, as the front end has run ahead of it on the copy.
+ * Trap instructions (i.e., system
+ * calls) are not executed by the front end thread, the front end waits for
+ * the timing model to reach them, and they are executed by the thread that
+ * takes their record, so the program exits and performs its I/O on the
+ * simulator main thread.
+ */
+
+/* minimum size of the ring, in records, a power of two */
+#define FRONTEND_MIN_RING	64
+
+/* front end record flags */
+#define FE_TRAP			0x0001	/* trap instruction */
+#define FE_TEXT_WRITE		0x0002	/* store to the program text */
+
+/* one instruction executed by the front end */
+struct fe_rec_t {
+  md_addr_t PC;			/* address of the instruction */
+  md_addr_t NPC;		/* address of the next instruction executed */
+  md_addr_t target_PC;		/* branch target, if computed */
+  md_addr_t addr;		/* effective address, if load/store */
+  int addr_size;		/* size of access at ADDR */
+  int flags;			/* record flags, see above */
+  enum md_fault_type fault;	/* instruction fault, if any */
+};
+
+/* start the front end, with a ring of RING_SIZE records, on the program in
+   REGS and MEM starting with the instruction at REGS->REGS_PC; the front end
+   executes at most LIMIT insts, or runs until the program exits if LIMIT is
+   zero, and it stops after the first instruction that faults */
+void
+frontend_start(struct regs_t *regs,	/* registers to start with */
+	       struct mem_t *mem,	/* memory holding the program */
+	       counter_t limit,		/* inst count limit, zero = none */
+	       int ring_size);		/* ring size, in records */
+
+/* take the record of the next instruction executed by the front end into
+   REC, waiting for the front end as needed, trap instructions are executed
+   here, NOTE: the program may exit in a trap */
+void
+frontend_next(struct fe_rec_t *rec);	/* record of the next inst */
+
+/* return the instruction at text address PC, from the private copy of the
+   program text */
+md_inst_t
+frontend_fetch(md_addr_t PC);		/* text address */
+
+/* stop the front end, the records not taken yet are discarded; the front
+   end runs up to its inst count limit or to the next trap instruction, so
+   the amount of work it does is not timing dependent */
+void
+frontend_stop(void);
+
+#endif /* FRONTEND_H */
@@ -0,0 +1,566 @@
+/* libcheetah.c - single-pass cache simulation library */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../host.h"
+#include "../misc.h"
+#include "../machine.h"
+#include "libcheetah.h"
+
+/* analysis being performed */
+static enum cheetah_config_t ch_config;
+
+/* line size (log2) of the fully and set associative caches */
+static int ch_line_size;
+
+/* total number of references analyzed */
+static counter_t ch_refs = 0;
+
+/* an invalid line address, no reference maps to it */
+#define CH_INVALID		(~(md_addr_t)0)
+
+
+/*
+ * fully associative caches, the LRU stack distance of a reference is the
+ * number of distinct lines referenced since the last reference to its line,
+ * lines are timestamped with the time of their last reference, and a binary
+ * indexed (Fenwick) tree over time marks the timestamps in use, so the
+ * distance is the number of marks after the timestamp of the line, which
+ * takes O(log n) time instead of a walk down the LRU stack
+ */
+
+/* a line referenced */
+struct fa_line_t {
+  struct fa_line_t *next;	/* next line in hash bucket chain */
+  md_addr_t line;		/* line address */
+  unsigned int time;		/* time of last reference */
+};
+
+/* line hash table, grown to keep the chains short */
+static struct fa_line_t **fa_htab = NULL;
+static unsigned int fa_hsize = 0;
+
+/* number of lines referenced */
+static unsigned int fa_nlines = 0;
+
+/* line entries are allocated in chunks */
+#define FA_CHUNK		4096
+static struct fa_line_t *fa_free = NULL;
+static int fa_nfree = 0;
+
+/* binary indexed tree of the timestamps in use, FA_TSIZE entries */
+static int *fa_tree = NULL;
+static unsigned int fa_tsize = 0;
+
+/* current time */
+static unsigned int fa_now = 0;
+
+/* number of lines in the largest cache, and the size interval (in lines) */
+static unsigned int fa_max_lines;
+static unsigned int fa_interval;
+
+/* stack distance histogram, FA_MAX_LINES entries, and the number of
+   references with larger distances or to lines never referenced */
+static counter_t *fa_dist = NULL;
+static counter_t fa_far = 0;
+
+/* hash a line address */
+#define FA_HASH(LINE)							\
+  ((unsigned int)((LINE) ^ ((LINE) >> 11) ^ ((LINE) >> 23)) & (fa_hsize-1))
+
+/* add V to the mark count of time I */
+static void
+fa_tree_add(unsigned int i, int v)
+{
+  for (; i <= fa_tsize; i += i & -i)
+    fa_tree[i] += v;
+}
+
+/* return the number of marks up to time I */
+static unsigned int
+fa_tree_sum(unsigned int i)
+{
+  unsigned int sum = 0;
+
+  for (; i > 0; i -= i & -i)
+    sum += fa_tree[i];
+  return sum;
+}
+
+/* double the size of the line hash table */
+static void
+fa_rehash(void)
+{
+  struct fa_line_t **htab = fa_htab, *ent, *next;
+  unsigned int i, hsize = fa_hsize;
+
+  fa_hsize = hsize ? hsize * 2 : 65536;
+  fa_htab = calloc(fa_hsize, sizeof(struct fa_line_t *));
+  if (!fa_htab)
+    fatal("out of virtual memory");
+
+  for (i=0; i<hsize; i++)
+    {
+      for (ent=htab[i]; ent; ent=next)
+	{
+	  next = ent->next;
+	  ent->next = fa_htab[FA_HASH(ent->line)];
+	  fa_htab[FA_HASH(ent->line)] = ent;
+	}
+    }
+  if (htab)
+    free(htab);
+}
+
+/* order lines by time of last reference */
+static int
+fa_time_cmp(const void *a, const void *b)
+{
+  unsigned int ta = (*(struct fa_line_t **)a)->time;
+  unsigned int tb = (*(struct fa_line_t **)b)->time;
+
+  return (ta < tb) ? -1 : (ta > tb);
+}
+
+/* renumber the timestamps of all lines from 1, in order, and rebuild the
+   tree, growing it so that at least as many timestamps remain free */
+static void
+fa_compact(void)
+{
+  struct fa_line_t **lines, *ent;
+  unsigned int i, j, n = 0;
+
+  lines = calloc(fa_nlines + 1, sizeof(struct fa_line_t *));
+  if (!lines)
+    fatal("out of virtual memory");
+  for (i=0; i<fa_hsize; i++)
+    for (ent=fa_htab[i]; ent; ent=ent->next)
+      lines[n++] = ent;
+  qsort(lines, n, sizeof(struct fa_line_t *), fa_time_cmp);
+
+  while (fa_tsize < 2 * n + 2)
+    fa_tsize = fa_tsize ? fa_tsize * 2 : 1048576;
+  free(fa_tree);
+  fa_tree = calloc(fa_tsize + 1, sizeof(int));
+  if (!fa_tree)
+    fatal("out of virtual memory");
+
+  for (i=1; i<=n; i++)
+    lines[i-1]->time = i;
+
+  /* build the tree bottom up, each node adds its count to its parent */
+  for (i=1; i<=fa_tsize; i++)
+    {
+      if (i <= n)
+	fa_tree[i]++;
+      j = i + (i & -i);
+      if (j <= fa_tsize)
+	fa_tree[j] += fa_tree[i];
+    }
+  fa_now = n;
+  free(lines);
+}
+
+/* analyze a reference to line LINE in the fully associative caches */
+static void
+fa_access(md_addr_t line)
+{
+  struct fa_line_t *ent;
+  unsigned int dist;
+
+  if (++fa_now > fa_tsize)
+    {
+      fa_compact();
+      fa_now++;
+    }
+
+  for (ent=fa_htab[FA_HASH(line)]; ent; ent=ent->next)
+    if (ent->line == line)
+      break;
+
+  if (ent)
+    {
+      /* all lines are marked at times before now */
+      dist = fa_nlines - fa_tree_sum(ent->time);
+      fa_tree_add(ent->time, -1);
+      if (dist < fa_max_lines)
+	fa_dist[dist]++;
+      else
+	fa_far++;
+    }
+  else
+    {
+      /* first reference to the line */
+      if (!fa_nfree)
+	{
+	  fa_free = calloc(FA_CHUNK, sizeof(struct fa_line_t));
+	  if (!fa_free)
+	    fatal("out of virtual memory");
+	  fa_nfree = FA_CHUNK;
+	}
+      ent = fa_free++;
+      fa_nfree--;
+      ent->line = line;
+      ent->next = fa_htab[FA_HASH(line)];
+      fa_htab[FA_HASH(line)] = ent;
+      if (++fa_nlines > 2 * fa_hsize)
+	fa_rehash();
+      fa_far++;
+    }
+
+  fa_tree_add(fa_now, 1);
+  ent->time = fa_now;
+}
+
+/* print the miss ratios of the fully associative caches */
+static void
+fa_stats(FILE *fd)
+{
+  unsigned int lines, d = 0;
+  counter_t hits = 0;
+
+  fprintf(fd, "fully associative LRU caches, %d byte lines\n",
+	  1 << ch_line_size);
+  fprintf(fd, "%12s %14s %10s\n", "size", "misses", "miss_ratio");
+  for (lines=fa_interval; lines<=fa_max_lines; lines+=fa_interval)
+    {
+      for (; d < lines; d++)
+	hits += fa_dist[d];
+      fprintf(fd, "%12u %14.0f %10.6f\n",
+	      lines << ch_line_size, (double)(ch_refs - hits),
+	      ch_refs ? (double)(ch_refs - hits) / (double)ch_refs : 0.0);
+    }
+}
+
+
+/*
+ * set associative caches, one LRU stack of up to SA_ASSOC lines is kept per
+ * set for each number of sets, a reference at depth D of its stack hits in
+ * all caches of that number of sets with an associativity above D
+ */
+
+/* range of the number of sets (log2), and the maximum associativity */
+static int sa_min_sets, sa_max_sets;
+static int sa_assoc;
+
+/* LRU stacks, SA_ASSOC lines per set, most recently used first, for each
+   number of sets from 2^SA_MIN_SETS */
+static md_addr_t **sa_stacks = NULL;
+
+/* stack distance histograms, SA_ASSOC entries for each number of sets,
+   references at the top of their stacks are counted in SA_TOP instead, at
+   the smallest number of sets they are at the top for (as they are at the
+   top for all larger numbers of sets too) */
+static counter_t **sa_dist = NULL;
+static counter_t *sa_top = NULL;
+
+/* analyze a reference to line LINE in the set associative caches */
+static void
+sa_access(md_addr_t line)
+{
+  int k, d;
+  md_addr_t *stack;
+
+  for (k=0; k<=sa_max_sets-sa_min_sets; k++)
+    {
+      stack = sa_stacks[k]
+	+ (line & ((1 << (k + sa_min_sets)) - 1)) * sa_assoc;
+
+      /* at the top of its stack, the stacks of all larger numbers of sets
+	 are left as they are */
+      if (stack[0] == line)
+	{
+	  sa_top[k]++;
+	  return;
+	}
+
+      for (d=1; d<sa_assoc && stack[d] != line; d++)
+	/* nada */;
+      if (d < sa_assoc)
+	sa_dist[k][d]++;
+      else
+	{
+	  /* a miss for all associativities, drop the LRU line */
+	  d = sa_assoc - 1;
+	}
+
+      /* move the line to the top of its stack */
+      memmove(stack + 1, stack, d * sizeof(md_addr_t));
+      stack[0] = line;
+    }
+}
+
+/* print the miss ratios of the set associative caches */
+static void
+sa_stats(FILE *fd)
+{
+  int k, a, d;
+  counter_t hits, top = 0;
+
+  fprintf(fd, "set associative LRU caches, %d byte lines\n",
+	  1 << ch_line_size);
+  fprintf(fd, "%10s %6s %12s %14s %10s\n",
+	  "sets", "assoc", "size", "misses", "miss_ratio");
+  for (k=0; k<=sa_max_sets-sa_min_sets; k++)
+    {
+      top += sa_top[k];
+      for (a=1; a<=sa_assoc; a*=2)
+	{
+	  hits = top;
+	  for (d=1; d<a; d++)
+	    hits += sa_dist[k][d];
+	  fprintf(fd, "%10d %6d %12.0f %14.0f %10.6f\n",
+		  1 << (k + sa_min_sets), a,
+		  (double)(1 << (k + sa_min_sets)) * a * (1 << ch_line_size),
+		  (double)(ch_refs - hits),
+		  ch_refs ? (double)(ch_refs - hits) / (double)ch_refs : 0.0);
+	}
+    }
+}
+
+
+/*
+ * direct-mapped caches of one size with varying line sizes, each simulated
+ * on its own
+ */
+
+/* cache size (log2) and range of line sizes (log2) */
+static int dm_size;
+static int dm_min_line, dm_max_line;
+
+/* cache tags, one array for each line size from 2^DM_MIN_LINE */
+static md_addr_t **dm_tags = NULL;
+
+/* number of misses, for each line size */
+static counter_t *dm_misses = NULL;
+
+/* analyze a reference to address ADDR in the direct-mapped caches */
+static void
+dm_access(md_addr_t addr)
+{
+  int k;
+  md_addr_t line, *tag;
+
+  for (k=0; k<=dm_max_line-dm_min_line; k++)
+    {
+      line = addr >> (k + dm_min_line);
+      tag = &dm_tags[k][line & ((1 << (dm_size - dm_min_line - k)) - 1)];
+      if (*tag != line)
+	{
+	  dm_misses[k]++;
+	  *tag = line;
+	}
+    }
+}
+
+/* print the miss ratios of the direct-mapped caches */
+static void
+dm_stats(FILE *fd)
+{
+  int k;
+
+  fprintf(fd, "direct-mapped caches, %d bytes\n", 1 << dm_size);
+  fprintf(fd, "%10s %14s %10s\n", "line_size", "misses", "miss_ratio");
+  for (k=0; k<=dm_max_line-dm_min_line; k++)
+    fprintf(fd, "%10d %14.0f %10.6f\n",
+	    1 << (k + dm_min_line), (double)dm_misses[k],
+	    ch_refs ? (double)dm_misses[k] / (double)ch_refs : 0.0);
+}
+
+
+/*
+ * libcheetah interfaces
+ */
+
+/* allocate an array of N lines, all invalid */
+static md_addr_t *
+ch_lines_create(unsigned int n)
+{
+  md_addr_t *lines;
+  unsigned int i;
+
+  if (!(lines = calloc(n, sizeof(md_addr_t))))
+    fatal("out of virtual memory");
+  for (i=0; i<n; i++)
+    lines[i] = CH_INVALID;
+  return lines;
+}
+
+/* initialize libcheetah for analysis CONFIG, for ch_sa, the number of sets
+   ranges from 2^MIN_SETS to 2^MAX_SETS and the associativity from 1 to
+   2^MAX_ASSOC, for ch_fa, cache sizes from SIZE_INTERVAL to MAX_SIZE bytes,
+   in steps of SIZE_INTERVAL, are reported, for ch_dm, the cache size is
+   2^DM_SIZE bytes and the line size ranges from 2^MIN_SETS to 2^MAX_SETS
+   bytes; all other caches have lines of 2^LINE_SIZE bytes */
+void
+cheetah_init(enum cheetah_config_t config,	/* analysis to perform */
+	     int min_sets,			/* min sets (log2) */
+	     int max_sets,			/* max sets (log2) */
+	     int line_size,			/* line size (log2) */
+	     int max_assoc,			/* max associativity (log2) */
+	     int size_interval,			/* fa size interval (bytes) */
+	     int max_size,			/* fa max cache size (bytes) */
+	     int dm_size_log2)			/* dm cache size (log2) */
+{
+  int k;
+
+  ch_config = config;
+  ch_line_size = line_size;
+  ch_refs = 0;
+
+  if (config != ch_dm && (line_size < 2 || line_size > 16))
+    fatal("line size (log2) `%d' must be between 2 and 16", line_size);
+
+  switch (config)
+    {
+    case ch_fa:
+      if (size_interval <= 0 || (size_interval & ((1 << line_size) - 1)))
+	fatal("cache size interval `%d' must be a multiple of the line size",
+	      size_interval);
+      if (max_size < size_interval)
+	fatal("max cache size `%d' must be at least the size interval",
+	      max_size);
+      fa_interval = size_interval >> line_size;
+      fa_max_lines = max_size >> line_size;
+      fa_dist = calloc(fa_max_lines, sizeof(counter_t));
+      if (!fa_dist)
+	fatal("out of virtual memory");
+      fa_rehash();
+      fa_compact();
+      break;
+
+    case ch_sa:
+      if (min_sets < 0 || max_sets < min_sets || max_sets > 24)
+	fatal("bad range of sets (log2) `%d'..`%d'", min_sets, max_sets);
+      if (max_assoc < 0 || max_assoc > 10)
+	fatal("bad max associativity (log2) `%d'", max_assoc);
+      sa_min_sets = min_sets;
+      sa_max_sets = max_sets;
+      sa_assoc = 1 << max_assoc;
+      sa_stacks = calloc(max_sets - min_sets + 1, sizeof(md_addr_t *));
+      sa_dist = calloc(max_sets - min_sets + 1, sizeof(counter_t *));
+      sa_top = calloc(max_sets - min_sets + 1, sizeof(counter_t));
+      if (!sa_stacks || !sa_dist || !sa_top)
+	fatal("out of virtual memory");
+      for (k=0; k<=max_sets-min_sets; k++)
+	{
+	  sa_stacks[k] = ch_lines_create((1 << (k + min_sets)) * sa_assoc);
+	  if (!(sa_dist[k] = calloc(sa_assoc, sizeof(counter_t))))
+	    fatal("out of virtual memory");
+	}
+      break;
+
+    case ch_dm:
+      if (min_sets < 2 || max_sets < min_sets || max_sets > dm_size_log2)
+	fatal("bad range of line sizes (log2) `%d'..`%d'", min_sets, max_sets);
+      if (dm_size_log2 > 28)
+	fatal("bad direct-mapped cache size (log2) `%d'", dm_size_log2);
+      dm_size = dm_size_log2;
+      dm_min_line = min_sets;
+      dm_max_line = max_sets;
+      dm_tags = calloc(max_sets - min_sets + 1, sizeof(md_addr_t *));
+      dm_misses = calloc(max_sets - min_sets + 1, sizeof(counter_t));
+      if (!dm_tags || !dm_misses)
+	fatal("out of virtual memory");
+      for (k=0; k<=max_sets-min_sets; k++)
+	dm_tags[k] = ch_lines_create(1 << (dm_size - min_sets - k));
+      break;
+
+    default:
+      panic("bogus cache configuration");
+    }
+}
+
+/* analyze a reference to address ADDR */
+void
+cheetah_access(md_addr_t addr)		/* address of access */
+{
+  ch_refs++;
+
+  switch (ch_config)
+    {
+    case ch_fa:
+      fa_access(addr >> ch_line_size);
+      break;
+    case ch_sa:
+      sa_access(addr >> ch_line_size);
+      break;
+    case ch_dm:
+      dm_access(addr);
+      break;
+    }
+}
+
+/* print the miss ratios of all caches analyzed to stream FD, MID is
+   non-zero if the stats are printed before the end of the analysis */
+void
+cheetah_stats(FILE *fd,			/* output stream */
+	      int mid)			/* intermediate stats? */
+{
+  fprintf(fd, "\ncheetah: ** %s miss ratios, %.0f references **\n",
+	  mid ? "intermediate" : "final", (double)ch_refs);
+
+  switch (ch_config)
+    {
+    case ch_fa:
+      fa_stats(fd);
+      break;
+    case ch_sa:
+      sa_stats(fd);
+      break;
+    case ch_dm:
+      dm_stats(fd);
+      break;
+    }
+}
@@ -0,0 +1,114 @@
+/* libcheetah.h - single-pass cache simulation library interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+/*
+ * libcheetah analyzes many cache configurations in one pass over a stream
+ * of references.  All caches use LRU replacement, three analyses are
+ * supported:
+ *
+ *   fully associative caches (ch_fa): the stack distance of every
+ *   reference is computed (Mattson et al.), a reference hits in all fully
+ *   associative caches with more lines than its stack distance, so the
+ *   miss ratios of caches of all sizes follow from one distance histogram
+ *
+ *   set associative caches (ch_sa): one LRU stack per set is kept for each
+ *   number of sets analyzed, the stack distance in the stack of its set
+ *   gives the hits for all associativities; since the stacks of 2N sets
+ *   refine those of N sets (Hill and Smith), a reference to the top of its
+ *   stack for N sets is at the top of its stacks for all larger numbers of
+ *   sets, and the analysis of the larger numbers of sets is skipped
+ *
+ *   direct-mapped caches of one size with varying line sizes (ch_dm)
+ */
+
+#ifndef LIBCHEETAH_H
+#define LIBCHEETAH_H
+
+#include <stdio.h>
+
+#include "../host.h"
+#include "../misc.h"
+#include "../machine.h"
+
+/* cache configurations analyzed */
+enum cheetah_config_t {
+  ch_fa,			/* fully associative */
+  ch_sa,			/* set associative */
+  ch_dm				/* direct-mapped, varying line size */
+};
+
+/* initialize libcheetah for analysis CONFIG, for ch_sa, the number of sets
+   ranges from 2^MIN_SETS to 2^MAX_SETS and the associativity from 1 to
+   2^MAX_ASSOC, for ch_fa, cache sizes from SIZE_INTERVAL to MAX_SIZE bytes,
+   in steps of SIZE_INTERVAL, are reported, for ch_dm, the cache size is
+   2^DM_SIZE bytes and the line size ranges from 2^MIN_SETS to 2^MAX_SETS
+   bytes; all other caches have lines of 2^LINE_SIZE bytes */
+void
+cheetah_init(enum cheetah_config_t config,	/* analysis to perform */
+	     int min_sets,			/* min sets (log2) */
+	     int max_sets,			/* max sets (log2) */
+	     int line_size,			/* line size (log2) */
+	     int max_assoc,			/* max associativity (log2) */
+	     int size_interval,			/* fa size interval (bytes) */
+	     int max_size,			/* fa max cache size (bytes) */
+	     int dm_size);			/* dm cache size (log2) */
+
+/* analyze a reference to address ADDR */
+void
+cheetah_access(md_addr_t addr);		/* address of access */
+
+/* print the miss ratios of all caches analyzed to stream FD, MID is
+   non-zero if the stats are printed before the end of the analysis */
+void
+cheetah_stats(FILE *fd,			/* output stream */
+	      int mid);			/* intermediate stats? */
+
+#endif /* LIBCHEETAH_H */
@@ -72,6 +72,7 @@
 #include "dlite.h"
 #include "options.h"
 #include "stats.h"
+#include "memory.h"
 #include "loader.h"
 #include "sim.h"
 
@@ -268,6 +269,9 @@ main(int argc, char **argv, char **envp)
 	       &init_quit, /* default */FALSE, /* !print */FALSE, NULL);
   opt_reg_string(sim_odb, "-chkpt", "restore EIO trace execution from <fname>",
 		 &sim_chkpt_fname, /* default */NULL, /* !print */FALSE, NULL);
+  opt_reg_flag(sim_odb, "-mem:flat",
+	       "back simulated memory with host virtual memory (64-bit hosts)",
+	       &mem_flat_spaces, /* default */FALSE, /* print */TRUE, NULL);
 
   /* stdio redirection options */
   opt_reg_string(sim_odb, "-redir:sim",
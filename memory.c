@@ -51,6 +51,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#if !defined(_MSC_VER)
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 #include "host.h"
 #include "misc.h"
@@ -60,7 +65,33 @@
 #include "memory.h"
 
 
-/* create a flat memory space */
+/* create memory spaces backed by host virtual memory (see mem_create()),
+   instead of the page table */
+int mem_flat_spaces = FALSE;
+
+/* invalidate all the translation cache entries of memory space MEM */
+static void
+mem_tlb_flush(struct mem_t *mem)	/* memory space to flush */
+{
+  int i, j;
+
+  for (i=0; i < MEM_NUM_TLBS; i++)
+    for (j=0; j < MEM_TLB_SIZE; j++)
+      {
+	mem->tlb[i][j].tag = MEM_TLB_INVALID;
+	mem->tlb[i][j].page = NULL;
+      }
+}
+
+#if defined(MAP_ANONYMOUS) && defined(MAP_NORESERVE)
+/* flat memory spaces are supported on hosts with a 64-bit address space */
+#define MEM_HAS_FLAT_SPACES	(sizeof(void *) >= sizeof(qword_t))
+#else
+#define MEM_HAS_FLAT_SPACES	FALSE
+#endif
+
+/* create a memory space, a flat memory space if MEM_FLAT_SPACES is set
+   and the host supports it */
 struct mem_t *
 mem_create(char *name)			/* name of the memory space */
 {
@@ -71,9 +102,68 @@ mem_create(char *name)			/* name of the memory space */
     fatal("out of virtual memory");
 
   mem->name = mystrdup(name);
+  mem_tlb_flush(mem);
+
+  if (mem_flat_spaces)
+    {
+      if (!MEM_HAS_FLAT_SPACES)
+	warn("flat memory spaces are not supported on this host, "
+	     "memory space `%s' uses the page table", name);
+      else
+	{
+	  /* reserve the first segment, the only one of a 32-bit target */
+	  mem->flat = TRUE;
+	  mem->seg_tag = 0;
+	  mem->seg_base = mem_segment(mem, 0);
+	}
+    }
   return mem;
 }
 
+/* locate the host region of the segment of flat memory space MEM that
+   holds address ADDR, the region is reserved when first accessed, and
+   becomes the last segment accessed */
+byte_t *
+mem_segment(struct mem_t *mem,		/* flat memory space to access */
+	    md_addr_t addr)		/* virtual address to translate */
+{
+  struct mem_seg_t *seg;
+
+  for (seg=mem->segs; seg != NULL; seg=seg->next)
+    {
+      if (seg->tag == MEM_SEG_TAG(addr))
+	break;
+    }
+
+  if (!seg)
+    {
+      seg = calloc(1, sizeof(struct mem_seg_t));
+      if (!seg)
+	fatal("out of virtual memory");
+      seg->tag = MEM_SEG_TAG(addr);
+
+#if defined(MAP_ANONYMOUS) && defined(MAP_NORESERVE)
+      /* no swap space is reserved, the host allocates zero-filled pages as
+	 they are first touched */
+      seg->base = mmap(NULL, ULL(1) << MEM_LOG_SEG_SIZE,
+		       PROT_READ|PROT_WRITE,
+		       MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+      if (seg->base == (byte_t *)MAP_FAILED)
+	fatal("cannot reserve host memory for memory space `%s'", mem->name);
+#else
+      panic("flat memory spaces are not supported on this host");
+#endif
+
+      seg->next = mem->segs;
+      mem->segs = seg;
+      mem->seg_count++;
+    }
+
+  mem->seg_tag = seg->tag;
+  mem->seg_base = seg->base;
+  return seg->base;
+}
+
 /* translate address ADDR in memory space MEM, returns pointer to host page */
 byte_t *
 mem_translate(struct mem_t *mem,	/* memory space to access */
@@ -106,14 +196,42 @@ mem_translate(struct mem_t *mem,	/* memory space to access */
   return NULL;
 }
 
+/* translation cache miss handler, locates the host page for address ADDR
+   in memory space MEM, and caches it in translation cache TLB, returns
+   NULL if the page is unallocated */
+byte_t *
+mem_tlb_fill(struct mem_t *mem,		/* memory space to access */
+	     int tlb,			/* translation cache to fill */
+	     md_addr_t addr)		/* virtual address to translate */
+{
+  byte_t *page;
+
+  mem->tlb_misses++;
+  page = MEM_PAGE(mem, addr);
+
+  /* unallocated pages are not cached, so the page allocator does not have
+     to look for them */
+  if (page)
+    {
+      mem->tlb[tlb][MEM_TLB_SET(addr)].tag = MEM_TLB_TAG(addr);
+      mem->tlb[tlb][MEM_TLB_SET(addr)].page = page;
+    }
+  return page;
+}
+
 /* allocate a memory page */
 void
 mem_newpage(struct mem_t *mem,		/* memory space to allocate in */
 	    md_addr_t addr)		/* virtual address to allocate */
 {
+  int i;
   byte_t *page;
   struct mem_pte_t *pte;
 
+  /* all the pages of flat memory spaces exist */
+  if (mem->flat)
+    return;
+
   /* see misc.c for details on the getcore() function */
   page = getcore(MD_PAGE_SIZE);
   if (!page)
@@ -130,6 +248,13 @@ mem_newpage(struct mem_t *mem,		/* memory space to allocate in */
   pte->next = mem->ptab[MEM_PTAB_SET(addr)];
   mem->ptab[MEM_PTAB_SET(addr)] = pte;
 
+  /* the page table changed, drop any translations of the page */
+  for (i=0; i < MEM_NUM_TLBS; i++)
+    {
+      if (mem->tlb[i][MEM_TLB_SET(addr)].tag == MEM_TLB_TAG(addr))
+	mem->tlb[i][MEM_TLB_SET(addr)].tag = MEM_TLB_INVALID;
+    }
+
   /* one more page allocated */
   mem->page_count++;
 }
@@ -144,7 +269,7 @@ mem_access(struct mem_t *mem,		/* memory space to access */
 	   void *vp,			/* host memory address to access */
 	   int nbytes)			/* number of bytes to access */
 {
-  byte_t *p = vp;
+  byte_t *p = vp, *page;
 
   /* check alignments */
   if (/* check size */(nbytes & (nbytes-1)) != 0
@@ -154,70 +279,116 @@ mem_access(struct mem_t *mem,		/* memory space to access */
   if (/* check natural alignment */(addr & (nbytes-1)) != 0)
     return md_fault_alignment;
 
-  /* perform the copy */
-  {
-    if (cmd == Read)
-      {
-	while (nbytes-- > 0)
-	  {
-	    *((byte_t *)p) = MEM_READ_BYTE(mem, addr);
-	    p += sizeof(byte_t);
-	    addr += sizeof(byte_t);
-	  }
-      }
-    else
-      {
-	while (nbytes-- > 0)
-	  {
-	    MEM_WRITE_BYTE(mem, addr, *((byte_t *)p));
-	    p += sizeof(byte_t);
-	    addr += sizeof(byte_t);
-	  }
-      }
-  }
+  /* a naturally aligned access never spans pages, so the page is looked up
+     once; the data is copied as is, i.e., in target byte order, the typed
+     accessors of the callers swap it if needed */
+  page = MEM_PAGE(mem, addr);
+  if (!page)
+    {
+      if (cmd == Read)
+	{
+	  /* page not yet allocated, read zero values */
+	  memset(p, 0, nbytes);
+	  return md_fault_none;
+	}
 
-#if 0
+      /* allocate the page when it is first written */
+      mem_newpage(mem, addr);
+      page = MEM_PAGE(mem, addr);
+    }
+  page += MEM_OFFSET(addr);
+
+  /* perform the copy, the host buffer may not be aligned, so the copies are
+     done with memcpy(), the common sizes are constant so each copy is a
+     single move */
   switch (nbytes)
     {
     case 1:
       if (cmd == Read)
-	*((byte_t *)p) = MEM_READ_BYTE(mem, addr);
+	*p = *page;
       else
-	MEM_WRITE_BYTE(mem, addr, *((byte_t *)p));
+	*page = *p;
       break;
 
     case 2:
       if (cmd == Read)
-	*((half_t *)p) = MEM_READ_HALF(mem, addr);
+	memcpy(p, page, sizeof(half_t));
       else
-	MEM_WRITE_HALF(mem, addr, *((half_t *)p));
+	memcpy(page, p, sizeof(half_t));
       break;
 
     case 4:
       if (cmd == Read)
-	*((word_t *)p) = MEM_READ_WORD(mem, addr);
+	memcpy(p, page, sizeof(word_t));
       else
-	MEM_WRITE_WORD(mem, addr, *((word_t *)p));
+	memcpy(page, p, sizeof(word_t));
       break;
 
-#ifdef HOST_HAS_QWORD
     case 8:
       if (cmd == Read)
-	*((qword_t *)p) = MEM_READ_QWORD(mem, addr);
+	memcpy(p, page, 8);
       else
-	MEM_WRITE_QWORD(mem, addr, *((qword_t *)p));
+	memcpy(page, p, 8);
       break;
-#endif /* HOST_HAS_QWORD */
 
     default:
+      if (cmd == Read)
+	memcpy(p, page, nbytes);
+      else
+	memcpy(page, p, nbytes);
       break;
     }
-#endif
 
   /* no fault... */
   return md_fault_none;
 }
 
+/* copy NBYTES to/from simulated memory space at address ADDR directly, one
+   page at a time, a NULL host buffer VP writes zeros; this is what
+   mem_access() does for a copy of single bytes, so the bulk routines below
+   use it when they are given mem_access() as memory accessor, any other
+   accessor sees the same byte accesses as before */
+static void
+mem_bulk(struct mem_t *mem,		/* memory space to access */
+	 enum mem_cmd cmd,		/* Read (from sim mem) or Write */
+	 md_addr_t addr,		/* target address to access */
+	 void *vp,			/* host memory address to access */
+	 int nbytes)			/* number of bytes to access */
+{
+  byte_t *p = vp, *page;
+  int chunk;
+
+  while (nbytes > 0)
+    {
+      chunk = MIN(nbytes, MD_PAGE_SIZE - MEM_OFFSET(addr));
+      page = MEM_PAGE(mem, addr);
+      if (cmd == Read)
+	{
+	  if (page)
+	    memcpy(p, page + MEM_OFFSET(addr), chunk);
+	  else
+	    memset(p, 0, chunk);
+	}
+      else
+	{
+	  if (!page)
+	    {
+	      mem_newpage(mem, addr);
+	      page = MEM_PAGE(mem, addr);
+	    }
+	  if (p)
+	    memcpy(page + MEM_OFFSET(addr), p, chunk);
+	  else
+	    memset(page + MEM_OFFSET(addr), 0, chunk);
+	}
+
+      if (p)
+	p += chunk;
+      addr += chunk;
+      nbytes -= chunk;
+    }
+}
+
 /* register memory system-specific statistics */
 void
 mem_reg_stats(struct mem_t *mem,	/* memory space to declare */
@@ -225,6 +396,19 @@ mem_reg_stats(struct mem_t *mem,	/* memory space to declare */
 {
   char buf[512], buf1[512];
 
+  sprintf(buf, "%s.tlb_misses", mem->name);
+  stat_reg_counter(sdb, buf, "total translation cache misses",
+		   &mem->tlb_misses, mem->tlb_misses, NULL);
+
+  if (mem->flat)
+    {
+      /* pages are allocated by the host, and not tracked */
+      sprintf(buf, "%s.seg_count", mem->name);
+      stat_reg_counter(sdb, buf, "total number of host segments reserved",
+		       &mem->seg_count, mem->seg_count, NULL);
+      return;
+    }
+
   sprintf(buf, "%s.page_count", mem->name);
   stat_reg_counter(sdb, buf, "total number of pages allocated",
 		   &mem->page_count, mem->page_count, NULL);
@@ -257,9 +441,109 @@ mem_init(struct mem_t *mem)	/* memory space to initialize */
   for (i=0; i < MEM_PTAB_SIZE; i++)
     mem->ptab[i] = NULL;
 
+  mem_tlb_flush(mem);
+
   mem->page_count = 0;
   mem->ptab_misses = 0;
   mem->ptab_accesses = 0;
+  mem->tlb_misses = 0;
+}
+
+/* call FN for each page of memory space MEM that may hold non-zero data,
+   i.e., each page allocated in a page table memory space, or each page
+   touched and not all zero in a flat memory space */
+void
+mem_forall_pages(struct mem_t *mem,	/* memory space to visit */
+		 mem_page_fn fn,	/* page visitor */
+		 void *data)		/* visitor data */
+{
+  int i;
+  struct mem_pte_t *pte;
+
+  if (!mem->flat)
+    {
+      MEM_FORALL(mem, i, pte)
+	fn(MEM_PTE_ADDR(pte, i), pte->page, data);
+    }
+#if defined(MAP_ANONYMOUS) && defined(MAP_NORESERVE)
+  else
+    {
+      static byte_t zero_page[MD_PAGE_SIZE];
+      qword_t npages = (ULL(1) << MEM_LOG_SEG_SIZE) / MD_PAGE_SIZE, n;
+      qword_t host_page = (qword_t)sysconf(_SC_PAGESIZE), h, h_end;
+      struct mem_seg_t *seg;
+      unsigned char *vec;
+      int touched;
+
+      /* the host knows which of its pages were touched, mincore() reports
+	 one byte per host page, which may be smaller or larger than a
+	 target page, pages that were only read map its zero page, so all
+	 zero pages are skipped */
+      vec = malloc(((ULL(1) << MEM_LOG_SEG_SIZE) + host_page - 1)
+		   / host_page);
+      if (!vec)
+	fatal("out of virtual memory");
+      for (seg=mem->segs; seg != NULL; seg=seg->next)
+	{
+	  if (mincore(seg->base, ULL(1) << MEM_LOG_SEG_SIZE, (void *)vec) < 0)
+	    fatal("cannot locate the pages of memory space `%s'", mem->name);
+	  for (n=0; n < npages; n++)
+	    {
+	      byte_t *page = seg->base + n * MD_PAGE_SIZE;
+
+	      /* a target page was touched if any of the host pages it
+		 spans was, every target page in a touched host page is
+		 checked */
+	      touched = FALSE;
+	      h_end = ((n + 1) * MD_PAGE_SIZE - 1) / host_page;
+	      for (h = (n * MD_PAGE_SIZE) / host_page; h <= h_end; h++)
+		{
+		  if (vec[h] & 1)
+		    {
+		      touched = TRUE;
+		      break;
+		    }
+		}
+
+	      if (touched && memcmp(page, zero_page, MD_PAGE_SIZE) != 0)
+		fn((md_addr_t)((seg->tag << MEM_LOG_SEG_SIZE)
+			       | (n * MD_PAGE_SIZE)), page, data);
+	    }
+	}
+      free(vec);
+    }
+#endif
+}
+
+/* zero all of memory space MEM, its pages stay allocated, e.g., before a
+   checkpoint restores the pages that may hold non-zero data, which are all
+   that mem_forall_pages() visits */
+void
+mem_clear(struct mem_t *mem)		/* memory space to clear */
+{
+  int i;
+  struct mem_pte_t *pte;
+
+  if (!mem->flat)
+    {
+      MEM_FORALL(mem, i, pte)
+	memset(pte->page, 0, MD_PAGE_SIZE);
+    }
+#if defined(MAP_ANONYMOUS) && defined(MAP_NORESERVE)
+  else
+    {
+      struct mem_seg_t *seg;
+
+      /* the host hands out zero-filled pages again, where they are next
+	 touched, the segments stay mapped where they are */
+      for (seg=mem->segs; seg != NULL; seg=seg->next)
+	{
+	  if (madvise(seg->base, ULL(1) << MEM_LOG_SEG_SIZE,
+		      MADV_DONTNEED) < 0)
+	    fatal("cannot clear memory space `%s'", mem->name);
+	}
+    }
+#endif
 }
 
 /* dump a block of memory, returns any faults encountered */
@@ -304,6 +588,50 @@ mem_strcpy(mem_access_fn mem_fn,	/* user-specified memory accessor */
   char c;
   enum md_fault_type fault;
 
+  if (mem_fn == mem_access)
+    {
+      byte_t *page, *end;
+      int chunk;
+
+      switch (cmd)
+	{
+	case Read:
+	  /* copy up to the string terminator, one page at a time */
+	  for (;;)
+	    {
+	      chunk = MD_PAGE_SIZE - MEM_OFFSET(addr);
+	      page = MEM_PAGE(mem, addr);
+	      if (!page)
+		{
+		  /* page not yet allocated, reads as a terminator */
+		  *s = '\0';
+		  break;
+		}
+	      page += MEM_OFFSET(addr);
+	      end = memchr(page, '\0', chunk);
+	      if (end)
+		{
+		  memcpy(s, page, end - page + 1);
+		  break;
+		}
+	      memcpy(s, page, chunk);
+	      s += chunk;
+	      addr += chunk;
+	    }
+	  break;
+
+	case Write:
+	  mem_bulk(mem, Write, addr, s, strlen(s) + 1);
+	  break;
+
+	default:
+	  return md_fault_internal;
+	}
+
+      /* no faults... */
+      return md_fault_none;
+    }
+
   switch (cmd)
     {
     case Read:
@@ -348,6 +676,13 @@ mem_bcopy(mem_access_fn mem_fn,		/* user-specified memory accessor */
   byte_t *p = vp;
   enum md_fault_type fault;
 
+  if (mem_fn == mem_access)
+    {
+      /* direct access, one page at a time */
+      mem_bulk(mem, cmd, addr, vp, nbytes);
+      return md_fault_none;
+    }
+
   /* copy NBYTES bytes to/from simulator memory */
   while (nbytes-- > 0)
     {
@@ -375,6 +710,13 @@ mem_bcopy4(mem_access_fn mem_fn,	/* user-specified memory accessor */
   int words = nbytes >> 2;		/* note: nbytes % 2 == 0 is assumed */
   enum md_fault_type fault;
 
+  if (mem_fn == mem_access && (addr & (sizeof(word_t)-1)) == 0)
+    {
+      /* direct access, one page at a time */
+      mem_bulk(mem, cmd, addr, vp, words * sizeof(word_t));
+      return md_fault_none;
+    }
+
   while (words-- > 0)
     {
       fault = mem_fn(mem, cmd, addr, p, sizeof(word_t));
@@ -399,6 +741,13 @@ mem_bzero(mem_access_fn mem_fn,		/* user-specified memory accessor */
   byte_t c = 0;
   enum md_fault_type fault;
 
+  if (mem_fn == mem_access)
+    {
+      /* direct access, one page at a time */
+      mem_bulk(mem, Write, addr, NULL, nbytes);
+      return md_fault_none;
+    }
+
   /* zero out NBYTES of simulator memory */
   while (nbytes-- > 0)
     {
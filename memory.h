@@ -71,16 +71,58 @@ struct mem_pte_t {
   byte_t *page;			/* page pointer */
 };
 
+/* log2 of the size of the host regions that back flat memory spaces, each
+   region maps a naturally aligned segment of the address space */
+#define MEM_LOG_SEG_SIZE	32
+
+/* flat memory space segment */
+struct mem_seg_t {
+  struct mem_seg_t *next;	/* next segment of the memory space */
+  qword_t tag;			/* segment number */
+  byte_t *base;			/* host region that backs the segment */
+};
+
+/* number of entries of each translation cache (must be power-of-two) */
+#define MEM_TLB_SIZE		64
+
+/* translation caches, one for each kind of access site */
+#define MEM_TLB_FETCH		0	/* instruction fetches */
+#define MEM_TLB_LOAD		1	/* loads */
+#define MEM_TLB_STORE		2	/* stores */
+#define MEM_NUM_TLBS		3
+
+/* translation cache entry, maps a virtual page to its host page */
+struct mem_tlb_ent_t {
+  md_addr_t tag;		/* virtual page address, or MEM_TLB_INVALID */
+  byte_t *page;			/* host page */
+};
+
 /* memory object */
 struct mem_t {
   /* memory object state */
   char *name;				/* name of this memory space */
   struct mem_pte_t *ptab[MEM_PTAB_SIZE];/* inverted page table */
 
+  /* direct-mapped translation caches of the host pages of recently
+     accessed virtual pages, in front of the page table, only allocated
+     pages are cached, and pages are never unmapped, so the entries stay
+     valid until the page table changes */
+  struct mem_tlb_ent_t tlb[MEM_NUM_TLBS][MEM_TLB_SIZE];
+
+  /* flat memory space state, a flat memory space is backed by host
+     virtual memory reserved when each segment is first accessed, and the
+     host supplies zero-filled pages on demand, the page table is unused */
+  int flat;				/* non-zero for a flat memory space */
+  qword_t seg_tag;			/* last segment accessed */
+  byte_t *seg_base;			/* host region of the last segment */
+  struct mem_seg_t *segs;		/* all the segments */
+  counter_t seg_count;			/* total number of segments reserved */
+
   /* memory object stats */
   counter_t page_count;			/* total number of pages allocated */
   counter_t ptab_misses;		/* total first level page tbl misses */
   counter_t ptab_accesses;		/* total page table accesses */
+  counter_t tlb_misses;			/* total translation cache misses */
 };
 
 /* memory access command */
@@ -115,9 +157,27 @@ typedef enum md_fault_type
   (((PTE)->tag << (MD_LOG_PAGE_SIZE + MEM_LOG_PTAB_SIZE))		\
    | ((IDX) << MD_LOG_PAGE_SIZE))
 
+/* compute flat memory space segment number */
+#define MEM_SEG_TAG(ADDR)						\
+  ((qword_t)(ADDR) >> MEM_LOG_SEG_SIZE)
+
+/* compute page address within a flat memory space segment */
+#define MEM_SEG_PAGE(ADDR)						\
+  ((qword_t)(ADDR) & ((ULL(1) << MEM_LOG_SEG_SIZE) - MD_PAGE_SIZE))
+
+/* locate host page for virtual address ADDR in a flat memory space, never
+   returns NULL, as all pages exist */
+#define MEM_FLAT_PAGE(MEM, ADDR)					\
+  ((MEM_SEG_TAG(ADDR) == (MEM)->seg_tag					\
+    ? (MEM)->seg_base							\
+    : mem_segment((MEM), (ADDR)))					\
+   + MEM_SEG_PAGE(ADDR))
+
 /* locate host page for virtual address ADDR, returns NULL if unallocated */
 #define MEM_PAGE(MEM, ADDR)						\
-  (/* first attempt to hit in first entry, otherwise call xlation fn */	\
+  ((MEM)->flat								\
+   ? MEM_FLAT_PAGE(MEM, ADDR)						\
+   : /* first attempt to hit in first entry, otherwise call xlation fn */\
    ((MEM)->ptab[MEM_PTAB_SET(ADDR)]					\
     && (MEM)->ptab[MEM_PTAB_SET(ADDR)]->tag == MEM_PTAB_TAG(ADDR))	\
    ? (/* hit - return the page address on host */			\
@@ -129,14 +189,34 @@ typedef enum md_fault_type
 /* compute address of access within a host page */
 #define MEM_OFFSET(ADDR)	((ADDR) & (MD_PAGE_SIZE - 1))
 
+/* tag of the translation cache entries that are not valid, never a page
+   address */
+#define MEM_TLB_INVALID		((md_addr_t)1)
+
+/* compute translation cache set and tag */
+#define MEM_TLB_SET(ADDR)						\
+  (((ADDR) >> MD_LOG_PAGE_SIZE) & (MEM_TLB_SIZE - 1))
+#define MEM_TLB_TAG(ADDR)						\
+  ((ADDR) & ~(md_addr_t)(MD_PAGE_SIZE - 1))
+
+/* locate host page for virtual address ADDR through translation cache TLB,
+   returns NULL if unallocated */
+#define MEM_TLB_PAGE(MEM, TLB, ADDR)					\
+  ((MEM)->tlb[TLB][MEM_TLB_SET(ADDR)].tag == MEM_TLB_TAG(ADDR)		\
+   ? /* hit - return the page address on host */			\
+     (MEM)->tlb[TLB][MEM_TLB_SET(ADDR)].page				\
+   : /* miss - look up the page table, and fill the entry */		\
+     mem_tlb_fill((MEM), (TLB), (ADDR)))
+
 /* memory tickle function, allocates pages when they are first written */
 #define MEM_TICKLE(MEM, ADDR)						\
-  (!MEM_PAGE(MEM, ADDR)							\
+  (!MEM_TLB_PAGE(MEM, MEM_TLB_STORE, ADDR)				\
    ? (/* allocate page at address ADDR */				\
       mem_newpage(MEM, ADDR))						\
    : (/* nada... */ (void)0))
 
-/* memory page iterator */
+/* memory page iterator, page table memory spaces only, see
+   mem_forall_pages() for any memory space */
 #define MEM_FORALL(MEM, ITER, PTE)					\
   for ((ITER)=0; (ITER) < MEM_PTAB_SIZE; (ITER)++)			\
     for ((PTE)=(MEM)->ptab[i]; (PTE) != NULL; (PTE)=(PTE)->next)
@@ -146,26 +226,54 @@ typedef enum md_fault_type
  * memory accessors macros, fast but difficult to debug...
  */
 
+/* safe version, works only with scalar types, reads through translation
+   cache TLB */
+#ifdef __GNUC__
+#define MEM_READ_TLB(MEM, TLB, ADDR, TYPE)				\
+  ({ byte_t *__mem_rpage = MEM_TLB_PAGE(MEM, TLB, (md_addr_t)(ADDR));	\
+     __mem_rpage							\
+     ? *((TYPE *)(__mem_rpage + MEM_OFFSET(ADDR)))			\
+     : /* page not yet allocated, return zero value */ (TYPE)0; })
+#else /* !__GNUC__ */
+#define MEM_READ_TLB(MEM, TLB, ADDR, TYPE)				\
+  (MEM_TLB_PAGE(MEM, TLB, (md_addr_t)(ADDR))				\
+   ? *((TYPE *)(MEM_TLB_PAGE(MEM, TLB, (md_addr_t)(ADDR))		\
+		+ MEM_OFFSET(ADDR)))					\
+   : /* page not yet allocated, return zero value */ 0)
+#endif /* __GNUC__ */
+
 /* safe version, works only with scalar types */
-/* FIXME: write a more efficient GNU C expression for this... */
 #define MEM_READ(MEM, ADDR, TYPE)					\
-  (MEM_PAGE(MEM, (md_addr_t)(ADDR))					\
-   ? *((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR)))	\
-   : /* page not yet allocated, return zero value */ 0)
+  MEM_READ_TLB(MEM, MEM_TLB_LOAD, ADDR, TYPE)
 
 /* unsafe version, works with any type */
 #define __UNCHK_MEM_READ(MEM, ADDR, TYPE)				\
-  (*((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR))))
+  (*((TYPE *)(MEM_TLB_PAGE(MEM, MEM_TLB_LOAD, (md_addr_t)(ADDR))	\
+	      + MEM_OFFSET(ADDR))))
 
 /* safe version, works only with scalar types */
-/* FIXME: write a more efficient GNU C expression for this... */
+#ifdef __GNUC__
+#define MEM_WRITE(MEM, ADDR, TYPE, VAL)					\
+  ({ byte_t *__mem_wpage =						\
+       MEM_TLB_PAGE(MEM, MEM_TLB_STORE, (md_addr_t)(ADDR));		\
+     if (!__mem_wpage)							\
+       {								\
+	 /* allocate page at address ADDR */				\
+	 mem_newpage(MEM, (md_addr_t)(ADDR));				\
+	 __mem_wpage = MEM_TLB_PAGE(MEM, MEM_TLB_STORE, (md_addr_t)(ADDR));\
+       }								\
+     *((TYPE *)(__mem_wpage + MEM_OFFSET(ADDR))) = (VAL); })
+#else /* !__GNUC__ */
 #define MEM_WRITE(MEM, ADDR, TYPE, VAL)					\
   (MEM_TICKLE(MEM, (md_addr_t)(ADDR)),					\
-   *((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR))) = (VAL))
+   *((TYPE *)(MEM_TLB_PAGE(MEM, MEM_TLB_STORE, (md_addr_t)(ADDR))	\
+	      + MEM_OFFSET(ADDR))) = (VAL))
+#endif /* __GNUC__ */
       
 /* unsafe version, works with any type */
 #define __UNCHK_MEM_WRITE(MEM, ADDR, TYPE, VAL)				\
-  (*((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR))) = (VAL))
+  (*((TYPE *)(MEM_TLB_PAGE(MEM, MEM_TLB_STORE, (md_addr_t)(ADDR))	\
+	      + MEM_OFFSET(ADDR))) = (VAL))
 
 
 /* fast memory accessor macros, typed versions */
@@ -181,6 +289,10 @@ typedef enum md_fault_type
 #define MEM_READ_SQWORD(MEM, ADDR)	MD_SWAPQ(MEM_READ(MEM, ADDR, sqword_t))
 #endif /* HOST_HAS_QWORD */
 
+/* instruction fetch accessor, see MD_FETCH_INST() */
+#define MEM_FETCH_WORD(MEM, ADDR)					\
+  MD_SWAPW(MEM_READ_TLB(MEM, MEM_TLB_FETCH, ADDR, word_t))
+
 #define MEM_WRITE_BYTE(MEM, ADDR, VAL)	MEM_WRITE(MEM, ADDR, byte_t, VAL)
 #define MEM_WRITE_SBYTE(MEM, ADDR, VAL)	MEM_WRITE(MEM, ADDR, sbyte_t, VAL)
 #define MEM_WRITE_HALF(MEM, ADDR, VAL)					\
@@ -204,7 +316,12 @@ typedef enum md_fault_type
 #endif /* HOST_HAS_QWORD */
 
 
-/* create a flat memory space */
+/* create memory spaces backed by host virtual memory (see mem_create()),
+   instead of the page table */
+extern int mem_flat_spaces;
+
+/* create a memory space, a flat memory space if MEM_FLAT_SPACES is set
+   and the host supports it */
 struct mem_t *
 mem_create(char *name);			/* name of the memory space */
 	   
@@ -213,11 +330,26 @@ byte_t *
 mem_translate(struct mem_t *mem,	/* memory space to access */
 	      md_addr_t addr);		/* virtual address to translate */
 
+/* locate the host region of the segment of flat memory space MEM that
+   holds address ADDR, the region is reserved when first accessed, and
+   becomes the last segment accessed */
+byte_t *
+mem_segment(struct mem_t *mem,		/* flat memory space to access */
+	    md_addr_t addr);		/* virtual address to translate */
+
 /* allocate a memory page */
 void
 mem_newpage(struct mem_t *mem,		/* memory space to allocate in */
 	    md_addr_t addr);		/* virtual address to allocate */
 
+/* translation cache miss handler, locates the host page for address ADDR
+   in memory space MEM, and caches it in translation cache TLB, returns
+   NULL if the page is unallocated */
+byte_t *
+mem_tlb_fill(struct mem_t *mem,		/* memory space to access */
+	     int tlb,			/* translation cache to fill */
+	     md_addr_t addr);		/* virtual address to translate */
+
 /* generic memory access function, it's safe because alignments and permissions
    are checked, handles any natural transfer sizes; note, faults out if nbytes
    is not a power-of-two or larger then MD_PAGE_SIZE */
@@ -237,6 +369,27 @@ mem_reg_stats(struct mem_t *mem,	/* memory space to declare */
 void
 mem_init(struct mem_t *mem);	/* memory space to initialize */
 
+/* memory page visitor, called with the address of a page, and its host
+   copy */
+typedef void
+(*mem_page_fn)(md_addr_t addr,		/* address of the page */
+	       byte_t *page,		/* host copy of the page */
+	       void *data);		/* visitor data */
+
+/* call FN for each page of memory space MEM that may hold non-zero data,
+   i.e., each page allocated in a page table memory space, or each page
+   touched and not all zero in a flat memory space */
+void
+mem_forall_pages(struct mem_t *mem,	/* memory space to visit */
+		 mem_page_fn fn,	/* page visitor */
+		 void *data);		/* visitor data */
+
+/* zero all of memory space MEM, its pages stay allocated, e.g., before a
+   checkpoint restores the pages that may hold non-zero data, which are all
+   that mem_forall_pages() visits */
+void
+mem_clear(struct mem_t *mem);		/* memory space to clear */
+
 /* dump a block of memory, returns any faults encountered */
 enum md_fault_type
 mem_dump(struct mem_t *mem,		/* memory space to display */
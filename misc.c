@@ -223,6 +223,15 @@ myrand(void)			/* returns random number */
 #endif
 }
 
+/* get a random number from the generator state at STATE, which is updated,
+   callers that keep their own state get a reentrant, reproducible sequence */
+int					/* returns random number, 0 to 32767 */
+myrand_r(unsigned int *state)		/* random number generator state */
+{
+  *state = *state * 1103515245 + 12345;
+  return (int)((*state >> 16) & 0x7fff);
+}
+
 /* copy a string to a new storage allocation (NOTE: many machines are missing
    this trivial function, so I funcdup() it here...) */
 char *				/* duplicated string */
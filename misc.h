@@ -182,6 +182,11 @@ mysrand(unsigned int seed);	/* random number generator seed */
 /* get a random number */
 int myrand(void);		/* returns random number */
 
+/* get a random number from the generator state at STATE, which is updated,
+   callers that keep their own state get a reentrant, reproducible sequence */
+int				/* returns random number, 0 to 32767 */
+myrand_r(unsigned int *state);	/* random number generator state */
+
 /* copy a string to a new storage allocation (NOTE: many machines are missing
    this trivial function, so I funcdup() it here...) */
 char *				/* duplicated string */
@@ -65,20 +65,21 @@
 #include "stats.h"
 #include "bpred.h"
 #include "sim.h"
+#include "fastfwd.h"
+#include "trace.h"
 
 /*
- * This file implements a branch predictor analyzer.
+ * This file implements a branch predictor analyzer.  When given a trace file
+ * written by sim-fast (see trace.h) in place of a program, the analyzer
+ * replays the branches of the trace instead of executing the program.
  */
 
-/* simulated registers */
-static struct regs_t regs;
-
-/* simulated memory */
-static struct mem_t *mem = NULL;
-
 /* maximum number of inst's to execute */
 static unsigned int max_insts;
 
+/* number of insts skipped before branch prediction simulation starts */
+static int fastfwd_count;
+
 /* branch predictor type {nottaken|taken|perfect|bimod|2lev} */
 static char *pred_type;
 
@@ -105,14 +106,22 @@ static int btb_nelt = 2;
 static int btb_config[2] =
   { /* nsets */512, /* assoc */4 };
 
-/* branch predictor */
-static struct bpred_t *pred;
+/* the machine state of one branch predictor analyzer instance, which is
+   kept apart from the options (only read once they are checked); the
+   routines below the simulator interface all work on an explicit instance,
+   NOTE: only one instance runs per process, the loader, system call, EIO
+   and DLite state, and sim_num_insn, are still process-wide */
+struct bpred_sim_t {
+  struct regs_t regs;		/* simulated registers */
+  struct mem_t *mem;		/* simulated memory */
+  struct bpred_t *pred;		/* branch predictor */
+  counter_t num_refs;		/* total number of loads and stores */
+  counter_t num_branches;	/* total number of branches executed */
+  struct trace_t *trace;	/* trace replayed, NULL if executing */
+};
 
-/* track number of insn and refs */
-static counter_t sim_num_refs = 0;
-
-/* total number of branches executed */
-static counter_t sim_num_branches = 0;
+/* the instance run through the simulator interface */
+static struct bpred_sim_t sim_bpred;
 
 
 /* register simulator-specific options */
@@ -145,6 +154,11 @@ sim_reg_options(struct opt_odb_t *odb)
 	       &max_insts, /* default */0,
 	       /* print */TRUE, /* format */NULL);
 
+  opt_reg_int(odb, "-fastfwd",
+	      "number of insts skipped before simulation starts",
+	      &fastfwd_count, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
   opt_reg_string(odb, "-bpred",
 		 "branch predictor type {nottaken|taken|bimod|2lev|comb}",
                  &pred_type, /* default */"bimod",
@@ -181,10 +195,12 @@ sim_reg_options(struct opt_odb_t *odb)
 		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
 }
 
-/* check simulator-specific option values */
-void
-sim_check_options(struct opt_odb_t *odb, int argc, char **argv)
+/* create a branch predictor, as configured by the options */
+static struct bpred_t *			/* branch predictor instance */
+pred_create(void)
 {
+  struct bpred_t *pred;
+
   if (!mystricmp(pred_type, "taken"))
     {
       /* static predictor, not taken */
@@ -258,6 +274,18 @@ sim_check_options(struct opt_odb_t *odb, int argc, char **argv)
     }
   else
     fatal("cannot parse predictor type `%s'", pred_type);
+
+  return pred;
+}
+
+/* check simulator-specific option values */
+void
+sim_check_options(struct opt_odb_t *odb, int argc, char **argv)
+{
+  if (fastfwd_count < 0 || fastfwd_count >= 2147483647)
+    fatal("bad fast forward count: %d", fastfwd_count);
+
+  sim_bpred.pred = pred_create();
 }
 
 /* register simulator-specific statistics */
@@ -269,7 +297,7 @@ sim_reg_stats(struct stat_sdb_t *sdb)
 		   &sim_num_insn, sim_num_insn, NULL);
   stat_reg_counter(sdb, "sim_num_refs",
 		   "total number of loads and stores executed",
-		   &sim_num_refs, 0, NULL);
+		   &sim_bpred.num_refs, 0, NULL);
   stat_reg_int(sdb, "sim_elapsed_time",
 	       "total simulation time in seconds",
 	       &sim_elapsed_time, 0, NULL);
@@ -279,28 +307,39 @@ sim_reg_stats(struct stat_sdb_t *sdb)
 
   stat_reg_counter(sdb, "sim_num_branches",
                    "total number of branches executed",
-                   &sim_num_branches, /* initial value */0, /* format */NULL);
+                   &sim_bpred.num_branches, /* initial value */0,
+		   /* format */NULL);
   stat_reg_formula(sdb, "sim_IPB",
                    "instruction per branch",
                    "sim_num_insn / sim_num_branches", /* format */NULL);
 
   /* register predictor stats */
-  if (pred)
-    bpred_reg_stats(pred, sdb);
+  if (sim_bpred.pred)
+    bpred_reg_stats(sim_bpred.pred, sdb);
 }
 
-/* initialize the simulator */
-void
-sim_init(void)
+/* initialize the machine state of instance SIM, its branch predictor must
+   already be created */
+static void
+bpred_sim_init(struct bpred_sim_t *sim)	/* instance to initialize */
 {
-  sim_num_refs = 0;
+  sim->num_refs = 0;
+  sim->num_branches = 0;
+  sim->trace = NULL;
 
   /* allocate and initialize register file */
-  regs_init(&regs);
+  regs_init(&sim->regs);
 
   /* allocate and initialize memory space */
-  mem = mem_create("mem");
-  mem_init(mem);
+  sim->mem = mem_create("mem");
+  mem_init(sim->mem);
+}
+
+/* initialize the simulator */
+void
+sim_init(void)
+{
+  bpred_sim_init(&sim_bpred);
 }
 
 /* local machine state accessor */
@@ -323,8 +362,20 @@ sim_load_prog(char *fname,		/* program to load */
 	      int argc, char **argv,	/* program arguments */
 	      char **envp)		/* program environment */
 {
+  /* replay a trace in place of the program, if given one */
+  if (trace_valid(fname))
+    {
+      if (dlite_active)
+	fatal("trace-driven simulation does not support DLite debugging");
+      sim_bpred.trace = trace_open(fname);
+      return;
+    }
+
   /* load program text and data, set up environment, memory, and regs */
-  ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
+  ld_load_prog(fname, argc, argv, envp, &sim_bpred.regs, sim_bpred.mem, TRUE);
+
+  /* set up the fast functional engine, used to fast forward */
+  fastfwd_init(sim_bpred.mem);
 
   /* initialize the DLite debugger */
   dlite_init(md_reg_obj, dlite_mem_obj, bpred_mstate_obj);
@@ -348,12 +399,92 @@ sim_aux_stats(FILE *stream)		/* output stream */
 void
 sim_uninit(void)
 {
-  /* nada */
+  if (sim_bpred.trace)
+    trace_close(sim_bpred.trace);
+}
+
+/* analyze the branch at PC of instance SIM, with opcode OP, which went to
+   NPC, TARGET_PC is its target */
+static void
+bpred_sim_branch(struct bpred_sim_t *sim,	/* instance */
+		 md_addr_t PC,			/* branch address */
+		 md_addr_t NPC,			/* next inst address */
+		 md_addr_t target_PC,		/* branch target */
+		 enum md_opcode op,		/* branch opcode */
+		 int is_call,			/* function call? */
+		 int is_return)			/* function return? */
+{
+  md_addr_t pred_PC;
+  struct bpred_update_t update_rec;
+  int stack_idx;
+
+  sim->num_branches++;
+
+  if (sim->pred)
+    {
+      /* get the next predicted fetch address */
+      pred_PC = bpred_lookup(sim->pred,
+			     /* branch addr */PC,
+			     /* target */target_PC,
+			     /* inst opcode */op,
+			     /* call? */is_call,
+			     /* return? */is_return,
+			     /* stash an update ptr */&update_rec,
+			     /* stash return stack ptr */&stack_idx);
+
+      /* valid address returned from branch predictor? */
+      if (!pred_PC)
+	{
+	  /* no predicted taken target, attempt not taken target */
+	  pred_PC = PC + sizeof(md_inst_t);
+	}
+
+      bpred_update(sim->pred,
+		   /* branch addr */PC,
+		   /* resolved branch target */NPC,
+		   /* taken? */NPC != (PC + sizeof(md_inst_t)),
+		   /* pred taken? */pred_PC != (PC + sizeof(md_inst_t)),
+		   /* correct pred? */pred_PC == NPC,
+		   /* opcode */op,
+		   /* predictor update pointer */&update_rec);
+    }
+}
+
+/* replay the trace of instance SIM, analyzing its branches, until the end of
+   the trace or MAX_INSTS insts */
+static void
+bpred_sim_replay(struct bpred_sim_t *sim)	/* instance to run */
+{
+  struct trace_ev_t ev;
+
+  fprintf(stderr,
+	  "sim: ** starting trace-driven simulation w/ predictors **\n");
+
+  while (trace_read(sim->trace, &ev))
+    {
+      if (ev.flags & TRACE_REF)
+	continue;
+
+      /* keep an instruction count */
+      sim_num_insn++;
+
+      if (ev.flags & TRACE_MEM)
+	sim->num_refs++;
+
+      if (ev.flags & TRACE_CTRL)
+	bpred_sim_branch(sim, ev.PC, ev.NPC, ev.target_PC, ev.op,
+			 (ev.flags & TRACE_CALL) != 0,
+			 (ev.flags & TRACE_RETURN) != 0);
+
+      /* finish early? */
+      if (max_insts && sim_num_insn >= max_insts)
+	return;
+    }
 }
 
 
 /*
- * configure the execution engine
+ * configure the execution engine, on the machine state of instance SIM
  */
 
 /*
@@ -361,50 +492,50 @@ sim_uninit(void)
  */
 
 /* next program counter */
-#define SET_NPC(EXPR)		(regs.regs_NPC = (EXPR))
+#define SET_NPC(EXPR)		(sim->regs.regs_NPC = (EXPR))
 
 /* target program counter */
 #undef  SET_TPC
 #define SET_TPC(EXPR)		(target_PC = (EXPR))
 
 /* current program counter */
-#define CPC			(regs.regs_PC)
+#define CPC			(sim->regs.regs_PC)
 
 /* general purpose registers */
-#define GPR(N)			(regs.regs_R[N])
-#define SET_GPR(N,EXPR)		(regs.regs_R[N] = (EXPR))
+#define GPR(N)			(sim->regs.regs_R[N])
+#define SET_GPR(N,EXPR)		(sim->regs.regs_R[N] = (EXPR))
 
 #if defined(TARGET_PISA)
 
 /* floating point registers, L->word, F->single-prec, D->double-prec */
-#define FPR_L(N)		(regs.regs_F.l[(N)])
-#define SET_FPR_L(N,EXPR)	(regs.regs_F.l[(N)] = (EXPR))
-#define FPR_F(N)		(regs.regs_F.f[(N)])
-#define SET_FPR_F(N,EXPR)	(regs.regs_F.f[(N)] = (EXPR))
-#define FPR_D(N)		(regs.regs_F.d[(N) >> 1])
-#define SET_FPR_D(N,EXPR)	(regs.regs_F.d[(N) >> 1] = (EXPR))
+#define FPR_L(N)		(sim->regs.regs_F.l[(N)])
+#define SET_FPR_L(N,EXPR)	(sim->regs.regs_F.l[(N)] = (EXPR))
+#define FPR_F(N)		(sim->regs.regs_F.f[(N)])
+#define SET_FPR_F(N,EXPR)	(sim->regs.regs_F.f[(N)] = (EXPR))
+#define FPR_D(N)		(sim->regs.regs_F.d[(N) >> 1])
+#define SET_FPR_D(N,EXPR)	(sim->regs.regs_F.d[(N) >> 1] = (EXPR))
 
 /* miscellaneous register accessors */
-#define SET_HI(EXPR)		(regs.regs_C.hi = (EXPR))
-#define HI			(regs.regs_C.hi)
-#define SET_LO(EXPR)		(regs.regs_C.lo = (EXPR))
-#define LO			(regs.regs_C.lo)
-#define FCC			(regs.regs_C.fcc)
-#define SET_FCC(EXPR)		(regs.regs_C.fcc = (EXPR))
+#define SET_HI(EXPR)		(sim->regs.regs_C.hi = (EXPR))
+#define HI			(sim->regs.regs_C.hi)
+#define SET_LO(EXPR)		(sim->regs.regs_C.lo = (EXPR))
+#define LO			(sim->regs.regs_C.lo)
+#define FCC			(sim->regs.regs_C.fcc)
+#define SET_FCC(EXPR)		(sim->regs.regs_C.fcc = (EXPR))
 
 #elif defined(TARGET_ALPHA)
 
 /* floating point registers, L->word, F->single-prec, D->double-prec */
-#define FPR_Q(N)		(regs.regs_F.q[N])
-#define SET_FPR_Q(N,EXPR)	(regs.regs_F.q[N] = (EXPR))
-#define FPR(N)			(regs.regs_F.d[N])
-#define SET_FPR(N,EXPR)		(regs.regs_F.d[N] = (EXPR))
+#define FPR_Q(N)		(sim->regs.regs_F.q[N])
+#define SET_FPR_Q(N,EXPR)	(sim->regs.regs_F.q[N] = (EXPR))
+#define FPR(N)			(sim->regs.regs_F.d[N])
+#define SET_FPR(N,EXPR)		(sim->regs.regs_F.d[N] = (EXPR))
 
 /* miscellaneous register accessors */
-#define FPCR			(regs.regs_C.fpcr)
-#define SET_FPCR(EXPR)		(regs.regs_C.fpcr = (EXPR))
-#define UNIQ			(regs.regs_C.uniq)
-#define SET_UNIQ(EXPR)		(regs.regs_C.uniq = (EXPR))
+#define FPCR			(sim->regs.regs_C.fpcr)
+#define SET_FPCR(EXPR)		(sim->regs.regs_C.fpcr = (EXPR))
+#define UNIQ			(sim->regs.regs_C.uniq)
+#define SET_UNIQ(EXPR)		(sim->regs.regs_C.uniq = (EXPR))
 
 #else
 #error No ISA target defined...
@@ -412,61 +543,63 @@ sim_uninit(void)
 
 /* precise architected memory state help functions */
 #define READ_BYTE(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_BYTE(mem, addr))
+  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_BYTE(sim->mem, addr))
 #define READ_HALF(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_HALF(mem, addr))
+  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_HALF(sim->mem, addr))
 #define READ_WORD(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_WORD(mem, addr))
+  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_WORD(sim->mem, addr))
 #ifdef HOST_HAS_QWORD
 #define READ_QWORD(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_QWORD(mem, addr))
+  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_QWORD(sim->mem, addr))
 #endif /* HOST_HAS_QWORD */
 
 #define WRITE_BYTE(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_BYTE(mem, addr, (SRC)))
+  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_BYTE(sim->mem, addr, (SRC)))
 #define WRITE_HALF(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_HALF(mem, addr, (SRC)))
+  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_HALF(sim->mem, addr, (SRC)))
 #define WRITE_WORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_WORD(mem, addr, (SRC)))
+  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_WORD(sim->mem, addr, (SRC)))
 #ifdef HOST_HAS_QWORD
 #define WRITE_QWORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_QWORD(mem, addr, (SRC)))
+  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_QWORD(sim->mem, addr, (SRC)))
 #endif /* HOST_HAS_QWORD */
 
 /* system call handler macro */
-#define SYSCALL(INST)	sys_syscall(&regs, mem_access, mem, INST, TRUE)
+#define SYSCALL(INST)							\
+  sys_syscall(&sim->regs, mem_access, sim->mem, INST, TRUE)
 
-/* start simulation, program loaded, processor precise state initialized */
-void
-sim_main(void)
+/* run instance SIM from its current PC until the program exits or MAX_INSTS
+   insts have executed, analyzing its branches */
+static void
+bpred_sim_run(struct bpred_sim_t *sim)	/* instance to run */
 {
   md_inst_t inst;
   register md_addr_t addr, target_PC = 0;
   enum md_opcode op;
   register int is_write;
-  int stack_idx;
   enum md_fault_type fault;
 
   fprintf(stderr, "sim: ** starting functional simulation w/ predictors **\n");
 
   /* set up initial default next PC */
-  regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
+  sim->regs.regs_NPC = sim->regs.regs_PC + sizeof(md_inst_t);
 
   /* check for DLite debugger entry condition */
-  if (dlite_check_break(regs.regs_PC, /* no access */0, /* addr */0, 0, 0))
-    dlite_main(regs.regs_PC - sizeof(md_inst_t), regs.regs_PC,
-	       sim_num_insn, &regs, mem);
+  if (dlite_check_break(sim->regs.regs_PC,
+			/* no access */0, /* addr */0, 0, 0))
+    dlite_main(sim->regs.regs_PC - sizeof(md_inst_t), sim->regs.regs_PC,
+	       sim_num_insn, &sim->regs, sim->mem);
 
   while (TRUE)
     {
       /* maintain $r0 semantics */
-      regs.regs_R[MD_REG_ZERO] = 0;
+      sim->regs.regs_R[MD_REG_ZERO] = 0;
 #ifdef TARGET_ALPHA
-      regs.regs_F.d[MD_REG_ZERO] = 0.0;
+      sim->regs.regs_F.d[MD_REG_ZERO] = 0.0;
 #endif /* TARGET_ALPHA */
 
       /* get the next instruction to execute */
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
+      MD_FETCH_INST(inst, sim->mem, sim->regs.regs_PC);
 
       /* keep an instruction count */
       sim_num_insn++;
@@ -499,66 +632,66 @@ sim_main(void)
       }
 
       if (fault != md_fault_none)
-	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
+	fatal("fault (%d) detected @ 0x%08p", fault, sim->regs.regs_PC);
 
       if (MD_OP_FLAGS(op) & F_MEM)
 	{
-	  sim_num_refs++;
+	  sim->num_refs++;
 	  if (MD_OP_FLAGS(op) & F_STORE)
 	    is_write = TRUE;
 	}
 
       if (MD_OP_FLAGS(op) & F_CTRL)
-	{
-	  md_addr_t pred_PC;
-	  struct bpred_update_t update_rec;
-
-	  sim_num_branches++;
-
-	  if (pred)
-	    {
-	      /* get the next predicted fetch address */
-	      pred_PC = bpred_lookup(pred,
-				     /* branch addr */regs.regs_PC,
-				     /* target */target_PC,
-				     /* inst opcode */op,
-				     /* call? */MD_IS_CALL(op),
-				     /* return? */MD_IS_RETURN(op),
-				     /* stash an update ptr */&update_rec,
-				     /* stash return stack ptr */&stack_idx);
-
-	      /* valid address returned from branch predictor? */
-	      if (!pred_PC)
-		{
-		  /* no predicted taken target, attempt not taken target */
-		  pred_PC = regs.regs_PC + sizeof(md_inst_t);
-		}
-
-	      bpred_update(pred,
-			   /* branch addr */regs.regs_PC,
-			   /* resolved branch target */regs.regs_NPC,
-			   /* taken? */regs.regs_NPC != (regs.regs_PC +
-							 sizeof(md_inst_t)),
-			   /* pred taken? */pred_PC != (regs.regs_PC +
-							sizeof(md_inst_t)),
-			   /* correct pred? */pred_PC == regs.regs_NPC,
-			   /* opcode */op,
-			   /* predictor update pointer */&update_rec);
-	    }
-	}
+	bpred_sim_branch(sim, sim->regs.regs_PC, sim->regs.regs_NPC,
+			 target_PC, op, MD_IS_CALL(op), MD_IS_RETURN(op));
 
       /* check for DLite debugger entry condition */
-      if (dlite_check_break(regs.regs_NPC,
+      if (dlite_check_break(sim->regs.regs_NPC,
 			    is_write ? ACCESS_WRITE : ACCESS_READ,
 			    addr, sim_num_insn, sim_num_insn))
-	dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
+	dlite_main(sim->regs.regs_PC, sim->regs.regs_NPC, sim_num_insn,
+		   &sim->regs, sim->mem);
 
       /* go to the next instruction */
-      regs.regs_PC = regs.regs_NPC;
-      regs.regs_NPC += sizeof(md_inst_t);
+      sim->regs.regs_PC = sim->regs.regs_NPC;
+      sim->regs.regs_NPC += sizeof(md_inst_t);
 
       /* finish early? */
       if (max_insts && sim_num_insn >= max_insts)
 	return;
     }
 }
+
+/* start simulation, program loaded, processor precise state initialized */
+void
+sim_main(void)
+{
+  if (sim_bpred.trace)
+    {
+      /* fast forwarding skips over the first FASTFWD_COUNT insts */
+      if (fastfwd_count > 0)
+	{
+	  fprintf(stderr, "sim: ** fast forwarding %d insts **\n",
+		  fastfwd_count);
+	  trace_seek(sim_bpred.trace, (counter_t)fastfwd_count);
+	}
+      bpred_sim_replay(&sim_bpred);
+      return;
+    }
+
+  /* fast forward simulator loop, skips FASTFWD_COUNT insts with the fast
+     functional engine of sim-fast, then turns on predictor simulation */
+  if (fastfwd_count > 0)
+    {
+      counter_t icount = 0;
+
+      if (!fastfwd_usable())
+	fatal("fast forwarding cannot swap bytes or words");
+
+      fprintf(stderr, "sim: ** fast forwarding %d insts **\n", fastfwd_count);
+      fastfwd_exec(&sim_bpred.regs, sim_bpred.mem,
+		   &icount, (counter_t)fastfwd_count);
+    }
+
+  bpred_sim_run(&sim_bpred);
+}
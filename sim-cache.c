@@ -65,13 +65,18 @@
 #include "syscall.h"
 #include "dlite.h"
 #include "sim.h"
+#include "fastfwd.h"
+#include "trace.h"
 
 /*
  * This file implements a functional cache simulator.  Cache statistics are
  * generated for a user-selected cache and TLB configuration, which may include
  * up to two levels of instruction and data cache (with any levels unified),
  * and one level of instruction and data TLBs.  No timing information is
- * generated (hence the distinction, "functional" simulator).
+ * generated (hence the distinction, "functional" simulator).  When given a
+ * trace file written by sim-fast (see trace.h) in place of a program, the
+ * simulator replays the instructions and memory references of the trace
+ * instead of executing the program.
  */
 
 /* simulated registers */
@@ -86,6 +91,12 @@ static counter_t sim_num_refs = 0;
 /* maximum number of inst's to execute */
 static unsigned int max_insts;
 
+/* number of insts skipped before cache simulation starts */
+static int fastfwd_count;
+
+/* trace being replayed, NULL if the program is executed */
+static struct trace_t *trace = NULL;
+
 /* level 1 instruction cache, entry level instruction cache */
 static struct cache_t *cache_il1 = NULL;
 
@@ -268,6 +279,11 @@ sim_reg_options(struct opt_odb_t *odb)	/* options database */
 	       &max_insts, /* default */0,
 	       /* print */TRUE, /* format */NULL);
 
+  opt_reg_int(odb, "-fastfwd",
+	      "number of insts skipped before simulation starts",
+	      &fastfwd_count, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
   opt_reg_string(odb, "-cache:dl1",
 		 "l1 data cache config, i.e., {<config>|none}",
 		 &cache_dl1_opt, "dl1:256:32:1:l", /* print */TRUE, NULL);
@@ -280,7 +296,9 @@ sim_reg_options(struct opt_odb_t *odb)	/* options database */
 "    <nsets>  - number of sets in the cache\n"
 "    <bsize>  - block size of the cache\n"
 "    <assoc>  - associativity of the cache\n"
-"    <repl>   - block replacement strategy, 'l'-LRU, 'f'-FIFO, 'r'-random\n"
+"    <repl>   - block replacement strategy, 'l'-LRU, 'f'-FIFO, 'r'-random,\n"
+"               'p'-tree PLRU, 's'-SRRIP, 'b'-BRRIP, 'd'-DRRIP (set dueling),\n"
+"               'h'-SHiP (SRRIP with signature-based hit prediction)\n"
 "\n"
 "    Examples:   -cache:dl1 dl1:4096:32:1:l\n"
 "                -dtlb dtlb:128:4096:32:r\n"
@@ -335,6 +353,9 @@ sim_check_options(struct opt_odb_t *odb,	/* options database */
   char name[128], c;
   int nsets, bsize, assoc;
 
+  if (fastfwd_count < 0 || fastfwd_count >= 2147483647)
+    fatal("bad fast forward count: %d", fastfwd_count);
+
   /* use a level 1 D-cache? */
   if (!mystricmp(cache_dl1_opt, "none"))
     {
@@ -494,9 +515,21 @@ sim_load_prog(char *fname,		/* program to load */
 	      int argc, char **argv,	/* program arguments */
 	      char **envp)		/* program environment */
 {
+  /* replay a trace in place of the program, if given one */
+  if (trace_valid(fname))
+    {
+      if (dlite_active)
+	fatal("trace-driven simulation does not support DLite debugging");
+      trace = trace_open(fname);
+      return;
+    }
+
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  /* set up the fast functional engine, used to fast forward */
+  fastfwd_init(mem);
+
   /* initialize the DLite debugger */
   dlite_init(md_reg_obj, dlite_mem_obj, cache_mstate_obj);
 }
@@ -589,7 +622,106 @@ sim_aux_stats(FILE *stream)		/* output stream */
 void
 sim_uninit(void)
 {
-  /* nada */
+  if (trace)
+    trace_close(trace);
+}
+
+/* update any stats tracked by PC, after the inst at PC */
+static void
+pcstat_update(md_addr_t PC)		/* inst address */
+{
+  int i;
+  counter_t newval;
+  int delta;
+
+  for (i=0; i < pcstat_nelt; i++)
+    {
+      /* check if any tracked stats changed */
+      newval = STATVAL(pcstat_stats[i]);
+      delta = newval - pcstat_lastvals[i];
+      if (delta != 0)
+	{
+	  stat_add_samples(pcstat_sdists[i], PC, delta);
+	  pcstat_lastvals[i] = newval;
+	}
+    }
+}
+
+/* replay the trace, the instructions and memory references of the trace
+   are simulated in place of executing the program, until the end of the
+   trace or MAX_INSTS insts */
+static void
+sim_replay(void)
+{
+  struct trace_ev_t ev;
+  md_addr_t PC = 0;
+  enum mem_cmd cmd;
+
+  /* fast forwarding skips over the first FASTFWD_COUNT insts of the trace */
+  if (fastfwd_count > 0)
+    {
+      fprintf(stderr, "sim: ** fast forwarding %d insts **\n", fastfwd_count);
+      trace_seek(trace, (counter_t)fastfwd_count);
+    }
+
+  fprintf(stderr, "sim: ** starting trace-driven simulation w/ caches **\n");
+
+  while (trace_read(trace, &ev))
+    {
+      if (ev.flags & TRACE_REF)
+	{
+	  /* system calls access memory directly when the caches are flushed
+	     on system calls */
+	  if ((ev.flags & TRACE_SYS) && flush_on_syscalls)
+	    continue;
+
+	  cmd = (ev.flags & TRACE_WRITE) ? Write : Read;
+	  if (dtlb)
+	    cache_access(dtlb, cmd, ev.addr, NULL, ev.nbytes, 0, NULL, NULL);
+	  if (cache_dl1)
+	    cache_access(cache_dl1, cmd, ev.addr, NULL, ev.nbytes, 0,
+			 NULL, NULL);
+	  continue;
+	}
+
+      /* the previous inst is complete, with all its references */
+      if (sim_num_insn)
+	{
+	  pcstat_update(PC);
+
+	  /* finish early? */
+	  if (max_insts && sim_num_insn >= max_insts)
+	    return;
+	}
+
+      /* fetch the next instruction */
+      PC = ev.PC;
+      if (itlb)
+	cache_access(itlb, Read, IACOMPRESS(PC),
+		     NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL);
+      if (cache_il1)
+	cache_access(cache_il1, Read, IACOMPRESS(PC),
+		     NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL);
+
+      /* keep an instruction count */
+      sim_num_insn++;
+
+      if (ev.flags & TRACE_MEM)
+	sim_num_refs++;
+
+      if ((ev.flags & TRACE_TRAP) && flush_on_syscalls)
+	{
+	  if (dtlb)
+	    cache_flush(dtlb, 0);
+	  if (cache_dl1)
+	    cache_flush(cache_dl1, 0);
+	  if (cache_dl2)
+	    cache_flush(cache_dl2, 0);
+	}
+    }
+
+  if (sim_num_insn)
+    pcstat_update(PC);
 }
 
 /*
@@ -725,13 +857,31 @@ dcache_access_fn(struct mem_t *mem,	/* memory space to access */
 void
 sim_main(void)
 {
-  int i;
   md_inst_t inst;
   register md_addr_t addr;
   enum md_opcode op;
   register int is_write;
   enum md_fault_type fault;
 
+  if (trace)
+    {
+      sim_replay();
+      return;
+    }
+
+  /* fast forward simulator loop, skips FASTFWD_COUNT insts with the fast
+     functional engine of sim-fast, then turns on cache simulation */
+  if (fastfwd_count > 0)
+    {
+      counter_t icount = 0;
+
+      if (!fastfwd_usable())
+	fatal("fast forwarding cannot swap bytes or words");
+
+      fprintf(stderr, "sim: ** fast forwarding %d insts **\n", fastfwd_count);
+      fastfwd_exec(&regs, mem, &icount, (counter_t)fastfwd_count);
+    }
+
   fprintf(stderr, "sim: ** starting functional simulation w/ caches **\n");
 
   /* set up initial default next PC */
@@ -800,21 +950,7 @@ sim_main(void)
 	}
 
       /* update any stats tracked by PC */
-      for (i=0; i < pcstat_nelt; i++)
-	{
-	  counter_t newval;
-	  int delta;
-
-	  /* check if any tracked stats changed */
-	  newval = STATVAL(pcstat_stats[i]);
-	  delta = newval - pcstat_lastvals[i];
-	  if (delta != 0)
-	    {
-	      stat_add_samples(pcstat_sdists[i], regs.regs_PC, delta);
-	      pcstat_lastvals[i] = newval;
-	    }
-
-	}
+      pcstat_update(regs.regs_PC);
 
       /* check for DLite debugger entry condition */
       if (dlite_check_break(regs.regs_NPC,
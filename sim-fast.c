@@ -61,21 +61,18 @@
  * manifest as simulator execution errors, possibly causing sim-fast to
  * execute incorrectly or dump core.  Such is the price we pay for speed!!!!
  *
- * The following options configure the bag of tricks used to make sim-fast
- * live up to its name.  For most machines, defining all the options results
- * in the fastest functional simulator.
+ * The execution engine lives in fastfwd.c, where the other simulators use it
+ * to fast forward, see there for the bag of tricks used to make sim-fast
+ * live up to its name.
+ *
+ * With the -trace option, sim-fast instead runs a simpler loop, which writes
+ * a trace of the instructions executed and of their memory references (see
+ * trace.h), for replay by the trace-driven simulators.
  */
 
 /* don't count instructions flag, enabled by default, disable for inst count */
 #undef NO_INSN_COUNT
 
-#ifdef __GNUC__
-/* faster dispatch mechanism, requires GNU GCC C extensions, CAVEAT: some
-   versions of GNU GCC core dump when optimizing the jump table code with
-   optimization levels higher than -O1 */
-/* #define USE_JUMP_TABLE */
-#endif /* __GNUC__ */
-
 #include "host.h"
 #include "misc.h"
 #include "machine.h"
@@ -85,6 +82,8 @@
 #include "syscall.h"
 #include "dlite.h"
 #include "sim.h"
+#include "fastfwd.h"
+#include "trace.h"
 
 /* simulated registers */
 static struct regs_t regs;
@@ -92,10 +91,14 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
-#ifdef TARGET_ALPHA
-/* predecoded text memory */
-static struct mem_t *dec = NULL;
-#endif
+/* maximum number of inst's to execute */
+static unsigned int max_insts;
+
+/* trace file name, NULL for no trace */
+static char *trace_fname;
+
+/* trace being written */
+static struct trace_t *trace = NULL;
 
 /* register simulator-specific options */
 void
@@ -110,6 +113,15 @@ sim_reg_options(struct opt_odb_t *odb)
 "causing sim-fast to execute incorrectly or dump core.  Such is the\n"
 "price we pay for speed!!!!\n"
 		 );
+
+  opt_reg_uint(odb, "-max:inst", "maximum number of inst's to execute",
+	       &max_insts, /* default */0,
+	       /* print */TRUE, /* format */NULL);
+
+  opt_reg_string(odb, "-trace",
+		 "write an instruction and memory reference trace to this file",
+		 &trace_fname, /* default */NULL,
+		 /* print */TRUE, /* format */NULL);
 }
 
 /* check simulator-specific option values */
@@ -139,9 +151,7 @@ sim_reg_stats(struct stat_sdb_t *sdb)
 #endif /* !NO_INSN_COUNT */
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
-#ifdef TARGET_ALPHA
-  mem_reg_stats(dec, sdb);
-#endif
+  fastfwd_reg_stats(sdb);
 }
 
 /* initialize the simulator */
@@ -165,38 +175,8 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
-#ifdef TARGET_ALPHA
-  /* pre-decode text segment */
-  {
-    unsigned i, num_insn = (ld_text_size + 3) / 4;
-
-    fprintf(stderr, "** pre-decoding %u insts...", num_insn);
-
-    /* allocate decoded text space */
-    dec = mem_create("dec");
-
-    for (i=0; i < num_insn; i++)
-      {
-	enum md_opcode op;
-	md_inst_t inst;
-	md_addr_t PC;
-
-	/* compute PC */
-	PC = ld_text_base + i * sizeof(md_inst_t);
-
-	/* get instruction from memory */
-	MD_FETCH_INST(inst, mem, PC);
-
-	/* decode the instruction */
-	MD_SET_OPCODE(op, inst);
-
-	/* insert into decoded opcode space */
-	MEM_WRITE_WORD(dec, PC << 1, (word_t)op);
-	MEM_WRITE_WORD(dec, (PC << 1)+sizeof(word_t), inst);
-      }
-    fprintf(stderr, "done\n");
-  }
-#endif /* TARGET_ALPHA */
+  /* set up the execution engine, e.g., pre-decode the text segment */
+  fastfwd_init(mem);
 }
 
 /* print simulator-specific configuration information */
@@ -217,16 +197,23 @@ sim_aux_stats(FILE *stream)
 void
 sim_uninit(void)
 {
-  /* nada */
+  /* the program may exit in the middle of the trace loop */
+  if (trace)
+    trace_close(trace);
 }
 
+
 /*
- * configure the execution engine
+ * configure the execution engine of the trace loop
  */
 
 /* next program counter */
 #define SET_NPC(EXPR)		(regs.regs_NPC = (EXPR))
 
+/* target program counter */
+#undef  SET_TPC
+#define SET_TPC(EXPR)		(target_PC = (EXPR))
+
 /* current program counter */
 #define CPC			(regs.regs_PC)
 
@@ -270,132 +257,75 @@ sim_uninit(void)
 #error No ISA target defined...
 #endif
 
-/* precise architected memory state accessor macros */
+/* precise architected memory state accessor macros, each access is
+   written to the trace */
 #define READ_BYTE(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, MEM_READ_BYTE(mem, (SRC)))
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   trace_ref(trace, 0, addr, sizeof(byte_t)), MEM_READ_BYTE(mem, addr))
 #define READ_HALF(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, MEM_READ_HALF(mem, (SRC)))
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   trace_ref(trace, 0, addr, sizeof(half_t)), MEM_READ_HALF(mem, addr))
 #define READ_WORD(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, MEM_READ_WORD(mem, (SRC)))
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   trace_ref(trace, 0, addr, sizeof(word_t)), MEM_READ_WORD(mem, addr))
 #ifdef HOST_HAS_QWORD
 #define READ_QWORD(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, MEM_READ_QWORD(mem, (SRC)))
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   trace_ref(trace, 0, addr, sizeof(qword_t)), MEM_READ_QWORD(mem, addr))
 #endif /* HOST_HAS_QWORD */
 
 #define WRITE_BYTE(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, MEM_WRITE_BYTE(mem, (DST), (SRC)))
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   trace_ref(trace, TRACE_WRITE, addr, sizeof(byte_t)),			\
+   MEM_WRITE_BYTE(mem, addr, (SRC)))
 #define WRITE_HALF(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, MEM_WRITE_HALF(mem, (DST), (SRC)))
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   trace_ref(trace, TRACE_WRITE, addr, sizeof(half_t)),			\
+   MEM_WRITE_HALF(mem, addr, (SRC)))
 #define WRITE_WORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, MEM_WRITE_WORD(mem, (DST), (SRC)))
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   trace_ref(trace, TRACE_WRITE, addr, sizeof(word_t)),			\
+   MEM_WRITE_WORD(mem, addr, (SRC)))
 #ifdef HOST_HAS_QWORD
 #define WRITE_QWORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, MEM_WRITE_QWORD(mem, (DST), (SRC)))
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   trace_ref(trace, TRACE_WRITE, addr, sizeof(qword_t)),		\
+   MEM_WRITE_QWORD(mem, addr, (SRC)))
 #endif /* HOST_HAS_QWORD */
 
-/* system call handler macro */
-#define SYSCALL(INST)	sys_syscall(&regs, mem_access, mem, INST, TRUE)
-
-#ifndef NO_INSN_COUNT
-#define INC_INSN_CTR()	sim_num_insn++
-#else /* !NO_INSN_COUNT */
-#define INC_INSN_CTR()	/* nada */
-#endif /* NO_INSN_COUNT */
-
-#ifdef TARGET_ALPHA
-#define ZERO_FP_REG()	regs.regs_F.d[MD_REG_ZERO] = 0.0
-#else
-#define ZERO_FP_REG()	/* nada... */
-#endif
-
-/* start simulation, program loaded, processor precise state initialized */
-void
-sim_main(void)
+/* system call memory access function, the accesses are written to the
+   trace as system call references */
+static enum md_fault_type
+trace_access_fn(struct mem_t *mem,	/* memory space to access */
+		enum mem_cmd cmd,	/* memory access cmd, Read or Write */
+		md_addr_t addr,		/* data address to access */
+		void *p,		/* data input/output buffer */
+		int nbytes)		/* number of bytes to access */
 {
-#ifdef USE_JUMP_TABLE
-  /* the jump table employs GNU GCC label extensions to construct an array
-     of pointers to instruction implementation code, the simulator then uses
-     the table to lookup the location of instruction's implementing code, a
-     GNU GCC `goto' extension is then used to jump to the inst's implementing
-     code through the op_jump table; as a result, there is no need for
-     a main simulator loop, which eliminates one branch from the simulator
-     interpreter - crazy, no!?!? */
-
-  /* instruction jump table, this code is GNU GCC specific */
-  static void *op_jump[/* max opcodes */] = {
-    &&opcode_NA, /* NA */
-#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
-    &&opcode_##OP,
-#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-    &&opcode_##OP,
-#define CONNECT(OP)
-#include "machine.def"
-  };
-#endif /* USE_JUMP_TABLE */
-
-  /* register allocate instruction buffer */
-  register md_inst_t inst;
-
-  /* decoded opcode */
-  register enum md_opcode op;
-
-  fprintf(stderr, "sim: ** starting *fast* functional simulation **\n");
-
-  /* must have natural byte/word ordering */
-  if (sim_swap_bytes || sim_swap_words)
-    fatal("sim: *fast* functional simulation cannot swap bytes or words");
-
-#ifdef USE_JUMP_TABLE
-
-  regs.regs_NPC = regs.regs_PC;
-
-  /* load instruction */
-  MD_FETCH_INST(inst, mem, regs.regs_NPC);
-
-  /* jump to instruction implementation */
-  MD_SET_OPCODE(op, inst);
-  goto *op_jump[op];
-
-#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
-  opcode_##OP:								\
-    /* maintain $r0 semantics */					\
-    regs.regs_R[MD_REG_ZERO] = 0;					\
-    ZERO_FP_REG();							\
-									\
-    /* keep an instruction count */					\
-    INC_INSN_CTR();							\
-									\
-    /* locate next instruction */					\
-    regs.regs_PC = regs.regs_NPC;					\
-									\
-    /* set up default next PC */					\
-    regs.regs_NPC += sizeof(md_inst_t);					\
-									\
-    /* execute the instruction */					\
-    SYMCAT(OP,_IMPL);							\
-									\
-    /* get the next instruction */					\
-    MD_FETCH_INST(inst, mem, regs.regs_NPC);				\
-									\
-    /* jump to instruction implementation */				\
-    MD_SET_OPCODE(op, inst);						\
-    goto *op_jump[op];
-
-#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-  opcode_##OP:								\
-    panic("attempted to execute a linking opcode");
-#define CONNECT(OP)
-#define DECLARE_FAULT(FAULT)						\
-	  { /* uncaught... */break; }
-#include "machine.def"
+  trace_ref(trace, TRACE_SYS | (cmd == Write ? TRACE_WRITE : 0),
+	    addr, nbytes);
+  return mem_access(mem, cmd, addr, p, nbytes);
+}
 
-  opcode_NA:
-    panic("attempted to execute a bogus opcode");
+/* system call handler macro */
+#define SYSCALL(INST)							\
+  sys_syscall(&regs, trace_access_fn, mem, INST, TRUE)
+
+/* execute the program, writing each instruction executed and its memory
+   references to the trace, until the program exits or MAX_INSTS insts
+   have executed */
+static void
+sim_trace(void)
+{
+  md_inst_t inst;
+  register md_addr_t addr, target_PC = 0;
+  enum md_opcode op;
+  enum md_fault_type fault;
+  int flags;
 
-  /* should not get here... */
-  panic("exited sim-fast main loop");
+  fprintf(stderr, "sim: ** starting functional simulation w/ tracing **\n");
 
-#else /* !USE_JUMP_TABLE */
+  trace = trace_create(trace_fname);
 
   /* set up initial default next PC */
   regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
@@ -408,46 +338,104 @@ sim_main(void)
       regs.regs_F.d[MD_REG_ZERO] = 0.0;
 #endif /* TARGET_ALPHA */
 
+      /* get the next instruction to execute */
+      MD_FETCH_INST(inst, mem, regs.regs_PC);
+
       /* keep an instruction count */
-#ifndef NO_INSN_COUNT
       sim_num_insn++;
-#endif /* !NO_INSN_COUNT */
 
-#ifdef TARGET_ALPHA
-      /* load predecoded instruction */
-      op = (enum md_opcode)__UNCHK_MEM_READ(dec, regs.regs_PC << 1, word_t);
-      inst =
-	__UNCHK_MEM_READ(dec, (regs.regs_PC << 1)+sizeof(word_t), md_inst_t);
-#else /* !TARGET_ALPHA */
-      /* load instruction */
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
+      /* set default reference address */
+      addr = 0;
+
+      /* set default fault - none */
+      fault = md_fault_none;
 
       /* decode the instruction */
       MD_SET_OPCODE(op, inst);
-#endif
+
+      /* the instruction goes to the trace ahead of its memory references,
+	 the program may exit in a system call */
+      flags = 0;
+      if (MD_OP_FLAGS(op) & F_CTRL)
+	{
+	  flags |= TRACE_CTRL;
+	  if (MD_IS_CALL(op))
+	    flags |= TRACE_CALL;
+	  if (MD_IS_RETURN(op))
+	    flags |= TRACE_RETURN;
+	}
+      if (MD_OP_FLAGS(op) & F_TRAP)
+	flags |= TRACE_TRAP;
+      if (MD_OP_FLAGS(op) & F_MEM)
+	{
+	  flags |= TRACE_MEM;
+	  if (MD_OP_FLAGS(op) & F_STORE)
+	    flags |= TRACE_STORE;
+	}
+      trace_inst(trace, flags, regs.regs_PC, op);
 
       /* execute the instruction */
       switch (op)
 	{
 #define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
 	case OP:							\
-	  SYMCAT(OP,_IMPL);						\
-	  break;
+          SYMCAT(OP,_IMPL);						\
+          break;
 #define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-	case OP:							\
-	  panic("attempted to execute a linking opcode");
+        case OP:							\
+          panic("attempted to execute a linking opcode");
 #define CONNECT(OP)
 #define DECLARE_FAULT(FAULT)						\
-	  { /* uncaught... */break; }
+	  { fault = (FAULT); break; }
 #include "machine.def"
 	default:
 	  panic("attempted to execute a bogus opcode");
-	}
+      }
+
+      if (fault != md_fault_none)
+	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
 
-      /* execute next instruction */
+      if (flags & TRACE_CTRL)
+	trace_ctrl(trace, regs.regs_NPC, target_PC);
+
+      /* go to the next instruction */
       regs.regs_PC = regs.regs_NPC;
       regs.regs_NPC += sizeof(md_inst_t);
+
+      /* finish early? */
+      if (max_insts && sim_num_insn >= max_insts)
+	return;
+    }
+}
+
+/* start simulation, program loaded, processor precise state initialized */
+void
+sim_main(void)
+{
+#ifdef NO_INSN_COUNT
+  counter_t icount = 0;
+#endif /* NO_INSN_COUNT */
+
+  if (trace_fname)
+    {
+      sim_trace();
+      return;
     }
 
-#endif /* USE_JUMP_TABLE */
+  fprintf(stderr, "sim: ** starting *fast* functional simulation **\n");
+
+  /* must have natural byte/word ordering */
+  if (!fastfwd_usable())
+    fatal("sim: *fast* functional simulation cannot swap bytes or words");
+
+  /* run the program to completion, or to the inst count limit */
+#ifndef NO_INSN_COUNT
+  fastfwd_exec(&regs, mem, &sim_num_insn, (counter_t)max_insts);
+#else /* !NO_INSN_COUNT */
+  fastfwd_exec(&regs, mem, &icount, (counter_t)max_insts);
+#endif /* NO_INSN_COUNT */
+
+  /* should not get here, unless the limit was reached... */
+  if (!max_insts)
+    panic("exited sim-fast main loop");
 }
@@ -51,9 +51,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 #include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "host.h"
 #include "misc.h"
@@ -61,6 +66,9 @@
 #include "regs.h"
 #include "memory.h"
 #include "cache.h"
+#include "chkpt.h"
+#include "fastfwd.h"
+#include "frontend.h"
 #include "loader.h"
 #include "syscall.h"
 #include "bpred.h"
@@ -97,6 +105,49 @@ static unsigned int max_insts;
 /* number of insts skipped before timing starts */
 static int fastfwd_count;
 
+/* functionally warm caches, TLBs and bpred while fast forwarding */
+static int fastfwd_warm;
+
+/* binary checkpoint file names: restore the machine from a checkpoint
+   before fast forwarding, and save it once timing simulation starts */
+static char *chkpt_restore_fname;
+static char *chkpt_save_fname;
+
+/* sampled simulation: measurement unit size, detailed warm-up size, and
+   sampling period (all in insts), sampling is disabled if the unit size is
+   zero */
+static unsigned int sample_unit;
+static unsigned int sample_warmup;
+static unsigned int sample_period;
+
+/* functionally warm caches, TLBs and bpred between samples */
+static int sample_fwarm;
+
+/* per-sample CPI output file name and stream */
+static char *sample_fname;
+static FILE *sample_outfd = NULL;
+
+/* number of samples (or simulation points) simulated at once, each by a
+   child process of its own, 1 simulates them one by one */
+static int sample_jobs;
+
+/* simulation points: interval size (in insts), and the simulation points
+   and weights file names, simulation points are disabled if no simulation
+   points file is given */
+static unsigned int simpoint_interval;
+static char *simpoint_fname;
+static char *simpoint_wfname;
+
+/* a simulation point, an interval of SIMPOINT_INTERVAL insts to simulate */
+struct simpoint_t {
+  counter_t interval;			/* interval number, from 0 */
+  double weight;			/* weight of the interval's CPI */
+};
+
+/* simulation points, in program order */
+static struct simpoint_t *simpoints = NULL;
+static int simpoint_npoints = 0;
+
 /* pipeline trace range and output filename */
 static int ptrace_nelt = 0;
 static char *ptrace_opts[2];
@@ -110,6 +161,13 @@ static int ruu_branch_penalty;
 /* speed of front-end of machine relative to execution core */
 static int fetch_speed;
 
+/* size of the ring of the decoupled functional front end, in insts, zero
+   if the timing model executes the instructions itself (see frontend.h) */
+static int fetch_decouple;
+
+/* non-zero while the functional front end executes the instructions */
+static int fetch_decoupled = FALSE;
+
 /* branch predictor type {nottaken|taken|perfect|bimod|2lev} */
 static char *pred_type;
 
@@ -139,12 +197,19 @@ static int btb_config[2] =
 /* instruction decode B/W (insts/cycle) */
 static int ruu_decode_width;
 
+/* keep the decoding of text segment insts in a decoded inst cache? */
+static int decode_cached;
+
 /* instruction issue B/W (insts/cycle) */
 static int ruu_issue_width;
 
 /* run pipeline with in-order issue */
 static int ruu_inorder_issue;
 
+/* issue ready memory, long latency and control operations oldest first,
+   instead of in the order of the original ready list */
+static int ruu_oldest_issue;
+
 /* issue instructions down wrong execution paths */
 static int ruu_include_spec = TRUE;
 
@@ -181,6 +246,15 @@ static char *cache_il2_opt;
 /* l2 instruction cache hit latency (in cycles) */
 static int cache_il2_lat;
 
+/* number of MSHRs of each cache level, 0 for unlimited outstanding misses */
+static int cache_dl1_mshrs;
+static int cache_dl2_mshrs;
+static int cache_il1_mshrs;
+static int cache_il2_mshrs;
+
+/* accesses that can wait on one MSHR, 0 for no limit */
+static int cache_mshr_targets;
+
 /* flush caches on system calls */
 static int flush_on_syscalls;
 
@@ -309,6 +383,9 @@ static counter_t sim_slip = 0;
 /* total number of instructions executed */
 static counter_t sim_total_insn = 0;
 
+/* total number of insts decoded into the decoded inst cache */
+static counter_t decode_fills = 0;
+
 /* total number of memory references committed */
 static counter_t sim_num_refs = 0;
 
@@ -338,9 +415,46 @@ static counter_t RUU_fcount;		/* cumulative RUU full count */
 static counter_t LSQ_count;		/* cumulative LSQ occupancy */
 static counter_t LSQ_fcount;		/* cumulative LSQ full count */
 
+/* store-to-load forwarding counters */
+static counter_t LSQ_fwd_loads;		/* loads forwarded from the LSQ */
+static counter_t LSQ_partial_loads;	/* loads partially overlapping an
+					   earlier store, not forwarded */
+
+/* loads held back at issue because the data cache had no MSHR for them */
+static counter_t LSQ_mshr_stalls;
+
 /* total non-speculative bogus addresses seen (debug var) */
 static counter_t sim_invalid_addrs;
 
+/* total number of insts executed by functional simulation only */
+static counter_t sim_func_insn = 0;
+
+/* functional warming stats, the warming accesses themselves are counted
+   by the warm_* stats of the caches, TLBs and bpred */
+static counter_t sim_warm_insn = 0;	/* insts executed with warming */
+static double sim_warm_time = 0.0;	/* host CPU time spent on them (s) */
+
+/* sampled simulation stats */
+static counter_t sample_num;		/* num measurement units */
+static counter_t sample_insn;		/* insts in measurement units */
+static counter_t sample_cycles;		/* cycles in measurement units */
+static double sample_cpi_sum = 0.0;	/* sum of per-unit CPI */
+static double sample_cpi_sumsq = 0.0;	/* sum of squares of per-unit CPI */
+static double sample_cpi_mean;		/* mean per-unit CPI */
+static double sample_cpi_stddev;	/* std deviation of per-unit CPI */
+static double sample_cpi_ci;		/* confidence interval of mean CPI */
+
+/* standard normal quantile of the CPI confidence interval, i.e., 95% */
+#define SAMPLE_CI_Z			1.96
+
+/* simulation point stats */
+static counter_t simpoint_num;		/* num simulation points simulated */
+static counter_t simpoint_insn;		/* insts in simulation points */
+static counter_t simpoint_cycles;	/* cycles in simulation points */
+static double simpoint_weight;		/* total weight of simulation points */
+static double simpoint_cpi_sum = 0.0;	/* weighted sum of per-point CPI */
+static double simpoint_cpi;		/* weighted mean per-point CPI */
+
 /*
  * simulator state variables
  */
@@ -351,6 +465,15 @@ static unsigned int inst_seq = 0;
 /* pipetrace instruction sequence counter */
 static unsigned int ptrace_seq = 0;
 
+/* instruction count at which dispatch and fetch stop, used to drain the
+   pipeline at the end of a detailed simulation interval (see
+   sim_detailed()), zero if unlimited */
+static counter_t ruu_dispatch_limit = 0;
+
+/* non-zero if dispatch has reached RUU_DISPATCH_LIMIT */
+#define RUU_DISPATCH_STOPPED()						\
+  (ruu_dispatch_limit && sim_num_insn >= ruu_dispatch_limit)
+
 /* speculation mode, non-zero when mis-speculating, i.e., executing
    instructions down the wrong path, thus state recovery will eventually have
    to occur that resets processor register and memory state back to the last
@@ -591,6 +714,111 @@ sim_reg_options(struct opt_odb_t *odb)
   opt_reg_int(odb, "-fastfwd", "number of insts skipped before timing starts",
 	      &fastfwd_count, /* default */0,
 	      /* print */TRUE, /* format */NULL);
+  opt_reg_flag(odb, "-fastfwd:warm",
+	       "functionally warm caches, TLBs and bpred during fastfwd",
+	       &fastfwd_warm, /* default */FALSE,
+	       /* print */TRUE, /* format */NULL);
+
+  opt_reg_string(odb, "-chkpt:restore",
+		 "restore machine state from binary checkpoint file",
+		 &chkpt_restore_fname, /* default */NULL,
+		 /* print */TRUE, /* format */NULL);
+  opt_reg_string(odb, "-chkpt:save",
+		 "save machine state to binary checkpoint file, after fastfwd",
+		 &chkpt_save_fname, /* default */NULL,
+		 /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  Binary checkpoints hold the architected state of the program together\n"
+"  with the contents of the caches, TLBs and branch predictor.  The machine\n"
+"  is saved with -chkpt:save after fast forwarding (or at the start of the\n"
+"  program), and later runs of the same program with the same cache, TLB\n"
+"  and branch predictor configuration restore it with -chkpt:restore, in\n"
+"  place of re-executing and re-warming the skipped insts.  Stats are not\n"
+"  saved, and the state of files opened by the program is not restored.\n"
+"\n"
+"    Example:   -fastfwd 100000000 -chkpt:save gcc.ckp -max:inst 1\n"
+"               -chkpt:restore gcc.ckp -max:inst 10000000\n"
+	       );
+
+  /* sampling options */
+
+  opt_reg_uint(odb, "-sample:unit",
+	       "sampled simulation measurement unit size (in insts), 0 = off",
+	       &sample_unit, /* default */0,
+	       /* print */TRUE, /* format */NULL);
+  opt_reg_uint(odb, "-sample:warmup",
+	       "detailed warm-up before each measurement unit (in insts)",
+	       &sample_warmup, /* default */2000,
+	       /* print */TRUE, /* format */NULL);
+  opt_reg_uint(odb, "-sample:period",
+	       "sampling period, from one measurement unit to the next (insts)",
+	       &sample_period, /* default */1000000,
+	       /* print */TRUE, /* format */NULL);
+  opt_reg_flag(odb, "-sample:fwarm",
+	       "functionally warm caches, TLBs and bpred between samples",
+	       &sample_fwarm, /* default */TRUE,
+	       /* print */TRUE, /* format */NULL);
+  opt_reg_string(odb, "-sample:out", "per-sample CPI output file",
+		 &sample_fname, /* default */NULL,
+		 /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-sample:jobs",
+	      "samples (or simulation points) simulated in parallel",
+	      &sample_jobs, /* default */1,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  Sampled simulation estimates CPI from periodic measurement units of\n"
+"  detailed simulation, in the manner of SMARTS.  Every sampling period\n"
+"  starts with functional simulation, which updates the caches, TLBs and\n"
+"  branch predictor if -sample:fwarm is set.  Detailed simulation then runs\n"
+"  for -sample:warmup insts of warm-up and -sample:unit insts of measurement,\n"
+"  and the pipeline is drained before the next period begins.  The mean CPI\n"
+"  of the measurement units is reported with a 95% confidence interval.\n"
+"  In sampled simulation, -max:inst limits all insts executed.  Functional\n"
+"  warming accesses are counted apart from the cache and bpred stats, in\n"
+"  their warm_* stats.\n"
+"\n"
+"    Example:   -sample:unit 1000 -sample:warmup 2000 -sample:period 100000\n"
+"\n"
+"  With -sample:jobs greater than 1, the detailed simulation of each sample\n"
+"  (or simulation point) runs in a child process, forked with a copy-on-\n"
+"  write snapshot of the simulator, while the simulator itself executes the\n"
+"  sample functionally and moves on to the next one.  The system calls of\n"
+"  the sample are replayed in the child from their effects in the parent,\n"
+"  and the stats of the child are added in as it finishes.  The caches,\n"
+"  TLBs and bpred after each sample are warmed functionally, as between\n"
+"  samples, so results differ slightly from those of serial simulation.\n"
+	       );
+
+  /* simulation point options */
+
+  opt_reg_string(odb, "-simpoint:points",
+		 "simulation points file, simulate only these intervals",
+		 &simpoint_fname, /* default */NULL,
+		 /* print */TRUE, /* format */NULL);
+  opt_reg_string(odb, "-simpoint:weights", "simulation point weights file",
+		 &simpoint_wfname, /* default */NULL,
+		 /* print */TRUE, /* format */NULL);
+  opt_reg_uint(odb, "-simpoint:interval",
+	       "simulation point interval size (in insts)",
+	       &simpoint_interval, /* default */10000000,
+	       /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  Simulation points restrict detailed simulation to a few representative\n"
+"  intervals of -simpoint:interval insts, as picked by the `simpoint' tool\n"
+"  from the basic block vectors of `sim-profile -bbv:interval'.  The\n"
+"  simulation points file lists `<interval> <cluster>' lines, and the\n"
+"  weights file lists `<weight> <cluster>' lines, as written by SimPoint.\n"
+"  Execution up to each simulation point is simulated functionally, with\n"
+"  -sample:warmup insts of detailed warm-up and functional warming as for\n"
+"  sampled simulation, and the CPI of the simulation points is combined by\n"
+"  weight.  Simulation ends after the last simulation point.\n"
+"\n"
+"    Example:   -simpoint:points gcc.pts -simpoint:weights gcc.wts\n"
+	       );
+
   opt_reg_string_list(odb, "-ptrace",
 	      "generate pipetrace, i.e., <fname|stdout|stderr> <range>",
 	      ptrace_opts, /* arr_sz */2, &ptrace_nelt, /* default */NULL,
@@ -631,6 +859,12 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &fetch_speed, /* default */1,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_int(odb, "-fetch:decouple",
+	      "ring size (insts) of a functional front end running ahead of"
+	      " the timing model on its own thread, 0 = off",
+	      &fetch_decouple, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
   /* branch predictor options */
 
   opt_reg_note(odb,
@@ -696,6 +930,11 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &ruu_decode_width, /* default */4,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_flag(odb, "-decode:cache",
+	       "keep decoded text segment insts in a decoded inst cache",
+	       &decode_cached, /* default */TRUE,
+	       /* print */TRUE, /* format */NULL);
+
   /* issue options */
 
   opt_reg_int(odb, "-issue:width",
@@ -707,11 +946,24 @@ sim_reg_options(struct opt_odb_t *odb)
 	       &ruu_inorder_issue, /* default */FALSE,
 	       /* print */TRUE, /* format */NULL);
 
+  opt_reg_flag(odb, "-issue:oldest",
+	       "issue ready memory, long latency and control ops oldest first",
+	       &ruu_oldest_issue, /* default */FALSE,
+	       /* print */TRUE, /* format */NULL);
+
   opt_reg_flag(odb, "-issue:wrongpath",
 	       "issue instructions down wrong execution paths",
 	       &ruu_include_spec, /* default */TRUE,
 	       /* print */TRUE, /* format */NULL);
 
+  opt_reg_note(odb,
+"  Each cycle, ready memory, long latency and control operations issue\n"
+"  first, the last to become ready first, then all other ready operations,\n"
+"  oldest first.  With -issue:oldest, the first class also issues oldest\n"
+"  first, which changes results, by a few percent when issue slots or\n"
+"  functional units are scarce.\n"
+	       );
+
   /* commit options */
 
   opt_reg_int(odb, "-commit:width",
@@ -749,7 +1001,9 @@ sim_reg_options(struct opt_odb_t *odb)
 "    <nsets>  - number of sets in the cache\n"
 "    <bsize>  - block size of the cache\n"
 "    <assoc>  - associativity of the cache\n"
-"    <repl>   - block replacement strategy, 'l'-LRU, 'f'-FIFO, 'r'-random\n"
+"    <repl>   - block replacement strategy, 'l'-LRU, 'f'-FIFO, 'r'-random,\n"
+"               'p'-tree PLRU, 's'-SRRIP, 'b'-BRRIP, 'd'-DRRIP (set dueling),\n"
+"               'h'-SHiP (SRRIP with signature-based hit prediction)\n"
 "\n"
 "    Examples:   -cache:dl1 dl1:4096:32:1:l\n"
 "                -dtlb dtlb:128:4096:32:r\n"
@@ -804,6 +1058,40 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &cache_il2_lat, /* default */6,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_int(odb, "-cache:dl1mshrs",
+	      "l1 data cache MSHRs (0 for unlimited outstanding misses)",
+	      &cache_dl1_mshrs, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-cache:dl2mshrs",
+	      "l2 data cache MSHRs (0 for unlimited outstanding misses)",
+	      &cache_dl2_mshrs, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-cache:il1mshrs",
+	      "l1 inst cache MSHRs (0 for unlimited outstanding misses)",
+	      &cache_il1_mshrs, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-cache:il2mshrs",
+	      "l2 inst cache MSHRs (0 for unlimited outstanding misses)",
+	      &cache_il2_mshrs, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-cache:mshrtargets",
+	      "accesses merged into one MSHR (0 for no limit)",
+	      &cache_mshr_targets, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  With MSHRs, each outstanding miss of a cache holds an MSHR until its block\n"
+"  is filled, and later misses to the block merge into the MSHR, up to\n"
+"  -cache:mshrtargets accesses.  Loads that would find no MSHR (or no free\n"
+"  target) in the l1 data cache are not issued until one is freed, other\n"
+"  misses wait for a free MSHR.  Shared cache levels use the MSHRs of the\n"
+"  data cache level.\n"
+	       );
+
   opt_reg_flag(odb, "-cache:flush", "flush caches on system calls",
 	       &flush_on_syscalls, /* default */FALSE, /* print */TRUE, NULL);
 
@@ -874,6 +1162,100 @@ sim_reg_options(struct opt_odb_t *odb)
 	       &bugcompat_mode, /* default */FALSE, /* print */TRUE, NULL);
 }
 
+/* compare simulation points by interval */
+static int
+simpoint_compare(const void *a, const void *b)
+{
+  const struct simpoint_t *sa = a, *sb = b;
+
+  if (sa->interval < sb->interval)
+    return -1;
+  else if (sa->interval > sb->interval)
+    return 1;
+  else
+    return 0;
+}
+
+/* read the simulation points in FNAME and their weights in WFNAME, the
+   files list `<interval> <cluster>' and `<weight> <cluster>' lines */
+static void
+simpoint_load(char *fname,			/* simulation points file */
+	      char *wfname)			/* weights file */
+{
+  FILE *fd;
+  int i, j, nweights, sz, *clusters, *wclusters, cluster;
+  double interval, weight, *weights;
+
+  /* read the simulation points */
+  if (!(fd = fopen(fname, "r")))
+    fatal("cannot open simulation points file `%s'", fname);
+  sz = 16;
+  simpoints = calloc(sz, sizeof(struct simpoint_t));
+  clusters = calloc(sz, sizeof(int));
+  if (!simpoints || !clusters)
+    fatal("out of virtual memory");
+  while (fscanf(fd, "%lf %d", &interval, &cluster) == 2)
+    {
+      if (simpoint_npoints == sz)
+	{
+	  sz *= 2;
+	  simpoints = realloc(simpoints, sz * sizeof(struct simpoint_t));
+	  clusters = realloc(clusters, sz * sizeof(int));
+	  if (!simpoints || !clusters)
+	    fatal("out of virtual memory");
+	}
+      if (interval < 0.0)
+	fatal("bad simulation point interval in `%s'", fname);
+      simpoints[simpoint_npoints].interval = (counter_t)interval;
+      clusters[simpoint_npoints++] = cluster;
+    }
+  if (!feof(fd) || simpoint_npoints == 0)
+    fatal("`%s' is not a simulation points file", fname);
+  fclose(fd);
+
+  /* read the weights */
+  if (!(fd = fopen(wfname, "r")))
+    fatal("cannot open simulation point weights file `%s'", wfname);
+  weights = calloc(simpoint_npoints, sizeof(double));
+  wclusters = calloc(simpoint_npoints, sizeof(int));
+  if (!weights || !wclusters)
+    fatal("out of virtual memory");
+  nweights = 0;
+  while (nweights < simpoint_npoints
+	 && fscanf(fd, "%lf %d", &weight, &cluster) == 2)
+    {
+      weights[nweights] = weight;
+      wclusters[nweights++] = cluster;
+    }
+  if (fscanf(fd, "%lf", &weight) != EOF || nweights != simpoint_npoints)
+    fatal("simulation point weights file `%s' does not match `%s'",
+	  wfname, fname);
+  fclose(fd);
+
+  /* match the weights to the simulation points by cluster */
+  for (i=0; i<simpoint_npoints; i++)
+    {
+      for (j=0; j<nweights && wclusters[j] != clusters[i]; j++)
+	/* nada */;
+      if (j == nweights)
+	fatal("no weight for cluster %d in `%s'", clusters[i], wfname);
+      simpoints[i].weight = weights[j];
+    }
+
+  /* simulate the simulation points in program order */
+  qsort(simpoints, simpoint_npoints, sizeof(struct simpoint_t),
+	simpoint_compare);
+  for (i=1; i<simpoint_npoints; i++)
+    {
+      if (simpoints[i].interval == simpoints[i-1].interval)
+	fatal("duplicate simulation point in `%s'", fname);
+    }
+
+  free(clusters);
+  free(weights);
+  free(wclusters);
+}
+
 /* check simulator-specific option values */
 void
 sim_check_options(struct opt_odb_t *odb,        /* options database */
@@ -885,6 +1267,53 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
   if (fastfwd_count < 0 || fastfwd_count >= 2147483647)
     fatal("bad fast forward count: %d", fastfwd_count);
 
+  if (sample_unit > 0)
+    {
+      if (sample_period < sample_warmup + sample_unit)
+	fatal("sampling period must cover the warm-up and measurement unit");
+
+      if (sample_fname)
+	{
+	  sample_outfd = fopen(sample_fname, "w");
+	  if (!sample_outfd)
+	    fatal("cannot open sample output file `%s'", sample_fname);
+	  fprintf(sample_outfd, "# sample insn unit_insn unit_cycles CPI\n");
+	}
+    }
+
+  if (sample_jobs < 1)
+    fatal("number of sampling jobs must be at least 1");
+  if (sample_jobs > 1 && (sample_unit > 0 || simpoint_fname))
+    {
+      /* the pipeline trace and DLite watch the detailed simulation, which
+	 runs in the child processes, and only scalar stats are merged */
+      if (pcstat_nelt > 0 || ptrace_nelt > 0 || dlite_active)
+	fatal("parallel sampling cannot be used with `-pcstat', `-ptrace' "
+	      "or DLite");
+    }
+
+  if (simpoint_fname)
+    {
+      if (sample_unit > 0)
+	fatal("sampled simulation and simulation points are exclusive");
+      if (!simpoint_wfname)
+	fatal("simulation points need a weights file (-simpoint:weights)");
+      if (simpoint_interval < 1)
+	fatal("simulation point interval must be at least one inst");
+      if (fastfwd_count > 0)
+	fatal("fast forwarding and simulation points are exclusive");
+
+      simpoint_load(simpoint_fname, simpoint_wfname);
+
+      if (sample_fname)
+	{
+	  sample_outfd = fopen(sample_fname, "w");
+	  if (!sample_outfd)
+	    fatal("cannot open sample output file `%s'", sample_fname);
+	  fprintf(sample_outfd, "# interval weight insn cycles CPI\n");
+	}
+    }
+
   if (ruu_ifq_size < 1 || (ruu_ifq_size & (ruu_ifq_size - 1)) != 0)
     fatal("inst fetch queue size must be positive > 0 and a power of two");
 
@@ -894,6 +1323,22 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
   if (fetch_speed < 1)
     fatal("front-end speed must be positive and non-zero");
 
+  if (fetch_decouple)
+    {
+      if (fetch_decouple < FRONTEND_MIN_RING
+	  || (fetch_decouple & (fetch_decouple - 1)) != 0)
+	fatal("decoupled front end ring size must be a power of two >= %d",
+	      FRONTEND_MIN_RING);
+      /* the front end executes the correct path only, and the architected
+	 state runs ahead of the timing model */
+      if (ruu_include_spec)
+	fatal("decoupled front end requires `-issue:wrongpath false'");
+      if (sample_unit > 0 || simpoint_fname)
+	fatal("decoupled front end cannot be used with sampled simulation");
+      if (verbose || dlite_active)
+	fatal("decoupled front end cannot be used with `-v' or DLite");
+    }
+
   if (!mystricmp(pred_type, "perfect"))
     {
       /* perfect predictor */
@@ -1135,6 +1580,23 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
   if (cache_il2_lat < 1)
     fatal("l2 instruction cache latency must be greater than zero");
 
+  if (cache_dl1_mshrs < 0 || cache_dl2_mshrs < 0
+      || cache_il1_mshrs < 0 || cache_il2_mshrs < 0)
+    fatal("number of MSHRs must be zero or positive");
+
+  if (cache_mshr_targets < 0)
+    fatal("MSHR targets must be zero or positive");
+
+  /* give the caches their MSHRs, shared levels use the data cache MSHRs */
+  if (cache_il1 && cache_il1 != cache_dl1 && cache_il1 != cache_dl2)
+    cache_set_mshrs(cache_il1, cache_il1_mshrs, cache_mshr_targets);
+  if (cache_il2 && cache_il2 != cache_dl2)
+    cache_set_mshrs(cache_il2, cache_il2_mshrs, cache_mshr_targets);
+  if (cache_dl1)
+    cache_set_mshrs(cache_dl1, cache_dl1_mshrs, cache_mshr_targets);
+  if (cache_dl2)
+    cache_set_mshrs(cache_dl2, cache_dl2_mshrs, cache_mshr_targets);
+
   if (mem_nelt != 2)
     fatal("bad memory access latency (<first_chunk> <inter_chunk>)");
 
@@ -1185,6 +1647,22 @@ sim_aux_config(FILE *stream)            /* output stream */
   /* nada */
 }
 
+/* register the average MSHR occupancy of cache CP, over all simulated
+   cycles, the cache module does not know the cycle count */
+static void
+mshr_reg_stats(struct cache_t *cp,		/* cache instance */
+	       struct stat_sdb_t *sdb)		/* stats database */
+{
+  char buf[512], buf1[512];
+
+  if (!cp->nmshrs)
+    return;
+
+  sprintf(buf, "%s.mshr_occupancy", cp->name);
+  sprintf(buf1, "%s.mshr_busy_cycles / sim_cycle", cp->name);
+  stat_reg_formula(sdb, buf, "avg MSHR occupancy (misses)", buf1, NULL);
+}
+
 /* register simulator-specific statistics */
 void
 sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
@@ -1215,6 +1693,15 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
   stat_reg_counter(sdb, "sim_total_insn",
 		   "total number of instructions executed",
 		   &sim_total_insn, 0, NULL);
+  if (decode_cached)
+    {
+      stat_reg_counter(sdb, "decode_fills",
+		       "total number of insts decoded into the decode cache",
+		       &decode_fills, 0, NULL);
+      stat_reg_formula(sdb, "decode_fill_rate",
+		       "decode cache fills per inst executed",
+		       "decode_fills / sim_total_insn", NULL);
+    }
   stat_reg_counter(sdb, "sim_total_refs",
 		   "total number of loads and stores executed",
 		   &sim_total_refs, 0, NULL);
@@ -1284,6 +1771,16 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
                    "lsq_occupancy / lsq_rate", /* format */NULL);
   stat_reg_formula(sdb, "lsq_full", "fraction of time (cycle's) LSQ was full",
                    "LSQ_fcount / sim_cycle", /* format */NULL);
+  stat_reg_counter(sdb, "LSQ_fwd_loads",
+		   "total loads forwarded from an earlier store in the LSQ",
+                   &LSQ_fwd_loads, /* initial value */0, /* format */NULL);
+  stat_reg_counter(sdb, "LSQ_partial_loads",
+		   "total loads partially overlapping an earlier store",
+                   &LSQ_partial_loads, /* initial value */0, /* format */NULL);
+  if (cache_dl1 && cache_dl1_mshrs)
+    stat_reg_counter(sdb, "LSQ_mshr_stalls",
+		     "total load issue attempts held back for a D-cache MSHR",
+		     &LSQ_mshr_stalls, /* initial value */0, /* format */NULL);
 
   stat_reg_counter(sdb, "sim_slip",
                    "total number of slip cycles",
@@ -1300,19 +1797,124 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
   /* register cache stats */
   if (cache_il1
       && (cache_il1 != cache_dl1 && cache_il1 != cache_dl2))
-    cache_reg_stats(cache_il1, sdb);
+    {
+      cache_reg_stats(cache_il1, sdb);
+      mshr_reg_stats(cache_il1, sdb);
+    }
   if (cache_il2
       && (cache_il2 != cache_dl1 && cache_il2 != cache_dl2))
-    cache_reg_stats(cache_il2, sdb);
+    {
+      cache_reg_stats(cache_il2, sdb);
+      mshr_reg_stats(cache_il2, sdb);
+    }
   if (cache_dl1)
-    cache_reg_stats(cache_dl1, sdb);
+    {
+      cache_reg_stats(cache_dl1, sdb);
+      mshr_reg_stats(cache_dl1, sdb);
+    }
   if (cache_dl2)
-    cache_reg_stats(cache_dl2, sdb);
+    {
+      cache_reg_stats(cache_dl2, sdb);
+      mshr_reg_stats(cache_dl2, sdb);
+    }
   if (itlb)
     cache_reg_stats(itlb, sdb);
   if (dtlb)
     cache_reg_stats(dtlb, sdb);
 
+  /* functional warming stats */
+  if ((fastfwd_warm && fastfwd_count > 0)
+      || ((sample_unit > 0 || simpoint_fname) && sample_fwarm))
+    {
+      stat_reg_counter(sdb, "sim_warm_insn",
+		       "total number of insts executed with functional warming",
+		       &sim_warm_insn, /* initial value */0, /* format */NULL);
+      stat_reg_double(sdb, "sim_warm_time",
+		      "total host CPU time spent on functional warming (s)",
+		      &sim_warm_time, /* initial value */0.0,
+		      /* format */NULL);
+      stat_reg_formula(sdb, "sim_warm_rate",
+		       "functional warming speed (insts per second)",
+		       "sim_warm_insn / sim_warm_time", /* format */"%12.0f");
+
+      if (pred)
+	bpred_reg_warm_stats(pred, sdb);
+      if (cache_il1
+	  && (cache_il1 != cache_dl1 && cache_il1 != cache_dl2))
+	cache_reg_warm_stats(cache_il1, sdb);
+      if (cache_il2
+	  && (cache_il2 != cache_dl1 && cache_il2 != cache_dl2))
+	cache_reg_warm_stats(cache_il2, sdb);
+      if (cache_dl1)
+	cache_reg_warm_stats(cache_dl1, sdb);
+      if (cache_dl2)
+	cache_reg_warm_stats(cache_dl2, sdb);
+      if (itlb)
+	cache_reg_warm_stats(itlb, sdb);
+      if (dtlb)
+	cache_reg_warm_stats(dtlb, sdb);
+    }
+
+  /* sampled simulation stats */
+  if (sample_unit > 0 || simpoint_fname || chkpt_restore_fname)
+    stat_reg_counter(sdb, "sim_func_insn",
+		     "total number of insts executed functionally",
+		     &sim_func_insn, /* initial value */0, /* format */NULL);
+  if (sample_unit > 0)
+    {
+      stat_reg_counter(sdb, "sample_num",
+		       "total number of measurement units",
+		       &sample_num, /* initial value */0, /* format */NULL);
+      stat_reg_counter(sdb, "sample_insn",
+		       "total number of insts in measurement units",
+		       &sample_insn, /* initial value */0, /* format */NULL);
+      stat_reg_counter(sdb, "sample_cycles",
+		       "total number of cycles in measurement units",
+		       &sample_cycles, /* initial value */0, /* format */NULL);
+      stat_reg_formula(sdb, "sample_CPI",
+		       "cycles per instruction, over all measurement units",
+		       "sample_cycles / sample_insn", /* format */NULL);
+      stat_reg_double(sdb, "sample_CPI_mean",
+		      "mean of per-unit CPI",
+		      &sample_cpi_mean, /* initial value */0.0,
+		      /* format */NULL);
+      stat_reg_double(sdb, "sample_CPI_stddev",
+		      "standard deviation of per-unit CPI",
+		      &sample_cpi_stddev, /* initial value */0.0,
+		      /* format */NULL);
+      stat_reg_double(sdb, "sample_CPI_ci",
+		      "95% confidence interval of mean CPI (+/-)",
+		      &sample_cpi_ci, /* initial value */0.0,
+		      /* format */NULL);
+      stat_reg_formula(sdb, "sample_CPI_rel_ci",
+		       "95% confidence interval of mean CPI, relative",
+		       "sample_CPI_ci / sample_CPI_mean", /* format */NULL);
+    }
+
+  /* simulation point stats */
+  if (simpoint_fname)
+    {
+      stat_reg_counter(sdb, "simpoint_num",
+		       "total number of simulation points simulated",
+		       &simpoint_num, /* initial value */0, /* format */NULL);
+      stat_reg_counter(sdb, "simpoint_insn",
+		       "total number of insts in simulation points",
+		       &simpoint_insn, /* initial value */0, /* format */NULL);
+      stat_reg_counter(sdb, "simpoint_cycles",
+		       "total number of cycles in simulation points",
+		       &simpoint_cycles, /* initial value */0, /* format */NULL);
+      stat_reg_double(sdb, "simpoint_weight",
+		      "total weight of simulation points simulated",
+		      &simpoint_weight, /* initial value */0.0,
+		      /* format */NULL);
+      stat_reg_double(sdb, "simpoint_CPI",
+		      "cycles per instruction, weighted over simulation points",
+		      &simpoint_cpi, /* initial value */0.0, /* format */NULL);
+      stat_reg_formula(sdb, "simpoint_IPC",
+		       "instructions per cycle, weighted over simulation points",
+		       "1 / simpoint_CPI", /* format */NULL);
+    }
+
   /* debug variable(s) */
   stat_reg_counter(sdb, "sim_invalid_addrs",
 		   "total non-speculative bogus addresses seen (debug var)",
@@ -1350,6 +1952,7 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
     }
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
+  fastfwd_reg_stats(sdb);
 }
 
 /* forward declarations */
@@ -1399,6 +2002,12 @@ simoo_mstate_obj(FILE *stream,			/* output stream */
 		 struct regs_t *regs,		/* registers to access */
 		 struct mem_t *mem);		/* memory space to access */
 
+/* allocate the decoded inst cache, the program must be loaded */
+static void decode_init(void);
+
+/* invalidate the decoded insts overlapping the NBYTES written at ADDR */
+static void decode_inval(md_addr_t addr, int nbytes);
+
 /* total RS links allocated at program start */
 #define MAX_RS_LINKS                    4096
 
@@ -1411,6 +2020,12 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  /* set up the fast functional engine, used to fast forward */
+  fastfwd_init(mem);
+
+  /* allocate the decoded inst cache */
+  decode_init();
+
   /* initialize here, so symbols can be loaded */
   if (ptrace_nelt == 2)
     {
@@ -1452,6 +2067,8 @@ sim_uninit(void)
 {
   if (ptrace_nelt > 0)
     ptrace_close();
+  if (sample_outfd)
+    fclose(sample_outfd);
 }
 
 
@@ -1462,8 +2079,8 @@ sim_uninit(void)
 /* inst tag type, used to tag an operation instance in the RUU */
 typedef unsigned int INST_TAG_TYPE;
 
-/* inst sequence type, used to order instructions in the ready list, if
-   this rolls over the ready list order temporarily will get messed up,
+/* inst sequence type, used to order instructions in the ready queue, if
+   this rolls over the ready queue order temporarily will get messed up,
    but execution will continue and complete correctly */
 typedef unsigned int INST_SEQ_TYPE;
 
@@ -1499,6 +2116,7 @@ struct RUU_station {
   struct bpred_update_t dir_update;	/* bpred direction update info */
   int spec_mode;			/* non-zero if issued in spec_mode */
   md_addr_t addr;			/* effective address for ld/st's */
+  int addr_size;			/* size of ld/st access at ADDR */
   INST_TAG_TYPE tag;			/* RUU slot tag, increment to
 					   squash operation */
   INST_SEQ_TYPE seq;			/* instruction sequence, used to
@@ -1609,6 +2227,60 @@ ruu_dump(FILE *stream)				/* output stream */
     }
 }
 
+/*
+ * queue slot bitmaps: the RUU and LSQ are circular queues kept in program
+ * order, so a bitmap with one bit per queue slot can mark a subset of queue
+ * entries, and the oldest marked entry is found by scanning from the head
+ */
+
+/* allocate a zeroed bitmap with one bit per queue slot */
+static BITMAP_PTR_TYPE
+qbitmap_create(int nslots)			/* number of queue slots */
+{
+  BITMAP_PTR_TYPE bmap;
+
+  bmap = calloc(BITMAP_SIZE(nslots), sizeof(BITMAP_ENT_TYPE));
+  if (!bmap)
+    fatal("out of virtual memory");
+  return bmap;
+}
+
+/* locate the first set bit in circular queue bitmap BMAP, visiting queue
+   offsets OFF through NUM-1 relative to queue head HEAD, returns the offset
+   of the first set bit found, or -1 if no bit is set in that range */
+static int
+qbitmap_scan(BITMAP_PTR_TYPE bmap,		/* queue bitmap to scan */
+	     int size,				/* number of queue slots */
+	     int head,				/* queue head slot */
+	     int off,				/* first offset to visit */
+	     int num)				/* number of valid queue slots */
+{
+  int slot, bit, span;
+  BITMAP_ENT_TYPE ent;
+
+  while (off < num)
+    {
+      slot = (head + off) % size;
+      bit = slot % 32;
+
+      /* check the remainder of this bitmap entry, in one go */
+      ent = bmap[slot / 32] >> bit;
+      if (ent)
+	{
+	  off += BITMAP_ENT_FIRST_ONE(ent);
+	  return (off < num) ? off : -1;
+	}
+
+      /* skip to the start of the next entry (or wrap to slot zero) */
+      span = 32 - bit;
+      if (span > size - slot)
+	span = size - slot;
+      off += span;
+    }
+  return -1;
+}
+
+
 /*
  * load/store queue (LSQ): holds loads and stores in program order, indicating
  * status of load/store access:
@@ -1652,6 +2324,54 @@ static int LSQ_num;                     /* num entries currently in LSQ */
 #define STORE_OP_READY(RS)              ((RS)->idep_ready[STORE_OP_INDEX])
 #define STORE_ADDR_READY(RS)            ((RS)->idep_ready[STORE_ADDR_INDEX])
 
+/* non-zero if LSQ entry RS is a store, else it is a load */
+#define LSQ_STORE_P(RS)							\
+  ((MD_OP_FLAGS((RS)->op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE))
+
+/*
+ * memory disambiguation state, used by lsq_refresh() to locate loads whose
+ * memory dependencies are satisfied without rescanning the LSQ each cycle;
+ * the state is updated only as memory operations enter the LSQ, as their
+ * operands (i.e., effective addresses) become ready, and as they leave the
+ * LSQ at commit or during recovery
+ */
+
+/* LSQ slots holding stores with an unknown address (STA unknown), the
+   oldest of these blocks all later loads */
+static BITMAP_PTR_TYPE lsq_sta_unknown;
+
+/* LSQ slots holding loads whose register operands are ready, but which are
+   still waiting for their memory dependencies to be satisfied */
+static BITMAP_PTR_TYPE lsq_ld_waiting;
+
+/* store address index, a hash table of all stores in the LSQ keyed by
+   the aligned LSQ_STORE_GRAIN-byte block holding their address, each
+   bucket chain is kept youngest store first, so the first matching store
+   older than a load is the store it depends on; since memory accesses are
+   naturally aligned (misaligned accesses fault), an access never spans two
+   blocks, and only stores in a load's block can overlap the load */
+struct lsq_store_link {
+  struct lsq_store_link *next;		/* next (older) store in bucket */
+  struct lsq_store_link *prev;		/* previous (younger) store in bucket */
+  struct RUU_station *rs;		/* LSQ store entry */
+};
+static struct lsq_store_link *lsq_store_links;	/* one link per LSQ slot */
+static struct lsq_store_link **lsq_store_htable;/* address hash buckets */
+static int lsq_store_hsize;			/* num buckets, power of two */
+
+/* store address index block size, NOTE: must be a power of two no smaller
+   than the largest memory access */
+#define LSQ_STORE_GRAIN			8
+
+/* store address index bucket of address ADDR */
+#define LSQ_STORE_HASH(ADDR)						\
+  ((((ADDR) / LSQ_STORE_GRAIN) ^ ((ADDR) >> 12)) & (lsq_store_hsize - 1))
+
+/* non-zero if the accesses of LSQ entries A and B overlap */
+#define LSQ_OVERLAP_P(A, B)						\
+  ((A)->addr < (B)->addr + (B)->addr_size				\
+   && (B)->addr < (A)->addr + (A)->addr_size)
+
 /* allocate and initialize the load/store queue (LSQ) */
 static void
 lsq_init(void)
@@ -1664,6 +2384,19 @@ lsq_init(void)
   LSQ_head = LSQ_tail = 0;
   LSQ_count = 0;
   LSQ_fcount = 0;
+
+  /* allocate the memory disambiguation state */
+  lsq_sta_unknown = qbitmap_create(LSQ_size);
+  lsq_ld_waiting = qbitmap_create(LSQ_size);
+
+  lsq_store_links = calloc(LSQ_size, sizeof(struct lsq_store_link));
+  for (lsq_store_hsize = 1;
+       lsq_store_hsize < 2 * LSQ_size;
+       lsq_store_hsize <<= 1)
+    /* nada */;
+  lsq_store_htable = calloc(lsq_store_hsize, sizeof(struct lsq_store_link *));
+  if (!lsq_store_links || !lsq_store_htable)
+    fatal("out of virtual memory");
 }
 
 /* dump the contents of the RUU */
@@ -1691,13 +2424,113 @@ lsq_dump(FILE *stream)				/* output stream */
     }
 }
 
+/* return the youngest store in the LSQ that precedes memory operation RS
+   and accesses some of the same bytes as RS, returns NULL if there is no
+   such store */
+static struct RUU_station *
+lsq_store_lookup(struct RUU_station *rs)	/* LSQ entry to match */
+{
+  struct lsq_store_link *link;
+
+  for (link = lsq_store_htable[LSQ_STORE_HASH(rs->addr)];
+       link != NULL;
+       link = link->next)
+    {
+      if (LSQ_OVERLAP_P(link->rs, rs) && (int)(link->rs->seq - rs->seq) < 0)
+	return link->rs;
+    }
+  return NULL;
+}
+
+/* return non-zero if store ST, the youngest earlier store overlapping load
+   RS (see lsq_store_lookup()), supplies all the bytes of RS, i.e., the store
+   value can be forwarded to the load */
+static INLINE int
+lsq_store_forward_p(struct RUU_station *st,	/* store, or NULL */
+		    struct RUU_station *rs)	/* load */
+{
+  return (st != NULL
+	  && st->addr == rs->addr && st->addr_size >= rs->addr_size);
+}
+
+/* add memory operation RS, just dispatched to the LSQ tail, to the memory
+   disambiguation state */
+static void
+lsq_disamb_insert(struct RUU_station *rs)	/* new LSQ entry */
+{
+  struct lsq_store_link *link;
+  int bucket;
+
+  if (LSQ_STORE_P(rs))
+    {
+      /* youngest store, insert at the front of its address bucket */
+      link = &lsq_store_links[rs - LSQ];
+      bucket = LSQ_STORE_HASH(rs->addr);
+      link->rs = rs;
+      link->prev = NULL;
+      link->next = lsq_store_htable[bucket];
+      if (link->next)
+	link->next->prev = link;
+      lsq_store_htable[bucket] = link;
+
+      if (!STORE_ADDR_READY(rs))
+	(void)BITMAP_SET(lsq_sta_unknown, BITMAP_SIZE(LSQ_size), rs - LSQ);
+    }
+  else if (OPERANDS_READY(rs))
+    (void)BITMAP_SET(lsq_ld_waiting, BITMAP_SIZE(LSQ_size), rs - LSQ);
+}
+
+/* update the memory disambiguation state, input OPNUM of memory operation
+   RS has just become ready */
+static void
+lsq_disamb_ready(struct RUU_station *rs,	/* LSQ entry */
+		 int opnum)			/* idep_ready[] index */
+{
+  if (LSQ_STORE_P(rs))
+    {
+      /* STA known, store no longer blocks later loads */
+      if (opnum == STORE_ADDR_INDEX)
+	(void)BITMAP_CLEAR(lsq_sta_unknown, BITMAP_SIZE(LSQ_size), rs - LSQ);
+    }
+  else if (OPERANDS_READY(rs))
+    {
+      /* load may now issue, once its memory dependencies are satisfied */
+      (void)BITMAP_SET(lsq_ld_waiting, BITMAP_SIZE(LSQ_size), rs - LSQ);
+    }
+}
+
+/* remove memory operation RS, which is leaving the LSQ (at commit or during
+   recovery), from the memory disambiguation state */
+static void
+lsq_disamb_remove(struct RUU_station *rs)	/* departing LSQ entry */
+{
+  struct lsq_store_link *link;
+
+  if (LSQ_STORE_P(rs))
+    {
+      /* unlink the store from its address bucket */
+      link = &lsq_store_links[rs - LSQ];
+      if (link->prev)
+	link->prev->next = link->next;
+      else
+	lsq_store_htable[LSQ_STORE_HASH(rs->addr)] = link->next;
+      if (link->next)
+	link->next->prev = link->prev;
+      link->next = link->prev = NULL;
+      link->rs = NULL;
+    }
+
+  (void)BITMAP_CLEAR(lsq_sta_unknown, BITMAP_SIZE(LSQ_size), rs - LSQ);
+  (void)BITMAP_CLEAR(lsq_ld_waiting, BITMAP_SIZE(LSQ_size), rs - LSQ);
+}
+
 
 /*
  * RS_LINK defs and decls
  */
 
 /* a reservation station link: this structure links elements of a RUU
-   reservation station list; used for ready instruction queue, event queue, and
+   reservation station list; used for the event queue, in-order issue, and
    output dependency lists; each RS_LINK node contains a pointer to the RUU
    entry it references along with an instance tag, the RS_LINK is only valid if
    the instruction instance tag matches the instruction RUU entry instance tag;
@@ -1710,7 +2543,6 @@ struct RS_link {
   INST_TAG_TYPE tag;			/* inst instance sequence number */
   union {
     tick_t when;			/* time stamp of entry (for eventq) */
-    INST_SEQ_TYPE seq;			/* inst sequence */
     int opnum;				/* input/output operand number */
   } x;
 };
@@ -1807,95 +2639,299 @@ ruu_release_fu(void)
  * the execution unit event queue implementation follows, the event queue
  * indicates which instruction will complete next, the writeback handler
  * drains this queue
+ *
+ * the event queue is organized as a timing wheel: a circular array of
+ * EVENTQ_WHEEL_SIZE buckets, one per cycle, covering the cycles starting at
+ * EVENTQ_BASE; an event for cycle WHEN is pushed onto the front of its
+ * bucket, so events scheduled for the same cycle are serviced in the reverse
+ * order they were queued (this matches the order of the original sorted
+ * event list); events too far in the future to fit on the wheel are held
+ * in an overflow heap, sorted by time (and queue order within a time), and
+ * moved onto the wheel as the wheel base advances into range; NOTE: RS_LINK
+ * nodes are used for the event queue so that it need not be updated during
+ * squash events
  */
 
-/* pending event queue, sorted from soonest to latest event (in time), NOTE:
-   RS_LINK nodes are used for the event queue list so that it need not be
-   updated during squash events */
-static struct RS_link *event_queue;
+/* number of cycles covered by the timing wheel, NOTE: must be a power of
+   two, and should exceed the latency of most events (e.g., memory misses) */
+#define EVENTQ_WHEEL_SIZE		1024
+
+/* timing wheel buckets, bucket EVENTQ_BASE_IDX holds events for cycle
+   EVENTQ_BASE, the following buckets hold events for the following cycles */
+static struct RS_link *eventq_wheel[EVENTQ_WHEEL_SIZE];
+static tick_t eventq_base;		/* first cycle covered by the wheel */
+static int eventq_base_idx;		/* wheel bucket of EVENTQ_BASE */
+static int eventq_wheel_num;		/* num events currently on the wheel */
+
+/* wheel bucket holding events for cycle WHEN, WHEN must be on the wheel */
+#define EVENTQ_BUCKET(WHEN)						\
+  ((eventq_base_idx + (int)((WHEN) - eventq_base)) & (EVENTQ_WHEEL_SIZE-1))
+
+/* non-zero if an event at cycle WHEN fits on the timing wheel */
+#define EVENTQ_ON_WHEEL(WHEN)						\
+  ((WHEN) - eventq_base < EVENTQ_WHEEL_SIZE)
+
+/* overflow event heap entry, SEQ preserves queue order within a cycle */
+struct eventq_ovfl_ent {
+  tick_t when;				/* time stamp of event */
+  counter_t seq;			/* event queue order */
+  struct RS_link *ev;			/* event record */
+};
+
+/* overflow event heap, a binary min-heap on (when, seq) */
+static struct eventq_ovfl_ent *eventq_ovfl;
+static int eventq_ovfl_num;		/* num events in overflow heap */
+static int eventq_ovfl_size;		/* allocated overflow heap entries */
+static counter_t eventq_ovfl_seq;	/* overflow event sequence counter */
+
+/* non-zero if overflow heap entry A should be serviced before entry B */
+#define EVENTQ_OVFL_LESS(A, B)						\
+  ((A)->when < (B)->when || ((A)->when == (B)->when && (A)->seq < (B)->seq))
 
 /* initialize the event queue structures */
 static void
 eventq_init(void)
 {
-  event_queue = NULL;
+  int i;
+
+  for (i=0; i<EVENTQ_WHEEL_SIZE; i++)
+    eventq_wheel[i] = NULL;
+  eventq_base = 0;
+  eventq_base_idx = 0;
+  eventq_wheel_num = 0;
+
+  eventq_ovfl = NULL;
+  eventq_ovfl_num = 0;
+  eventq_ovfl_size = 0;
+  eventq_ovfl_seq = 0;
+}
+
+/* dump the contents of an event queue record */
+static void
+eventq_dumpent(struct RS_link *ev,		/* event record to dump */
+	       FILE *stream)			/* output stream */
+{
+  /* is event still valid? */
+  if (RSLINK_VALID(ev))
+    {
+      struct RUU_station *rs = RSLINK_RS(ev);
+
+      fprintf(stream, "idx: %2d: @ %.0f\n",
+	      (int)(rs - (rs->in_LSQ ? LSQ : RUU)), (double)ev->x.when);
+      ruu_dumpent(rs, rs - (rs->in_LSQ ? LSQ : RUU),
+		  stream, /* !header */FALSE);
+    }
 }
 
 /* dump the contents of the event queue */
 static void
 eventq_dump(FILE *stream)			/* output stream */
 {
+  int i;
   struct RS_link *ev;
 
   if (!stream)
     stream = stderr;
 
   fprintf(stream, "** event queue state **\n");
+  fprintf(stream, "wheel base: %.0f, wheel events: %d, overflow events: %d\n",
+	  (double)eventq_base, eventq_wheel_num, eventq_ovfl_num);
 
-  for (ev = event_queue; ev != NULL; ev = ev->next)
+  /* dump the timing wheel, from soonest to latest event */
+  for (i=0; i<EVENTQ_WHEEL_SIZE; i++)
     {
-      /* is event still valid? */
-      if (RSLINK_VALID(ev))
-	{
-	  struct RUU_station *rs = RSLINK_RS(ev);
-
-	  fprintf(stream, "idx: %2d: @ %.0f\n",
-		  (int)(rs - (rs->in_LSQ ? LSQ : RUU)), (double)ev->x.when);
-	  ruu_dumpent(rs, rs - (rs->in_LSQ ? LSQ : RUU),
-		      stream, /* !header */FALSE);
-	}
+      for (ev = eventq_wheel[(eventq_base_idx + i) & (EVENTQ_WHEEL_SIZE-1)];
+	   ev != NULL;
+	   ev = ev->next)
+	eventq_dumpent(ev, stream);
     }
+
+  /* dump the overflow heap, in heap order */
+  for (i=0; i<eventq_ovfl_num; i++)
+    eventq_dumpent(eventq_ovfl[i].ev, stream);
 }
 
-/* insert an event for RS into the event queue, event queue is sorted from
-   earliest to latest event, event and associated side-effects will be
-   apparent at the start of cycle WHEN */
+/* insert event record EV into the overflow heap */
 static void
-eventq_queue_event(struct RUU_station *rs, tick_t when)
+eventq_ovfl_insert(struct RS_link *ev)		/* event record to insert */
 {
-  struct RS_link *prev, *ev, *new_ev;
-
-  if (rs->completed)
-    panic("event completed");
-
-  if (when <= sim_cycle)
-    panic("event occurred in the past");
-
-  /* get a free event record */
-  RSLINK_NEW(new_ev, rs);
-  new_ev->x.when = when;
+  int i, parent;
+  struct eventq_ovfl_ent ent;
 
-  /* locate insertion point */
-  for (prev=NULL, ev=event_queue;
-       ev && ev->x.when < when;
-       prev=ev, ev=ev->next);
-
-  if (prev)
+  /* grow the heap, if needed */
+  if (eventq_ovfl_num == eventq_ovfl_size)
     {
-      /* insert middle or end */
-      new_ev->next = prev->next;
-      prev->next = new_ev;
+      eventq_ovfl_size = eventq_ovfl_size ? 2 * eventq_ovfl_size : 64;
+      eventq_ovfl =
+	realloc(eventq_ovfl,
+		eventq_ovfl_size * sizeof(struct eventq_ovfl_ent));
+      if (!eventq_ovfl)
+	fatal("out of virtual memory");
     }
-  else
+
+  ent.when = ev->x.when;
+  ent.seq = eventq_ovfl_seq++;
+  ent.ev = ev;
+
+  /* sift the new entry up from the bottom of the heap */
+  for (i=eventq_ovfl_num++; i > 0; i=parent)
     {
-      /* insert at beginning */
-      new_ev->next = event_queue;
-      event_queue = new_ev;
+      parent = (i - 1) / 2;
+      if (!EVENTQ_OVFL_LESS(&ent, &eventq_ovfl[parent]))
+	break;
+      eventq_ovfl[i] = eventq_ovfl[parent];
     }
+  eventq_ovfl[i] = ent;
 }
 
-/* return the next event that has already occurred, returns NULL when no
-   remaining events or all remaining events are in the future */
-static struct RUU_station *
-eventq_next_event(void)
+/* remove and return the soonest event record in the overflow heap */
+static struct RS_link *
+eventq_ovfl_remove(void)
 {
+  int i, child;
   struct RS_link *ev;
+  struct eventq_ovfl_ent last;
 
-  if (event_queue && event_queue->x.when <= sim_cycle)
-    {
-      /* unlink and return first event on priority list */
-      ev = event_queue;
-      event_queue = event_queue->next;
+  if (!eventq_ovfl_num)
+    panic("overflow event heap is empty");
+
+  ev = eventq_ovfl[0].ev;
+  last = eventq_ovfl[--eventq_ovfl_num];
+
+  /* sift the last entry down from the top of the heap */
+  for (i=0; (child = 2 * i + 1) < eventq_ovfl_num; i=child)
+    {
+      if (child + 1 < eventq_ovfl_num
+	  && EVENTQ_OVFL_LESS(&eventq_ovfl[child + 1], &eventq_ovfl[child]))
+	child++;
+      if (!EVENTQ_OVFL_LESS(&eventq_ovfl[child], &last))
+	break;
+      eventq_ovfl[i] = eventq_ovfl[child];
+    }
+  if (eventq_ovfl_num)
+    eventq_ovfl[i] = last;
+
+  return ev;
+}
+
+/* move all overflow events that now fit on the timing wheel onto the wheel,
+   events are moved in queue order, so the wheel buckets retain the same
+   order the events would have had if they had been queued on the wheel */
+static void
+eventq_ovfl_drain(void)
+{
+  struct RS_link *ev;
+  int bucket;
+
+  while (eventq_ovfl_num && EVENTQ_ON_WHEEL(eventq_ovfl[0].when))
+    {
+      ev = eventq_ovfl_remove();
+      bucket = EVENTQ_BUCKET(ev->x.when);
+      ev->next = eventq_wheel[bucket];
+      eventq_wheel[bucket] = ev;
+      eventq_wheel_num++;
+    }
+}
+
+/* advance the timing wheel base to cycle WHEN, WHEN must not precede any
+   event still held on the wheel */
+static void
+eventq_advance(tick_t when)			/* new wheel base */
+{
+  if (!eventq_wheel_num)
+    {
+      /* wheel is empty, jump directly to the new base */
+      eventq_base_idx = EVENTQ_BUCKET(when);
+      eventq_base = when;
+    }
+  else
+    {
+      while (eventq_base < when)
+	{
+	  if (eventq_wheel[eventq_base_idx])
+	    panic("timing wheel advanced past pending events");
+	  eventq_base_idx = (eventq_base_idx + 1) & (EVENTQ_WHEEL_SIZE-1);
+	  eventq_base++;
+	}
+    }
+
+  /* newly uncovered wheel slots may receive overflow events */
+  eventq_ovfl_drain();
+}
+
+/* insert an event for RS into the event queue, event queue is sorted from
+   earliest to latest event, event and associated side-effects will be
+   apparent at the start of cycle WHEN */
+static void
+eventq_queue_event(struct RUU_station *rs, tick_t when)
+{
+  struct RS_link *new_ev;
+  int bucket;
+
+  if (rs->completed)
+    panic("event completed");
+
+  if (when <= sim_cycle)
+    panic("event occurred in the past");
+
+  /* get a free event record */
+  RSLINK_NEW(new_ev, rs);
+  new_ev->x.when = when;
+
+  if (EVENTQ_ON_WHEEL(when))
+    {
+      /* insert at the beginning of the event's wheel bucket */
+      bucket = EVENTQ_BUCKET(when);
+      new_ev->next = eventq_wheel[bucket];
+      eventq_wheel[bucket] = new_ev;
+      eventq_wheel_num++;
+    }
+  else
+    {
+      /* too far in the future, hold in the overflow heap */
+      eventq_ovfl_insert(new_ev);
+    }
+}
+
+/* return the next event that has already occurred, returns NULL when no
+   remaining events or all remaining events are in the future */
+static struct RUU_station *
+eventq_next_event(void)
+{
+  struct RS_link *ev;
+
+  for (;;)
+    {
+      /* bring the wheel up to the current cycle */
+      if (eventq_base < sim_cycle)
+	{
+	  if (eventq_wheel_num && eventq_wheel[eventq_base_idx])
+	    {
+	      /* service remaining events at the wheel base first */;
+	    }
+	  else if (eventq_wheel_num)
+	    {
+	      /* step the wheel to the next cycle */
+	      eventq_advance(eventq_base + 1);
+	      continue;
+	    }
+	  else
+	    {
+	      /* wheel is empty, jump to now (or the soonest overflow event) */
+	      eventq_advance((eventq_ovfl_num && eventq_ovfl[0].when < sim_cycle)
+			     ? eventq_ovfl[0].when : sim_cycle);
+	      continue;
+	    }
+	}
+
+      /* no event at the wheel base? */
+      if (!eventq_wheel[eventq_base_idx])
+	return NULL;
+
+      /* unlink and return first event in the wheel base bucket */
+      ev = eventq_wheel[eventq_base_idx];
+      eventq_wheel[eventq_base_idx] = ev->next;
+      eventq_wheel_num--;
 
       /* event still valid? */
       if (RSLINK_VALID(ev))
@@ -1908,20 +2944,35 @@ eventq_next_event(void)
 	  /* event is valid, return resv station */
 	  return rs;
 	}
-      else
-	{
-	  /* reclaim event record */
-	  RSLINK_FREE(ev);
 
-	  /* receiving inst was squashed, return next event */
-	  return eventq_next_event();
-	}
+      /* receiving inst was squashed, reclaim event record and continue */
+      RSLINK_FREE(ev);
     }
-  else
+}
+
+/* return the time of the soonest event in the event queue, or zero if the
+   event queue is empty, NOTE: the event may belong to a squashed instruction */
+static tick_t
+eventq_next_time(void)
+{
+  int i;
+
+  /* wheel events precede all overflow events */
+  if (eventq_wheel_num)
     {
-      /* no event or no event is ready */
-      return NULL;
+      for (i=0; i<EVENTQ_WHEEL_SIZE; i++)
+	{
+	  if (eventq_wheel[(eventq_base_idx + i) & (EVENTQ_WHEEL_SIZE-1)])
+	    return eventq_base + i;
+	}
+      panic("timing wheel event count is broken");
     }
+
+  if (eventq_ovfl_num)
+    return eventq_ovfl[0].when;
+
+  /* no events */
+  return 0;
 }
 
 
@@ -1930,51 +2981,114 @@ eventq_next_event(void)
  * queue indicates which instruction have all of there *register* dependencies
  * satisfied, instruction will issue when 1) all memory dependencies for
  * the instruction have been satisfied (see lsq_refresh() for details on how
- * this is accomplished) and 2) resources are available; ready queue is fully
- * constructed each cycle before any operation is issued from it -- this
- * ensures that instruction issue priorities are properly observed; NOTE:
- * RS_LINK nodes are used for the event queue list so that it need not be
- * updated during squash events
+ * this is accomplished) and 2) resources are available; the ready queue is
+ * kept as a set of bitmaps indexed by RUU and LSQ slot, since both queues
+ * are in program order, selecting the oldest ready instructions is a scan
+ * for set bits starting at the queue head; NOTE: squashed instructions are
+ * removed from the ready bitmaps during recovery (see ruu_recover())
+ *
+ * unless they issue oldest first (see -issue:oldest), ready memory, long
+ * latency and control operations are kept on a stack instead, in the order
+ * of the original ready list, which pushed them on its head, and which was
+ * rebuilt every cycle, reversing the order of those that did not issue;
+ * squashed and issued operations are detected by their tags and dropped
+ * from the stack when it is rebuilt, after each issue cycle
  */
 
-/* the ready instruction queue */
-static struct RS_link *ready_queue;
+/* the ready instruction queue, one bitmap for all ready LSQ operations, one
+   for ready long latency and control operations in the RUU, and one for all
+   other ready operations in the RUU */
+static BITMAP_PTR_TYPE readyq_lsq;	/* ready LSQ ops, by LSQ slot */
+static BITMAP_PTR_TYPE readyq_prio;	/* ready priority ops, by RUU slot */
+static BITMAP_PTR_TYPE readyq_norm;	/* other ready ops, by RUU slot */
+static int readyq_num;			/* num ops in the ready queue */
+
+/* an entry of the ready stack */
+struct readyq_ent_t {
+  struct RUU_station *rs;		/* ready operation */
+  INST_TAG_TYPE tag;			/* instance tag of the operation */
+};
+
+/* the ready stack, of ready priority ops unless they issue oldest first,
+   the entry on top issues first */
+static struct readyq_ent_t *readyq_stack;
+static int readyq_stack_num;		/* num entries on the stack */
+static int readyq_stack_size;		/* max entries on the stack */
+
+/* non-zero if ready stack entry ENT is still queued */
+#define READYQ_ENT_VALID(ENT)						\
+  ((ENT)->rs->queued && (ENT)->rs->tag == (ENT)->tag)
+
+/* non-zero if RS is issued from the ready queue before other operations */
+#define READYQ_PRIO_P(RS)						\
+  ((RS)->in_LSQ || (MD_OP_FLAGS((RS)->op) & (F_LONGLAT|F_CTRL)))
+
+/* ready queue scan position, used to visit the ready queue in issue order */
+struct readyq_cursor {
+  int stack_off;			/* next ready stack entry to visit */
+  int lsq_off;				/* next LSQ offset to scan */
+  int prio_off;				/* next RUU offset to scan (prio ops) */
+  int norm_off;				/* next RUU offset to scan (other ops) */
+};
 
-/* initialize the event queue structures */
+/* initialize the ready queue structures */
 static void
 readyq_init(void)
 {
-  ready_queue = NULL;
+  readyq_lsq = qbitmap_create(LSQ_size);
+  readyq_prio = qbitmap_create(RUU_size);
+  readyq_norm = qbitmap_create(RUU_size);
+  readyq_num = 0;
+
+  /* the stack holds at most one live entry per RUU and LSQ slot, and one
+     stale entry per slot squashed since the last issue cycle */
+  readyq_stack_size = 2 * (RUU_size + LSQ_size);
+  readyq_stack = (struct readyq_ent_t *)
+    calloc(readyq_stack_size, sizeof(struct readyq_ent_t));
+  if (!readyq_stack)
+    fatal("out of virtual memory");
+  readyq_stack_num = 0;
 }
 
 /* dump the contents of the ready queue */
 static void
 readyq_dump(FILE *stream)			/* output stream */
 {
-  struct RS_link *link;
+  int i;
+  struct RUU_station *rs;
 
   if (!stream)
     stream = stderr;
 
   fprintf(stream, "** ready queue state **\n");
 
-  for (link = ready_queue; link != NULL; link = link->next)
+  for (i=readyq_stack_num-1; i >= 0; i--)
     {
-      /* is entry still valid? */
-      if (RSLINK_VALID(link))
-	{
-	  struct RUU_station *rs = RSLINK_RS(link);
-
-	  ruu_dumpent(rs, rs - (rs->in_LSQ ? LSQ : RUU),
-		      stream, /* header */TRUE);
-	}
+      rs = readyq_stack[i].rs;
+      if (READYQ_ENT_VALID(&readyq_stack[i]))
+	ruu_dumpent(rs, rs - (rs->in_LSQ ? LSQ : RUU),
+		    stream, /* header */TRUE);
+    }
+  for (i=0; i < LSQ_num; i++)
+    {
+      rs = &LSQ[(LSQ_head + i) % LSQ_size];
+      if (BITMAP_SET_P(readyq_lsq, BITMAP_SIZE(LSQ_size), rs - LSQ))
+	ruu_dumpent(rs, rs - LSQ, stream, /* header */TRUE);
+    }
+  for (i=0; i < RUU_num; i++)
+    {
+      rs = &RUU[(RUU_head + i) % RUU_size];
+      if (BITMAP_SET_P(readyq_prio, BITMAP_SIZE(RUU_size), rs - RUU)
+	  || BITMAP_SET_P(readyq_norm, BITMAP_SIZE(RUU_size), rs - RUU))
+	ruu_dumpent(rs, rs - RUU, stream, /* header */TRUE);
     }
 }
 
 /* insert ready node into the ready list using ready instruction scheduling
    policy; currently the following scheduling policy is enforced:
 
-     memory and long latency operands, and branch instructions first
+     memory and long latency operands, and branch instructions first,
+     the last one queued first (or oldest first, with -issue:oldest)
 
    then
 
@@ -1987,44 +3101,135 @@ readyq_dump(FILE *stream)			/* output stream */
 static void
 readyq_enqueue(struct RUU_station *rs)		/* RS to enqueue */
 {
-  struct RS_link *prev, *node, *new_node;
-
   /* node is now queued */
   if (rs->queued)
     panic("node is already queued");
   rs->queued = TRUE;
+  readyq_num++;
 
-  /* get a free ready list node */
-  RSLINK_NEW(new_node, rs);
-  new_node->x.seq = rs->seq;
-
-  /* locate insertion point */
-  if (rs->in_LSQ || MD_OP_FLAGS(rs->op) & (F_LONGLAT|F_CTRL))
+  /* push priority ops on the ready stack, or mark the instruction's slot as
+     ready, issue order is then implied by slot */
+  if (!ruu_oldest_issue && READYQ_PRIO_P(rs))
     {
-      /* insert loads/stores and long latency ops at the head of the queue */
-      prev = NULL;
-      node = ready_queue;
+      if (readyq_stack_num == readyq_stack_size)
+	panic("ready stack overflow");
+      readyq_stack[readyq_stack_num].rs = rs;
+      readyq_stack[readyq_stack_num].tag = rs->tag;
+      readyq_stack_num++;
     }
+  else if (rs->in_LSQ)
+    (void)BITMAP_SET(readyq_lsq, BITMAP_SIZE(LSQ_size), rs - LSQ);
+  else if (READYQ_PRIO_P(rs))
+    (void)BITMAP_SET(readyq_prio, BITMAP_SIZE(RUU_size), rs - RUU);
   else
+    (void)BITMAP_SET(readyq_norm, BITMAP_SIZE(RUU_size), rs - RUU);
+}
+
+/* remove RS from the ready queue, after it issues or is squashed */
+static void
+readyq_remove(struct RUU_station *rs)		/* RS to dequeue */
+{
+  if (!rs->queued)
+    panic("node is not queued");
+  rs->queued = FALSE;
+  readyq_num--;
+
+  /* ready stack entries are dropped when the stack is rebuilt */
+  if (!ruu_oldest_issue && READYQ_PRIO_P(rs))
+    return;
+  else if (rs->in_LSQ)
+    (void)BITMAP_CLEAR(readyq_lsq, BITMAP_SIZE(LSQ_size), rs - LSQ);
+  else if (READYQ_PRIO_P(rs))
+    (void)BITMAP_CLEAR(readyq_prio, BITMAP_SIZE(RUU_size), rs - RUU);
+  else
+    (void)BITMAP_CLEAR(readyq_norm, BITMAP_SIZE(RUU_size), rs - RUU);
+}
+
+/* start a visit of the ready queue, in issue order */
+static void
+readyq_start(struct readyq_cursor *cur)		/* cursor to initialize */
+{
+  cur->stack_off = readyq_stack_num - 1;
+  cur->lsq_off = cur->prio_off = cur->norm_off = 0;
+}
+
+/* rebuild the ready stack after an issue cycle, the entries of operations
+   that issued or were squashed are dropped, and the order of the others is
+   reversed, as the original ready list was pushed again in the order it was
+   visited */
+static void
+readyq_rebuild(void)
+{
+  int i, n;
+  struct readyq_ent_t ent;
+
+  for (i=0, n=0; i < readyq_stack_num; i++)
+    {
+      if (READYQ_ENT_VALID(&readyq_stack[i]))
+	readyq_stack[n++] = readyq_stack[i];
+    }
+  readyq_stack_num = n;
+
+  for (i=0; i < n/2; i++)
     {
-      /* otherwise insert in program order (earliest seq first) */
-      for (prev=NULL, node=ready_queue;
-	   node && node->x.seq < rs->seq;
-	   prev=node, node=node->next);
+      ent = readyq_stack[i];
+      readyq_stack[i] = readyq_stack[n-1-i];
+      readyq_stack[n-1-i] = ent;
     }
+}
+
+/* return the next ready instruction in issue order, i.e., the next
+   remaining memory, long latency, or control operation on the ready stack,
+   or the oldest with -issue:oldest, then the oldest remaining other
+   operation, returns NULL when all have been visited */
+static struct RUU_station *
+readyq_next(struct readyq_cursor *cur)		/* ready queue cursor */
+{
+  struct RUU_station *lsq_rs = NULL, *prio_rs = NULL;
 
-  if (prev)
+  /* priority operations go first, from the top of the ready stack */
+  for (; cur->stack_off >= 0; cur->stack_off--)
     {
-      /* insert middle or end */
-      new_node->next = prev->next;
-      prev->next = new_node;
+      if (READYQ_ENT_VALID(&readyq_stack[cur->stack_off]))
+	return readyq_stack[cur->stack_off--].rs;
     }
+
+  /* locate the oldest remaining priority operation in the LSQ and RUU */
+  cur->lsq_off =
+    qbitmap_scan(readyq_lsq, LSQ_size, LSQ_head, cur->lsq_off, LSQ_num);
+  if (cur->lsq_off >= 0)
+    lsq_rs = &LSQ[(LSQ_head + cur->lsq_off) % LSQ_size];
+  else
+    cur->lsq_off = LSQ_num;
+
+  cur->prio_off =
+    qbitmap_scan(readyq_prio, RUU_size, RUU_head, cur->prio_off, RUU_num);
+  if (cur->prio_off >= 0)
+    prio_rs = &RUU[(RUU_head + cur->prio_off) % RUU_size];
   else
+    cur->prio_off = RUU_num;
+
+  /* priority operations go first, oldest (by sequence) first */
+  if (lsq_rs && (!prio_rs || (int)(lsq_rs->seq - prio_rs->seq) < 0))
+    {
+      cur->lsq_off++;
+      return lsq_rs;
+    }
+  else if (prio_rs)
     {
-      /* insert at beginning */
-      new_node->next = ready_queue;
-      ready_queue = new_node;
+      cur->prio_off++;
+      return prio_rs;
     }
+
+  /* then all other operations, oldest first */
+  cur->norm_off =
+    qbitmap_scan(readyq_norm, RUU_size, RUU_head, cur->norm_off, RUU_num);
+  if (cur->norm_off >= 0)
+    return &RUU[(RUU_head + cur->norm_off++) % RUU_size];
+
+  /* ready queue exhausted */
+  cur->norm_off = RUU_num;
+  return NULL;
 }
 
 
@@ -2212,6 +3417,7 @@ ruu_commit(void)
 
 	  /* invalidate load/store operation instance */
 	  LSQ[LSQ_head].tag++;
+	  lsq_disamb_remove(&LSQ[LSQ_head]);
           sim_slip += (sim_cycle - LSQ[LSQ_head].slip);
    
 	  /* indicate to pipeline trace that this instruction retired */
@@ -2320,8 +3526,12 @@ ruu_recover(int branch_index)			/* index of mis-pred branch */
 	      LSQ[LSQ_index].odep_list[i] = NULL;
 	    }
       
-	  /* squash this LSQ entry */
+	  /* squash this LSQ entry, and drop it from the ready queue and the
+	     memory disambiguation state */
 	  LSQ[LSQ_index].tag++;
+	  if (LSQ[LSQ_index].queued)
+	    readyq_remove(&LSQ[LSQ_index]);
+	  lsq_disamb_remove(&LSQ[LSQ_index]);
 
 	  /* indicate in pipetrace that this instruction was squashed */
 	  ptrace_endinst(LSQ[LSQ_index].ptrace_seq);
@@ -2340,8 +3550,10 @@ ruu_recover(int branch_index)			/* index of mis-pred branch */
 	  RUU[RUU_index].odep_list[i] = NULL;
 	}
       
-      /* squash this RUU entry */
+      /* squash this RUU entry, and drop it from the ready queue */
       RUU[RUU_index].tag++;
+      if (RUU[RUU_index].queued)
+	readyq_remove(&RUU[RUU_index]);
 
       /* indicate in pipetrace that this instruction was squashed */
       ptrace_endinst(RUU[RUU_index].ptrace_seq);
@@ -2485,6 +3697,10 @@ ruu_writeback(void)
 		      /* input is now ready */
 		      olink->rs->idep_ready[olink->x.opnum] = TRUE;
 
+		      /* a memory operation's address may now be known */
+		      if (olink->rs->in_LSQ)
+			lsq_disamb_ready(olink->rs, olink->x.opnum);
+
 		      /* are all the register operands of target ready? */
 		      if (OPERANDS_READY(olink->rs))
 			{
@@ -2522,76 +3738,40 @@ ruu_writeback(void)
  */
 
 /* this function locates ready instructions whose memory dependencies have
-   been satisfied, this is accomplished by walking the LSQ for loads, looking
-   for blocking memory dependency condition (e.g., earlier store with an
-   unknown address) */
-#define MAX_STD_UNKNOWNS		64
+   been satisfied, only loads whose register operands are ready (see
+   lsq_disamb_ready()) are visited, from the oldest load up to the first
+   blocking memory dependency condition (e.g., earlier store with an unknown
+   address) */
 static void
 lsq_refresh(void)
 {
-  int i, j, index, n_std_unknowns;
-  md_addr_t std_unknowns[MAX_STD_UNKNOWNS];
-
-  /* scan entire queue for ready loads: scan from oldest instruction
-     (head) until we reach the tail or an unresolved store, after which no
-     other instruction will become ready */
-  for (i=0, index=LSQ_head, n_std_unknowns=0;
-       i < LSQ_num;
-       i++, index=(index + 1) % LSQ_size)
-    {
-      /* terminate search for ready loads after first unresolved store,
-	 as no later load could be resolved in its presence */
-      if (/* store? */
-	  (MD_OP_FLAGS(LSQ[index].op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE))
-	{
-	  if (!STORE_ADDR_READY(&LSQ[index]))
-	    {
-	      /* FIXME: a later STD + STD known could hide the STA unknown */
-	      /* sta unknown, blocks all later loads, stop search */
-	      break;
-	    }
-	  else if (!OPERANDS_READY(&LSQ[index]))
-	    {
-	      /* sta known, but std unknown, may block a later store, record
-		 this address for later referral, we use an array here because
-		 for most simulations the number of entries to search will be
-		 very small */
-	      if (n_std_unknowns == MAX_STD_UNKNOWNS)
-		fatal("STD unknown array overflow, increase MAX_STD_UNKNOWNS");
-	      std_unknowns[n_std_unknowns++] = LSQ[index].addr;
-	    }
-	  else /* STORE_ADDR_READY() && OPERANDS_READY() */
-	    {
-	      /* a later STD known hides an earlier STD unknown */
-	      for (j=0; j<n_std_unknowns; j++)
-		{
-		  if (std_unknowns[j] == /* STA/STD known */LSQ[index].addr)
-		    std_unknowns[j] = /* bogus addr */0;
-		}
-	    }
-	}
-
-      if (/* load? */
-	  ((MD_OP_FLAGS(LSQ[index].op) & (F_MEM|F_LOAD)) == (F_MEM|F_LOAD))
-	  && /* queued? */!LSQ[index].queued
-	  && /* waiting? */!LSQ[index].issued
-	  && /* completed? */!LSQ[index].completed
-	  && /* regs ready? */OPERANDS_READY(&LSQ[index]))
-	{
-	  /* no STA unknown conflict (because we got to this check), check for
-	     a STD unknown conflict */
-	  for (j=0; j<n_std_unknowns; j++)
-	    {
-	      /* found a relevant STD unknown? */
-	      if (std_unknowns[j] == LSQ[index].addr)
-		break;
-	    }
-	  if (j == n_std_unknowns)
-	    {
-	      /* no STA or STD unknown conflicts, put load on ready queue */
-	      readyq_enqueue(&LSQ[index]);
-	    }
-	}
+  int off, limit;
+  struct RUU_station *rs, *st;
+
+  /* an unresolved store blocks all later loads, so stop the search for
+     ready loads at the oldest store with an unknown address */
+  /* FIXME: a later STD + STD known could hide the STA unknown */
+  limit = qbitmap_scan(lsq_sta_unknown, LSQ_size, LSQ_head, 0, LSQ_num);
+  if (limit < 0)
+    limit = LSQ_num;
+
+  for (off = 0;
+       (off = qbitmap_scan(lsq_ld_waiting, LSQ_size, LSQ_head, off, limit)) >= 0;
+       off++)
+    {
+      rs = &LSQ[(LSQ_head + off) % LSQ_size];
+
+      /* no STA unknown conflict (because all earlier store addresses are
+	 known), check for a STD unknown conflict, the load waits for the
+	 value of the nearest earlier store it overlaps, which hides any
+	 other earlier STD unknown */
+      st = lsq_store_lookup(rs);
+      if (st && !OPERANDS_READY(st))
+	continue;
+
+      /* no STA or STD unknown conflicts, put load on ready queue */
+      (void)BITMAP_CLEAR(lsq_ld_waiting, BITMAP_SIZE(LSQ_size), rs - LSQ);
+      readyq_enqueue(rs);
     }
 }
 
@@ -2610,240 +3790,202 @@ lsq_refresh(void)
 static void
 ruu_issue(void)
 {
-  int i, load_lat, tlb_lat, n_issued;
-  struct RS_link *node, *next_node;
+  int load_lat, tlb_lat, n_issued;
+  struct RUU_station *rs, *st;
+  struct readyq_cursor cur;
   struct res_template *fu;
 
-  /* FIXME: could be a little more efficient when scanning the ready queue */
-
-  /* copy and then blow away the ready list, NOTE: the ready list is
-     always totally reclaimed each cycle, and instructions that are not
-     issue are explicitly reinserted into the ready instruction queue,
-     this management strategy ensures that the ready instruction queue
-     is always properly sorted */
-  node = ready_queue;
-  ready_queue = NULL;
-
   /* visit all ready instructions (i.e., insts whose register input
-     dependencies have been satisfied, stop issue when no more instructions
-     are available or issue bandwidth is exhausted */
+     dependencies have been satisfied) in issue priority order, stop issue
+     when no more instructions are available or issue bandwidth is exhausted,
+     NOTE: instructions that do not issue simply remain on the ready queue */
+  readyq_start(&cur);
   for (n_issued=0;
-       node && n_issued < ruu_issue_width;
-       node = next_node)
+       n_issued < ruu_issue_width && (rs = readyq_next(&cur)) != NULL;
+       /* n_issued incremented on issue */)
     {
-      next_node = node->next;
+      /* issue operation, both reg and mem deps have been satisfied */
+      if (!OPERANDS_READY(rs) || !rs->queued
+	  || rs->issued || rs->completed)
+	panic("issued inst !ready, issued, or completed");
+
+      /* for loads, find the nearest earlier store the load overlaps, once
+	 per issue attempt, both the MSHR check and the store forward at
+	 issue use it */
+      if (rs->in_LSQ
+	  && ((MD_OP_FLAGS(rs->op) & (F_MEM|F_LOAD)) == (F_MEM|F_LOAD)))
+	st = lsq_store_lookup(rs);
+      else
+	st = NULL;
 
-      /* still valid? */
-      if (RSLINK_VALID(node))
+      if (rs->in_LSQ
+	  && ((MD_OP_FLAGS(rs->op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE)))
 	{
-	  struct RUU_station *rs = RSLINK_RS(node);
-
-	  /* issue operation, both reg and mem deps have been satisfied */
-	  if (!OPERANDS_READY(rs) || !rs->queued
-	      || rs->issued || rs->completed)
-	    panic("issued inst !ready, issued, or completed");
-
-	  /* node is now un-queued */
-	  rs->queued = FALSE;
-
-	  if (rs->in_LSQ
-	      && ((MD_OP_FLAGS(rs->op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE)))
+	  /* stores complete in effectively zero time, result is
+	     written into the load/store queue, the actual store into
+	     the memory system occurs when the instruction is retired
+	     (see ruu_commit()) */
+	  readyq_remove(rs);
+	  rs->issued = TRUE;
+	  rs->completed = TRUE;
+	  if (rs->onames[0] || rs->onames[1])
+	    panic("store creates result");
+
+	  if (rs->recover_inst)
+	    panic("mis-predicted store");
+
+	  /* entered execute stage, indicate in pipe trace */
+	  ptrace_newstage(rs->ptrace_seq, PST_WRITEBACK, 0);
+
+	  /* one more inst issued */
+	  n_issued++;
+	}
+      else if (cache_dl1_mshrs && cache_dl1
+	       && rs->in_LSQ
+	       && ((MD_OP_FLAGS(rs->op) & (F_MEM|F_LOAD)) == (F_MEM|F_LOAD))
+	       && MD_VALID_ADDR(rs->addr)
+	       && !lsq_store_forward_p(st, rs)
+	       && !cache_mshr_avail(cache_dl1, (rs->addr & ~3), sim_cycle))
+	{
+	  /* the load misses in the data cache, but there is no MSHR (or
+	     MSHR target) for it, leave the load on the ready list, we'll
+	     try to issue it again next cycle */
+	  LSQ_mshr_stalls++;
+	}
+      else
+	{
+	  /* issue the instruction to a functional unit */
+	  if (MD_OP_FUCLASS(rs->op) != NA)
 	    {
-	      /* stores complete in effectively zero time, result is
-		 written into the load/store queue, the actual store into
-		 the memory system occurs when the instruction is retired
-		 (see ruu_commit()) */
-	      rs->issued = TRUE;
-	      rs->completed = TRUE;
-	      if (rs->onames[0] || rs->onames[1])
-		panic("store creates result");
-
-	      if (rs->recover_inst)
-		panic("mis-predicted store");
+	      fu = res_get(fu_pool, MD_OP_FUCLASS(rs->op));
+	      if (fu)
+		{
+		  /* got one! issue inst to functional unit */
+		  readyq_remove(rs);
+		  rs->issued = TRUE;
+		  /* reserve the functional unit */
+		  if (fu->master->busy)
+		    panic("functional unit already in use");
 
-	      /* entered execute stage, indicate in pipe trace */
-	      ptrace_newstage(rs->ptrace_seq, PST_WRITEBACK, 0);
+		  /* schedule functional unit release event */
+		  fu->master->busy = fu->issuelat;
 
-	      /* one more inst issued */
-	      n_issued++;
-	    }
-	  else
-	    {
-	      /* issue the instruction to a functional unit */
-	      if (MD_OP_FUCLASS(rs->op) != NA)
-		{
-		  fu = res_get(fu_pool, MD_OP_FUCLASS(rs->op));
-		  if (fu)
+		  /* schedule a result writeback event */
+		  if (rs->in_LSQ
+		      && ((MD_OP_FLAGS(rs->op) & (F_MEM|F_LOAD))
+			  == (F_MEM|F_LOAD)))
 		    {
-		      /* got one! issue inst to functional unit */
-		      rs->issued = TRUE;
-		      /* reserve the functional unit */
-		      if (fu->master->busy)
-			panic("functional unit already in use");
-
-		      /* schedule functional unit release event */
-		      fu->master->busy = fu->issuelat;
-
-		      /* schedule a result writeback event */
-		      if (rs->in_LSQ
-			  && ((MD_OP_FLAGS(rs->op) & (F_MEM|F_LOAD))
-			      == (F_MEM|F_LOAD)))
+		      int events = 0;
+
+		      /* for loads, determine cache access latency:
+			 first check the LSQ store index to see if a store
+			 forward is possible, if not, access the data cache */
+		      load_lat = 0;
+		      if (lsq_store_forward_p(st, rs))
 			{
-			  int events = 0;
-
-			  /* for loads, determine cache access latency:
-			     first scan LSQ to see if a store forward is
-			     possible, if not, access the data cache */
-			  load_lat = 0;
-			  i = (rs - LSQ);
-			  if (i != LSQ_head)
-			    {
-			      for (;;)
-				{
-				  /* go to next earlier LSQ entry */
-				  i = (i + (LSQ_size-1)) % LSQ_size;
-
-				  /* FIXME: not dealing with partials! */
-				  if ((MD_OP_FLAGS(LSQ[i].op) & F_STORE)
-				      && (LSQ[i].addr == rs->addr))
-				    {
-				      /* hit in the LSQ */
-				      load_lat = 1;
-				      break;
-				    }
-
-				  /* scan finished? */
-				  if (i == LSQ_head)
-				    break;
-				}
-			    }
+			  /* hit in the LSQ */
+			  load_lat = 1;
+			  LSQ_fwd_loads++;
+			}
+		      else if (st)
+			{
+			  /* the nearest earlier store supplies only part of
+			     the load, the load reads the data cache */
+			  LSQ_partial_loads++;
+			}
 
-			  /* was the value store forwared from the LSQ? */
-			  if (!load_lat)
+		      /* was the value store forwared from the LSQ? */
+		      if (!load_lat)
+			{
+			  int valid_addr = MD_VALID_ADDR(rs->addr);
+
+			  if (!spec_mode && !valid_addr)
+			    sim_invalid_addrs++;
+
+			  /* no! go to the data cache if addr is valid */
+			  if (cache_dl1 && valid_addr)
 			    {
-			      int valid_addr = MD_VALID_ADDR(rs->addr);
-
-			      if (!spec_mode && !valid_addr)
-				sim_invalid_addrs++;
-
-			      /* no! go to the data cache if addr is valid */
-			      if (cache_dl1 && valid_addr)
-				{
-				  /* access the cache if non-faulting */
-				  load_lat =
-				    cache_access(cache_dl1, Read,
-						 (rs->addr & ~3), NULL, 4,
-						 sim_cycle, NULL, NULL);
-				  if (load_lat > cache_dl1_lat)
-				    events |= PEV_CACHEMISS;
-				}
-			      else
-				{
-				  /* no caches defined, just use op latency */
-				  load_lat = fu->oplat;
-				}
+			      /* access the cache if non-faulting */
+			      load_lat =
+				cache_access(cache_dl1, Read,
+					     (rs->addr & ~3), NULL, 4,
+					     sim_cycle, NULL, NULL);
+			      if (load_lat > cache_dl1_lat)
+				events |= PEV_CACHEMISS;
 			    }
-
-			  /* all loads and stores must to access D-TLB */
-			  if (dtlb && MD_VALID_ADDR(rs->addr))
+			  else
 			    {
-			      /* access the D-DLB, NOTE: this code will
-				 initiate speculative TLB misses */
-			      tlb_lat =
-				cache_access(dtlb, Read, (rs->addr & ~3),
-					     NULL, 4, sim_cycle, NULL, NULL);
-			      if (tlb_lat > 1)
-				events |= PEV_TLBMISS;
-
-			      /* D-cache/D-TLB accesses occur in parallel */
-			      load_lat = MAX(tlb_lat, load_lat);
+			      /* no caches defined, just use op latency */
+			      load_lat = fu->oplat;
 			    }
-
-			  /* use computed cache access latency */
-			  eventq_queue_event(rs, sim_cycle + load_lat);
-
-			  /* entered execute stage, indicate in pipe trace */
-			  ptrace_newstage(rs->ptrace_seq, PST_EXECUTE,
-					  ((rs->ea_comp ? PEV_AGEN : 0)
-					   | events));
 			}
-		      else /* !load && !store */
-			{
-			  /* use deterministic functional unit latency */
-			  eventq_queue_event(rs, sim_cycle + fu->oplat);
 
-			  /* entered execute stage, indicate in pipe trace */
-			  ptrace_newstage(rs->ptrace_seq, PST_EXECUTE, 
-					  rs->ea_comp ? PEV_AGEN : 0);
+		      /* all loads and stores must to access D-TLB */
+		      if (dtlb && MD_VALID_ADDR(rs->addr))
+			{
+			  /* access the D-DLB, NOTE: this code will
+			     initiate speculative TLB misses */
+			  tlb_lat =
+			    cache_access(dtlb, Read, (rs->addr & ~3),
+					 NULL, 4, sim_cycle, NULL, NULL);
+			  if (tlb_lat > 1)
+			    events |= PEV_TLBMISS;
+
+			  /* D-cache/D-TLB accesses occur in parallel */
+			  load_lat = MAX(tlb_lat, load_lat);
 			}
 
-		      /* one more inst issued */
-		      n_issued++;
+		      /* use computed cache access latency */
+		      eventq_queue_event(rs, sim_cycle + load_lat);
+
+		      /* entered execute stage, indicate in pipe trace */
+		      ptrace_newstage(rs->ptrace_seq, PST_EXECUTE,
+				      ((rs->ea_comp ? PEV_AGEN : 0)
+				       | events));
 		    }
-		  else /* no functional unit */
+		  else /* !load && !store */
 		    {
-		      /* insufficient functional unit resources, put operation
-			 back onto the ready list, we'll try to issue it
-			 again next cycle */
-		      readyq_enqueue(rs);
-		    }
-		}
-	      else /* does not require a functional unit! */
-		{
-		  /* FIXME: need better solution for these */
-		  /* the instruction does not need a functional unit */
-		  rs->issued = TRUE;
-
-		  /* schedule a result event */
-		  eventq_queue_event(rs, sim_cycle + 1);
+		      /* use deterministic functional unit latency */
+		      eventq_queue_event(rs, sim_cycle + fu->oplat);
 
-		  /* entered execute stage, indicate in pipe trace */
-		  ptrace_newstage(rs->ptrace_seq, PST_EXECUTE,
-				  rs->ea_comp ? PEV_AGEN : 0);
+		      /* entered execute stage, indicate in pipe trace */
+		      ptrace_newstage(rs->ptrace_seq, PST_EXECUTE, 
+				      rs->ea_comp ? PEV_AGEN : 0);
+		    }
 
 		  /* one more inst issued */
 		  n_issued++;
 		}
-	    } /* !store */
-
-	}
-      /* else, RUU entry was squashed */
-
-      /* reclaim ready list entry, NOTE: this is done whether or not the
-         instruction issued, since the instruction was once again reinserted
-         into the ready queue if it did not issue, this ensures that the ready
-         queue is always properly sorted */
-      RSLINK_FREE(node);
-    }
-
-  /* put any instruction not issued back into the ready queue, go through
-     normal channels to ensure instruction stay ordered correctly */
-  for (; node; node = next_node)
-    {
-      next_node = node->next;
-
-      /* still valid? */
-      if (RSLINK_VALID(node))
-        {
-	  struct RUU_station *rs = RSLINK_RS(node);
+	      else /* no functional unit */
+		{
+		  /* insufficient functional unit resources, leave operation
+		     on the ready list, we'll try to issue it again next
+		     cycle */;
+		}
+	    }
+	  else /* does not require a functional unit! */
+	    {
+	      /* FIXME: need better solution for these */
+	      /* the instruction does not need a functional unit */
+	      readyq_remove(rs);
+	      rs->issued = TRUE;
 
-          /* node is now un-queued */
-          rs->queued = FALSE;
+	      /* schedule a result event */
+	      eventq_queue_event(rs, sim_cycle + 1);
 
-	  /* not issued, put operation back onto the ready list, we'll try to
-	     issue it again next cycle */
-          readyq_enqueue(rs);
-        }
-      /* else, RUU entry was squashed */
+	      /* entered execute stage, indicate in pipe trace */
+	      ptrace_newstage(rs->ptrace_seq, PST_EXECUTE,
+			      rs->ea_comp ? PEV_AGEN : 0);
 
-      /* reclaim ready list entry, NOTE: this is done whether or not the
-         instruction issued, since the instruction was once again reinserted
-         into the ready queue if it did not issue, this ensures that the ready
-         queue is always properly sorted */
-      RSLINK_FREE(node);
+	      /* one more inst issued */
+	      n_issued++;
+	    }
+	} /* !store */
     }
-}
 
+  /* drop the priority ops that issued from the ready stack */
+  readyq_rebuild();
+}
 
 /*
  * routines for generating on-the-fly instruction traces with support
@@ -3267,7 +4409,11 @@ simoo_mem_obj(struct mem_t *mem,		/* memory space to access */
   if (spec_mode)
     spec_mem_access(mem, cmd, addr, p, nbytes);
   else
-    mem_access(mem, cmd, addr, p, nbytes);
+    {
+      if (cmd == Write)
+	decode_inval(addr, nbytes);
+      mem_access(mem, cmd, addr, p, nbytes);
+    }
 
   /* no error */
   return NULL;
@@ -3390,39 +4536,185 @@ ruu_install_odep(struct RUU_station *rs,	/* creating RUU station */
 
 
 /*
- * configure the execution engine
+ * decoded instruction cache: holds the decoding of the insts of the text
+ * segment, indexed by PC, so an inst is decoded once rather than each time
+ * it is dispatched, including each time it is refetched down a mis-predicted
+ * path; entries are filled in lazily by ruu_dispatch(), and are invalidated
+ * when the text they were decoded from is written; insts outside of the text
+ * segment (i.e., the NOPs fetched down bogus paths) are not cached
  */
 
-/* next program counter */
-#define SET_NPC(EXPR)           (regs.regs_NPC = (EXPR))
+/* a decoded instruction */
+struct decode_ent_t {
+  unsigned int gen;			/* generation decoded in, 0 = never */
+  md_inst_t inst;			/* instruction bits decoded */
+  unsigned int flags;			/* opcode flags, i.e., MD_OP_FLAGS() */
+  enum md_opcode op;			/* opcode, bogus insts become NOPs */
+  short out1, out2;			/* output register names */
+  short in1, in2, in3;			/* input register names */
+};
 
-/* target program counter */
-#undef  SET_TPC
-#define SET_TPC(EXPR)		(target_PC = (EXPR))
+/* the decoded inst cache, one entry per text segment inst, or NULL */
+static struct decode_ent_t *decode_cache = NULL;
 
-/* current program counter */
-#define CPC                     (regs.regs_PC)
-#define SET_CPC(EXPR)           (regs.regs_PC = (EXPR))
+/* current generation, entries of an older generation are invalid, so
+   bumping the generation flushes the whole cache */
+static unsigned int decode_gen = 1;
 
-/* general purpose register accessors, NOTE: speculative copy on write storage
-   provided for fast recovery during wrong path execute (see tracer_recover()
-   for details on this process */
-#define GPR(N)                  (BITMAP_SET_P(use_spec_R, R_BMAP_SZ, (N))\
-				 ? spec_regs_R[N]                       \
-				 : regs.regs_R[N])
-#define SET_GPR(N,EXPR)         (spec_mode				\
-				 ? ((spec_regs_R[N] = (EXPR)),		\
-				    BITMAP_SET(use_spec_R, R_BMAP_SZ, (N)),\
-				    spec_regs_R[N])			\
-				 : (regs.regs_R[N] = (EXPR)))
+/* allocate the decoded inst cache, the program must be loaded */
+static void
+decode_init(void)
+{
+  if (!decode_cached)
+    return;
 
-#if defined(TARGET_PISA)
+  decode_cache = (struct decode_ent_t *)
+    calloc(ld_text_size / sizeof(md_inst_t) + 1, sizeof(struct decode_ent_t));
+  if (!decode_cache)
+    fatal("out of virtual memory");
+}
 
-/* floating point register accessors, NOTE: speculative copy on write storage
-   provided for fast recovery during wrong path execute (see tracer_recover()
-   for details on this process */
-#define FPR_L(N)                (BITMAP_SET_P(use_spec_F, F_BMAP_SZ, ((N)&~1))\
-				 ? spec_regs_F.l[(N)]                   \
+/* decode instruction INST into entry ENT */
+static void
+decode_inst(md_inst_t inst,			/* instruction to decode */
+	    struct decode_ent_t *ent)		/* decoded instruction */
+{
+  enum md_opcode op;
+
+  MD_SET_OPCODE(op, inst);
+  switch (op)
+    {
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,CLASS,O1,O2,I1,I2,I3)		\
+    case OP:								\
+      /* compute output/input dependencies to out1-2 and in1-3 */	\
+      ent->out1 = O1; ent->out2 = O2;					\
+      ent->in1 = I1; ent->in2 = I2; ent->in3 = I3;			\
+      break;
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+    case OP:								\
+      /* could speculatively decode a bogus inst, convert to NOP */	\
+      op = MD_NOP_OP;							\
+      ent->out1 = NA; ent->out2 = NA;					\
+      ent->in1 = NA; ent->in2 = NA; ent->in3 = NA;			\
+      break;
+#define CONNECT(OP)	/* nada... */
+#include "machine.def"
+    default:
+      /* can speculatively decode a bogus inst, convert to a NOP */
+      op = MD_NOP_OP;
+      ent->out1 = NA; ent->out2 = NA;
+      ent->in1 = NA; ent->in2 = NA; ent->in3 = NA;
+    }
+  ent->op = op;
+  ent->flags = MD_OP_FLAGS(op);
+}
+
+/* return the decoding of instruction INST fetched from PC, SCRATCH holds
+   the decoding of insts that are not cached, i.e., insts outside the text
+   segment and insts at misaligned PCs, which ruu_fetch() turns into NOPs
+   and which must not take the entry of the aligned inst they fall in; an
+   entry is only used for the inst bits it was decoded from, as an inst
+   fetched before a store to its PC may be dispatched after the store
+   invalidated the entry */
+static INLINE struct decode_ent_t *
+decode_lookup(md_addr_t PC,			/* address of the inst */
+	      md_inst_t inst,			/* inst fetched from PC */
+	      struct decode_ent_t *scratch)	/* entry for uncached insts */
+{
+  struct decode_ent_t *ent;
+
+  if (!decode_cache
+      || PC < ld_text_base || PC >= (ld_text_base+ld_text_size)
+      || (PC & (sizeof(md_inst_t)-1)) != 0)
+    {
+      decode_inst(inst, scratch);
+      return scratch;
+    }
+
+  ent = &decode_cache[(PC - ld_text_base) / sizeof(md_inst_t)];
+  if (ent->gen != decode_gen
+      || memcmp(&ent->inst, &inst, sizeof(md_inst_t)) != 0)
+    {
+      decode_inst(inst, ent);
+      ent->inst = inst;
+      ent->gen = decode_gen;
+      decode_fills++;
+    }
+  return ent;
+}
+
+/* invalidate the decoded insts overlapping the NBYTES written at ADDR, and
+   the code the fast forwarding engine translated from them */
+static void
+decode_inval(md_addr_t addr,			/* address written */
+	     int nbytes)			/* size of the write */
+{
+  md_addr_t PC;
+
+  fastfwd_text_write(addr, nbytes);
+
+  if (!decode_cache
+      || addr >= (ld_text_base+ld_text_size) || addr + nbytes <= ld_text_base)
+    return;
+
+  for (PC = MAX(addr, ld_text_base) & ~(sizeof(md_inst_t) - 1);
+       PC < addr + nbytes && PC < (ld_text_base+ld_text_size);
+       PC += sizeof(md_inst_t))
+    decode_cache[(PC - ld_text_base) / sizeof(md_inst_t)].gen = 0;
+}
+
+/* invalidate the whole decoded inst cache */
+static void
+decode_flush(void)
+{
+  if (!decode_cache)
+    return;
+
+  if (++decode_gen == 0)
+    {
+      /* the generation wrapped around, start over */
+      memset(decode_cache, 0,
+	     (ld_text_size / sizeof(md_inst_t) + 1)
+	     * sizeof(struct decode_ent_t));
+      decode_gen = 1;
+    }
+}
+
+
+/*
+ * configure the execution engine
+ */
+
+/* next program counter */
+#define SET_NPC(EXPR)           (regs.regs_NPC = (EXPR))
+
+/* target program counter */
+#undef  SET_TPC
+#define SET_TPC(EXPR)		(target_PC = (EXPR))
+
+/* current program counter */
+#define CPC                     (regs.regs_PC)
+#define SET_CPC(EXPR)           (regs.regs_PC = (EXPR))
+
+/* general purpose register accessors, NOTE: speculative copy on write storage
+   provided for fast recovery during wrong path execute (see tracer_recover()
+   for details on this process */
+#define GPR(N)                  (BITMAP_SET_P(use_spec_R, R_BMAP_SZ, (N))\
+				 ? spec_regs_R[N]                       \
+				 : regs.regs_R[N])
+#define SET_GPR(N,EXPR)         (spec_mode				\
+				 ? ((spec_regs_R[N] = (EXPR)),		\
+				    BITMAP_SET(use_spec_R, R_BMAP_SZ, (N)),\
+				    spec_regs_R[N])			\
+				 : (regs.regs_R[N] = (EXPR)))
+
+#if defined(TARGET_PISA)
+
+/* floating point register accessors, NOTE: speculative copy on write storage
+   provided for fast recovery during wrong path execute (see tracer_recover()
+   for details on this process */
+#define FPR_L(N)                (BITMAP_SET_P(use_spec_F, F_BMAP_SZ, ((N)&~1))\
+				 ? spec_regs_F.l[(N)]                   \
 				 : regs.regs_F.l[(N)])
 #define SET_FPR_L(N,EXPR)       (spec_mode				\
 				 ? ((spec_regs_F.l[(N)] = (EXPR)),	\
@@ -3532,7 +4824,7 @@ ruu_install_odep(struct RUU_station *rs,	/* creating RUU station */
    write storage provided for fast recovery during wrong path execute (see
    tracer_recover() for details on this process */
 #define __READ_SPECMEM(SRC, SRC_V, FAULT)				\
-  (addr = (SRC),							\
+  (addr = (SRC), addr_size = sizeof(SRC_V),				\
    (spec_mode								\
     ? ((FAULT) = spec_mem_access(mem, Read, addr, &SRC_V, sizeof(SRC_V)))\
     : ((FAULT) = mem_access(mem, Read, addr, &SRC_V, sizeof(SRC_V)))),	\
@@ -3551,7 +4843,7 @@ ruu_install_odep(struct RUU_station *rs,	/* creating RUU station */
 
 
 #define __WRITE_SPECMEM(SRC, DST, DST_V, FAULT)				\
-  (DST_V = (SRC), addr = (DST),						\
+  (DST_V = (SRC), addr = (DST), addr_size = sizeof(DST_V),		\
    (spec_mode								\
     ? ((FAULT) = spec_mem_access(mem, Write, addr, &DST_V, sizeof(DST_V)))\
     : ((FAULT) = mem_access(mem, Write, addr, &DST_V, sizeof(DST_V)))))
@@ -3567,11 +4859,174 @@ ruu_install_odep(struct RUU_station *rs,	/* creating RUU station */
   __WRITE_SPECMEM(MD_SWAPQ(SRC), (DST), temp_qword, (FAULT))
 #endif /* HOST_HAS_QWORD */
 
+/* parallel sampling system call channels: while it executes a sample, the
+   simulator sends the effects of each system call, i.e., the registers and
+   memory writes that follow it, to the sample's child process, which
+   applies them in place of executing the system call a second time */
+static int sample_sys_fd = -1;		/* parent: channel to the child */
+static int sample_replay_fd = -1;	/* child: channel from the parent */
+
+/* memory writes of the current system call, a list of write headers, each
+   followed by the bytes written */
+static byte_t *sample_sys_buf = NULL;
+static int sample_sys_len = 0;
+static int sample_sys_size = 0;
+
+/* header of a memory write in SAMPLE_SYS_BUF */
+struct sample_write_t {
+  md_addr_t addr;			/* address written */
+  int nbytes;				/* bytes written */
+};
+
+/* system call effects, followed by NBYTES of memory writes */
+struct sample_syscall_t {
+  struct regs_t regs;			/* registers after the system call */
+  int set_npc;				/* system call set REGS_NPC? */
+  int nbytes;				/* size of the memory writes */
+};
+
+/* write NBYTES at P to pipe FD, returns zero if the reader has gone */
+static int
+sample_write(int fd,				/* pipe to write */
+	     void *p,				/* data to write */
+	     int nbytes)			/* bytes to write */
+{
+  char *s = p;
+  int n;
+
+  while (nbytes > 0)
+    {
+      n = write(fd, s, nbytes);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+	return FALSE;
+      s += n;
+      nbytes -= n;
+    }
+  return TRUE;
+}
+
+/* read NBYTES from pipe FD to P, returns zero if the writer has gone */
+static int
+sample_read(int fd,				/* pipe to read */
+	    void *p,				/* data read */
+	    int nbytes)				/* bytes to read */
+{
+  char *s = p;
+  int n;
+
+  while (nbytes > 0)
+    {
+      n = read(fd, s, nbytes);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+	return FALSE;
+      s += n;
+      nbytes -= n;
+    }
+  return TRUE;
+}
+
+/* system call memory access function, the writes of system calls may
+   overwrite the text of decoded insts */
+static enum md_fault_type
+syscall_access(struct mem_t *mem,		/* memory space to access */
+	       enum mem_cmd cmd,		/* memory access cmd */
+	       md_addr_t addr,			/* data address to access */
+	       void *p,				/* data input/output buffer */
+	       int nbytes)			/* number of bytes to access */
+{
+  struct sample_write_t hdr;
+
+  if (cmd == Write)
+    {
+      decode_inval(addr, nbytes);
+
+      /* log the write for the sample's child process */
+      if (sample_sys_fd >= 0)
+	{
+	  if (sample_sys_len + sizeof(hdr) + nbytes > sample_sys_size)
+	    {
+	      sample_sys_size = 2 * (sample_sys_len + sizeof(hdr) + nbytes);
+	      sample_sys_buf = realloc(sample_sys_buf, sample_sys_size);
+	      if (!sample_sys_buf)
+		fatal("out of virtual memory");
+	    }
+	  hdr.addr = addr;
+	  hdr.nbytes = nbytes;
+	  memcpy(sample_sys_buf + sample_sys_len, &hdr, sizeof(hdr));
+	  memcpy(sample_sys_buf + sample_sys_len + sizeof(hdr), p, nbytes);
+	  sample_sys_len += sizeof(hdr) + nbytes;
+	}
+    }
+  return mem_access(mem, cmd, addr, p, nbytes);
+}
+
+static void sample_child_exit(int done, counter_t n_insn, tick_t n_cycles);
+
+/* execute a system call, or in a sample's child process, replay the system
+   call executed by the parent */
+static void
+sim_syscall(md_inst_t inst)			/* system call inst */
+{
+  struct sample_syscall_t rec;
+  struct sample_write_t hdr;
+  byte_t *p;
+
+  if (sample_replay_fd >= 0)
+    {
+      /* the parent stops sending at the end of the sample, or when the
+	 program exits */
+      if (!sample_read(sample_replay_fd, &rec, sizeof(rec)))
+	sample_child_exit(/* done */FALSE, 0, 0);
+      if (rec.nbytes > sample_sys_size)
+	{
+	  sample_sys_size = rec.nbytes;
+	  sample_sys_buf = realloc(sample_sys_buf, sample_sys_size);
+	  if (!sample_sys_buf)
+	    fatal("out of virtual memory");
+	}
+      if (!sample_read(sample_replay_fd, sample_sys_buf, rec.nbytes))
+	sample_child_exit(/* done */FALSE, 0, 0);
+
+      for (p = sample_sys_buf; p < sample_sys_buf + rec.nbytes; )
+	{
+	  memcpy(&hdr, p, sizeof(hdr));
+	  p += sizeof(hdr);
+	  syscall_access(mem, Write, hdr.addr, p, hdr.nbytes);
+	  p += hdr.nbytes;
+	}
+
+      memcpy(regs.regs_R, rec.regs.regs_R, sizeof(regs.regs_R));
+      memcpy(&regs.regs_F, &rec.regs.regs_F, sizeof(regs.regs_F));
+      memcpy(&regs.regs_C, &rec.regs.regs_C, sizeof(regs.regs_C));
+      if (rec.set_npc)
+	regs.regs_NPC = rec.regs.regs_NPC;
+      return;
+    }
+
+  sample_sys_len = 0;
+  rec.regs.regs_NPC = regs.regs_NPC;
+  sys_syscall(&regs, syscall_access, mem, inst, TRUE);
+
+  if (sample_sys_fd >= 0)
+    {
+      /* a child that stopped early no longer reads, which is fine */
+      rec.set_npc = regs.regs_NPC != rec.regs.regs_NPC;
+      rec.regs = regs;
+      rec.nbytes = sample_sys_len;
+      if (sample_write(sample_sys_fd, &rec, sizeof(rec)))
+	sample_write(sample_sys_fd, sample_sys_buf, sample_sys_len);
+    }
+}
+
 /* system call handler macro */
 #define SYSCALL(INST)							\
   (/* only execute system calls in non-speculative mode */		\
    (spec_mode ? panic("speculative syscall") : (void) 0),		\
-   sys_syscall(&regs, mem_access, mem, INST, TRUE))
+   sim_syscall(INST))
 
 /* default register state accessor, used by DLite */
 static char *					/* err str, NULL for no err */
@@ -3705,8 +5160,11 @@ ruu_dispatch(void)
   md_inst_t inst;			/* actual instruction bits */
   enum md_opcode op;			/* decoded opcode enum */
   int out1, out2, in1, in2, in3;	/* output/input register names */
+  struct decode_ent_t *dec;		/* decoded inst */
+  struct decode_ent_t dec_scratch;	/* decoded inst, if not cached */
   md_addr_t target_PC;			/* actual next/target PC address */
   md_addr_t addr;			/* effective address, if load/store */
+  int addr_size;			/* size of access at ADDR */
   struct RUU_station *rs;		/* RUU station being allocated */
   struct RUU_station *lsq;		/* LSQ station for ld/st's */
   struct bpred_update_t *dir_update_ptr;/* branch predictor dir update ptr */
@@ -3723,6 +5181,7 @@ ruu_dispatch(void)
   qword_t temp_qword = 0;		/* " ditto " */
 #endif /* HOST_HAS_QWORD */
   enum md_fault_type fault;
+  struct fe_rec_t fe_rec;		/* functional front end record */
 
   made_check = FALSE;
   n_dispatched = 0;
@@ -3733,7 +5192,9 @@ ruu_dispatch(void)
 	 /* insts still available from fetch unit? */
 	 && fetch_num != 0
 	 /* on an acceptable trace path */
-	 && (ruu_include_spec || !spec_mode))
+	 && (ruu_include_spec || !spec_mode)
+	 /* and the pipeline is not being drained */
+	 && !RUU_DISPATCH_STOPPED())
     {
       /* if issuing in-order, block until last op issues if inorder issue */
       if (ruu_inorder_issue
@@ -3752,14 +5213,19 @@ ruu_dispatch(void)
       stack_recover_idx = fetch_data[fetch_head].stack_recover_idx;
       pseq = fetch_data[fetch_head].ptrace_seq;
 
-      /* decode the inst */
-      MD_SET_OPCODE(op, inst);
+      /* decode the inst, bogus insts are decoded as NOPs */
+      dec = decode_lookup(regs.regs_PC, inst, &dec_scratch);
+      op = dec->op;
+
+      /* compute output/input dependencies to out1-2 and in1-3 */
+      out1 = dec->out1; out2 = dec->out2;
+      in1 = dec->in1; in2 = dec->in2; in3 = dec->in3;
 
       /* compute default next PC */
       regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
 
       /* drain RUU for TRAPs and system calls */
-      if (MD_OP_FLAGS(op) & F_TRAP)
+      if (dec->flags & F_TRAP)
 	{
 	  if (RUU_num != 0)
 	    break;
@@ -3783,52 +5249,59 @@ ruu_dispatch(void)
 	}
 
       /* default effective address (none) and access */
-      addr = 0; is_write = FALSE;
+      addr = 0; addr_size = 0; is_write = FALSE;
 
       /* set default fault - none */
       fault = md_fault_none;
 
-      /* more decoding and execution */
-      switch (op)
+      /* with a decoupled front end, the instruction has been executed
+	 already (dispatch never gets past a mis-prediction in this mode,
+	 see sim_check_options()) */
+      if (fetch_decoupled)
+	{
+	  frontend_next(&fe_rec);
+	  if (fe_rec.PC != regs.regs_PC)
+	    panic("functional front end out of sync @ 0x%08p",
+		  regs.regs_PC);
+	  regs.regs_NPC = fe_rec.NPC;
+	  target_PC = fe_rec.target_PC;
+	  addr = fe_rec.addr;
+	  addr_size = fe_rec.addr_size;
+	  fault = fe_rec.fault;
+	}
+      else
 	{
+	  /* execute the instruction */
+	  switch (op)
+	    {
 #define DEFINST(OP,MSK,NAME,OPFORM,RES,CLASS,O1,O2,I1,I2,I3)		\
-	case OP:							\
-	  /* compute output/input dependencies to out1-2 and in1-3 */	\
-	  out1 = O1; out2 = O2;						\
-	  in1 = I1; in2 = I2; in3 = I3;					\
-	  /* execute the instruction */					\
-	  SYMCAT(OP,_IMPL);						\
-	  break;
+	    case OP:							\
+	      /* execute the instruction */				\
+	      SYMCAT(OP,_IMPL);						\
+	      break;
 #define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-	case OP:							\
-	  /* could speculatively decode a bogus inst, convert to NOP */	\
-	  op = MD_NOP_OP;						\
-	  /* compute output/input dependencies to out1-2 and in1-3 */	\
-	  out1 = NA; out2 = NA;						\
-	  in1 = NA; in2 = NA; in3 = NA;					\
-	  /* no EXPR */							\
-	  break;
+	    case OP:							\
+	      /* bogus insts are decoded as NOPs, see decode_inst() */	\
+	      /* no EXPR */						\
+	      break;
 #define CONNECT(OP)	/* nada... */
-	  /* the following macro wraps the instruction fault declaration macro
-	     with a test to see if the trace generator is in non-speculative
-	     mode, if so the instruction fault is declared, otherwise, the
-	     error is shunted because instruction faults need to be masked on
-	     the mis-speculated instruction paths */
+	      /* the following macro wraps the instruction fault declaration
+		 macro with a test to see if the trace generator is in
+		 non-speculative mode, if so the instruction fault is declared,
+		 otherwise, the error is shunted because instruction faults
+		 need to be masked on the mis-speculated instruction paths */
 #define DECLARE_FAULT(FAULT)						\
-	  {								\
-	    if (!spec_mode)						\
-	      fault = (FAULT);						\
-	    /* else, spec fault, ignore it, always terminate exec... */	\
-	    break;							\
-	  }
+	      {								\
+		if (!spec_mode)						\
+		  fault = (FAULT);					\
+		/* else, spec fault, ignore it, always terminate exec... */ \
+		break;							\
+	      }
 #include "machine.def"
-	default:
-	  /* can speculatively decode a bogus inst, convert to a NOP */
-	  op = MD_NOP_OP;
-	  /* compute output/input dependencies to out1-2 and in1-3 */	\
-	  out1 = NA; out2 = NA;
-	  in1 = NA; in2 = NA; in3 = NA;
-	  /* no EXPR */
+	    default:
+	      /* bogus insts are decoded as NOPs, see decode_inst() */
+	      /* no EXPR */;
+	    }
 	}
       /* operation sets next PC */
 
@@ -3848,14 +5321,20 @@ ruu_dispatch(void)
 	      fault, regs.regs_PC);
 
       /* update memory access stats */
-      if (MD_OP_FLAGS(op) & F_MEM)
+      if (dec->flags & F_MEM)
 	{
 	  sim_total_refs++;
 	  if (!spec_mode)
 	    sim_num_refs++;
 
-	  if (MD_OP_FLAGS(op) & F_STORE)
-	    is_write = TRUE;
+	  if (dec->flags & F_STORE)
+	    {
+	      is_write = TRUE;
+
+	      /* the store may overwrite the text of decoded insts */
+	      if (!spec_mode)
+		decode_inval(addr, addr_size);
+	    }
 	  else
 	    {
 	      sim_total_loads++;
@@ -3868,7 +5347,7 @@ ruu_dispatch(void)
       br_pred_taken = (pred_PC != (regs.regs_PC + sizeof(md_inst_t)));
 
       if ((pred_PC != regs.regs_NPC && pred_perfect)
-	  || ((MD_OP_FLAGS(op) & (F_CTRL|F_DIRJMP)) == (F_CTRL|F_DIRJMP)
+	  || ((dec->flags & (F_CTRL|F_DIRJMP)) == (F_CTRL|F_DIRJMP)
 	      && target_PC != pred_PC && br_pred_taken))
 	{
 	  /* Either 1) we're simulating perfect prediction and are in a
@@ -3926,13 +5405,14 @@ ruu_dispatch(void)
 	  rs->stack_recover_idx = stack_recover_idx;
 	  rs->spec_mode = spec_mode;
 	  rs->addr = 0;
+	  rs->addr_size = 0;
 	  /* rs->tag is already set */
 	  rs->seq = ++inst_seq;
 	  rs->queued = rs->issued = rs->completed = FALSE;
 	  rs->ptrace_seq = pseq;
 
 	  /* split ld/st's into two operations: eff addr comp + mem access */
-	  if (MD_OP_FLAGS(op) & F_MEM)
+	  if (dec->flags & F_MEM)
 	    {
 	      /* convert RUU operation from ld/st to an add (eff addr comp) */
 	      rs->op = MD_AGEN_OP;
@@ -3953,6 +5433,7 @@ ruu_dispatch(void)
 	      lsq->stack_recover_idx = 0;
 	      lsq->spec_mode = spec_mode;
 	      lsq->addr = addr;
+	      lsq->addr_size = addr_size;
 	      /* lsq->tag is already set */
 	      lsq->seq = ++inst_seq;
 	      lsq->queued = lsq->issued = lsq->completed = FALSE;
@@ -3990,6 +5471,7 @@ ruu_dispatch(void)
 	      RUU_num++;
 	      LSQ_tail = (LSQ_tail + 1) % LSQ_size;
 	      LSQ_num++;
+	      lsq_disamb_insert(lsq);
 
 	      if (OPERANDS_READY(rs))
 		{
@@ -4000,7 +5482,7 @@ ruu_dispatch(void)
 	      RSLINK_INIT(last_op, lsq);
 
 	      /* issue stores only, loads are issued by lsq_refresh() */
-	      if (((MD_OP_FLAGS(op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE))
+	      if (((dec->flags & (F_MEM|F_STORE)) == (F_MEM|F_STORE))
 		  && OPERANDS_READY(lsq))
 		{
 		  /* panic("store immediately ready"); */
@@ -4008,7 +5490,7 @@ ruu_dispatch(void)
 		  readyq_enqueue(lsq);
 		}
 	    }
-	  else /* !(MD_OP_FLAGS(op) & F_MEM) */
+	  else /* !(dec->flags & F_MEM) */
 	    {
 	      /* link onto producing operation */
 	      ruu_link_idep(rs, /* idep_ready[] index */0, in1);
@@ -4047,7 +5529,7 @@ ruu_dispatch(void)
 
       /* one more instruction executed, speculative or otherwise */
       sim_total_insn++;
-      if (MD_OP_FLAGS(op) & F_CTRL)
+      if (dec->flags & F_CTRL)
 	sim_total_branches++;
 
       if (!spec_mode)
@@ -4059,7 +5541,7 @@ ruu_dispatch(void)
 
 	  /* if this is a branching instruction update BTB, i.e., only
 	     non-speculative state is committed into the BTB */
-	  if (MD_OP_FLAGS(op) & F_CTRL)
+	  if (dec->flags & F_CTRL)
 	    {
 	      sim_num_branches++;
 	      if (pred && bpred_spec_update == spec_ID)
@@ -4211,7 +5693,9 @@ ruu_fetch(void)
        /* fetch until IFETCH -> DISPATCH queue fills */
        && fetch_num < ruu_ifq_size
        /* and no IFETCH blocking condition encountered */
-       && !done;
+       && !done
+       /* and the pipeline is not being drained */
+       && !RUU_DISPATCH_STOPPED();
        i++)
     {
       /* fetch an instruction at the next predicted fetch address */
@@ -4222,8 +5706,12 @@ ruu_fetch(void)
 	  && fetch_regs_PC < (ld_text_base+ld_text_size)
 	  && !(fetch_regs_PC & (sizeof(md_inst_t)-1)))
 	{
-	  /* read instruction from memory */
-	  MD_FETCH_INST(inst, mem, fetch_regs_PC);
+	  /* read instruction from memory, memory belongs to the functional
+	     front end when it is decoupled, so read its copy of the text */
+	  if (fetch_decoupled)
+	    inst = frontend_fetch(fetch_regs_PC);
+	  else
+	    MD_FETCH_INST(inst, mem, fetch_regs_PC);
 
 	  /* address is within program text, read instruction from memory */
 	  lat = cache_il1_lat;
@@ -4339,6 +5827,67 @@ ruu_fetch(void)
     }
 }
 
+
+/*
+ *  RUU_IDLE_CYCLES() - detect pipeline stalls that only an event can end
+ */
+
+/* return the number of cycles, starting with the current cycle, in which no
+   pipeline stage can do any work, because the pipeline is stalled waiting
+   on an outstanding event (e.g., a long latency cache miss); returns zero
+   if the current cycle may do work; the main loop skips over these cycles,
+   since all they would do is update the buffer occupancy stats */
+static tick_t
+ruu_idle_cycles(void)
+{
+  tick_t when, idle;
+
+  /* pipetraces and the debugger observe every cycle */
+  if (ptrace_outfd != NULL || dlite_active || dlite_check)
+    return 0;
+
+  /* nothing to issue... */
+  if (readyq_num != 0)
+    return 0;
+
+  /* ...and commit is waiting on the oldest instruction (or its memory
+     access) to complete */
+  if (RUU_num != 0
+      && RUU[RUU_head].completed
+      && (!RUU[RUU_head].ea_comp || LSQ[LSQ_head].completed))
+    return 0;
+
+  /* dispatch must be stalled... */
+  if (!(fetch_num == 0
+	|| RUU_num == RUU_size || LSQ_num == LSQ_size
+	|| (!ruu_include_spec && spec_mode)
+	|| RUU_DISPATCH_STOPPED()
+	|| (ruu_inorder_issue
+	    && (last_op.rs && RSLINK_VALID(&last_op)
+		&& !OPERANDS_READY(last_op.rs)))))
+    return 0;
+
+  /* ...and so must fetch */
+  if (fetch_num != ruu_ifq_size && !ruu_fetch_issue_delay
+      && !RUU_DISPATCH_STOPPED())
+    return 0;
+
+  /* with no instruction to issue, only a writeback event can change the
+     state of the pipeline, NOTE: the release of functional units can only
+     matter to issue and commit, which are both stalled */
+  when = eventq_next_time();
+  if (when <= sim_cycle)
+    return 0;
+  idle = when - sim_cycle;
+
+  /* an I-cache miss in progress may unblock fetch earlier */
+  if (fetch_num != ruu_ifq_size && !RUU_DISPATCH_STOPPED()
+      && ruu_fetch_issue_delay < idle)
+    idle = ruu_fetch_issue_delay;
+
+  return idle;
+}
+
 /* default machine state accessor, used by DLite */
 static char *					/* err str, NULL for no err */
 simoo_mstate_obj(FILE *stream,			/* output stream */
@@ -4421,186 +5970,898 @@ simoo_mstate_obj(FILE *stream,			/* output stream */
 }
 
 
-/* start simulation, program loaded, processor precise state initialized */
-void
-sim_main(void)
+/* functionally warm level-1 cache L1 with a CMD access to address ADDR,
+   with the misses and writebacks of L1 going to level-2 cache L2, if any,
+   as the L1 miss handlers above would, but without any timing */
+static void
+sim_warm_cache(struct cache_t *l1,		/* level-1 cache */
+	       struct cache_t *l2,		/* level-2 cache, or NULL */
+	       enum mem_cmd cmd,		/* access type, Read or Write */
+	       md_addr_t addr)			/* address of access */
 {
-  /* ignore any floating point exceptions, they may occur on mis-speculated
-     execution paths */
-  signal(SIGFPE, SIG_IGN);
+  md_addr_t wb_addr;
 
-  /* set up program entry state */
-  regs.regs_PC = ld_prog_entry;
-  regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
+  if (cache_warm(l1, cmd, addr, &wb_addr) || !l2)
+    return;
 
-  /* check for DLite debugger entry condition */
-  if (dlite_check_break(regs.regs_PC, /* no access */0, /* addr */0, 0, 0))
-    dlite_main(regs.regs_PC, regs.regs_PC + sizeof(md_inst_t),
-	       sim_cycle, &regs, mem);
+  /* write back the replaced block, then fetch the missing block, the
+     writebacks of L2 go to memory */
+  if (wb_addr)
+    cache_warm(l2, Write, wb_addr, &wb_addr);
+  cache_warm(l2, Read, addr, &wb_addr);
+}
 
-  /* fast forward simulator loop, performs functional simulation for
-     FASTFWD_COUNT insts, then turns on performance (timing) simulation */
-  if (fastfwd_count > 0)
-    {
-      int icount;
-      md_inst_t inst;			/* actual instruction bits */
-      enum md_opcode op;		/* decoded opcode enum */
-      md_addr_t target_PC;		/* actual next/target PC address */
-      md_addr_t addr;			/* effective address, if load/store */
-      int is_write;			/* store? */
-      byte_t temp_byte = 0;		/* temp variable for spec mem access */
-      half_t temp_half = 0;		/* " ditto " */
-      word_t temp_word = 0;		/* " ditto " */
+/* execute COUNT insts functionally, i.e., without timing, starting with the
+   instruction at REGS.REGS_PC, if WARM is non-zero, the caches, TLBs and
+   branch predictor are updated by each instruction executed (functional
+   warming), so their state is warm when timing simulation resumes, this
+   uses the lightweight warming access paths, which leave the timing state
+   of the caches alone and count the accesses apart from the timing stats;
+   without warming, the insts are executed by the fast functional engine of
+   sim-fast, which does not check for instruction faults, unless the system
+   calls are sent to a sample's child process */
+static void
+sim_fastfwd(counter_t count,			/* insts to execute */
+	    int warm)				/* warm caches and bpred? */
+{
+  counter_t icount;
+  md_inst_t inst;			/* actual instruction bits */
+  enum md_opcode op;			/* decoded opcode enum */
+  md_addr_t target_PC;			/* actual next/target PC address */
+  md_addr_t addr;			/* effective address, if load/store */
+  int addr_size;			/* size of access at ADDR */
+  int is_write;				/* store? */
+  byte_t temp_byte = 0;			/* temp variable for spec mem access */
+  half_t temp_half = 0;			/* " ditto " */
+  word_t temp_word = 0;			/* " ditto " */
 #ifdef HOST_HAS_QWORD
-      qword_t temp_qword = 0;		/* " ditto " */
+  qword_t temp_qword = 0;		/* " ditto " */
 #endif /* HOST_HAS_QWORD */
-      enum md_fault_type fault;
+  enum md_fault_type fault;
+  clock_t start = 0;
 
-      fprintf(stderr, "sim: ** fast forwarding %d insts **\n", fastfwd_count);
+  /* without warming, execute at sim-fast speed, unless the DLite debugger
+     must watch every instruction */
+  if (!warm && !dlite_active && sample_sys_fd < 0 && fastfwd_usable())
+    {
+      /* NOTE: a zero limit would run the program to completion */
+      if (count > 0)
+	fastfwd_exec(&regs, mem, &sim_func_insn, sim_func_insn + count);
+      return;
+    }
 
-      for (icount=0; icount < fastfwd_count; icount++)
-	{
-	  /* maintain $r0 semantics */
-	  regs.regs_R[MD_REG_ZERO] = 0;
+  if (warm)
+    start = clock();
+
+  for (icount=0; icount < count; icount++)
+    {
+      /* maintain $r0 semantics */
+      regs.regs_R[MD_REG_ZERO] = 0;
 #ifdef TARGET_ALPHA
-	  regs.regs_F.d[MD_REG_ZERO] = 0.0;
+      regs.regs_F.d[MD_REG_ZERO] = 0.0;
 #endif /* TARGET_ALPHA */
 
-	  /* get the next instruction to execute */
-	  MD_FETCH_INST(inst, mem, regs.regs_PC);
+      /* get the next instruction to execute */
+      MD_FETCH_INST(inst, mem, regs.regs_PC);
 
-	  /* set default reference address */
-	  addr = 0; is_write = FALSE;
+      /* set default reference address */
+      addr = 0; addr_size = 0; is_write = FALSE;
 
-	  /* set default fault - none */
-	  fault = md_fault_none;
+      /* set default fault - none */
+      fault = md_fault_none;
 
-	  /* decode the instruction */
-	  MD_SET_OPCODE(op, inst);
+      /* decode the instruction */
+      MD_SET_OPCODE(op, inst);
 
-	  /* execute the instruction */
-	  switch (op)
-	    {
+      /* execute the instruction */
+      switch (op)
+	{
 #define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
-	    case OP:							\
-	      SYMCAT(OP,_IMPL);						\
-	      break;
+	case OP:							\
+	  SYMCAT(OP,_IMPL);						\
+	  break;
 #define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-	    case OP:							\
-	      panic("attempted to execute a linking opcode");
+	case OP:							\
+	  panic("attempted to execute a linking opcode");
 #define CONNECT(OP)
 #undef DECLARE_FAULT
 #define DECLARE_FAULT(FAULT)						\
-	      { fault = (FAULT); break; }
+	  { fault = (FAULT); break; }
 #include "machine.def"
-	    default:
-	      panic("attempted to execute a bogus opcode");
+	default:
+	  panic("attempted to execute a bogus opcode");
+	}
+
+      if (fault != md_fault_none)
+	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
+
+      /* update memory access stats */
+      if (MD_OP_FLAGS(op) & F_MEM)
+	{
+	  if (MD_OP_FLAGS(op) & F_STORE)
+	    {
+	      is_write = TRUE;
+
+	      /* the store may overwrite text translated by the fast
+		 forwarding engine, decoded insts are flushed by
+		 ruu_start() */
+	      fastfwd_text_write(addr, addr_size);
 	    }
+	}
 
-	  if (fault != md_fault_none)
-	    fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
+      if (warm)
+	{
+	  /* warm the I-cache and I-TLB with the instruction fetch */
+	  if (cache_il1)
+	    sim_warm_cache(cache_il1, cache_il2, Read,
+			   IACOMPRESS(regs.regs_PC));
+	  if (itlb)
+	    sim_warm_cache(itlb, NULL, Read, IACOMPRESS(regs.regs_PC));
 
-	  /* update memory access stats */
+	  /* warm the D-cache and D-TLB with loads and stores */
 	  if (MD_OP_FLAGS(op) & F_MEM)
 	    {
-	      if (MD_OP_FLAGS(op) & F_STORE)
-		is_write = TRUE;
+	      if (cache_dl1)
+		sim_warm_cache(cache_dl1, cache_dl2,
+			       is_write ? Write : Read, addr);
+	      if (dtlb)
+		sim_warm_cache(dtlb, NULL, Read, addr);
 	    }
 
-	  /* check for DLite debugger entry condition */
-	  if (dlite_check_break(regs.regs_NPC,
-				is_write ? ACCESS_WRITE : ACCESS_READ,
-				addr, sim_num_insn, sim_num_insn))
-	    dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
-
-	  /* go to the next instruction */
-	  regs.regs_PC = regs.regs_NPC;
-	  regs.regs_NPC += sizeof(md_inst_t);
+	  /* train the branch predictor with the actual branch outcome */
+	  if (pred && (MD_OP_FLAGS(op) & F_CTRL))
+	    bpred_warm(pred,
+		       /* branch address */regs.regs_PC,
+		       /* target address */target_PC,
+		       /* next address */regs.regs_NPC,
+		       /* opcode */op,
+		       /* call? */MD_IS_CALL(op),
+		       /* return? */MD_IS_RETURN(op));
+
+	  sim_warm_insn++;
 	}
+
+      /* check for DLite debugger entry condition */
+      if (dlite_check_break(regs.regs_NPC,
+			    is_write ? ACCESS_WRITE : ACCESS_READ,
+			    addr, sim_num_insn, sim_num_insn))
+	dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
+
+      /* go to the next instruction */
+      regs.regs_PC = regs.regs_NPC;
+      regs.regs_NPC += sizeof(md_inst_t);
+      sim_func_insn++;
     }
 
-  fprintf(stderr, "sim: ** starting performance simulation **\n");
+  if (warm)
+    sim_warm_time += (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* set up the timing simulation entry state, the pipeline must be empty and
+   REGS.REGS_PC must hold the next instruction to execute */
+static void
+ruu_start(void)
+{
+  /* the text may have been written while the insts were executed by
+     functional simulation only */
+  decode_flush();
+
+  /* restart instruction fetch at the next instruction */
+  fetch_num = 0;
+  fetch_tail = fetch_head = 0;
+  ruu_fetch_issue_delay = 0;
 
-  /* set up timing simulation entry state */
   fetch_regs_PC = regs.regs_PC - sizeof(md_inst_t);
   fetch_pred_PC = regs.regs_PC;
   regs.regs_PC = regs.regs_PC - sizeof(md_inst_t);
+}
 
-  /* main simulator loop, NOTE: the pipe stages are traverse in reverse order
-     to eliminate this/next state synchronization and relaxation problems */
-  for (;;)
+/* leave timing simulation, the pipeline must have been drained (see
+   RUU_DISPATCH_LIMIT), after which REGS.REGS_PC holds the next instruction
+   to execute */
+static void
+ruu_stop(void)
+{
+  if (RUU_num != 0 || LSQ_num != 0)
+    panic("pipeline not drained");
+  if (spec_mode)
+    panic("drained and speculative");
+
+  /* the last instruction dispatched was non-speculative, so the precise
+     state continues at its successor */
+  regs.regs_PC = regs.regs_NPC;
+  regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
+
+  /* discard any fetched instructions */
+  fetch_num = 0;
+  fetch_tail = fetch_head = 0;
+}
+
+/* simulate one machine cycle, NOTE: the pipe stages are traverse in reverse
+   order to eliminate this/next state synchronization and relaxation
+   problems */
+static void
+ruu_cycle(void)
+{
+  /* RUU/LSQ sanity checks */
+  if (RUU_num < LSQ_num)
+    panic("RUU_num < LSQ_num");
+  if (((RUU_head + RUU_num) % RUU_size) != RUU_tail)
+    panic("RUU_head/RUU_tail wedged");
+  if (((LSQ_head + LSQ_num) % LSQ_size) != LSQ_tail)
+    panic("LSQ_head/LSQ_tail wedged");
+
+  /* check if pipetracing is still active */
+  ptrace_check_active(regs.regs_PC, sim_num_insn, sim_cycle);
+
+  /* indicate new cycle in pipetrace */
+  ptrace_newcycle(sim_cycle);
+
+  /* commit entries from RUU/LSQ to architected register file */
+  ruu_commit();
+
+  /* service function unit release events */
+  ruu_release_fu();
+
+  /* ==> may have ready queue entries carried over from previous cycles */
+
+  /* service result completions, also readies dependent operations */
+  /* ==> inserts operations into ready queue --> register deps resolved */
+  ruu_writeback();
+
+  if (!bugcompat_mode)
     {
-      /* RUU/LSQ sanity checks */
-      if (RUU_num < LSQ_num)
-	panic("RUU_num < LSQ_num");
-      if (((RUU_head + RUU_num) % RUU_size) != RUU_tail)
-	panic("RUU_head/RUU_tail wedged");
-      if (((LSQ_head + LSQ_num) % LSQ_size) != LSQ_tail)
-	panic("LSQ_head/LSQ_tail wedged");
+      /* try to locate memory operations that are ready to execute */
+      /* ==> inserts operations into ready queue --> mem deps resolved */
+      lsq_refresh();
 
-      /* check if pipetracing is still active */
-      ptrace_check_active(regs.regs_PC, sim_num_insn, sim_cycle);
+      /* issue operations ready to execute from a previous cycle */
+      /* <== drains ready queue <-- ready operations commence execution */
+      ruu_issue();
+    }
 
-      /* indicate new cycle in pipetrace */
-      ptrace_newcycle(sim_cycle);
+  /* decode and dispatch new operations */
+  /* ==> insert ops w/ no deps or all regs ready --> reg deps resolved */
+  ruu_dispatch();
 
-      /* commit entries from RUU/LSQ to architected register file */
-      ruu_commit();
+  if (bugcompat_mode)
+    {
+      /* try to locate memory operations that are ready to execute */
+      /* ==> inserts operations into ready queue --> mem deps resolved */
+      lsq_refresh();
 
-      /* service function unit release events */
-      ruu_release_fu();
+      /* issue operations ready to execute from a previous cycle */
+      /* <== drains ready queue <-- ready operations commence execution */
+      ruu_issue();
+    }
 
-      /* ==> may have ready queue entries carried over from previous cycles */
+  /* call instruction fetch unit if it is not blocked */
+  if (!ruu_fetch_issue_delay)
+    ruu_fetch();
+  else
+    ruu_fetch_issue_delay--;
+
+  /* update buffer occupancy stats */
+  IFQ_count += fetch_num;
+  IFQ_fcount += ((fetch_num == ruu_ifq_size) ? 1 : 0);
+  RUU_count += RUU_num;
+  RUU_fcount += ((RUU_num == RUU_size) ? 1 : 0);
+  LSQ_count += LSQ_num;
+  LSQ_fcount += ((LSQ_num == LSQ_size) ? 1 : 0);
+
+  /* go to next cycle */
+  sim_cycle++;
+}
 
-      /* service result completions, also readies dependent operations */
-      /* ==> inserts operations into ready queue --> register deps resolved */
-      ruu_writeback();
+/* skip over cycles in which the pipeline is stalled waiting on an event (see
+   ruu_idle_cycles()), applying their effects on the machine state and the
+   buffer occupancy stats in bulk */
+static void
+ruu_idle_skip(void)
+{
+  int i;
+  tick_t idle;
 
-      if (!bugcompat_mode)
-	{
-	  /* try to locate memory operations that are ready to execute */
-	  /* ==> inserts operations into ready queue --> mem deps resolved */
-	  lsq_refresh();
+  idle = ruu_idle_cycles();
+  if (idle <= 0)
+    return;
+
+  IFQ_count += idle * fetch_num;
+  IFQ_fcount += ((fetch_num == ruu_ifq_size) ? idle : 0);
+  RUU_count += idle * RUU_num;
+  RUU_fcount += ((RUU_num == RUU_size) ? idle : 0);
+  LSQ_count += idle * LSQ_num;
+  LSQ_fcount += ((LSQ_num == LSQ_size) ? idle : 0);
+
+  /* release functional units, as ruu_release_fu() would have */
+  for (i=0; i<fu_pool->num_resources; i++)
+    {
+      if (fu_pool->resources[i].busy > idle)
+	fu_pool->resources[i].busy -= (int)idle;
+      else
+	fu_pool->resources[i].busy = 0;
+    }
+
+  /* count down an I-cache miss in progress */
+  if (ruu_fetch_issue_delay > idle)
+    ruu_fetch_issue_delay -= (int)idle;
+  else
+    ruu_fetch_issue_delay = 0;
+
+  sim_cycle += idle;
+}
+
+/* non-zero if the instruction limit has been reached, in sampling modes
+   the limit covers both functionally and timing simulated instructions */
+#define SIM_INSN_LIMIT_P()						\
+  (max_insts && sim_num_insn + sim_func_insn >= max_insts)
+
+/* record the CPI of a measurement unit of N_INSN insts that took N_CYCLES,
+   and ended after POS insts */
+static void
+sample_record(counter_t pos,			/* insts executed */
+	      counter_t n_insn,			/* insts in the unit */
+	      tick_t n_cycles)			/* cycles taken */
+{
+  double cpi, n;
+
+  cpi = (double)n_cycles / (double)n_insn;
+
+  sample_num++;
+  sample_insn += n_insn;
+  sample_cycles += n_cycles;
+
+  /* update the CPI estimate and its confidence interval */
+  sample_cpi_sum += cpi;
+  sample_cpi_sumsq += cpi * cpi;
+  n = (double)sample_num;
+  sample_cpi_mean = sample_cpi_sum / n;
+  if (sample_num > 1)
+    {
+      sample_cpi_stddev =
+	sqrt(MAX(sample_cpi_sumsq - n * sample_cpi_mean * sample_cpi_mean,
+		 0.0) / (n - 1.0));
+      sample_cpi_ci = SAMPLE_CI_Z * sample_cpi_stddev / sqrt(n);
+    }
+
+  if (sample_outfd)
+    fprintf(sample_outfd, "%.0f %.0f %.0f %.0f %.4f\n",
+	    (double)sample_num, (double)pos,
+	    (double)n_insn, (double)n_cycles, cpi);
+}
+
+/* detailed simulation of WARMUP insts of warm-up followed by UNIT insts of
+   measurement, the pipeline starts empty, dispatch stops at the end of the
+   measurement, and the pipeline is drained before returning; returns the
+   insts and cycles of the measurement in N_INSN and N_CYCLES, or returns
+   zero if the instruction limit is reached first */
+static int
+sim_detailed(counter_t warmup,			/* insts of warm-up */
+	     counter_t unit,			/* insts of measurement */
+	     counter_t *n_insn,			/* insts measured */
+	     tick_t *n_cycles)			/* cycles measured */
+{
+  counter_t start_insn;
+  tick_t start_cycle;
+
+  /* detailed warm-up */
+  ruu_start();
+  ruu_dispatch_limit = sim_num_insn + warmup + unit;
+  while (sim_num_insn < ruu_dispatch_limit - unit)
+    {
+      ruu_cycle();
+      if (SIM_INSN_LIMIT_P())
+	return FALSE;
+      ruu_idle_skip();
+    }
+
+  /* detailed measurement */
+  start_insn = sim_num_insn;
+  start_cycle = sim_cycle;
+  while (sim_num_insn < ruu_dispatch_limit)
+    {
+      ruu_cycle();
+      if (SIM_INSN_LIMIT_P())
+	return FALSE;
+      ruu_idle_skip();
+    }
+  *n_insn = sim_num_insn - start_insn;
+  *n_cycles = sim_cycle - start_cycle;
+
+  /* drain the pipeline, back to functional simulation */
+  while (RUU_num != 0)
+    {
+      ruu_cycle();
+      ruu_idle_skip();
+    }
+  ruu_dispatch_limit = 0;
+  ruu_stop();
+
+  return TRUE;
+}
+
+static void simpoint_record(struct simpoint_t *sp,
+			    counter_t n_insn, tick_t n_cycles);
+
+/* a sample (or simulation point) simulated by a child process */
+struct sample_job_t {
+  pid_t pid;				/* child process */
+  int result_fd;			/* pipe of the child's results */
+  struct simpoint_t *sp;		/* simulation point, NULL for sample */
+  counter_t pos;			/* insts executed after the sample */
+  counter_t func_insn;			/* insts the parent executed of it */
+  union stat_value_t *base;		/* scalar stats when forked */
+};
+
+/* results of a sample's child process, followed by its scalar stats */
+struct sample_result_t {
+  int done;				/* measurement completed? */
+  counter_t n_insn;			/* insts measured */
+  tick_t n_cycles;			/* cycles measured */
+};
+
+/* running sample jobs, oldest first, in a ring of SAMPLE_JOBS entries */
+static struct sample_job_t *sample_jobq = NULL;
+static int sample_jobq_head = 0;
+static int sample_jobq_num = 0;
+
+/* exit point of the simulator, while sample jobs may be running */
+static jmp_buf sample_exit_buf;
+
+/* job whose sample the parent is executing, or NULL */
+static struct sample_job_t *sample_window = NULL;
+
+/* scalar stats: number, and the final values of a child */
+static int sample_nstats = 0;
+static union stat_value_t *sample_stats = NULL;
+
+/* child: pipe of the results */
+static int sample_result_fd = -1;
+
+/* allocate the sample jobs */
+static void
+sample_jobs_init(void)
+{
+  int i;
+
+  sample_nstats = stat_num_scalars(sim_sdb);
+  sample_jobq = calloc(sample_jobs, sizeof(struct sample_job_t));
+  sample_stats = calloc(sample_nstats + 1, sizeof(union stat_value_t));
+  if (!sample_jobq || !sample_stats)
+    fatal("out of virtual memory");
+  for (i=0; i<sample_jobs; i++)
+    {
+      sample_jobq[i].base =
+	calloc(sample_nstats + 1, sizeof(union stat_value_t));
+      if (!sample_jobq[i].base)
+	fatal("out of virtual memory");
+    }
+
+  /* children that stop early close their end of the system call pipe */
+  signal(SIGPIPE, SIG_IGN);
+}
+
+/* child: send the results and stats of the sample to the parent and exit,
+   DONE is zero if the measurement did not complete */
+static void
+sample_child_exit(int done,			/* measurement completed? */
+		  counter_t n_insn,		/* insts measured */
+		  tick_t n_cycles)		/* cycles measured */
+{
+  struct sample_result_t res;
+
+  close(sample_replay_fd);
+  sample_replay_fd = -1;
+
+  res.done = done;
+  res.n_insn = n_insn;
+  res.n_cycles = n_cycles;
+  stat_save_scalars(sim_sdb, sample_stats);
+  if (sample_write(sample_result_fd, &res, sizeof(res)))
+    sample_write(sample_result_fd, sample_stats,
+		 sample_nstats * sizeof(union stat_value_t));
+
+  /* NOTE: skip exit(), the stdio buffers belong to the parent */
+  _exit(0);
+}
+
+/* wait for the oldest sample job, and add its stats and measurement */
+static void
+sample_job_wait(void)
+{
+  struct sample_job_t *job = &sample_jobq[sample_jobq_head];
+  struct sample_result_t res;
+  int status;
+
+  if (!sample_read(job->result_fd, &res, sizeof(res))
+      || !sample_read(job->result_fd, sample_stats,
+		      sample_nstats * sizeof(union stat_value_t)))
+    fatal("sample process %d failed", (int)job->pid);
+  close(job->result_fd);
+  waitpid(job->pid, &status, 0);
+
+  /* the child's insts replace those the parent executed of the sample */
+  stat_add_scalars(sim_sdb, sample_stats, job->base);
+  sim_func_insn -= job->func_insn;
+
+  if (res.done)
+    {
+      if (job->sp)
+	simpoint_record(job->sp, res.n_insn, res.n_cycles);
+      else
+	sample_record(job->pos, res.n_insn, res.n_cycles);
+    }
+
+  sample_jobq_head = (sample_jobq_head + 1) % sample_jobs;
+  sample_jobq_num--;
+}
+
+/* end the parent's execution of a sample, its stats are counted by the
+   child, so all but the functional inst count are rolled back */
+static void
+sample_window_end(void)
+{
+  counter_t func_insn = sim_func_insn;
+
+  close(sample_sys_fd);
+  sample_sys_fd = -1;
+
+  stat_restore_scalars(sim_sdb, sample_window->base);
+  sample_window->func_insn = func_insn - sim_func_insn;
+  sim_func_insn = func_insn;
+  sample_window->pos = sim_num_insn + sim_func_insn;
+  sample_window = NULL;
+}
+
+/* wait for all sample jobs, also when the program exits during a sample */
+static void
+sample_jobs_finish(void)
+{
+  if (sample_window)
+    sample_window_end();
+  while (sample_jobq_num > 0)
+    sample_job_wait();
+}
+
+/* parallel sim_detailed(): detailed simulation of WARMUP insts of warm-up
+   followed by UNIT insts of measurement, for simulation point SP, or a
+   sample if SP is NULL, in a child process forked with a copy-on-write
+   snapshot of the simulator; the parent executes the same insts
+   functionally and sends their system calls to the child, the child's
+   results are recorded when sample_job_wait() collects it; returns zero if
+   the instruction limit is reached */
+static int
+sample_job_start(counter_t warmup,		/* insts of warm-up */
+		 counter_t unit,		/* insts of measurement */
+		 struct simpoint_t *sp)		/* simulation point */
+{
+  struct sample_job_t *job;
+  int sys_pipe[2], result_pipe[2];
+  counter_t count, n_insn;
+  tick_t n_cycles;
+
+  if (sample_jobq_num == sample_jobs)
+    sample_job_wait();
+
+  job = &sample_jobq[(sample_jobq_head + sample_jobq_num) % sample_jobs];
+  job->sp = sp;
+  stat_save_scalars(sim_sdb, job->base);
+
+  if (pipe(sys_pipe) < 0 || pipe(result_pipe) < 0)
+    fatal("cannot create sample pipes");
+  fflush(NULL);
+  if ((job->pid = fork()) < 0)
+    fatal("cannot fork sample process");
+
+  if (job->pid == 0)
+    {
+      /* child: detailed simulation, with the parent's system calls */
+      close(sys_pipe[1]);
+      close(result_pipe[0]);
+      sample_replay_fd = sys_pipe[0];
+      sample_result_fd = result_pipe[1];
+
+      if (!sim_detailed(warmup, unit, &n_insn, &n_cycles))
+	sample_child_exit(/* done */FALSE, 0, 0);
+      sample_child_exit(/* done */TRUE, n_insn, n_cycles);
+    }
+
+  close(sys_pipe[0]);
+  close(result_pipe[1]);
+  job->result_fd = result_pipe[0];
+  sample_jobq_num++;
+
+  /* parent: functional simulation of the same insts */
+  count = warmup + unit;
+  if (max_insts)
+    count = MIN(count, max_insts - (sim_num_insn + sim_func_insn));
+  sample_sys_fd = sys_pipe[1];
+  sample_window = job;
+  sim_fastfwd(count, /* warm */sample_fwarm);
+  sample_window_end();
+
+  return !SIM_INSN_LIMIT_P();
+}
+
+/* systematically sampled simulation: each sampling period begins with
+   functional simulation (with functional warming, if enabled) up to the
+   next sample, each sample consists of SAMPLE_WARMUP insts of detailed
+   warm-up followed by SAMPLE_UNIT insts of detailed measurement, after
+   which the pipeline is drained; runs until the program exits or the
+   instruction limit is reached */
+static void
+sim_sample(void)
+{
+  counter_t count, n_insn;
+  tick_t n_cycles;
+
+  for (;;)
+    {
+      /* functional simulation up to the next sample */
+      count = sample_period - sample_warmup - sample_unit;
+      if (max_insts)
+	count = MIN(count, max_insts - (sim_num_insn + sim_func_insn));
+      sim_fastfwd(count, /* warm */sample_fwarm);
+      if (SIM_INSN_LIMIT_P())
+	return;
 
-	  /* issue operations ready to execute from a previous cycle */
-	  /* <== drains ready queue <-- ready operations commence execution */
-	  ruu_issue();
+      /* detailed warm-up and measurement */
+      if (sample_jobs > 1)
+	{
+	  if (!sample_job_start(sample_warmup, sample_unit, NULL))
+	    return;
+	  continue;
 	}
+      if (!sim_detailed(sample_warmup, sample_unit, &n_insn, &n_cycles))
+	return;
+      sample_record(sim_num_insn + sim_func_insn, n_insn, n_cycles);
+    }
+}
 
-      /* decode and dispatch new operations */
-      /* ==> insert ops w/ no deps or all regs ready --> reg deps resolved */
-      ruu_dispatch();
+/* record the CPI of simulation point SP, N_INSN insts that took N_CYCLES */
+static void
+simpoint_record(struct simpoint_t *sp,		/* simulation point */
+		counter_t n_insn,		/* insts simulated */
+		tick_t n_cycles)		/* cycles taken */
+{
+  double cpi;
+
+  cpi = (double)n_cycles / (double)n_insn;
+
+  simpoint_num++;
+  simpoint_insn += n_insn;
+  simpoint_cycles += n_cycles;
+
+  /* update the weighted CPI */
+  simpoint_weight += sp->weight;
+  simpoint_cpi_sum += sp->weight * cpi;
+  if (simpoint_weight > 0.0)
+    simpoint_cpi = simpoint_cpi_sum / simpoint_weight;
 
-      if (bugcompat_mode)
+  if (sample_outfd)
+    fprintf(sample_outfd, "%.0f %.6f %.0f %.0f %.4f\n",
+	    (double)sp->interval, sp->weight,
+	    (double)n_insn, (double)n_cycles, cpi);
+}
+
+/* simulation point simulation: functional simulation (with functional
+   warming, if enabled) up to each simulation point, then SAMPLE_WARMUP insts
+   of detailed warm-up, or fewer if the previous simulation point is closer,
+   followed by detailed measurement of the simulation point's interval; runs
+   until the last simulation point is simulated, the program exits, or the
+   instruction limit is reached */
+static void
+sim_simpoints(void)
+{
+  int i;
+  counter_t start, pos, warmup, count, n_insn;
+  tick_t n_cycles;
+
+  for (i=0; i<simpoint_npoints; i++)
+    {
+      /* functional simulation up to the warm-up of the simulation point */
+      start = simpoints[i].interval * simpoint_interval;
+      pos = sim_num_insn + sim_func_insn;
+      if (start < pos)
+	panic("simulation points overlap");
+      warmup = MIN((counter_t)sample_warmup, start - pos);
+      count = start - warmup - pos;
+      if (max_insts)
+	count = MIN(count, max_insts - pos);
+      sim_fastfwd(count, /* warm */sample_fwarm);
+      if (SIM_INSN_LIMIT_P())
+	return;
+
+      /* detailed warm-up and measurement */
+      if (sample_jobs > 1)
 	{
-	  /* try to locate memory operations that are ready to execute */
-	  /* ==> inserts operations into ready queue --> mem deps resolved */
-	  lsq_refresh();
+	  if (!sample_job_start(warmup, simpoint_interval, &simpoints[i]))
+	    return;
+	  continue;
+	}
+      if (!sim_detailed(warmup, simpoint_interval, &n_insn, &n_cycles))
+	return;
+      simpoint_record(&simpoints[i], n_insn, n_cycles);
+    }
+}
+
+/* return in CACHES the caches and TLBs held in checkpoints, in checkpoint
+   order and each only once, returns the number of caches and TLBs */
+static int
+sim_chkpt_caches(struct cache_t **caches)	/* caches and TLBs */
+{
+  int n = 0;
+
+  if (cache_dl1)
+    caches[n++] = cache_dl1;
+  if (cache_dl2)
+    caches[n++] = cache_dl2;
+  if (cache_il1 && cache_il1 != cache_dl1 && cache_il1 != cache_dl2)
+    caches[n++] = cache_il1;
+  if (cache_il2 && cache_il2 != cache_dl2)
+    caches[n++] = cache_il2;
+  if (dtlb)
+    caches[n++] = dtlb;
+  if (itlb)
+    caches[n++] = itlb;
+
+  return n;
+}
+
+/* save the machine, i.e., the architected state, caches, TLBs and branch
+   predictor, to binary checkpoint file FNAME */
+static void
+sim_chkpt_save(char *fname)			/* checkpoint file name */
+{
+  FILE *fd;
+  int i, n;
+  struct cache_t *caches[6];
+
+  if (!(fd = fopen(fname, "wb")))
+    fatal("cannot open checkpoint file `%s'", fname);
+
+  chkpt_write_arch(fd, &regs, mem, sim_num_insn + sim_func_insn);
+  n = sim_chkpt_caches(caches);
+  for (i=0; i<n; i++)
+    cache_chkpt_write(caches[i], fd);
+  if (pred)
+    bpred_chkpt_write(pred, fd);
+
+  fclose(fd);
+}
+
+/* restore the machine from binary checkpoint file FNAME, the insts executed
+   before the checkpoint count as functionally simulated */
+static void
+sim_chkpt_restore(char *fname)			/* checkpoint file name */
+{
+  FILE *fd;
+  int i, n;
+  struct cache_t *caches[6];
+
+  if (!(fd = fopen(fname, "rb")))
+    fatal("cannot open checkpoint file `%s'", fname);
+
+  sim_func_insn = chkpt_read_arch(fd, &regs, mem);
+  n = sim_chkpt_caches(caches);
+  for (i=0; i<n; i++)
+    cache_chkpt_read(caches[i], fd);
+  if (pred)
+    bpred_chkpt_read(pred, fd);
+
+  fclose(fd);
+}
+
+/* start simulation, program loaded, processor precise state initialized */
+void
+sim_main(void)
+{
+  int exit_code;
+
+  /* ignore any floating point exceptions, they may occur on mis-speculated
+     execution paths */
+  signal(SIGFPE, SIG_IGN);
 
-	  /* issue operations ready to execute from a previous cycle */
-	  /* <== drains ready queue <-- ready operations commence execution */
-	  ruu_issue();
+  /* set up program entry state */
+  regs.regs_PC = ld_prog_entry;
+  regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
+
+  /* check for DLite debugger entry condition */
+  if (dlite_check_break(regs.regs_PC, /* no access */0, /* addr */0, 0, 0))
+    dlite_main(regs.regs_PC, regs.regs_PC + sizeof(md_inst_t),
+	       sim_cycle, &regs, mem);
+
+  /* restore the machine from a checkpoint, in place of executing the
+     insts that precede it */
+  if (chkpt_restore_fname)
+    {
+      sim_chkpt_restore(chkpt_restore_fname);
+      myfprintf(stderr, "sim: ** restored checkpoint `%s' at %n insts **\n",
+		chkpt_restore_fname, sim_func_insn);
+    }
+
+  /* fast forward simulator loop, performs functional simulation for
+     FASTFWD_COUNT insts, then turns on performance (timing) simulation */
+  if (fastfwd_count > 0)
+    {
+      fprintf(stderr, "sim: ** fast forwarding %d insts%s **\n",
+	      fastfwd_count, fastfwd_warm ? ", with functional warming" : "");
+      sim_fastfwd(fastfwd_count, fastfwd_warm);
+    }
+
+  /* save the machine, as it is when timing simulation starts */
+  if (chkpt_save_fname)
+    {
+      sim_chkpt_save(chkpt_save_fname);
+      myfprintf(stderr, "sim: ** saved checkpoint `%s' at %n insts **\n",
+		chkpt_save_fname, sim_num_insn + sim_func_insn);
+    }
+
+  /* parallel sampling, the samples still running when the program exits
+     are waited for before the stats are printed */
+  if (sample_jobs > 1 && (sample_unit > 0 || simpoint_npoints > 0))
+    {
+      sample_jobs_init();
+      memcpy(sample_exit_buf, sim_exit_buf, sizeof(jmp_buf));
+      if ((exit_code = setjmp(sim_exit_buf)) != 0)
+	{
+	  memcpy(sim_exit_buf, sample_exit_buf, sizeof(jmp_buf));
+	  sample_jobs_finish();
+	  longjmp(sim_exit_buf, exit_code);
 	}
+    }
 
-      /* call instruction fetch unit if it is not blocked */
-      if (!ruu_fetch_issue_delay)
-	ruu_fetch();
-      else
-	ruu_fetch_issue_delay--;
+  /* sampled simulation alternates functional and timing simulation */
+  if (sample_unit > 0)
+    {
+      fprintf(stderr, "sim: ** starting sampled simulation **\n");
+      sim_sample();
+      if (sample_jobs > 1)
+	sample_jobs_finish();
+      return;
+    }
 
-      /* update buffer occupancy stats */
-      IFQ_count += fetch_num;
-      IFQ_fcount += ((fetch_num == ruu_ifq_size) ? 1 : 0);
-      RUU_count += RUU_num;
-      RUU_fcount += ((RUU_num == RUU_size) ? 1 : 0);
-      LSQ_count += LSQ_num;
-      LSQ_fcount += ((LSQ_num == LSQ_size) ? 1 : 0);
+  /* simulation points likewise, but only at the simulation points */
+  if (simpoint_npoints > 0)
+    {
+      fprintf(stderr, "sim: ** simulating %d simulation points **\n",
+	      simpoint_npoints);
+      sim_simpoints();
+      if (sample_jobs > 1)
+	sample_jobs_finish();
+      return;
+    }
+
+  fprintf(stderr, "sim: ** starting performance simulation **\n");
+
+  /* start the functional front end, dispatch may go past the instruction
+     limit by as many insts as it dispatches in a cycle */
+  if (fetch_decouple)
+    {
+      frontend_start(&regs, mem,
+		     max_insts
+		     ? max_insts - sim_num_insn + ruu_decode_width * fetch_speed
+		     : 0,
+		     fetch_decouple);
+      fetch_decoupled = TRUE;
+    }
+
+  /* set up timing simulation entry state */
+  ruu_start();
 
-      /* go to next cycle */
-      sim_cycle++;
+  /* main simulator loop */
+  for (;;)
+    {
+      ruu_cycle();
 
       /* finish early? */
       if (max_insts && sim_num_insn >= max_insts)
-	return;
+	{
+	  frontend_stop();
+	  return;
+	}
+
+      /* skip over cycles in which the pipeline is stalled */
+      ruu_idle_skip();
     }
 }
@@ -100,6 +100,13 @@ static int prof_taddr /* = FALSE */;
 static int pcstat_nelt = 0;
 static char *pcstat_vars[MAX_PCSTAT_VARS];
 
+/* basic block vector profile interval size (in insts), 0 if disabled */
+static unsigned int bbv_interval;
+
+/* basic block vector profile output file name and stream */
+static char *bbv_fname;
+static FILE *bbv_outfd = NULL;
+
 /* register simulator-specific options */
 void
 sim_reg_options(struct opt_odb_t *odb)
@@ -150,6 +157,28 @@ sim_reg_options(struct opt_odb_t *odb)
 		      "profile stat(s) against text addr's (mult uses ok)",
 		      pcstat_vars, MAX_PCSTAT_VARS, &pcstat_nelt, NULL,
 		      /* !print */FALSE, /* format */NULL, /* accrue */TRUE);
+
+  opt_reg_uint(odb, "-bbv:interval",
+	       "basic block vector profile interval (in insts), 0 = off",
+	       &bbv_interval, /* default */0,
+	       /* print */TRUE, /* format */NULL);
+
+  opt_reg_string(odb, "-bbv:out", "basic block vector profile output file",
+		 &bbv_fname, /* default */"sim.bb",
+		 /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  The basic block vector profile divides execution into intervals of\n"
+"  -bbv:interval insts, and writes one line per interval to the -bbv:out\n"
+"  file, in the SimPoint frequency vector format, i.e., `T' followed by\n"
+"  `:<block>:<insts>' for every basic block executed in the interval, where\n"
+"  <block> numbers the block (from 1, in order of first execution) and\n"
+"  <insts> is the number of insts the block executed in the interval.  A\n"
+"  final partial interval is not written.  The `simpoint' tool clusters the\n"
+"  intervals into simulation points for `sim-outorder -simpoint:points'.\n"
+"\n"
+"    Example:   -bbv:interval 10000000 -bbv:out gcc.bb\n"
+	       );
 }
 
 /* check simulator-specific option values */
@@ -168,6 +197,13 @@ sim_check_options(struct opt_odb_t *odb, int argc, char **argv)
       prof_dsyms = TRUE;
       prof_taddr = TRUE;
     }
+
+  if (bbv_interval > 0)
+    {
+      bbv_outfd = fopen(bbv_fname, "w");
+      if (!bbv_outfd)
+	fatal("cannot open basic block vector file `%s'", bbv_fname);
+    }
 }
 
 /* instruction classes */
@@ -277,6 +313,10 @@ static char **dsym_names = NULL;
 /* text address profile */
 static struct stat_stat_t *taddr_prof = NULL;
 
+/* basic block vector profile stats */
+static counter_t bbv_num = 0;		/* num intervals written */
+static int bbv_nblocks = 0;		/* num distinct basic blocks */
+
 /* text-based stat profiles */
 static struct stat_stat_t *pcstat_stats[MAX_PCSTAT_VARS];
 static counter_t pcstat_lastvals[MAX_PCSTAT_VARS];
@@ -485,6 +525,16 @@ sim_reg_stats(struct stat_sdb_t *sdb)
 					/* format */"0x%p %u %.2f",
 					/* print fn */NULL);
     }
+  if (bbv_interval > 0)
+    {
+      stat_reg_counter(sdb, "bbv_num",
+		       "total number of basic block vector intervals written",
+		       &bbv_num, /* initial value */0, /* format */NULL);
+      stat_reg_int(sdb, "bbv_nblocks",
+		   "total number of distinct basic blocks executed",
+		   &bbv_nblocks, /* initial value */0, /* format */NULL);
+    }
+
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
 }
@@ -548,7 +598,8 @@ sim_aux_stats(FILE *stream)		/* output stream */
 void
 sim_uninit(void)
 {
-  /* nada */
+  if (bbv_outfd)
+    fclose(bbv_outfd);
 }
 
 
@@ -636,6 +687,111 @@ sim_uninit(void)
 /* addressing mode FSM (dest of last LUI, used for decoding addr modes) */
 static unsigned int fsm = 0;
 
+
+/*
+ * basic block vector profile
+ */
+
+/* a basic block, i.e., a run of insts ending with a control or trap inst,
+   identified by the address of its first inst */
+struct bbv_block_t {
+  struct bbv_block_t *next;		/* next block in hash bucket */
+  md_addr_t pc;				/* address of first inst */
+  int id;				/* block number, from 1 */
+  counter_t count;			/* insts executed in this interval */
+};
+
+/* basic block hash table, keyed by the address of the first inst */
+#define BBV_HASH_SIZE			32768
+#define BBV_HASH(PC)							\
+  ((((PC) / sizeof(md_inst_t)) ^ ((PC) >> 17)) & (BBV_HASH_SIZE - 1))
+static struct bbv_block_t *bbv_htable[BBV_HASH_SIZE];
+
+/* blocks executed in the current interval, in order of first execution */
+static struct bbv_block_t **bbv_touched = NULL;
+static int bbv_ntouched = 0;
+static int bbv_touched_sz = 0;
+
+/* block of the inst being executed, NULL at a block boundary */
+static struct bbv_block_t *bbv_block = NULL;
+
+/* insts executed in the current interval */
+static counter_t bbv_count = 0;
+
+/* return the basic block starting at PC, creating it if new */
+static struct bbv_block_t *
+bbv_lookup(md_addr_t pc)		/* address of first inst */
+{
+  struct bbv_block_t *blk;
+  int index = BBV_HASH(pc);
+
+  for (blk = bbv_htable[index]; blk != NULL; blk = blk->next)
+    {
+      if (blk->pc == pc)
+	return blk;
+    }
+
+  blk = calloc(1, sizeof(struct bbv_block_t));
+  if (!blk)
+    fatal("out of virtual memory");
+  blk->pc = pc;
+  blk->id = ++bbv_nblocks;
+  blk->count = 0;
+  blk->next = bbv_htable[index];
+  bbv_htable[index] = blk;
+  return blk;
+}
+
+/* write the basic block vector of the current interval and start another */
+static void
+bbv_dump(void)
+{
+  int i;
+
+  fputc('T', bbv_outfd);
+  for (i=0; i<bbv_ntouched; i++)
+    {
+      myfprintf(bbv_outfd, ":%d:%n ",
+		bbv_touched[i]->id, bbv_touched[i]->count);
+      bbv_touched[i]->count = 0;
+    }
+  fputc('\n', bbv_outfd);
+
+  bbv_ntouched = 0;
+  bbv_count = 0;
+  bbv_num++;
+}
+
+/* count inst at PC, with opcode flags FLAGS, in the basic block vector */
+static void
+bbv_update(md_addr_t pc,		/* address of inst */
+	   unsigned int flags)		/* inst opcode flags */
+{
+  if (!bbv_block)
+    bbv_block = bbv_lookup(pc);
+
+  if (bbv_block->count++ == 0)
+    {
+      /* first execution in this interval */
+      if (bbv_ntouched == bbv_touched_sz)
+	{
+	  bbv_touched_sz = bbv_touched_sz ? 2 * bbv_touched_sz : 1024;
+	  bbv_touched = realloc(bbv_touched,
+				bbv_touched_sz * sizeof(struct bbv_block_t *));
+	  if (!bbv_touched)
+	    fatal("out of virtual memory");
+	}
+      bbv_touched[bbv_ntouched++] = bbv_block;
+    }
+
+  /* control and trap insts end the block */
+  if (flags & (F_CTRL|F_TRAP))
+    bbv_block = NULL;
+
+  if (++bbv_count == bbv_interval)
+    bbv_dump();
+}
+
 /* start simulation, program loaded, processor precise state initialized */
 void
 sim_main(void)
@@ -851,6 +1007,12 @@ sim_main(void)
 	  stat_add_sample(taddr_prof, regs.regs_PC);
 	}
 
+      if (bbv_interval > 0)
+	{
+	  /* add inst to the basic block vector of this interval */
+	  bbv_update(regs.regs_PC, flags);
+	}
+
       /* update any stats tracked by PC */
       for (i=0; i<pcstat_nelt; i++)
 	{
@@ -0,0 +1,1019 @@
+/* sim-sweep.c - design space sweep driver implementation */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "regs.h"
+#include "memory.h"
+#include "cache.h"
+#include "bpred.h"
+#include "loader.h"
+#include "syscall.h"
+#include "dlite.h"
+#include "options.h"
+#include "stats.h"
+#include "sim.h"
+#include "fastfwd.h"
+
+/*
+ * This file implements a design space sweep driver.  The program is executed
+ * once, functionally, and the stream of instruction and memory references it
+ * produces is fanned out to any number of independent cache hierarchies and
+ * branch predictors (the sweep points).  Every sweep point is simulated by
+ * its own worker thread, which reads the reference stream from a lock-free
+ * ring buffer of its own, so the cost of executing the program is shared by
+ * all the points and the points are simulated in parallel.  The caches are
+ * simulated with the functional warming path of the cache module, so no
+ * timing information is generated.  The results of all the sweep points are
+ * printed in one table at the end of the simulation.
+ */
+
+/* simulated registers */
+static struct regs_t regs;
+
+/* simulated memory */
+static struct mem_t *mem = NULL;
+
+/* track number of refs and branches */
+static counter_t sim_num_refs = 0;
+static counter_t sim_num_branches = 0;
+
+/* maximum number of inst's to execute */
+static unsigned int max_insts;
+
+/* number of insts skipped before the sweep starts */
+static int fastfwd_count;
+
+/* maximum number of sweep points of each kind */
+#define MAX_SWEEP_POINTS	64
+
+/* cache hierarchy sweep points, <l1 config>[,<l2 config>] */
+static char *sweep_cache_opts[MAX_SWEEP_POINTS];
+static int sweep_cache_nelt = 0;
+
+/* branch predictor sweep points, <type>[:<args>] */
+static char *sweep_bpred_opts[MAX_SWEEP_POINTS];
+static int sweep_bpred_nelt = 0;
+
+/* references seen by the cache hierarchies {data|inst|all} */
+static char *sweep_refs_opt;
+
+/* simulate data and/or instruction references in the cache hierarchies */
+static int sweep_data_refs;
+static int sweep_inst_refs;
+
+/* return address stack (RAS) size of the branch predictor sweep points */
+static int ras_size = 8;
+
+/* BTB config of the branch predictor sweep points */
+static int btb_nelt = 2;
+static int btb_config[2] =
+  { /* nsets */512, /* assoc */4 };
+
+/* number of references per batch sent to the sweep points */
+static int sweep_batch_size;
+
+
+/*
+ * reference stream, the producer (i.e., the functional simulator running on
+ * the main thread) fills batches of references, which are published to the
+ * sweep point workers through one single-producer single-consumer ring per
+ * worker; the batches themselves are shared by all the workers, read-only,
+ * and a batch is refilled only after all workers are done with it
+ */
+
+/* reference flags */
+#define SWEEP_MEM		0x0001	/* memory reference */
+#define SWEEP_STORE		0x0002	/* store memory reference */
+#define SWEEP_CTRL		0x0004	/* control transfer */
+#define SWEEP_CALL		0x0008	/* function call */
+#define SWEEP_RETURN		0x0010	/* function return */
+
+/* one instruction of the reference stream */
+struct sweep_ref_t {
+  md_addr_t PC;			/* address of the instruction */
+  md_addr_t NPC;		/* address of the next instruction executed */
+  md_addr_t addr;		/* memory reference address, or branch target */
+  short op;			/* instruction opcode */
+  short flags;			/* reference flags, see above */
+};
+
+/* number of batches in flight, i.e., the capacity of each ring, a power
+   of two */
+#define SWEEP_NUM_BATCHES	16
+
+/* a batch of references */
+struct sweep_batch_t {
+  int nrefs;			/* number of references in the batch */
+  struct sweep_ref_t *refs;	/* references, -sweep:batch entries */
+};
+
+/* all the batches, batch number N is kept in entry N % SWEEP_NUM_BATCHES */
+static struct sweep_batch_t sweep_batches[SWEEP_NUM_BATCHES];
+
+/* batch being filled by the producer, and its number */
+static struct sweep_batch_t *sweep_fill = NULL;
+static unsigned long sweep_fill_num = 0;
+
+/* non-zero once the producer has published its last batch */
+static int sweep_done = FALSE;
+
+/* ring accessors, loads acquire and stores release the ring contents, so
+   a worker sees the references of every batch published to it, and the
+   producer refills a batch only after its last reader is done with it */
+#define RING_LOAD(P)		__atomic_load_n((P), __ATOMIC_ACQUIRE)
+#define RING_STORE(P, V)	__atomic_store_n((P), (V), __ATOMIC_RELEASE)
+
+/* spin this many times on an empty or full ring before yielding the CPU */
+#define RING_SPIN		64
+
+/* sweep point kinds */
+enum sweep_kind_t {
+  sk_cache,			/* cache hierarchy */
+  sk_bpred			/* branch predictor */
+};
+
+/* a sweep point, the simulated structures of a sweep point are only
+   touched by its worker thread once the sweep has started */
+struct sweep_point_t {
+  enum sweep_kind_t kind;	/* kind of sweep point */
+  char *config;			/* configuration string */
+
+  /* cache hierarchy sweep point */
+  struct cache_t *l1;		/* level 1 cache */
+  struct cache_t *l2;		/* level 2 cache, or NULL */
+
+  /* branch predictor sweep point */
+  struct bpred_t *pred;		/* branch predictor */
+
+  /* ring of batches, HEAD is the number of batches published by the
+     producer, TAIL the number of batches consumed by the worker, each is
+     only written by one side */
+  unsigned long head;
+  unsigned long tail;
+
+  pthread_t thread;		/* worker thread */
+};
+
+/* all the sweep points */
+static struct sweep_point_t sweep_points[2 * MAX_SWEEP_POINTS];
+static int sweep_num_points = 0;
+
+/* non-zero while the worker threads are running */
+static int sweep_running = FALSE;
+
+
+/* cache miss handler of the sweep point caches, which are only accessed
+   through cache_warm(), so it is never called */
+static unsigned int			/* latency of block access */
+sweep_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
+		md_addr_t baddr,	/* block address to access */
+		int bsize,		/* size of block to access */
+		struct cache_blk_t *blk,/* ptr to block in upper level */
+		tick_t now)		/* time of access */
+{
+  panic("sweep point caches are only accessed functionally");
+  return 0;
+}
+
+/* create a cache hierarchy sweep point, from CONFIG */
+static void
+sweep_cache_create(struct sweep_point_t *pt,	/* sweep point to create */
+		   char *config)		/* configuration string */
+{
+  char name1[128], name2[128], c1, c2;
+  int nsets1, bsize1, assoc1, nsets2, bsize2, assoc2, nargs;
+
+  nargs = sscanf(config, "%127[^:]:%d:%d:%d:%c,%127[^:]:%d:%d:%d:%c",
+		 name1, &nsets1, &bsize1, &assoc1, &c1,
+		 name2, &nsets2, &bsize2, &assoc2, &c2);
+  if (nargs != 5 && nargs != 10)
+    fatal("bad cache sweep point `%s': "
+	  "<name>:<nsets>:<bsize>:<assoc>:<repl>[,<l2 config>]", config);
+
+  pt->kind = sk_cache;
+  pt->config = config;
+  pt->l1 = cache_create(name1, nsets1, bsize1, /* balloc */FALSE,
+			/* usize */0, assoc1, cache_char2policy(c1),
+			sweep_access_fn, /* hit latency */1);
+  if (nargs == 10)
+    pt->l2 = cache_create(name2, nsets2, bsize2, /* balloc */FALSE,
+			  /* usize */0, assoc2, cache_char2policy(c2),
+			  sweep_access_fn, /* hit latency */1);
+  else
+    pt->l2 = NULL;
+
+  /* the worker threads cannot share the myrand() generator, random
+     replacements are drawn from per-cache generators, seeded here, in
+     sweep point order, so the results are reproducible for a given -seed */
+  cache_seed_rand(pt->l1, (unsigned int)myrand());
+  if (pt->l2)
+    cache_seed_rand(pt->l2, (unsigned int)myrand());
+}
+
+/* create a branch predictor sweep point, from CONFIG */
+static void
+sweep_bpred_create(struct sweep_point_t *pt,	/* sweep point to create */
+		   char *config)		/* configuration string */
+{
+  char type[128];
+  int n[6], nargs;
+
+  nargs = sscanf(config, "%127[^:]:%d:%d:%d:%d:%d:%d",
+		 type, &n[0], &n[1], &n[2], &n[3], &n[4], &n[5]);
+
+  pt->kind = sk_bpred;
+  pt->config = config;
+  if (nargs == 1 && !mystricmp(type, "taken"))
+    pt->pred = bpred_create(BPredTaken, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  else if (nargs == 1 && !mystricmp(type, "nottaken"))
+    pt->pred = bpred_create(BPredNotTaken, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  else if (nargs == 2 && !mystricmp(type, "bimod"))
+    pt->pred = bpred_create(BPred2bit,
+			    /* bimod table size */n[0],
+			    /* 2lev l1 size */0,
+			    /* 2lev l2 size */0,
+			    /* meta table size */0,
+			    /* history reg size */0,
+			    /* history xor address */0,
+			    /* btb sets */btb_config[0],
+			    /* btb assoc */btb_config[1],
+			    /* ret-addr stack size */ras_size);
+  else if (nargs == 5 && !mystricmp(type, "2lev"))
+    pt->pred = bpred_create(BPred2Level,
+			    /* bimod table size */0,
+			    /* 2lev l1 size */n[0],
+			    /* 2lev l2 size */n[1],
+			    /* meta table size */0,
+			    /* history reg size */n[2],
+			    /* history xor address */n[3],
+			    /* btb sets */btb_config[0],
+			    /* btb assoc */btb_config[1],
+			    /* ret-addr stack size */ras_size);
+  else if (nargs == 7 && !mystricmp(type, "comb"))
+    pt->pred = bpred_create(BPredComb,
+			    /* bimod table size */n[0],
+			    /* l1 size */n[1],
+			    /* l2 size */n[2],
+			    /* meta table size */n[5],
+			    /* history reg size */n[3],
+			    /* history xor address */n[4],
+			    /* btb sets */btb_config[0],
+			    /* btb assoc */btb_config[1],
+			    /* ret-addr stack size */ras_size);
+  else
+    fatal("bad branch predictor sweep point `%s'", config);
+}
+
+/* register simulator-specific options */
+void
+sim_reg_options(struct opt_odb_t *odb)
+{
+  opt_reg_header(odb,
+"sim-sweep: This simulator implements a design space sweep driver.  The\n"
+"program is executed once, and its reference stream is fanned out to any\n"
+"number of cache hierarchies and branch predictors (the sweep points), each\n"
+"simulated functionally by a worker thread of its own.  The results of all\n"
+"sweep points are printed in one table.\n"
+		 );
+
+  /* instruction limit */
+  opt_reg_uint(odb, "-max:inst", "maximum number of inst's to execute",
+	       &max_insts, /* default */0,
+	       /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-fastfwd",
+	      "number of insts skipped before simulation starts",
+	      &fastfwd_count, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_string_list(odb, "-sweep:cache",
+		      "cache hierarchy sweep point(s), "
+		      "<l1 config>[,<l2 config>] (mult uses ok)",
+		      sweep_cache_opts, MAX_SWEEP_POINTS, &sweep_cache_nelt,
+		      /* default */NULL, /* print */TRUE, /* format */NULL,
+		      /* accrue */TRUE);
+  opt_reg_note(odb,
+"  The cache configs <l1 config> and <l2 config> have the format of the\n"
+"  sim-cache cache configs, <name>:<nsets>:<bsize>:<assoc>:<repl>.  The\n"
+"  misses and writebacks of the level 1 cache go to the level 2 cache.\n"
+"\n"
+"    Example:   -sweep:cache dl1:256:32:1:l,ul2:1024:64:4:l\n"
+	       );
+  opt_reg_string(odb, "-sweep:refs",
+		 "references simulated by the cache sweep points "
+		 "{data|inst|all}",
+		 &sweep_refs_opt, /* default */"data",
+		 /* print */TRUE, /* format */NULL);
+
+  opt_reg_string_list(odb, "-sweep:bpred",
+		      "branch predictor sweep point(s), <type>[:<args>] "
+		      "(mult uses ok)",
+		      sweep_bpred_opts, MAX_SWEEP_POINTS, &sweep_bpred_nelt,
+		      /* default */NULL, /* print */TRUE, /* format */NULL,
+		      /* accrue */TRUE);
+  opt_reg_note(odb,
+"  The branch predictor sweep points have one of the following formats:\n"
+"\n"
+"    taken\n"
+"    nottaken\n"
+"    bimod:<table_size>\n"
+"    2lev:<l1size>:<l2size>:<hist_size>:<xor>\n"
+"    comb:<table_size>:<l1size>:<l2size>:<hist_size>:<xor>:<meta_table_size>\n"
+"\n"
+"  where the arguments are those of the sim-bpred predictor options.\n"
+"\n"
+"    Example:   -sweep:bpred bimod:2048 -sweep:bpred 2lev:1:1024:8:1\n"
+	       );
+
+  opt_reg_int(odb, "-sweep:ras",
+              "return address stack size of the predictor sweep points",
+              &ras_size, /* default */ras_size,
+              /* print */TRUE, /* format */NULL);
+
+  opt_reg_int_list(odb, "-sweep:btb",
+		   "BTB config of the predictor sweep points "
+		   "(<num_sets> <associativity>)",
+		   btb_config, btb_nelt, &btb_nelt,
+		   /* default */btb_config,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
+  opt_reg_int(odb, "-sweep:batch",
+	      "number of references per batch sent to the sweep points",
+	      &sweep_batch_size, /* default */4096,
+	      /* print */TRUE, /* format */NULL);
+}
+
+/* check simulator-specific option values */
+void
+sim_check_options(struct opt_odb_t *odb, int argc, char **argv)
+{
+  int i;
+
+  if (fastfwd_count < 0 || fastfwd_count >= 2147483647)
+    fatal("bad fast forward count: %d", fastfwd_count);
+
+  if (!mystricmp(sweep_refs_opt, "data"))
+    {
+      sweep_data_refs = TRUE;
+      sweep_inst_refs = FALSE;
+    }
+  else if (!mystricmp(sweep_refs_opt, "inst"))
+    {
+      sweep_data_refs = FALSE;
+      sweep_inst_refs = TRUE;
+    }
+  else if (!mystricmp(sweep_refs_opt, "all"))
+    {
+      sweep_data_refs = TRUE;
+      sweep_inst_refs = TRUE;
+    }
+  else
+    fatal("cannot parse sweep reference type `%s'", sweep_refs_opt);
+
+  if (btb_nelt != 2)
+    fatal("bad btb config (<num_sets> <associativity>)");
+
+  if (sweep_batch_size <= 0)
+    fatal("sweep batch size must be positive");
+
+  /* create the sweep points */
+  for (i=0; i<sweep_cache_nelt; i++)
+    sweep_cache_create(&sweep_points[sweep_num_points++], sweep_cache_opts[i]);
+  for (i=0; i<sweep_bpred_nelt; i++)
+    sweep_bpred_create(&sweep_points[sweep_num_points++], sweep_bpred_opts[i]);
+
+  /* allocate the reference batches */
+  for (i=0; i<SWEEP_NUM_BATCHES; i++)
+    {
+      sweep_batches[i].nrefs = 0;
+      sweep_batches[i].refs =
+	calloc(sweep_batch_size, sizeof(struct sweep_ref_t));
+      if (!sweep_batches[i].refs)
+	fatal("out of virtual memory");
+    }
+}
+
+/* register simulator-specific statistics */
+void
+sim_reg_stats(struct stat_sdb_t *sdb)
+{
+  stat_reg_counter(sdb, "sim_num_insn",
+		   "total number of instructions executed",
+		   &sim_num_insn, sim_num_insn, NULL);
+  stat_reg_counter(sdb, "sim_num_refs",
+		   "total number of loads and stores executed",
+		   &sim_num_refs, 0, NULL);
+  stat_reg_counter(sdb, "sim_num_branches",
+                   "total number of branches executed",
+                   &sim_num_branches, /* initial value */0, /* format */NULL);
+  stat_reg_int(sdb, "sim_elapsed_time",
+	       "total simulation time in seconds",
+	       &sim_elapsed_time, 0, NULL);
+  stat_reg_formula(sdb, "sim_inst_rate",
+		   "simulation speed (in insts/sec)",
+		   "sim_num_insn / sim_elapsed_time", NULL);
+  stat_reg_int(sdb, "sweep_points",
+	       "total number of sweep points",
+	       &sweep_num_points, sweep_num_points, NULL);
+  ld_reg_stats(sdb);
+  mem_reg_stats(mem, sdb);
+}
+
+/* initialize the simulator */
+void
+sim_init(void)
+{
+  sim_num_refs = 0;
+
+  /* allocate and initialize register file */
+  regs_init(&regs);
+
+  /* allocate and initialize memory space */
+  mem = mem_create("mem");
+  mem_init(mem);
+}
+
+/* local machine state accessor */
+static char *					/* err str, NULL for no err */
+sweep_mstate_obj(FILE *stream,			/* output stream */
+		 char *cmd,			/* optional command string */
+		 struct regs_t *regs,		/* register to access */
+		 struct mem_t *mem)		/* memory to access */
+{
+  /* just dump intermediate stats */
+  sim_print_stats(stream);
+
+  /* no error */
+  return NULL;
+}
+
+/* load program into simulated state */
+void
+sim_load_prog(char *fname,		/* program to load */
+	      int argc, char **argv,	/* program arguments */
+	      char **envp)		/* program environment */
+{
+  /* load program text and data, set up environment, memory, and regs */
+  ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
+
+  /* set up the fast functional engine, used to fast forward */
+  fastfwd_init(mem);
+
+  /* initialize the DLite debugger */
+  dlite_init(md_reg_obj, dlite_mem_obj, sweep_mstate_obj);
+}
+
+/* print simulator-specific configuration information */
+void
+sim_aux_config(FILE *stream)		/* output stream */
+{
+  /* nothing currently */
+}
+
+
+/*
+ * sweep point workers
+ */
+
+/* access address ADDR of the cache hierarchy of sweep point PT with a CMD
+   operation, the misses and writebacks of the level 1 cache go to the level
+   2 cache, if any, as the miss handlers of sim-cache would */
+static void
+sweep_cache_access(struct sweep_point_t *pt,	/* cache sweep point */
+		   enum mem_cmd cmd,		/* access type, Read or Write */
+		   md_addr_t addr)		/* address of access */
+{
+  md_addr_t wb_addr;
+
+  if (cache_warm(pt->l1, cmd, addr, &wb_addr) || !pt->l2)
+    return;
+
+  /* write back the replaced block, then fetch the missing block, the
+     writebacks of the level 2 cache go to memory */
+  if (wb_addr)
+    cache_warm(pt->l2, Write, wb_addr, &wb_addr);
+  cache_warm(pt->l2, Read, addr, &wb_addr);
+}
+
+/* simulate the references of BATCH in the cache hierarchy of sweep point PT */
+static void
+sweep_cache_batch(struct sweep_point_t *pt,	/* cache sweep point */
+		  struct sweep_batch_t *batch)	/* references to simulate */
+{
+  int i;
+  struct sweep_ref_t *ref;
+
+  for (i=0; i<batch->nrefs; i++)
+    {
+      ref = &batch->refs[i];
+      if (sweep_inst_refs)
+	sweep_cache_access(pt, Read, ref->PC);
+      if (sweep_data_refs && (ref->flags & SWEEP_MEM))
+	sweep_cache_access(pt, (ref->flags & SWEEP_STORE) ? Write : Read,
+			   ref->addr);
+    }
+}
+
+/* simulate the branches of BATCH in the predictor of sweep point PT */
+static void
+sweep_bpred_batch(struct sweep_point_t *pt,	/* bpred sweep point */
+		  struct sweep_batch_t *batch)	/* references to simulate */
+{
+  int i, stack_idx;
+  md_addr_t pred_PC;
+  struct bpred_update_t update_rec;
+  struct sweep_ref_t *ref;
+
+  for (i=0; i<batch->nrefs; i++)
+    {
+      ref = &batch->refs[i];
+      if (!(ref->flags & SWEEP_CTRL))
+	continue;
+
+      /* get the next predicted fetch address */
+      pred_PC = bpred_lookup(pt->pred,
+			     /* branch addr */ref->PC,
+			     /* target */ref->addr,
+			     /* inst opcode */(enum md_opcode)ref->op,
+			     /* call? */(ref->flags & SWEEP_CALL) != 0,
+			     /* return? */(ref->flags & SWEEP_RETURN) != 0,
+			     /* stash an update ptr */&update_rec,
+			     /* stash return stack ptr */&stack_idx);
+
+      /* valid address returned from branch predictor? */
+      if (!pred_PC)
+	{
+	  /* no predicted taken target, attempt not taken target */
+	  pred_PC = ref->PC + sizeof(md_inst_t);
+	}
+
+      bpred_update(pt->pred,
+		   /* branch addr */ref->PC,
+		   /* resolved branch target */ref->NPC,
+		   /* taken? */ref->NPC != (ref->PC + sizeof(md_inst_t)),
+		   /* pred taken? */pred_PC != (ref->PC + sizeof(md_inst_t)),
+		   /* correct pred? */pred_PC == ref->NPC,
+		   /* opcode */(enum md_opcode)ref->op,
+		   /* predictor update pointer */&update_rec);
+    }
+}
+
+/* sweep point worker thread, simulates the batches published to sweep point
+   ARG until the producer is done */
+static void *
+sweep_worker(void *arg)				/* sweep point to simulate */
+{
+  struct sweep_point_t *pt = arg;
+  struct sweep_batch_t *batch;
+  int spin = 0;
+
+  while (TRUE)
+    {
+      if (pt->tail == RING_LOAD(&pt->head))
+	{
+	  /* the ring is empty, NOTE: the producer publishes its last batch
+	     before it sets SWEEP_DONE, so check the ring once more */
+	  if (RING_LOAD(&sweep_done) && pt->tail == RING_LOAD(&pt->head))
+	    break;
+	  if (++spin >= RING_SPIN)
+	    {
+	      sched_yield();
+	      spin = 0;
+	    }
+	  continue;
+	}
+      spin = 0;
+
+      batch = &sweep_batches[pt->tail & (SWEEP_NUM_BATCHES-1)];
+      if (pt->kind == sk_cache)
+	sweep_cache_batch(pt, batch);
+      else
+	sweep_bpred_batch(pt, batch);
+
+      /* hand the batch back to the producer */
+      RING_STORE(&pt->tail, pt->tail + 1);
+    }
+
+  return NULL;
+}
+
+/* start the sweep point workers */
+static void
+sweep_start(void)
+{
+  int i;
+
+  if (!sweep_num_points)
+    return;
+
+  sweep_fill_num = 0;
+  sweep_fill = &sweep_batches[0];
+  sweep_fill->nrefs = 0;
+
+  for (i=0; i<sweep_num_points; i++)
+    {
+      sweep_points[i].head = 0;
+      sweep_points[i].tail = 0;
+      if (pthread_create(&sweep_points[i].thread, NULL,
+			 sweep_worker, &sweep_points[i]) != 0)
+	fatal("cannot create the worker thread of sweep point `%s'",
+	      sweep_points[i].config);
+    }
+  sweep_running = TRUE;
+}
+
+/* publish the batch being filled to all sweep points, then wait for the
+   next batch to be free, i.e., for all sweep points to be done with the
+   batch last held in its entry */
+static void
+sweep_publish(void)
+{
+  int i, spin = 0;
+
+  sweep_fill_num++;
+  for (i=0; i<sweep_num_points; i++)
+    RING_STORE(&sweep_points[i].head, sweep_fill_num);
+
+  for (i=0; i<sweep_num_points; i++)
+    {
+      while (sweep_fill_num - RING_LOAD(&sweep_points[i].tail)
+	     >= SWEEP_NUM_BATCHES)
+	{
+	  if (++spin >= RING_SPIN)
+	    {
+	      sched_yield();
+	      spin = 0;
+	    }
+	}
+    }
+
+  sweep_fill = &sweep_batches[sweep_fill_num & (SWEEP_NUM_BATCHES-1)];
+  sweep_fill->nrefs = 0;
+}
+
+/* publish the remaining references, and wait for the sweep point workers
+   to finish, no references are sent to the sweep points after this */
+static void
+sweep_finish(void)
+{
+  int i;
+
+  if (!sweep_running)
+    return;
+
+  if (sweep_fill->nrefs)
+    sweep_publish();
+  sweep_fill = NULL;
+  RING_STORE(&sweep_done, TRUE);
+
+  for (i=0; i<sweep_num_points; i++)
+    pthread_join(sweep_points[i].thread, NULL);
+  sweep_running = FALSE;
+}
+
+/* dump simulator-specific auxiliary simulator statistics, i.e., the sweep
+   results, NOTE: this stops the sweep, e.g., if the stats are dumped from
+   DLite, the remaining references are not simulated */
+void
+sim_aux_stats(FILE *stream)		/* output stream */
+{
+  int i;
+  struct sweep_point_t *pt;
+  double refs, misses, l2_refs, l2_misses;
+
+  if (!sweep_num_points)
+    return;
+
+  sweep_finish();
+
+  fprintf(stream, "\nsim: ** sweep results **\n");
+  fprintf(stream,
+	  "# for bpred points, refs are lookups and misses are address "
+	  "mispredictions\n");
+  fprintf(stream, "%5s %-5s %12s %12s %9s %12s %12s %9s  %s\n",
+	  "point", "kind", "refs", "misses", "miss_rate",
+	  "l2_refs", "l2_misses", "miss_rate", "config");
+  for (i=0; i<sweep_num_points; i++)
+    {
+      pt = &sweep_points[i];
+      if (pt->kind == sk_cache)
+	{
+	  refs = (double)(pt->l1->warm_hits + pt->l1->warm_misses);
+	  misses = (double)pt->l1->warm_misses;
+	  fprintf(stream, "%5d %-5s %12.0f %12.0f %9.4f",
+		  i, "cache", refs, misses, refs ? misses / refs : 0.0);
+	  if (pt->l2)
+	    {
+	      l2_refs = (double)(pt->l2->warm_hits + pt->l2->warm_misses);
+	      l2_misses = (double)pt->l2->warm_misses;
+	      fprintf(stream, " %12.0f %12.0f %9.4f", l2_refs, l2_misses,
+		      l2_refs ? l2_misses / l2_refs : 0.0);
+	    }
+	  else
+	    fprintf(stream, " %12s %12s %9s", "-", "-", "-");
+	}
+      else
+	{
+	  refs = (double)pt->pred->lookups;
+	  misses = (double)(pt->pred->lookups - pt->pred->addr_hits);
+	  fprintf(stream, "%5d %-5s %12.0f %12.0f %9.4f %12s %12s %9s",
+		  i, "bpred", refs, misses, refs ? misses / refs : 0.0,
+		  "-", "-", "-");
+	}
+      fprintf(stream, "  %s\n", pt->config);
+    }
+}
+
+/* un-initialize simulator-specific state */
+void
+sim_uninit(void)
+{
+  /* nada */
+}
+
+
+
+/*
+ * configure the execution engine
+ */
+
+/*
+ * precise architected register accessors
+ */
+
+/* next program counter */
+#define SET_NPC(EXPR)		(regs.regs_NPC = (EXPR))
+
+/* target program counter */
+#undef  SET_TPC
+#define SET_TPC(EXPR)		(target_PC = (EXPR))
+
+/* current program counter */
+#define CPC			(regs.regs_PC)
+
+/* general purpose registers */
+#define GPR(N)			(regs.regs_R[N])
+#define SET_GPR(N,EXPR)		(regs.regs_R[N] = (EXPR))
+
+#if defined(TARGET_PISA)
+
+/* floating point registers, L->word, F->single-prec, D->double-prec */
+#define FPR_L(N)		(regs.regs_F.l[(N)])
+#define SET_FPR_L(N,EXPR)	(regs.regs_F.l[(N)] = (EXPR))
+#define FPR_F(N)		(regs.regs_F.f[(N)])
+#define SET_FPR_F(N,EXPR)	(regs.regs_F.f[(N)] = (EXPR))
+#define FPR_D(N)		(regs.regs_F.d[(N) >> 1])
+#define SET_FPR_D(N,EXPR)	(regs.regs_F.d[(N) >> 1] = (EXPR))
+
+/* miscellaneous register accessors */
+#define SET_HI(EXPR)		(regs.regs_C.hi = (EXPR))
+#define HI			(regs.regs_C.hi)
+#define SET_LO(EXPR)		(regs.regs_C.lo = (EXPR))
+#define LO			(regs.regs_C.lo)
+#define FCC			(regs.regs_C.fcc)
+#define SET_FCC(EXPR)		(regs.regs_C.fcc = (EXPR))
+
+#elif defined(TARGET_ALPHA)
+
+/* floating point registers, L->word, F->single-prec, D->double-prec */
+#define FPR_Q(N)		(regs.regs_F.q[N])
+#define SET_FPR_Q(N,EXPR)	(regs.regs_F.q[N] = (EXPR))
+#define FPR(N)			(regs.regs_F.d[N])
+#define SET_FPR(N,EXPR)		(regs.regs_F.d[N] = (EXPR))
+
+/* miscellaneous register accessors */
+#define FPCR			(regs.regs_C.fpcr)
+#define SET_FPCR(EXPR)		(regs.regs_C.fpcr = (EXPR))
+#define UNIQ			(regs.regs_C.uniq)
+#define SET_UNIQ(EXPR)		(regs.regs_C.uniq = (EXPR))
+
+#else
+#error No ISA target defined...
+#endif
+
+/* precise architected memory state help functions */
+#define READ_BYTE(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_BYTE(mem, addr))
+#define READ_HALF(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_HALF(mem, addr))
+#define READ_WORD(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_WORD(mem, addr))
+#ifdef HOST_HAS_QWORD
+#define READ_QWORD(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_QWORD(mem, addr))
+#endif /* HOST_HAS_QWORD */
+
+#define WRITE_BYTE(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_BYTE(mem, addr, (SRC)))
+#define WRITE_HALF(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_HALF(mem, addr, (SRC)))
+#define WRITE_WORD(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_WORD(mem, addr, (SRC)))
+#ifdef HOST_HAS_QWORD
+#define WRITE_QWORD(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_QWORD(mem, addr, (SRC)))
+#endif /* HOST_HAS_QWORD */
+
+/* system call handler macro */
+#define SYSCALL(INST)	sys_syscall(&regs, mem_access, mem, INST, TRUE)
+
+/* start simulation, program loaded, processor precise state initialized */
+void
+sim_main(void)
+{
+  md_inst_t inst;
+  register md_addr_t addr, target_PC = 0;
+  enum md_opcode op;
+  register int is_write;
+  enum md_fault_type fault;
+  int flags, ref_mask, all_refs;
+  struct sweep_ref_t *ref;
+
+  /* fast forward simulator loop, skips FASTFWD_COUNT insts with the fast
+     functional engine of sim-fast, then starts the sweep */
+  if (fastfwd_count > 0)
+    {
+      counter_t icount = 0;
+
+      if (!fastfwd_usable())
+	fatal("fast forwarding cannot swap bytes or words");
+
+      fprintf(stderr, "sim: ** fast forwarding %d insts **\n", fastfwd_count);
+      fastfwd_exec(&regs, mem, &icount, (counter_t)fastfwd_count);
+    }
+
+  /* only send the references of interest to the sweep points, i.e., memory
+     references to data cache points, control transfers to bpred points,
+     and every instruction to instruction cache points */
+  ref_mask = 0;
+  all_refs = FALSE;
+  if (sweep_cache_nelt && sweep_data_refs)
+    ref_mask |= SWEEP_MEM;
+  if (sweep_cache_nelt && sweep_inst_refs)
+    all_refs = TRUE;
+  if (sweep_bpred_nelt)
+    ref_mask |= SWEEP_CTRL;
+
+  fprintf(stderr, "sim: ** starting sweep of %d points **\n",
+	  sweep_num_points);
+  sweep_start();
+
+  /* set up initial default next PC */
+  regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
+
+  /* check for DLite debugger entry condition */
+  if (dlite_check_break(regs.regs_PC, /* no access */0, /* addr */0, 0, 0))
+    dlite_main(regs.regs_PC - sizeof(md_inst_t), regs.regs_PC,
+	       sim_num_insn, &regs, mem);
+
+  while (TRUE)
+    {
+      /* maintain $r0 semantics */
+      regs.regs_R[MD_REG_ZERO] = 0;
+#ifdef TARGET_ALPHA
+      regs.regs_F.d[MD_REG_ZERO] = 0.0;
+#endif /* TARGET_ALPHA */
+
+      /* get the next instruction to execute */
+      MD_FETCH_INST(inst, mem, regs.regs_PC);
+
+      /* keep an instruction count */
+      sim_num_insn++;
+
+      /* set default reference address and access mode */
+      addr = 0; is_write = FALSE;
+
+      /* set default fault - none */
+      fault = md_fault_none;
+
+      /* decode the instruction */
+      MD_SET_OPCODE(op, inst);
+
+      /* execute the instruction */
+      switch (op)
+	{
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+	case OP:							\
+          SYMCAT(OP,_IMPL);						\
+          break;
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+        case OP:							\
+          panic("attempted to execute a linking opcode");
+#define CONNECT(OP)
+#define DECLARE_FAULT(FAULT)						\
+	  { fault = (FAULT); break; }
+#include "machine.def"
+	default:
+	  panic("attempted to execute a bogus opcode");
+      }
+
+      if (fault != md_fault_none)
+	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
+
+      flags = 0;
+      if (MD_OP_FLAGS(op) & F_MEM)
+	{
+	  sim_num_refs++;
+	  flags |= SWEEP_MEM;
+	  if (MD_OP_FLAGS(op) & F_STORE)
+	    {
+	      is_write = TRUE;
+	      flags |= SWEEP_STORE;
+	    }
+	}
+
+      if (MD_OP_FLAGS(op) & F_CTRL)
+	{
+	  sim_num_branches++;
+	  flags |= SWEEP_CTRL;
+	  if (MD_IS_CALL(op))
+	    flags |= SWEEP_CALL;
+	  if (MD_IS_RETURN(op))
+	    flags |= SWEEP_RETURN;
+	}
+
+      /* send the instruction to the sweep points */
+      if (sweep_fill && (all_refs || (flags & ref_mask)))
+	{
+	  ref = &sweep_fill->refs[sweep_fill->nrefs];
+	  ref->PC = regs.regs_PC;
+	  ref->NPC = regs.regs_NPC;
+	  ref->addr = (flags & SWEEP_CTRL) ? target_PC : addr;
+	  ref->op = op;
+	  ref->flags = flags;
+	  if (++sweep_fill->nrefs == sweep_batch_size)
+	    sweep_publish();
+	}
+
+      /* check for DLite debugger entry condition */
+      if (dlite_check_break(regs.regs_NPC,
+			    is_write ? ACCESS_WRITE : ACCESS_READ,
+			    addr, sim_num_insn, sim_num_insn))
+	dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
+
+      /* go to the next instruction */
+      regs.regs_PC = regs.regs_NPC;
+      regs.regs_NPC += sizeof(md_inst_t);
+
+      /* finish early? */
+      if (max_insts && sim_num_insn >= max_insts)
+	return;
+    }
+}
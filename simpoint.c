@@ -0,0 +1,543 @@
+/* simpoint.c - simulation point selection from basic block vectors */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "host.h"
+#include "misc.h"
+#include "options.h"
+
+/*
+ * This file implements a tool that picks simulation points for sampled
+ * simulation, in the manner of SimPoint.  It reads the basic block vectors
+ * written by `sim-profile -bbv:interval', normalizes each interval's vector
+ * and randomly projects it down to a few dimensions, clusters the intervals
+ * with k-means, and picks the number of clusters by the Bayesian Information
+ * Criterion (BIC).  The interval closest to each cluster centroid becomes a
+ * simulation point, weighted by the fraction of all insts in its cluster.
+ * `sim-outorder -simpoint:points' simulates only the simulation points, and
+ * combines their CPI by weight.
+ */
+
+/* options */
+static int help_me;			/* print help message? */
+static int max_k;			/* maximum number of clusters */
+static int proj_dim;			/* random projection dimensions */
+static int init_seed;			/* random number generator seed */
+static int num_inits;			/* k-means initializations per k */
+static int max_iters;			/* maximum k-means iterations */
+static double bic_thresh;		/* BIC score threshold, fraction */
+static char *points_fname;		/* simulation points output file */
+static char *weights_fname;		/* simulation point weights output file */
+
+/* index of the basic block vector file name in argv, -1 if none */
+static int bbv_index = -1;
+
+#ifndef M_PI
+#define M_PI			3.14159265358979323846
+#endif /* !M_PI */
+
+/* intervals read from the basic block vector file */
+static int npts = 0;			/* num intervals */
+static int pts_sz = 0;			/* allocated interval slots */
+static double *pts_vec = NULL;		/* projected vectors, PROJ_DIM each */
+static double *pts_insts = NULL;	/* insts in each interval */
+
+/* vector of interval N */
+#define PT_VEC(N)		(pts_vec + (N) * proj_dim)
+
+/* random projection matrix, one row of PROJ_DIM values per basic block */
+static double *proj = NULL;
+static int proj_nrows = 0;
+
+/* number of distinct basic blocks read */
+static int nblocks = 0;
+
+/* return a uniform random number in [0, 1) */
+static double
+rand_unit(void)
+{
+  double hi = (double)(myrand() & 0xffff), lo = (double)(myrand() & 0xffff);
+
+  return (hi * 65536.0 + lo) / 4294967296.0;
+}
+
+/* squared euclidean distance between vectors A and B */
+static double
+vec_dist(double *a, double *b)
+{
+  int d;
+  double dist = 0.0, diff;
+
+  for (d=0; d<proj_dim; d++)
+    {
+      diff = a[d] - b[d];
+      dist += diff * diff;
+    }
+  return dist;
+}
+
+/* return the random projection row of basic block ID, rows are created in
+   order of block number so the projection only depends on the seed */
+static double *
+proj_row(int id)			/* basic block number, from 1 */
+{
+  int i, sz;
+
+  if (id > proj_nrows)
+    {
+      sz = MAX(id, 2 * proj_nrows);
+      proj = realloc(proj, sz * proj_dim * sizeof(double));
+      if (!proj)
+	fatal("out of virtual memory");
+
+      /* uniform random values in [-1, 1] */
+      for (i = proj_nrows * proj_dim; i < sz * proj_dim; i++)
+	proj[i] = 2.0 * rand_unit() - 1.0;
+      proj_nrows = sz;
+    }
+  return proj + (id - 1) * proj_dim;
+}
+
+/* add an empty interval, returns its vector */
+static double *
+add_interval(void)
+{
+  int d;
+
+  if (npts == pts_sz)
+    {
+      pts_sz = pts_sz ? 2 * pts_sz : 256;
+      pts_vec = realloc(pts_vec, pts_sz * proj_dim * sizeof(double));
+      pts_insts = realloc(pts_insts, pts_sz * sizeof(double));
+      if (!pts_vec || !pts_insts)
+	fatal("out of virtual memory");
+    }
+
+  for (d=0; d<proj_dim; d++)
+    PT_VEC(npts)[d] = 0.0;
+  pts_insts[npts] = 0.0;
+  return PT_VEC(npts++);
+}
+
+/* normalize the vector of the last interval read, so that intervals of
+   different length are comparable */
+static void
+end_interval(void)
+{
+  int d;
+
+  if (npts > 0 && pts_insts[npts-1] > 0.0)
+    {
+      for (d=0; d<proj_dim; d++)
+	PT_VEC(npts-1)[d] /= pts_insts[npts-1];
+    }
+}
+
+/* read the basic block vector file FNAME, one `T' line per interval, with
+   a `:<block>:<insts>' entry for every block executed in the interval */
+static void
+bbv_read(char *fname)			/* basic block vector file name */
+{
+  FILE *fd;
+  int c, d, id;
+  double count, *vec = NULL, *row;
+
+  fd = fopen(fname, "r");
+  if (!fd)
+    fatal("cannot open basic block vector file `%s'", fname);
+
+  while ((c = getc(fd)) != EOF)
+    {
+      if (c == 'T')
+	{
+	  /* next interval */
+	  end_interval();
+	  vec = add_interval();
+	}
+      else if (c == ':')
+	{
+	  if (!vec || fscanf(fd, "%d:%lf", &id, &count) != 2 || id < 1)
+	    fatal("`%s' is not a basic block vector file", fname);
+
+	  /* project the block count */
+	  nblocks = MAX(nblocks, id);
+	  row = proj_row(id);
+	  for (d=0; d<proj_dim; d++)
+	    vec[d] += count * row[d];
+	  pts_insts[npts-1] += count;
+	}
+      else if (c == '#')
+	{
+	  /* comment, skip to end of line */
+	  while ((c = getc(fd)) != EOF && c != '\n')
+	    /* nada */;
+	}
+      else if (!isspace(c))
+	fatal("`%s' is not a basic block vector file", fname);
+    }
+  end_interval();
+
+  fclose(fd);
+}
+
+/* cluster the intervals into K clusters with k-means, seeded by k-means++
+   (i.e., each initial centroid is an interval picked with probability
+   proportional to its squared distance from the nearest centroid picked so
+   far), returns the cluster of each interval in ASSIGN and the cluster
+   centroids in CENT, and returns the total squared distance of the
+   intervals to their centroids */
+static double
+kmeans(int k,				/* number of clusters */
+       int *assign,			/* cluster of each interval */
+       double *cent)			/* K centroids, PROJ_DIM each */
+{
+  int i, c, d, best, iter, changed;
+  int *size;
+  double *near, dist, best_dist, distortion, sum;
+
+  size = calloc(k, sizeof(int));
+  near = calloc(npts, sizeof(double));
+  if (!size || !near)
+    fatal("out of virtual memory");
+
+  /* initial centroids, picked by k-means++ */
+  i = myrand() % npts;
+  for (c=0; c<k; c++)
+    {
+      for (d=0; d<proj_dim; d++)
+	cent[c * proj_dim + d] = PT_VEC(i)[d];
+
+      /* update the distance of each interval to its nearest centroid */
+      sum = 0.0;
+      for (i=0; i<npts; i++)
+	{
+	  dist = vec_dist(PT_VEC(i), cent + c * proj_dim);
+	  if (c == 0 || dist < near[i])
+	    near[i] = dist;
+	  sum += near[i];
+	}
+
+      /* pick the next centroid, any interval if all are covered */
+      sum *= rand_unit();
+      for (i=0; i<npts-1 && sum >= near[i]; i++)
+	sum -= near[i];
+    }
+
+  for (i=0; i<npts; i++)
+    assign[i] = -1;
+
+  for (iter=0; iter<max_iters; iter++)
+    {
+      /* assign each interval to its nearest centroid */
+      changed = 0;
+      for (i=0; i<npts; i++)
+	{
+	  best = 0;
+	  best_dist = vec_dist(PT_VEC(i), cent);
+	  for (c=1; c<k; c++)
+	    {
+	      dist = vec_dist(PT_VEC(i), cent + c * proj_dim);
+	      if (dist < best_dist)
+		{
+		  best = c;
+		  best_dist = dist;
+		}
+	    }
+	  if (assign[i] != best)
+	    {
+	      assign[i] = best;
+	      changed++;
+	    }
+	}
+      if (!changed)
+	break;
+
+      /* move each centroid to the mean of its intervals, an empty cluster
+	 keeps its centroid */
+      for (c=0; c<k; c++)
+	size[c] = 0;
+      for (i=0; i<npts; i++)
+	{
+	  if (size[assign[i]]++ == 0)
+	    {
+	      for (d=0; d<proj_dim; d++)
+		cent[assign[i] * proj_dim + d] = 0.0;
+	    }
+	  for (d=0; d<proj_dim; d++)
+	    cent[assign[i] * proj_dim + d] += PT_VEC(i)[d];
+	}
+      for (c=0; c<k; c++)
+	{
+	  for (d=0; size[c] && d<proj_dim; d++)
+	    cent[c * proj_dim + d] /= size[c];
+	}
+    }
+
+  distortion = 0.0;
+  for (i=0; i<npts; i++)
+    distortion += vec_dist(PT_VEC(i), cent + assign[i] * proj_dim);
+
+  free(size);
+  free(near);
+  return distortion;
+}
+
+/* return the BIC score of clustering ASSIGN into K clusters, with total
+   squared distance DISTORTION, under a spherical gaussian model of each
+   cluster (after Pelleg and Moore's X-means) */
+static double
+bic_score(int k,			/* number of clusters */
+	  int *assign,			/* cluster of each interval */
+	  double distortion)		/* total squared distance */
+{
+  int i, c, *size;
+  double r = (double)npts, m = (double)proj_dim;
+  double var, loglike, params;
+
+  size = calloc(k, sizeof(int));
+  if (!size)
+    fatal("out of virtual memory");
+  for (i=0; i<npts; i++)
+    size[assign[i]]++;
+
+  /* maximum likelihood estimate of the per-dimension variance */
+  var = (npts > k) ? distortion / (m * (r - k)) : 0.0;
+  var = MAX(var, 1.0e-12);
+
+  loglike = -r * m / 2.0 * log(2.0 * M_PI * var) - m * (r - k) / 2.0;
+  for (c=0; c<k; c++)
+    {
+      if (size[c] > 0)
+	loglike += size[c] * log((double)size[c] / r);
+    }
+
+  /* cluster probabilities, centroids and the variance */
+  params = (k - 1) + m * k + 1;
+
+  free(size);
+  return loglike - params / 2.0 * log(r);
+}
+
+/* user-specified argument orphan parser, the first orphan names the basic
+   block vector file */
+static int
+orphan_fn(int i, int argc, char **argv)
+{
+  bbv_index = i;
+  return /* done */FALSE;
+}
+
+int
+main(int argc, char **argv)
+{
+  struct opt_odb_t *odb;
+  int i, k, c, n, best_k, *assign, *best_assign, *rep;
+  double *cent, *best_cent, *bic, *weight, dist;
+  double distortion, best_distortion, min_bic, max_bic, total;
+  FILE *fd;
+
+  odb = opt_new(orphan_fn);
+  opt_reg_header(odb,
+"simpoint: This tool picks simulation points from the basic block vectors\n"
+"written by `sim-profile -bbv:interval', for use by `sim-outorder\n"
+"-simpoint:points'.  Usage: simpoint {-options} <basic block vector file>\n"
+		 );
+  opt_reg_flag(odb, "-h", "print help message",
+	       &help_me, /* default */FALSE, /* !print */FALSE, NULL);
+  opt_reg_int(odb, "-k", "maximum number of clusters (simulation points)",
+	      &max_k, /* default */10, /* print */TRUE, NULL);
+  opt_reg_int(odb, "-dim", "random projection dimensions",
+	      &proj_dim, /* default */15, /* print */TRUE, NULL);
+  opt_reg_int(odb, "-seed", "random number generator seed",
+	      &init_seed, /* default */1, /* print */TRUE, NULL);
+  opt_reg_int(odb, "-inits", "k-means initializations for each k",
+	      &num_inits, /* default */5, /* print */TRUE, NULL);
+  opt_reg_int(odb, "-iters", "maximum k-means iterations",
+	      &max_iters, /* default */100, /* print */TRUE, NULL);
+  opt_reg_double(odb, "-bic",
+		 "pick the fewest clusters scoring this fraction of the BIC "
+		 "range",
+		 &bic_thresh, /* default */0.9, /* print */TRUE, NULL);
+  opt_reg_string(odb, "-points", "simulation points output file",
+		 &points_fname, /* default */"sim.pts",
+		 /* print */TRUE, NULL);
+  opt_reg_string(odb, "-weights", "simulation point weights output file",
+		 &weights_fname, /* default */"sim.wts",
+		 /* print */TRUE, NULL);
+  opt_reg_note(odb,
+"  The simulation points file lists one `<interval> <cluster>' line per\n"
+"  cluster, where <interval> numbers the chosen interval (from 0), and the\n"
+"  weights file lists one `<weight> <cluster>' line per cluster.\n"
+"\n"
+"    Example:   simpoint -k 30 -points gcc.pts -weights gcc.wts gcc.bb\n"
+	       );
+
+  opt_process_options(odb, argc, argv);
+  if (help_me || bbv_index == -1)
+    {
+      opt_print_help(odb, stderr);
+      exit(1);
+    }
+
+  if (max_k < 1)
+    fatal("maximum number of clusters must be at least one");
+  if (proj_dim < 1)
+    fatal("random projection needs at least one dimension");
+  if (num_inits < 1 || max_iters < 1)
+    fatal("k-means needs at least one initialization and iteration");
+  if (bic_thresh < 0.0 || bic_thresh > 1.0)
+    fatal("BIC threshold must be between 0 and 1");
+
+  mysrand(init_seed);
+
+  bbv_read(argv[bbv_index]);
+  if (npts == 0)
+    fatal("no intervals in basic block vector file `%s'", argv[bbv_index]);
+  max_k = MIN(max_k, npts);
+
+  assign = calloc(npts, sizeof(int));
+  best_assign = calloc(max_k * npts, sizeof(int));
+  cent = calloc(max_k * proj_dim, sizeof(double));
+  best_cent = calloc(max_k * max_k * proj_dim, sizeof(double));
+  bic = calloc(max_k + 1, sizeof(double));
+  rep = calloc(max_k, sizeof(int));
+  weight = calloc(max_k, sizeof(double));
+  if (!assign || !best_assign || !cent || !best_cent || !bic
+      || !rep || !weight)
+    fatal("out of virtual memory");
+
+  fprintf(stderr, "simpoint: %d intervals, %d basic blocks\n",
+	  npts, nblocks);
+
+  /* cluster for every k, keeping the best of NUM_INITS initializations */
+  min_bic = max_bic = 0.0;
+  for (k=1; k<=max_k; k++)
+    {
+      best_distortion = 0.0;
+      for (n=0; n<num_inits; n++)
+	{
+	  distortion = kmeans(k, assign, cent);
+	  if (n == 0 || distortion < best_distortion)
+	    {
+	      best_distortion = distortion;
+	      for (i=0; i<npts; i++)
+		best_assign[(k-1) * npts + i] = assign[i];
+	      for (i=0; i<k * proj_dim; i++)
+		best_cent[(k-1) * max_k * proj_dim + i] = cent[i];
+	    }
+	}
+
+      bic[k] = bic_score(k, best_assign + (k-1) * npts, best_distortion);
+      if (k == 1 || bic[k] < min_bic)
+	min_bic = bic[k];
+      if (k == 1 || bic[k] > max_bic)
+	max_bic = bic[k];
+      fprintf(stderr, "simpoint: k = %2d, distortion = %g, BIC = %g\n",
+	      k, best_distortion, bic[k]);
+    }
+
+  /* pick the fewest clusters that score well enough */
+  for (best_k=1; best_k<max_k; best_k++)
+    {
+      if (bic[best_k] >= min_bic + bic_thresh * (max_bic - min_bic))
+	break;
+    }
+  memcpy(assign, best_assign + (best_k-1) * npts, npts * sizeof(int));
+  memcpy(cent, best_cent + (best_k-1) * max_k * proj_dim,
+	 best_k * proj_dim * sizeof(double));
+
+  /* the simulation point of a cluster is its interval closest to the
+     centroid, weighted by the cluster's fraction of all insts */
+  total = 0.0;
+  for (c=0; c<best_k; c++)
+    {
+      rep[c] = -1;
+      weight[c] = 0.0;
+    }
+  for (i=0; i<npts; i++)
+    {
+      c = assign[i];
+      dist = vec_dist(PT_VEC(i), cent + c * proj_dim);
+      if (rep[c] == -1
+	  || dist < vec_dist(PT_VEC(rep[c]), cent + c * proj_dim))
+	rep[c] = i;
+      weight[c] += pts_insts[i];
+      total += pts_insts[i];
+    }
+
+  if (!(fd = fopen(points_fname, "w")))
+    fatal("cannot open simulation points file `%s'", points_fname);
+  for (c=0, n=0; c<best_k; c++)
+    {
+      if (rep[c] != -1)
+	fprintf(fd, "%d %d\n", rep[c], n++);
+    }
+  fclose(fd);
+
+  if (!(fd = fopen(weights_fname, "w")))
+    fatal("cannot open simulation point weights file `%s'", weights_fname);
+  for (c=0, n=0; c<best_k; c++)
+    {
+      if (rep[c] != -1)
+	fprintf(fd, "%.6f %d\n", total > 0.0 ? weight[c] / total : 0.0, n++);
+    }
+  fclose(fd);
+
+  fprintf(stderr, "simpoint: picked %d simulation points (k = %d)\n",
+	  n, best_k);
+
+  exit(0);
+}
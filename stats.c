@@ -1026,6 +1026,141 @@ stat_find_stat(struct stat_sdb_t *sdb,	/* stat database */
   return stat;
 }
 
+/* return the number of scalar stat variables in stat database SDB */
+int
+stat_num_scalars(struct stat_sdb_t *sdb)	/* stat database */
+{
+  int n = 0;
+  struct stat_stat_t *stat;
+
+  for (stat = sdb->stats; stat != NULL; stat = stat->next)
+    {
+      if (stat->sc != sc_dist && stat->sc != sc_sdist
+	  && stat->sc != sc_formula)
+	n++;
+    }
+  return n;
+}
+
+/* save the values of the scalar stat variables of stat database SDB to
+   VALS, which holds stat_num_scalars() values, in database order */
+void
+stat_save_scalars(struct stat_sdb_t *sdb,	/* stat database */
+		  union stat_value_t *vals)	/* saved values */
+{
+  struct stat_stat_t *stat;
+
+  for (stat = sdb->stats; stat != NULL; stat = stat->next)
+    {
+      switch (stat->sc)
+	{
+	case sc_int:
+	  (vals++)->for_int = *stat->variant.for_int.var;
+	  break;
+	case sc_uint:
+	  (vals++)->for_uint = *stat->variant.for_uint.var;
+	  break;
+#ifdef HOST_HAS_QWORD
+	case sc_qword:
+	  (vals++)->for_qword = *stat->variant.for_qword.var;
+	  break;
+	case sc_sqword:
+	  (vals++)->for_sqword = *stat->variant.for_sqword.var;
+	  break;
+#endif /* HOST_HAS_QWORD */
+	case sc_float:
+	  (vals++)->for_float = *stat->variant.for_float.var;
+	  break;
+	case sc_double:
+	  (vals++)->for_double = *stat->variant.for_double.var;
+	  break;
+	default:
+	  /* not a scalar */;
+	}
+    }
+}
+
+/* restore the scalar stat variables of stat database SDB from VALS */
+void
+stat_restore_scalars(struct stat_sdb_t *sdb,	/* stat database */
+		     union stat_value_t *vals)	/* saved values */
+{
+  struct stat_stat_t *stat;
+
+  for (stat = sdb->stats; stat != NULL; stat = stat->next)
+    {
+      switch (stat->sc)
+	{
+	case sc_int:
+	  *stat->variant.for_int.var = (vals++)->for_int;
+	  break;
+	case sc_uint:
+	  *stat->variant.for_uint.var = (vals++)->for_uint;
+	  break;
+#ifdef HOST_HAS_QWORD
+	case sc_qword:
+	  *stat->variant.for_qword.var = (vals++)->for_qword;
+	  break;
+	case sc_sqword:
+	  *stat->variant.for_sqword.var = (vals++)->for_sqword;
+	  break;
+#endif /* HOST_HAS_QWORD */
+	case sc_float:
+	  *stat->variant.for_float.var = (vals++)->for_float;
+	  break;
+	case sc_double:
+	  *stat->variant.for_double.var = (vals++)->for_double;
+	  break;
+	default:
+	  /* not a scalar */;
+	}
+    }
+}
+
+/* add to each scalar stat variable of stat database SDB its change from the
+   saved values BASE to the saved values VALS, e.g., to merge in the stats
+   of a copy of the program that ran on from BASE to VALS */
+void
+stat_add_scalars(struct stat_sdb_t *sdb,	/* stat database */
+		 union stat_value_t *vals,	/* final values */
+		 union stat_value_t *base)	/* initial values */
+{
+  struct stat_stat_t *stat;
+
+  for (stat = sdb->stats; stat != NULL; stat = stat->next)
+    {
+      switch (stat->sc)
+	{
+	case sc_int:
+	  *stat->variant.for_int.var += vals->for_int - base->for_int;
+	  break;
+	case sc_uint:
+	  *stat->variant.for_uint.var += vals->for_uint - base->for_uint;
+	  break;
+#ifdef HOST_HAS_QWORD
+	case sc_qword:
+	  *stat->variant.for_qword.var += vals->for_qword - base->for_qword;
+	  break;
+	case sc_sqword:
+	  *stat->variant.for_sqword.var +=
+	    vals->for_sqword - base->for_sqword;
+	  break;
+#endif /* HOST_HAS_QWORD */
+	case sc_float:
+	  *stat->variant.for_float.var += vals->for_float - base->for_float;
+	  break;
+	case sc_double:
+	  *stat->variant.for_double.var +=
+	    vals->for_double - base->for_double;
+	  break;
+	default:
+	  /* not a scalar */
+	  continue;
+	}
+      vals++, base++;
+    }
+}
+
 #ifdef TESTIT
 
 void
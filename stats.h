@@ -328,5 +328,41 @@ stat_print_stats(struct stat_sdb_t *sdb,/* stat database */
 struct stat_stat_t *
 stat_find_stat(struct stat_sdb_t *sdb,	/* stat database */
 	       char *stat_name);	/* stat name */
+
+/* value of a scalar stat variable, i.e., of an integer or floating point
+   stat variable, distributions and formulas are not scalars */
+union stat_value_t {
+  int for_int;				/* sc == sc_int */
+  unsigned int for_uint;		/* sc == sc_uint */
+#ifdef HOST_HAS_QWORD
+  qword_t for_qword;			/* sc == sc_qword */
+  sqword_t for_sqword;			/* sc == sc_sqword */
+#endif /* HOST_HAS_QWORD */
+  float for_float;			/* sc == sc_float */
+  double for_double;			/* sc == sc_double */
+};
+
+/* return the number of scalar stat variables in stat database SDB */
+int
+stat_num_scalars(struct stat_sdb_t *sdb);	/* stat database */
+
+/* save the values of the scalar stat variables of stat database SDB to
+   VALS, which holds stat_num_scalars() values, in database order */
+void
+stat_save_scalars(struct stat_sdb_t *sdb,	/* stat database */
+		  union stat_value_t *vals);	/* saved values */
+
+/* restore the scalar stat variables of stat database SDB from VALS */
+void
+stat_restore_scalars(struct stat_sdb_t *sdb,	/* stat database */
+		     union stat_value_t *vals);	/* saved values */
+
+/* add to each scalar stat variable of stat database SDB its change from the
+   saved values BASE to the saved values VALS, e.g., to merge in the stats
+   of a copy of the program that ran on from BASE to VALS */
+void
+stat_add_scalars(struct stat_sdb_t *sdb,	/* stat database */
+		 union stat_value_t *vals,	/* final values */
+		 union stat_value_t *base);	/* initial values */
 	       
 #endif /* STAT_H */
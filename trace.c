@@ -0,0 +1,604 @@
+/* trace.c - binary instruction and memory reference trace routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif /* !_MSC_VER */
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "trace.h"
+
+/* trace file magic number */
+#define TRACE_MAGIC		"SStrace1"
+
+/* size of the trace file header, and of a chunk header */
+#define TRACE_HDR_SIZE		40
+#define TRACE_CHUNK_HDR_SIZE	8
+
+/* instruction event tag bit, set if the PC is not the one expected */
+#define TRACE_NEWPC		0x40
+
+/* width of md_addr_t, in bits */
+#define ADDR_BITS		(sizeof(md_addr_t) * 8)
+
+/* map signed address delta D to an unsigned value, small in magnitude
+   deltas map to small values, and back */
+#define ZIGZAG(D)	(((D) << 1) ^ ((md_addr_t)0 - ((D) >> (ADDR_BITS - 1))))
+#define UNZIGZAG(Z)	(((Z) >> 1) ^ ((md_addr_t)0 - ((Z) & 1)))
+
+
+/*
+ * trace writer
+ */
+
+/* write V to FD in little-endian byte order, in N bytes */
+static void
+trace_put_int(FILE *fd,				/* file to write */
+	      qword_t v,			/* value to write */
+	      int n)				/* bytes to write */
+{
+  int i;
+
+  for (i=0; i < n; i++)
+    fputc((int)((v >> (8 * i)) & 0xff), fd);
+}
+
+/* append byte C to the encoded events of the current chunk */
+static void
+trace_put(struct trace_t *t,			/* trace being written */
+	  int c)				/* byte to append */
+{
+  if (t->buf_len == t->buf_size)
+    {
+      t->buf_size = t->buf_size ? 2 * t->buf_size : 65536;
+      t->buf = (unsigned char *)realloc(t->buf, t->buf_size);
+      if (!t->buf)
+	fatal("out of virtual memory");
+    }
+  t->buf[t->buf_len++] = (unsigned char)c;
+}
+
+/* append V as a variable-length integer, seven bits per byte, least
+   significant bits first, the top bit of each byte set if more follow */
+static void
+trace_put_var(struct trace_t *t,		/* trace being written */
+	      md_addr_t v)			/* value to append */
+{
+  while (v >= 0x80)
+    {
+      trace_put(t, (int)(v & 0x7f) | 0x80);
+      v >>= 7;
+    }
+  trace_put(t, (int)v);
+}
+
+/* append the delta of V from BASE */
+static void
+trace_put_delta(struct trace_t *t,		/* trace being written */
+		md_addr_t v,			/* value to append */
+		md_addr_t base)			/* expected value */
+{
+  md_addr_t d = v - base;
+
+  trace_put_var(t, ZIGZAG(d));
+}
+
+/* create trace file FNAME for writing */
+struct trace_t *				/* trace */
+trace_create(char *fname)			/* trace file name */
+{
+  struct trace_t *t;
+
+  t = (struct trace_t *)calloc(1, sizeof(struct trace_t));
+  if (!t)
+    fatal("out of virtual memory");
+  t->fname = mystrdup(fname);
+  t->writing = TRUE;
+
+  t->fd = fopen(fname, "wb");
+  if (!t->fd)
+    fatal("cannot open trace file `%s'", fname);
+
+  /* the header is filled in when the trace is closed */
+  trace_put_int(t->fd, 0, TRACE_HDR_SIZE);
+  t->offset = TRACE_HDR_SIZE;
+
+  return t;
+}
+
+/* write out the current chunk, if it holds any insts */
+static void
+trace_end_chunk(struct trace_t *t)		/* trace being written */
+{
+  if (t->chunk_insts == 0)
+    return;
+
+  /* index the chunk */
+  if (t->num_chunks == t->index_size)
+    {
+      t->index_size = t->index_size ? 2 * t->index_size : 1024;
+      t->index = (qword_t *)realloc(t->index,
+				    2 * t->index_size * sizeof(qword_t));
+      if (!t->index)
+	fatal("out of virtual memory");
+    }
+  t->index[2 * t->num_chunks] = t->offset;
+  t->index[2 * t->num_chunks + 1] = t->num_insts - t->chunk_insts;
+  t->num_chunks++;
+
+  trace_put_int(t->fd, t->chunk_insts, 4);
+  trace_put_int(t->fd, t->buf_len, 4);
+  if (fwrite(t->buf, 1, t->buf_len, t->fd) != (size_t)t->buf_len)
+    fatal("cannot write trace file `%s'", t->fname);
+  t->offset += TRACE_CHUNK_HDR_SIZE + t->buf_len;
+
+  /* the next chunk decodes on its own */
+  t->buf_len = 0;
+  t->chunk_insts = 0;
+  t->next_PC = 0;
+  t->last_addr = 0;
+}
+
+/* encode the pending instruction and its memory references */
+static void
+trace_put_inst(struct trace_t *t)		/* trace being written */
+{
+  int i, tag, nbytes;
+  struct trace_ev_t *ev = &t->inst;
+
+  if (!t->inst_valid)
+    return;
+
+  if (t->chunk_insts == TRACE_CHUNK_INSTS)
+    trace_end_chunk(t);
+
+  tag = ev->flags;
+  if (ev->PC != t->next_PC)
+    tag |= TRACE_NEWPC;
+  trace_put(t, tag);
+  if (tag & TRACE_NEWPC)
+    trace_put_delta(t, ev->PC, t->next_PC);
+
+  if (ev->flags & TRACE_CTRL)
+    {
+      trace_put_var(t, (md_addr_t)ev->op);
+      trace_put_delta(t, ev->NPC, ev->PC + sizeof(md_inst_t));
+      trace_put_delta(t, ev->target_PC, ev->NPC);
+      t->next_PC = ev->NPC;
+    }
+  else
+    t->next_PC = ev->PC + sizeof(md_inst_t);
+
+  for (i=0; i < t->num_refs; i++)
+    {
+      ev = &t->refs[i];
+      nbytes = (ev->nbytes > 0 && ev->nbytes < 32) ? ev->nbytes : 0;
+      trace_put(t, ev->flags | (nbytes << 2));
+      if (!nbytes)
+	trace_put_var(t, (md_addr_t)ev->nbytes);
+      trace_put_delta(t, ev->addr, t->last_addr);
+      t->last_addr = ev->addr;
+    }
+
+  t->chunk_insts++;
+  t->num_insts++;
+  t->inst_valid = FALSE;
+  t->num_refs = 0;
+}
+
+/* start the instruction event of an instruction at PC, with opcode OP and
+   instruction flags FLAGS, the memory references made by the instruction
+   follow, and, for control instructions, its outcome (see trace_ctrl()) */
+void
+trace_inst(struct trace_t *t,			/* trace being written */
+	   int flags,				/* instruction flags */
+	   md_addr_t PC,			/* inst address */
+	   enum md_opcode op)			/* inst opcode */
+{
+  trace_put_inst(t);
+
+  t->inst.flags = flags;
+  t->inst.PC = PC;
+  t->inst.op = op;
+  t->inst.NPC = PC + sizeof(md_inst_t);
+  t->inst.target_PC = 0;
+  t->inst_valid = TRUE;
+}
+
+/* record the outcome of the current control instruction */
+void
+trace_ctrl(struct trace_t *t,			/* trace being written */
+	   md_addr_t NPC,			/* next inst address */
+	   md_addr_t target_PC)			/* branch target */
+{
+  if (!t->inst_valid || !(t->inst.flags & TRACE_CTRL))
+    panic("control outcome without a control instruction");
+
+  t->inst.NPC = NPC;
+  t->inst.target_PC = target_PC;
+}
+
+/* record a memory reference of NBYTES at ADDR made by the current
+   instruction, FLAGS are memory reference flags */
+void
+trace_ref(struct trace_t *t,			/* trace being written */
+	  int flags,				/* memory reference flags */
+	  md_addr_t addr,			/* address accessed */
+	  int nbytes)				/* size of the access */
+{
+  if (!t->inst_valid)
+    panic("memory reference without an instruction");
+
+  if (t->num_refs == t->refs_size)
+    {
+      t->refs_size = t->refs_size ? 2 * t->refs_size : 16;
+      t->refs = (struct trace_ev_t *)
+	realloc(t->refs, t->refs_size * sizeof(struct trace_ev_t));
+      if (!t->refs)
+	fatal("out of virtual memory");
+    }
+  t->refs[t->num_refs].flags = TRACE_REF | flags;
+  t->refs[t->num_refs].addr = addr;
+  t->refs[t->num_refs].nbytes = nbytes;
+  t->num_refs++;
+}
+
+
+/*
+ * trace replay
+ */
+
+/* return the N byte little-endian integer at P */
+static qword_t
+trace_get_int(unsigned char *p,			/* bytes to decode */
+	      int n)				/* number of bytes */
+{
+  int i;
+  qword_t v = 0;
+
+  for (i=0; i < n; i++)
+    v |= (qword_t)p[i] << (8 * i);
+  return v;
+}
+
+/* decode a variable-length integer */
+static md_addr_t
+trace_get_var(struct trace_t *t)		/* trace being replayed */
+{
+  md_addr_t v = 0;
+  unsigned int shift = 0;
+  int c;
+
+  do
+    {
+      if (t->pos == t->end || shift >= ADDR_BITS)
+	fatal("trace file `%s' is corrupt", t->fname);
+      c = *t->pos++;
+      v |= (md_addr_t)(c & 0x7f) << shift;
+      shift += 7;
+    }
+  while (c & 0x80);
+
+  return v;
+}
+
+/* decode a delta from BASE */
+static md_addr_t
+trace_get_delta(struct trace_t *t,		/* trace being replayed */
+		md_addr_t base)			/* expected value */
+{
+  md_addr_t z = trace_get_var(t);
+
+  return base + UNZIGZAG(z);
+}
+
+/* return non-zero if file FNAME is a trace file */
+int
+trace_valid(char *fname)			/* file name */
+{
+  FILE *fd;
+  char buf[sizeof(TRACE_MAGIC)];
+  int valid;
+
+  fd = fopen(fname, "rb");
+  if (!fd)
+    return FALSE;
+  valid = (fread(buf, 1, 8, fd) == 8 && !strncmp(buf, TRACE_MAGIC, 8));
+  fclose(fd);
+
+  return valid;
+}
+
+/* open trace file FNAME for replay */
+struct trace_t *				/* trace */
+trace_open(char *fname)				/* trace file name */
+{
+  struct trace_t *t;
+  qword_t index_offset;
+#ifndef _MSC_VER
+  int fd;
+  struct stat sbuf;
+#else /* _MSC_VER */
+  FILE *fd;
+#endif /* _MSC_VER */
+
+  t = (struct trace_t *)calloc(1, sizeof(struct trace_t));
+  if (!t)
+    fatal("out of virtual memory");
+  t->fname = mystrdup(fname);
+  t->writing = FALSE;
+
+#ifndef _MSC_VER
+  /* map the trace file, the events are decoded in place */
+  fd = open(fname, O_RDONLY);
+  if (fd < 0 || fstat(fd, &sbuf) < 0)
+    fatal("cannot open trace file `%s'", fname);
+  t->map_size = sbuf.st_size;
+  if (t->map_size < TRACE_HDR_SIZE)
+    fatal("trace file `%s' is corrupt", fname);
+  t->map = (unsigned char *)mmap(NULL, t->map_size, PROT_READ, MAP_PRIVATE,
+				 fd, 0);
+  if (t->map == (unsigned char *)MAP_FAILED)
+    fatal("cannot map trace file `%s'", fname);
+  close(fd);
+#else /* _MSC_VER */
+  /* no mmap(), read the trace file into memory */
+  fd = fopen(fname, "rb");
+  if (!fd)
+    fatal("cannot open trace file `%s'", fname);
+  fseek(fd, 0, SEEK_END);
+  t->map_size = ftell(fd);
+  fseek(fd, 0, SEEK_SET);
+  if (t->map_size < TRACE_HDR_SIZE)
+    fatal("trace file `%s' is corrupt", fname);
+  t->map = (unsigned char *)malloc(t->map_size);
+  if (!t->map)
+    fatal("out of virtual memory");
+  if (fread(t->map, 1, t->map_size, fd) != t->map_size)
+    fatal("cannot read trace file `%s'", fname);
+  fclose(fd);
+#endif /* _MSC_VER */
+
+  /* check the header */
+  if (strncmp((char *)t->map, TRACE_MAGIC, 8))
+    fatal("`%s' is not a trace file", fname);
+  if (trace_get_int(t->map + 8, 4) != sizeof(md_addr_t)
+      || trace_get_int(t->map + 12, 4) != OP_MAX)
+    fatal("trace file `%s' was written for another target", fname);
+  t->num_insts = (counter_t)trace_get_int(t->map + 16, 8);
+  t->num_chunks = (counter_t)trace_get_int(t->map + 24, 8);
+  index_offset = trace_get_int(t->map + 32, 8);
+  if (index_offset < TRACE_HDR_SIZE
+      || index_offset > t->map_size
+      || (t->map_size - index_offset) / 16 < (qword_t)t->num_chunks)
+    fatal("trace file `%s' is corrupt, or was not closed", fname);
+  t->index = (qword_t *)(t->map + index_offset);
+
+  /* start before the first chunk */
+  t->pos = t->end = NULL;
+  t->chunk = 0;
+
+  return t;
+}
+
+/* enter chunk N of trace T, returns the number of the first inst of the
+   chunk */
+static counter_t
+trace_enter_chunk(struct trace_t *t,		/* trace being replayed */
+		  counter_t n)			/* chunk to enter */
+{
+  unsigned char *idx = (unsigned char *)t->index + 16 * n;
+  qword_t offset, nbytes;
+
+  offset = trace_get_int(idx, 8);
+  if (offset < TRACE_HDR_SIZE
+      || offset > t->map_size - TRACE_CHUNK_HDR_SIZE)
+    fatal("trace file `%s' is corrupt", t->fname);
+  nbytes = trace_get_int(t->map + offset + 4, 4);
+  if (nbytes > t->map_size - offset - TRACE_CHUNK_HDR_SIZE)
+    fatal("trace file `%s' is corrupt", t->fname);
+
+  t->pos = t->map + offset + TRACE_CHUNK_HDR_SIZE;
+  t->end = t->pos + nbytes;
+  t->chunk = n + 1;
+  t->next_PC = 0;
+  t->last_addr = 0;
+
+  return (counter_t)trace_get_int(idx + 8, 8);
+}
+
+/* read the next event of trace T into EV, returns zero at the end of the
+   trace */
+int
+trace_read(struct trace_t *t,			/* trace being replayed */
+	   struct trace_ev_t *ev)		/* event read */
+{
+  int tag, nbytes;
+
+  while (t->pos == t->end)
+    {
+      if (t->chunk >= t->num_chunks)
+	return FALSE;
+      trace_enter_chunk(t, t->chunk);
+    }
+
+  tag = *t->pos++;
+  if (tag & TRACE_REF)
+    {
+      /* memory reference event */
+      ev->flags = tag & (TRACE_REF|TRACE_WRITE|TRACE_SYS);
+      nbytes = (tag >> 2) & 0x1f;
+      ev->nbytes = nbytes ? nbytes : (int)trace_get_var(t);
+      ev->addr = t->last_addr = trace_get_delta(t, t->last_addr);
+    }
+  else
+    {
+      /* instruction event */
+      ev->flags = tag & ~TRACE_NEWPC;
+      ev->PC = t->next_PC;
+      if (tag & TRACE_NEWPC)
+	ev->PC = trace_get_delta(t, t->next_PC);
+      ev->NPC = ev->PC + sizeof(md_inst_t);
+      if (tag & TRACE_CTRL)
+	{
+	  ev->op = (enum md_opcode)trace_get_var(t);
+	  if (ev->op <= OP_NA || ev->op >= OP_MAX)
+	    fatal("trace file `%s' is corrupt", t->fname);
+	  ev->NPC = trace_get_delta(t, ev->NPC);
+	  ev->target_PC = trace_get_delta(t, ev->NPC);
+	}
+      t->next_PC = ev->NPC;
+    }
+
+  return TRUE;
+}
+
+/* position trace T at instruction N, i.e., the next event read is the
+   instruction event of the (N+1)-th instruction of the trace */
+void
+trace_seek(struct trace_t *t,			/* trace being replayed */
+	   counter_t n)				/* insts to skip */
+{
+  counter_t lo, hi, mid, first;
+  struct trace_ev_t ev;
+  unsigned char *pos;
+  md_addr_t next_PC, last_addr;
+
+  if (n >= t->num_insts)
+    {
+      /* past the end of the trace */
+      t->pos = t->end = NULL;
+      t->chunk = t->num_chunks;
+      return;
+    }
+
+  /* find the last chunk that starts at or before inst N */
+  lo = 0; hi = t->num_chunks - 1;
+  while (lo < hi)
+    {
+      mid = (lo + hi + 1) / 2;
+      if ((counter_t)trace_get_int((unsigned char *)t->index + 16 * mid + 8,
+				   8) <= n)
+	lo = mid;
+      else
+	hi = mid - 1;
+    }
+  first = trace_enter_chunk(t, lo);
+
+  /* skip the events before inst N within the chunk */
+  for (;;)
+    {
+      pos = t->pos;
+      next_PC = t->next_PC;
+      last_addr = t->last_addr;
+      if (!trace_read(t, &ev))
+	break;
+      if (!(ev.flags & TRACE_REF) && first++ == n)
+	{
+	  /* read inst N again on the next trace_read() */
+	  t->pos = pos;
+	  t->next_PC = next_PC;
+	  t->last_addr = last_addr;
+	  break;
+	}
+    }
+}
+
+/* finish and close trace T, open for writing or for replay */
+void
+trace_close(struct trace_t *t)			/* trace to close */
+{
+  counter_t i;
+
+  if (t->writing)
+    {
+      /* write out the last inst and chunk, then the index */
+      trace_put_inst(t);
+      trace_end_chunk(t);
+      for (i=0; i < 2 * t->num_chunks; i++)
+	trace_put_int(t->fd, t->index[i], 8);
+
+      /* fill in the header */
+      fseek(t->fd, 0, SEEK_SET);
+      fwrite(TRACE_MAGIC, 1, 8, t->fd);
+      trace_put_int(t->fd, sizeof(md_addr_t), 4);
+      trace_put_int(t->fd, OP_MAX, 4);
+      trace_put_int(t->fd, t->num_insts, 8);
+      trace_put_int(t->fd, t->num_chunks, 8);
+      trace_put_int(t->fd, t->offset, 8);
+      if (fclose(t->fd) != 0)
+	fatal("cannot write trace file `%s'", t->fname);
+
+      free(t->buf);
+      free(t->index);
+      free(t->refs);
+    }
+  else
+    {
+#ifndef _MSC_VER
+      munmap(t->map, t->map_size);
+#else /* _MSC_VER */
+      free(t->map);
+#endif /* _MSC_VER */
+    }
+
+  free(t->fname);
+  free(t);
+}
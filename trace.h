@@ -0,0 +1,208 @@
+/* trace.h - binary instruction and memory reference trace interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+
+/*
+ * This module implements a compact binary trace of the instructions executed
+ * by a program and of the memory references they make, which is written
+ * once, by sim-fast, and replayed by the trace-driven simulators (sim-cache
+ * and sim-bpred) in place of executing the program.  The trace is a
+ * sequence of events: one instruction event per instruction executed,
+ * followed by one memory reference event per memory access the instruction
+ * makes, including the accesses of system calls.  Events are grouped in
+ * chunks of TRACE_CHUNK_INSTS instructions; within a chunk, each PC and
+ * address is encoded as a variable-length delta from the PC or address
+ * expected from the previous event, so a typical instruction takes one
+ * byte, and each chunk decodes on its own.  An index of the chunks at the
+ * end of the file allows seeking to any instruction.  The replay side maps
+ * the file into memory and decodes the events in place, with no allocation
+ * per event.
+ *
+ * The format of a trace file is:
+ *
+ *   header:	magic[8] addr_bytes:u32 num_ops:u32
+ *		num_insts:u64 num_chunks:u64 index_offset:u64
+ *   chunks:	num_insts:u32 num_bytes:u32 events[num_bytes]
+ *   index:	offset:u64 first_inst:u64, one per chunk
+ *
+ * All integers are little-endian.  An instruction event is a tag byte (the
+ * instruction flags below, with the TRACE_REF bit clear), then, if the PC is
+ * not the one expected, the PC delta, then, for control instructions, the
+ * opcode, the next PC delta from the fall-through PC and the branch target
+ * delta from the next PC.  A memory reference event is a tag byte (the
+ * TRACE_REF bit set, the reference flags and the access size, if less than
+ * 32 bytes), then the access size otherwise, then the address delta from
+ * the previous address referenced.
+ */
+
+/* instruction event flags */
+#define TRACE_CTRL	0x01		/* control transfer */
+#define TRACE_CALL	0x02		/* function call */
+#define TRACE_RETURN	0x04		/* function return */
+#define TRACE_TRAP	0x08		/* trap, i.e., system call */
+#define TRACE_MEM	0x10		/* load or store */
+#define TRACE_STORE	0x20		/* store */
+
+/* memory reference event flags */
+#define TRACE_REF	0x80		/* memory reference event */
+#define TRACE_WRITE	0x01		/* write access */
+#define TRACE_SYS	0x02		/* access made by a system call */
+
+/* instructions per chunk */
+#define TRACE_CHUNK_INSTS	65536
+
+/* one trace event */
+struct trace_ev_t {
+  int flags;			/* event flags, see above */
+
+  /* instruction events */
+  md_addr_t PC;			/* address of the instruction */
+  md_addr_t NPC;		/* address of the next instruction */
+  md_addr_t target_PC;		/* branch target, control insts only */
+  enum md_opcode op;		/* opcode, control insts only */
+
+  /* memory reference events */
+  md_addr_t addr;		/* address accessed */
+  int nbytes;			/* size of the access */
+};
+
+/* a trace file, open for writing or for replay */
+struct trace_t {
+  char *fname;			/* trace file name */
+  int writing;			/* non-zero if open for writing */
+  counter_t num_insts;		/* insts in the trace */
+  counter_t num_chunks;		/* chunks in the trace */
+
+  /* decoder/encoder state, reset at each chunk */
+  md_addr_t next_PC;		/* PC expected for the next inst */
+  md_addr_t last_addr;		/* last address referenced */
+
+  /* writer state */
+  FILE *fd;			/* trace file */
+  qword_t offset;		/* file offset of the current chunk */
+  int chunk_insts;		/* insts in the current chunk */
+  unsigned char *buf;		/* encoded events of the current chunk */
+  int buf_len, buf_size;	/* bytes used and allocated in BUF */
+  qword_t *index;		/* chunk index, two entries per chunk */
+  int index_size;		/* chunks allocated in INDEX */
+  struct trace_ev_t inst;	/* pending inst, written with its refs */
+  int inst_valid;		/* non-zero if INST is pending */
+  struct trace_ev_t *refs;	/* pending memory references of INST */
+  int num_refs, refs_size;	/* refs used and allocated in REFS */
+
+  /* replay state */
+  unsigned char *map;		/* trace file contents */
+  qword_t map_size;		/* size of the trace file */
+  unsigned char *pos;		/* next event to decode */
+  unsigned char *end;		/* end of the current chunk */
+  counter_t chunk;		/* number of the current chunk */
+};
+
+/* create trace file FNAME for writing */
+struct trace_t *				/* trace */
+trace_create(char *fname);			/* trace file name */
+
+/* start the instruction event of an instruction at PC, with opcode OP and
+   instruction flags FLAGS, the memory references made by the instruction
+   follow, and, for control instructions, its outcome (see trace_ctrl()) */
+void
+trace_inst(struct trace_t *t,			/* trace being written */
+	   int flags,				/* instruction flags */
+	   md_addr_t PC,			/* inst address */
+	   enum md_opcode op);			/* inst opcode */
+
+/* record the outcome of the current control instruction */
+void
+trace_ctrl(struct trace_t *t,			/* trace being written */
+	   md_addr_t NPC,			/* next inst address */
+	   md_addr_t target_PC);		/* branch target */
+
+/* record a memory reference of NBYTES at ADDR made by the current
+   instruction, FLAGS are memory reference flags */
+void
+trace_ref(struct trace_t *t,			/* trace being written */
+	  int flags,				/* memory reference flags */
+	  md_addr_t addr,			/* address accessed */
+	  int nbytes);				/* size of the access */
+
+/* finish and close trace T, open for writing or for replay */
+void
+trace_close(struct trace_t *t);			/* trace to close */
+
+/* return non-zero if file FNAME is a trace file */
+int
+trace_valid(char *fname);			/* file name */
+
+/* open trace file FNAME for replay */
+struct trace_t *				/* trace */
+trace_open(char *fname);			/* trace file name */
+
+/* read the next event of trace T into EV, returns zero at the end of the
+   trace */
+int
+trace_read(struct trace_t *t,			/* trace being replayed */
+	   struct trace_ev_t *ev);		/* event read */
+
+/* position trace T at instruction N, i.e., the next event read is the
+   instruction event of the (N+1)-th instruction of the trace */
+void
+trace_seek(struct trace_t *t,			/* trace being replayed */
+	   counter_t n);			/* insts to skip */
+
+#endif /* TRACE_H */